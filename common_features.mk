@@ -38,7 +38,10 @@ ifeq ($(strip $(AUDIO_ENABLE)), yes)
         SRC += $(QUANTUM_DIR)/audio/audio.c
     else
         SRC += $(QUANTUM_DIR)/audio/audio_arm.c
+        SRC += $(QUANTUM_DIR)/audio/mixer.c
     endif
+    SRC += $(QUANTUM_DIR)/audio/sequencer.c
+    SRC += $(QUANTUM_DIR)/audio/synth.c
     SRC += $(QUANTUM_DIR)/audio/voices.c
     SRC += $(QUANTUM_DIR)/audio/luts.c
 endif
@@ -51,6 +54,7 @@ endif
 
 ifeq ($(MUSIC_ENABLE), 1)
     SRC += $(QUANTUM_DIR)/process_keycode/process_music.c
+    SRC += $(QUANTUM_DIR)/process_keycode/music_scheduler.c
 endif
 
 ifeq ($(strip $(COMBO_ENABLE)), yes)
@@ -60,10 +64,16 @@ endif
 
 ifeq ($(strip $(STENO_ENABLE)), yes)
     OPT_DEFS += -DSTENO_ENABLE
-	VIRTSER_ENABLE := yes
+	# The dictionary types on its own, VIRTSER_ENABLE = no drops Bolt and Gemini
+	VIRTSER_ENABLE ?= yes
 	SRC += $(QUANTUM_DIR)/process_keycode/process_steno.c
 endif
 
+ifeq ($(strip $(STENO_DICT_ENABLE)), yes)
+    OPT_DEFS += -DSTENO_DICT_ENABLE
+	SRC += $(QUANTUM_DIR)/process_keycode/process_steno_dict.c
+endif
+
 ifeq ($(strip $(VIRTSER_ENABLE)), yes)
     OPT_DEFS += -DVIRTSER_ENABLE
 endif
@@ -79,6 +89,28 @@ ifeq ($(strip $(POINTING_DEVICE_ENABLE)), yes)
 	SRC += $(QUANTUM_DIR)/pointing_device.c
 endif
 
+ifeq ($(strip $(ACTION_TABLE_ENABLE)), yes)
+    OPT_DEFS += -DACTION_TABLE_ENABLE
+endif
+
+ifeq ($(strip $(RAW_API_ENABLE)), yes)
+    ifneq ($(strip $(RAW_ENABLE)), yes)
+        $(error RAW_API_ENABLE needs RAW_ENABLE = yes)
+    endif
+    OPT_DEFS += -DRAW_API_ENABLE
+    SRC += $(QUANTUM_DIR)/raw_api.c
+endif
+
+ifeq ($(strip $(KEY_TRACE_ENABLE)), yes)
+    OPT_DEFS += -DKEY_TRACE_ENABLE
+    SRC += $(QUANTUM_DIR)/key_trace.c
+endif
+
+ifeq ($(strip $(DYNAMIC_KEYMAP_ENABLE)), yes)
+    OPT_DEFS += -DDYNAMIC_KEYMAP_ENABLE
+    SRC += $(QUANTUM_DIR)/dynamic_keymap.c
+endif
+
 ifeq ($(strip $(UCIS_ENABLE)), yes)
     OPT_DEFS += -DUCIS_ENABLE
     UNICODE_COMMON = yes
@@ -161,6 +193,10 @@ ifeq ($(strip $(BACKLIGHT_ENABLE)), yes)
     endif
 		ifeq ($(strip $(BACKLIGHT_CUSTOM_DRIVER)), yes)
         OPT_DEFS += -DBACKLIGHT_CUSTOM_DRIVER
+    else
+        SRC += $(QUANTUM_DIR)/backlight/backlight_pwm.c
+        CIE1931_CURVE = yes
+        LED_BREATHING_TABLE = yes
     endif
 endif
 
@@ -183,6 +219,11 @@ ifeq ($(strip $(TERMINAL_ENABLE)), yes)
     OPT_DEFS += -DTERMINAL_ENABLE
 endif
 
+ifeq ($(strip $(I2C_MASTER_ENABLE)), yes)
+    OPT_DEFS += -DI2C_MASTER_ENABLE
+    SRC += i2c_master.c
+endif
+
 ifeq ($(strip $(USB_HID_ENABLE)), yes)
     include $(TMK_DIR)/protocol/usb_hid.mk
 endif
@@ -193,6 +234,16 @@ QUANTUM_SRC:= \
     $(QUANTUM_DIR)/keycode_config.c \
     $(QUANTUM_DIR)/process_keycode/process_leader.c
 
-ifndef CUSTOM_MATRIX
+ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
+    OPT_DEFS += -DSPLIT_KEYBOARD
+    QUANTUM_SRC += $(QUANTUM_DIR)/split_common/split_util.c \
+                   $(QUANTUM_DIR)/split_common/transport.c \
+                   $(QUANTUM_DIR)/split_common/i2c.c \
+                   $(QUANTUM_DIR)/split_common/serial.c
+    VPATH += $(QUANTUM_PATH)/split_common
+    ifndef CUSTOM_MATRIX
+        QUANTUM_SRC += $(QUANTUM_DIR)/split_common/matrix.c
+    endif
+else ifndef CUSTOM_MATRIX
     QUANTUM_SRC += $(QUANTUM_DIR)/matrix.c
 endif
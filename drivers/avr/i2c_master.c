@@ -0,0 +1,250 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+#include <stddef.h>
+#include "i2c_master.h"
+#include "timer.h"
+
+#define TWBR_VALUE (((F_CPU / F_SCL) - 16) / 2)
+
+// TWCR values for the next bus action; TWIE stays set while the queue runs
+#define TWCR_START    ((1 << TWINT) | (1 << TWEN) | (1 << TWIE) | (1 << TWSTA))
+#define TWCR_NEXT     ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_NEXT_ACK ((1 << TWINT) | (1 << TWEN) | (1 << TWIE) | (1 << TWEA))
+#define TWCR_STOP     ((1 << TWINT) | (1 << TWEN) | (1 << TWSTO))
+// STOP immediately followed by START of the next queued transaction
+#define TWCR_STOP_START (TWCR_STOP | (1 << TWIE) | (1 << TWSTA))
+
+static i2c_transaction_t *volatile queue_head = NULL;
+static i2c_transaction_t *volatile queue_tail = NULL;
+
+void i2c_init(void) {
+    TWSR = 0; // no prescaler
+    TWBR = (uint8_t)TWBR_VALUE;
+    TWCR = (1 << TWEN);
+}
+
+static inline uint8_t tx_total(const i2c_transaction_t *t) {
+    return t->tx_length + (t->has_reg ? 1 : 0);
+}
+
+static inline uint8_t tx_byte(const i2c_transaction_t *t, uint8_t index) {
+    if (t->has_reg) {
+        if (index == 0) {
+            return t->reg;
+        }
+        index--;
+    }
+    return t->tx_data[index];
+}
+
+// Called from the ISR (or with interrupts disabled) when the head is done.
+static void finish(i2c_status_t status) {
+    i2c_transaction_t *t = queue_head;
+
+    queue_head = t->next;
+    if (!queue_head) {
+        queue_tail = NULL;
+    }
+    t->next = NULL;
+    t->status = status;
+
+    if (queue_head) {
+        queue_head->index = 0;
+        TWCR = TWCR_STOP_START;
+    } else {
+        TWCR = TWCR_STOP;
+    }
+
+    if (t->callback) {
+        t->callback(t);
+    }
+}
+
+ISR(TWI_vect) {
+    i2c_transaction_t *t = queue_head;
+
+    if (!t) {
+        TWCR = TWCR_STOP;
+        return;
+    }
+
+    switch (TW_STATUS) {
+        case TW_START:
+            // a transaction without anything to write starts reading right away
+            TWDR = (t->address << 1) | ((tx_total(t) == 0 && t->rx_length > 0) ? TW_READ : TW_WRITE);
+            TWCR = TWCR_NEXT;
+            break;
+
+        case TW_REP_START:
+            TWDR = (t->address << 1) | TW_READ;
+            TWCR = TWCR_NEXT;
+            break;
+
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (t->index < tx_total(t)) {
+                TWDR = tx_byte(t, t->index++);
+                TWCR = TWCR_NEXT;
+            } else if (t->rx_length) {
+                t->index = 0;
+                TWCR = TWCR_START; // repeated start
+            } else {
+                finish(I2C_STATUS_SUCCESS);
+            }
+            break;
+
+        case TW_MR_SLA_ACK:
+            // ACK every byte but the last one
+            TWCR = t->rx_length > 1 ? TWCR_NEXT_ACK : TWCR_NEXT;
+            break;
+
+        case TW_MR_DATA_ACK:
+            t->rx_data[t->index++] = TWDR;
+            TWCR = (t->rx_length - t->index) > 1 ? TWCR_NEXT_ACK : TWCR_NEXT;
+            break;
+
+        case TW_MR_DATA_NACK:
+            t->rx_data[t->index++] = TWDR;
+            finish(I2C_STATUS_SUCCESS);
+            break;
+
+        case TW_MT_ARB_LOST:
+        case TW_MT_SLA_NACK:
+        case TW_MT_DATA_NACK:
+        case TW_MR_SLA_NACK:
+        default:
+            finish(I2C_STATUS_ERROR);
+            break;
+    }
+}
+
+bool i2c_submit(i2c_transaction_t *transaction) {
+    uint8_t sreg = SREG;
+    cli();
+
+    for (i2c_transaction_t *t = queue_head; t; t = t->next) {
+        if (t == transaction) {
+            SREG = sreg;
+            return false;
+        }
+    }
+
+    transaction->status = I2C_STATUS_PENDING;
+    transaction->index = 0;
+    transaction->next = NULL;
+
+    if (queue_tail) {
+        // the ISR picks it up once the running transaction is done
+        queue_tail->next = transaction;
+        queue_tail = transaction;
+    } else {
+        queue_head = queue_tail = transaction;
+        TWCR = TWCR_START;
+    }
+
+    SREG = sreg;
+    return true;
+}
+
+bool i2c_idle(void) {
+    return queue_head == NULL;
+}
+
+// Gives up on everything queued and returns the TWI to a known state.
+static void i2c_abort(void) {
+    uint8_t sreg = SREG;
+    cli();
+
+    TWCR = 0;
+    i2c_transaction_t *aborted = queue_head;
+    queue_head = queue_tail = NULL;
+    TWCR = (1 << TWEN);
+
+    SREG = sreg;
+
+    // the queue is empty again, so the callbacks may submit
+    while (aborted) {
+        i2c_transaction_t *t = aborted;
+        aborted = t->next;
+        t->next = NULL;
+        t->status = I2C_STATUS_TIMEOUT;
+        if (t->callback) {
+            t->callback(t);
+        }
+    }
+}
+
+i2c_status_t i2c_wait(i2c_transaction_t *transaction, uint16_t timeout) {
+    uint16_t start = timer_read();
+
+    while (transaction->status == I2C_STATUS_PENDING) {
+        if (timeout != I2C_TIMEOUT_INFINITE && timer_elapsed(start) > timeout) {
+            i2c_abort();
+            break;
+        }
+    }
+    return transaction->status;
+}
+
+static i2c_status_t i2c_run(i2c_transaction_t *transaction, uint16_t timeout) {
+    if (!i2c_submit(transaction)) {
+        return I2C_STATUS_ERROR;
+    }
+    return i2c_wait(transaction, timeout);
+}
+
+i2c_status_t i2c_transmit(uint8_t address, const uint8_t *data, uint8_t length, uint16_t timeout) {
+    i2c_transaction_t t = {
+        .address = address,
+        .tx_data = data,
+        .tx_length = length,
+    };
+    return i2c_run(&t, timeout);
+}
+
+i2c_status_t i2c_receive(uint8_t address, uint8_t *data, uint8_t length, uint16_t timeout) {
+    i2c_transaction_t t = {
+        .address = address,
+        .rx_data = data,
+        .rx_length = length,
+    };
+    return i2c_run(&t, timeout);
+}
+
+i2c_status_t i2c_writeReg(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length, uint16_t timeout) {
+    i2c_transaction_t t = {
+        .address = address,
+        .has_reg = true,
+        .reg = reg,
+        .tx_data = data,
+        .tx_length = length,
+    };
+    return i2c_run(&t, timeout);
+}
+
+i2c_status_t i2c_readReg(uint8_t address, uint8_t reg, uint8_t *data, uint8_t length, uint16_t timeout) {
+    i2c_transaction_t t = {
+        .address = address,
+        .has_reg = true,
+        .reg = reg,
+        .rx_data = data,
+        .rx_length = length,
+    };
+    return i2c_run(&t, timeout);
+}
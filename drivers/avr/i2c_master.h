@@ -0,0 +1,96 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Interrupt driven TWI master.
+ *
+ * Transactions are queued and run back to back from the TWI interrupt, so the
+ * caller can submit a port expander read, an OLED frame and an LED update and
+ * go on with the scan while they are clocked out. Each transaction is a write,
+ * a read, or a write followed by a repeated start and a read (the usual
+ * "select register, read it" pattern).
+ *
+ * The transaction structs are owned by the caller and must stay alive until
+ * they are no longer pending; nothing is allocated by the driver.
+ *
+ * i2c_transmit(), i2c_receive(), i2c_writeReg() and i2c_readReg() are
+ * blocking wrappers for code that just wants the result.
+ *
+ * This driver owns TWI_vect, so it can't be linked together with a TWI slave
+ * such as the one used by split keyboards in I2C mode.
+ */
+
+#ifndef I2C_MASTER_H
+#define I2C_MASTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef F_SCL
+#  define F_SCL 400000UL // SCL frequency
+#endif
+
+#define I2C_TIMEOUT_INFINITE 0xFFFF
+
+typedef enum {
+    I2C_STATUS_SUCCESS = 0,
+    I2C_STATUS_PENDING,
+    I2C_STATUS_ERROR,
+    I2C_STATUS_TIMEOUT,
+} i2c_status_t;
+
+struct i2c_transaction;
+typedef void (*i2c_callback_t)(struct i2c_transaction *transaction);
+
+typedef struct i2c_transaction {
+    uint8_t address;            // 7-bit slave address
+    bool has_reg;               // write reg before tx_data
+    uint8_t reg;
+    const uint8_t *tx_data;     // bytes written first, may be NULL
+    uint8_t tx_length;
+    uint8_t *rx_data;           // bytes read afterwards, may be NULL
+    uint8_t rx_length;
+    // Called from the interrupt once the transaction has finished, or from
+    // i2c_wait() when it times out, may be NULL
+    i2c_callback_t callback;
+    volatile i2c_status_t status;
+    // driver private
+    uint8_t index;
+    struct i2c_transaction *next;
+} i2c_transaction_t;
+
+void i2c_init(void);
+
+// Queues a transaction. Returns false if it is already queued.
+bool i2c_submit(i2c_transaction_t *transaction);
+// Blocks until the transaction finished or timeout ms passed. On timeout the
+// bus is reset and every queued transaction fails with I2C_STATUS_TIMEOUT,
+// their callbacks are called.
+// Needs interrupts enabled, so don't call it (or the wrappers) from an ISR.
+i2c_status_t i2c_wait(i2c_transaction_t *transaction, uint16_t timeout);
+// True while no transaction is queued or running.
+bool i2c_idle(void);
+
+static inline bool i2c_pending(const i2c_transaction_t *transaction) {
+    return transaction->status == I2C_STATUS_PENDING;
+}
+
+// Blocking wrappers
+i2c_status_t i2c_transmit(uint8_t address, const uint8_t *data, uint8_t length, uint16_t timeout);
+i2c_status_t i2c_receive(uint8_t address, uint8_t *data, uint8_t length, uint16_t timeout);
+i2c_status_t i2c_writeReg(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length, uint16_t timeout);
+i2c_status_t i2c_readReg(uint8_t address, uint8_t reg, uint8_t *data, uint8_t length, uint16_t timeout);
+
+#endif
@@ -28,6 +28,12 @@
 static uint8_t displaying;
 #endif
 static uint16_t last_flush;
+static bool display_on;
+
+// Text currently shown on the panel, and the rows where it differs from the
+// character matrix. Only those cells are sent on the next flush.
+static uint8_t panel[MatrixRows][MatrixCols];
+static uint8_t dirty_rows;
 
 // Write command sequence.
 // Returns true on success.
@@ -76,6 +82,28 @@ static inline bool _send_cmd3(uint8_t cmd, uint8_t opr1, uint8_t opr2) {
   return _send_cmd1(opr2);
 }
 
+// Write a sequence of commands in one transaction.
+// Returns true on success
+static bool send_cmds(const uint8_t *cmds, uint8_t count) {
+  bool res = false;
+
+  if (i2c_start_write(SSD1306_ADDRESS)) {
+    goto done;
+  }
+  if (i2c_master_write(0x0 /* command bytes follow */)) {
+    goto done;
+  }
+  for (uint8_t i = 0; i < count; ++i) {
+    if (i2c_master_write(cmds[i])) {
+      goto done;
+    }
+  }
+  res = true;
+done:
+  i2c_master_stop();
+  return res;
+}
+
 #define send_cmd1(c) if (!_send_cmd1(c)) {goto done;}
 #define send_cmd2(c,o) if (!_send_cmd2(c,o)) {goto done;}
 #define send_cmd3(c,o1,o2) if (!_send_cmd3(c,o1,o2)) {goto done;}
@@ -101,6 +129,9 @@ static void clear_display(void) {
     }
   }
 
+  // The panel is blank now, which is what a matrix full of spaces looks like
+  memset(panel, ' ', sizeof(panel));
+  dirty_rows = 0;
   display.dirty = false;
 
 done:
@@ -153,6 +184,7 @@ bool iota_gfx_init(void) {
   send_cmd1(NormalDisplay);
   send_cmd1(DeActivateScroll);
   send_cmd1(DisplayOn);
+  display_on = true;
 
   send_cmd2(SetContrast, 0); // Dim
 
@@ -174,6 +206,7 @@ bool iota_gfx_off(void) {
   bool success = false;
 
   send_cmd1(DisplayOff);
+  display_on = false;
   success = true;
 
 done:
@@ -184,6 +217,7 @@ bool iota_gfx_on(void) {
   bool success = false;
 
   send_cmd1(DisplayOn);
+  display_on = true;
   success = true;
 
 done:
@@ -261,16 +295,19 @@ void iota_gfx_clear_screen(void) {
   matrix_clear(&display);
 }
 
-void matrix_render(struct CharacterMatrix *matrix) {
-  last_flush = timer_read();
-  iota_gfx_on();
-#if DEBUG_TO_SCREEN
-  ++displaying;
-#endif
+// Sends a run of characters from one text row. The panel's address window is
+// narrowed to exactly those cells first, so nothing else gets retransmitted.
+static bool render_cells(const uint8_t *chars, uint8_t row, uint8_t col, uint8_t count) {
+  bool success = false;
 
-  // Move to the home position
-  send_cmd3(PageAddr, 0, MatrixRows - 1);
-  send_cmd3(ColumnAddr, 0, (MatrixCols * FontWidth) - 1);
+  // Page and column address ranges in a single command transaction
+  const uint8_t window[] = {
+    PageAddr, row, row,
+    ColumnAddr, col * FontWidth, ((col + count) * FontWidth) - 1,
+  };
+  if (!send_cmds(window, sizeof(window))) {
+    return false;
+  }
 
   if (i2c_start_write(SSD1306_ADDRESS)) {
     goto done;
@@ -280,24 +317,100 @@ void matrix_render(struct CharacterMatrix *matrix) {
     goto done;
   }
 
+  for (uint8_t i = 0; i < count; ++i) {
+    const uint8_t *glyph = font + (chars[i] * (FontWidth - 1));
+
+    for (uint8_t glyphCol = 0; glyphCol < FontWidth - 1; ++glyphCol) {
+      uint8_t colBits = pgm_read_byte(glyph + glyphCol);
+      i2c_master_write(colBits);
+    }
+
+    // 1 column of space between chars (it's not included in the glyph)
+    i2c_master_write(0);
+  }
+  success = true;
+
+done:
+  i2c_master_stop();
+  return success;
+}
+
+// Picks up a new frame from the matrix: every row whose text differs from
+// what is on the panel gets marked for the flush below.
+static void matrix_collect_dirty(struct CharacterMatrix *matrix) {
   for (uint8_t row = 0; row < MatrixRows; ++row) {
-    for (uint8_t col = 0; col < MatrixCols; ++col) {
-      const uint8_t *glyph = font + (matrix->display[row][col] * (FontWidth - 1));
+    if (memcmp(matrix->display[row], panel[row], MatrixCols)) {
+      dirty_rows |= (1 << row);
+    }
+  }
+  matrix->dirty = false;
+}
+
+// Sends changed cells until either everything is on the panel or about
+// max_bytes of glyph data went out. Returns true when the panel is up to date.
+static bool matrix_flush_dirty(struct CharacterMatrix *matrix, uint16_t max_bytes) {
+  uint16_t budget = max_bytes / FontWidth;
+  if (budget == 0) {
+    budget = 1;
+  }
+
+  for (uint8_t row = 0; row < MatrixRows && dirty_rows; ++row) {
+    if (!(dirty_rows & (1 << row))) {
+      continue;
+    }
 
-      for (uint8_t glyphCol = 0; glyphCol < FontWidth - 1; ++glyphCol) {
-        uint8_t colBits = pgm_read_byte(glyph + glyphCol);
-        i2c_master_write(colBits);
+    uint8_t col = 0;
+    while (col < MatrixCols) {
+      if (matrix->display[row][col] == panel[row][col]) {
+        ++col;
+        continue;
       }
 
-      // 1 column of space between chars (it's not included in the glyph)
-      i2c_master_write(0);
+      // Extend the run over changed cells, and over short unchanged gaps,
+      // since resending a blank costs less than a new address window.
+      uint8_t end = col + 1;
+      uint8_t last = col;
+      while (end < MatrixCols && end - last <= SSD1306_MERGE_GAP) {
+        if (matrix->display[row][end] != panel[row][end]) {
+          last = end;
+        }
+        ++end;
+      }
+      uint8_t count = last - col + 1;
+
+      if (budget == 0) {
+        return false;
+      }
+      if (count > budget) {
+        count = budget;
+      }
+      if (!render_cells(&matrix->display[row][col], row, col, count)) {
+        // leave the cells dirty and retry on the next call
+        return false;
+      }
+      memcpy(&panel[row][col], &matrix->display[row][col], count);
+      budget -= count;
+      col += count;
     }
+
+    dirty_rows &= ~(1 << row);
   }
 
-  matrix->dirty = false;
+  return true;
+}
+
+void matrix_render(struct CharacterMatrix *matrix) {
+  last_flush = timer_read();
+  if (!display_on) {
+    iota_gfx_on();
+  }
+#if DEBUG_TO_SCREEN
+  ++displaying;
+#endif
+
+  matrix_collect_dirty(matrix);
+  matrix_flush_dirty(matrix, MatrixRows * MatrixCols * FontWidth);
 
-done:
-  i2c_master_stop();
 #if DEBUG_TO_SCREEN
   --displaying;
 #endif
@@ -315,10 +428,18 @@ void iota_gfx_task(void) {
   iota_gfx_task_user();
 
   if (display.dirty) {
-    iota_gfx_flush();
+    matrix_collect_dirty(&display);
   }
 
-  if (timer_elapsed(last_flush) > ScreenOffInterval) {
+  if (dirty_rows) {
+    // Only send a slice of the frame per call, so the matrix scan isn't held
+    // up for a full-screen transfer.
+    last_flush = timer_read();
+    if (!display_on) {
+      iota_gfx_on();
+    }
+    matrix_flush_dirty(&display, SSD1306_FLUSH_BYTES);
+  } else if (display_on && timer_elapsed(last_flush) > ScreenOffInterval) {
     iota_gfx_off();
   }
 }
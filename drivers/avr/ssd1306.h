@@ -61,6 +61,18 @@ enum ssd1306_cmds {
 #define MatrixRows (DisplayHeight / FontHeight)
 #define MatrixCols (DisplayWidth / FontWidth)
 
+// Upper bound of glyph data iota_gfx_task() sends per call. A changed frame
+// is flushed over several calls instead of blocking for the whole screen.
+#ifndef SSD1306_FLUSH_BYTES
+#define SSD1306_FLUSH_BYTES 48
+#endif
+
+// Unchanged cells between two changed ones that are resent anyway, rather
+// than starting a new address window.
+#ifndef SSD1306_MERGE_GAP
+#define SSD1306_MERGE_GAP 2
+#endif
+
 struct CharacterMatrix {
   uint8_t display[MatrixRows][MatrixCols];
   uint8_t *cursor;
@@ -20,4 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "config_common.h"
 
+// i2c runs at 100kHz on these halves
+#define SCL_CLOCK 100000L
+
 #endif
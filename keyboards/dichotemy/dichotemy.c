@@ -37,16 +37,10 @@ void pointing_device_task(void){
 	//We can use this to verify the report sent properly.
     if (uart_data[4] == 0x0F || uart_data[4] == 0x8F)
     {
+        //the movement adds up until the next report goes out
+		pointing_device_move((int8_t)uart_data[0], (int8_t)uart_data[1]);
+		pointing_device_scroll((int8_t)uart_data[2], (int8_t)uart_data[3]);
 		currentReport = pointing_device_get_report();
-        //shifting and transferring the info to the mouse report varaible
-        //mouseReport.x = 127 max -127 min
-		currentReport.x = uart_data[0];
-        //mouseReport.y = 127 max -127 min
-		currentReport.y = uart_data[1];
-        //mouseReport.v = 127 max -127 min (scroll vertical)
-		currentReport.v = uart_data[2];
-        //mouseReport.h = 127 max -127 min (scroll horizontal)
-		currentReport.h = uart_data[3];
         //mouseReport.buttons = 0x31 max (bitmask for mouse buttons 1-5) 0x00 min
 		//mouse buttons 1 and 2 are handled by the keymap, but not 3
 		if (uart_data[4] == 0x0F) { //then 3 is not pressed
@@ -1,5 +1,4 @@
 #include QMK_KEYBOARD_H
-#include "i2cmaster.h"
 
 
 extern inline void ergodox_board_led_on(void);
@@ -124,24 +123,18 @@ uint8_t init_mcp23018(void) {
     // - unused  : input  : 1
     // - input   : input  : 1
     // - driving : output : 0
-    mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(IODIRA);            if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(0b00000000);        if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(0b00111111);        if (mcp23018_status) goto out;
-    i2c_stop();
+    static const uint8_t iodir[] = { 0b00000000, 0b00111111 };
+    mcp23018_status = i2c_writeReg(I2C_ADDR, IODIRA, iodir, sizeof(iodir), I2C_TIMEOUT);
+    if (mcp23018_status) goto out;
 
     // set pull-up
     // - unused  : on  : 1
     // - input   : on  : 1
     // - driving : off : 0
-    mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(GPPUA);             if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(0b00000000);        if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(0b00111111);        if (mcp23018_status) goto out;
+    static const uint8_t gppu[] = { 0b00000000, 0b00111111 };
+    mcp23018_status = i2c_writeReg(I2C_ADDR, GPPUA, gppu, sizeof(gppu), I2C_TIMEOUT);
 
 out:
-    i2c_stop();
-
 #ifdef LEFT_LEDS
     if (!mcp23018_status) mcp23018_status = ergodox_left_leds_update();
 #endif // LEFT_LEDS
@@ -164,22 +157,12 @@ uint8_t ergodox_left_leds_update(void) {
     // - unused  : hi-Z : 1
     // - input   : hi-Z : 1
     // - driving : hi-Z : 1
-    mcp23018_status = i2c_start(I2C_ADDR_WRITE);
-    if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(OLATA);
-    if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(0b11111111
-                                & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT)
-                                );
-    if (mcp23018_status) goto out;
-    mcp23018_status = i2c_write(0b11111111
-                                & ~(ergodox_left_led_2<<LEFT_LED_2_SHIFT)
-                                & ~(ergodox_left_led_1<<LEFT_LED_1_SHIFT)
-                                );
-    if (mcp23018_status) goto out;
-
- out:
-    i2c_stop();
+    uint8_t olat[] = {
+        0b11111111 & ~(ergodox_left_led_3<<LEFT_LED_3_SHIFT),
+        0b11111111 & ~(ergodox_left_led_2<<LEFT_LED_2_SHIFT)
+                   & ~(ergodox_left_led_1<<LEFT_LED_1_SHIFT),
+    };
+    mcp23018_status = i2c_writeReg(I2C_ADDR, OLATA, olat, sizeof(olat), I2C_TIMEOUT);
     return mcp23018_status;
 }
 #endif
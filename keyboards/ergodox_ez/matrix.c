@@ -34,7 +34,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util.h"
 #include "matrix.h"
 #include QMK_KEYBOARD_H
-#include "i2cmaster.h"
+#include "i2c_master.h"
 #ifdef DEBUG_MATRIX_SCAN_RATE
 #include  "timer.h"
 #endif
@@ -68,9 +68,15 @@ static matrix_row_t read_cols(uint8_t row);
 static void init_cols(void);
 static void unselect_rows(void);
 static void select_row(uint8_t row);
+static void mcp23018_scan_row_start(uint8_t row);
+static matrix_row_t mcp23018_scan_row_finish(void);
 
 static uint8_t mcp23018_reset_loop;
 
+#ifdef LEFT_LEDS
+static uint8_t left_leds_sent;
+#endif
+
 #ifdef DEBUG_MATRIX_SCAN_RATE
 uint32_t matrix_timer;
 uint32_t matrix_scan_count;
@@ -205,16 +211,25 @@ uint8_t matrix_scan(void)
 #endif
 
 #ifdef LEFT_LEDS
-    mcp23018_status = ergodox_left_leds_update();
+    // only talk to the mcp23018 about the leds when they changed
+    uint8_t left_leds = ergodox_left_led_1 | (ergodox_left_led_2 << 1) | (ergodox_left_led_3 << 2);
+    if (left_leds != left_leds_sent) {
+        mcp23018_status = ergodox_left_leds_update();
+        if (!mcp23018_status) {
+            left_leds_sent = left_leds;
+        }
+    }
 #endif // LEFT_LEDS
     for (uint8_t i = 0; i < MATRIX_ROWS_PER_SIDE; i++) {
-        select_row(i);
-        // and select on left hand
+        // Select the left hand row and read it back in one i2c transaction,
+        // which runs in the background while the right hand row is selected.
+        mcp23018_scan_row_start(i);
         select_row(i + MATRIX_ROWS_PER_SIDE);
-        // we don't need a 30us delay anymore, because selecting a
-        // left-hand row requires more than 30us for i2c.
+        // we don't need a 30us delay anymore, because waiting for the
+        // left-hand row takes more than 30us for i2c.
+        matrix_row_t left_cols = mcp23018_scan_row_finish();
         matrix_row_t mask = debounce_mask(i);
-        matrix_row_t cols = (read_cols(i) & mask) | (matrix[i] & ~mask);
+        matrix_row_t cols = (left_cols & mask) | (matrix[i] & ~mask);
         debounce_report(cols ^ matrix[i], i);
         matrix[i] = cols;
         // grab cols from right hand
@@ -287,31 +302,66 @@ static void  init_cols(void)
     PORTF |=  (1<<7 | 1<<6 | 1<<5 | 1<<4 | 1<<1 | 1<<0);
 }
 
-static matrix_row_t read_cols(uint8_t row)
+/* Left hand scan, one i2c transaction per row:
+ *
+ *   S addr+W  GPIOA  row  Sr addr+R  GPIOB  P
+ *
+ * Writing GPIOA selects the row, and since sequential addressing is on the
+ * register pointer then moves on to GPIOB, so the read after the repeated
+ * start returns the columns. The row has a full address byte to settle before
+ * the columns are sampled.
+ */
+static uint8_t mcp23018_row;
+static uint8_t mcp23018_cols;
+static i2c_transaction_t mcp23018_scan = {
+    .address = I2C_ADDR,
+    .has_reg = true,
+    .reg = GPIOA,
+    .tx_data = &mcp23018_row,
+    .tx_length = 1,
+    .rx_data = &mcp23018_cols,
+    .rx_length = 1,
+};
+
+static void mcp23018_scan_row_start(uint8_t row)
 {
-    if (row < 7) {
-        if (mcp23018_status) { // if there was an error
-            return 0;
-        } else {
-            uint8_t data = 0;
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);    if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOB);             if (mcp23018_status) goto out;
-            mcp23018_status = i2c_start(I2C_ADDR_READ);     if (mcp23018_status) goto out;
-            data = i2c_readNak();
-            data = ~data;
-        out:
-            i2c_stop();
-            return data;
-        }
-    } else {
-        /* read from teensy
-	 * bitmask is 0b11110011, but we want those all
-	 * in the lower six bits.
-	 * we'll return 1s for the top two, but that's harmless.
-	 */
+    if (mcp23018_status) { // if there was an error
+        return;
+    }
 
-        return ~((PINF & 0x03) | ((PINF & 0xF0) >> 2));
+    // set active row low  : 0
+    // set other rows hi-Z : 1
+    mcp23018_row = 0xFF & ~(1<<row);
+#ifdef LEFT_LEDS
+    // A7 drives the third led, keep it as it is
+    mcp23018_row &= ~(ergodox_left_led_3<<7);
+#endif
+    i2c_submit(&mcp23018_scan);
+}
+
+static matrix_row_t mcp23018_scan_row_finish(void)
+{
+    if (mcp23018_status) { // if there was an error
+        return 0;
     }
+
+    mcp23018_status = i2c_wait(&mcp23018_scan, I2C_TIMEOUT);
+    if (mcp23018_status) {
+        return 0;
+    }
+    return (uint8_t)~mcp23018_cols;
+}
+
+// the left hand is read by mcp23018_scan_row_finish()
+static matrix_row_t read_cols(uint8_t row)
+{
+    /* read from teensy
+     * bitmask is 0b11110011, but we want those all
+     * in the lower six bits.
+     * we'll return 1s for the top two, but that's harmless.
+     */
+
+    return ~((PINF & 0x03) | ((PINF & 0xF0) >> 2));
 }
 
 /* Row pin configuration
@@ -342,52 +392,38 @@ static void unselect_rows(void)
 
 static void select_row(uint8_t row)
 {
-    if (row < 7) {
-        // select on mcp23018
-        if (mcp23018_status) { // if there was an error
-            // do nothing
-        } else {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            mcp23018_status = i2c_start(I2C_ADDR_WRITE);        if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(GPIOA);                 if (mcp23018_status) goto out;
-            mcp23018_status = i2c_write(0xFF & ~(1<<row));      if (mcp23018_status) goto out;
-        out:
-            i2c_stop();
-        }
-    } else {
-        // select on teensy
-        // Output low(DDR:1, PORT:0) to select
-        switch (row) {
-            case 7:
-                DDRB  |= (1<<0);
-                PORTB &= ~(1<<0);
-                break;
-            case 8:
-                DDRB  |= (1<<1);
-                PORTB &= ~(1<<1);
-                break;
-            case 9:
-                DDRB  |= (1<<2);
-                PORTB &= ~(1<<2);
-                break;
-            case 10:
-                DDRB  |= (1<<3);
-                PORTB &= ~(1<<3);
-                break;
-            case 11:
-                DDRD  |= (1<<2);
-                PORTD &= ~(1<<3);
-                break;
-            case 12:
-                DDRD  |= (1<<3);
-                PORTD &= ~(1<<3);
-                break;
-            case 13:
-                DDRC  |= (1<<6);
-                PORTC &= ~(1<<6);
-                break;
-        }
+    // rows on the mcp23018 are selected by mcp23018_scan_row_start()
+    // select on teensy
+    // Output low(DDR:1, PORT:0) to select
+    switch (row) {
+        case 7:
+            DDRB  |= (1<<0);
+            PORTB &= ~(1<<0);
+            break;
+        case 8:
+            DDRB  |= (1<<1);
+            PORTB &= ~(1<<1);
+            break;
+        case 9:
+            DDRB  |= (1<<2);
+            PORTB &= ~(1<<2);
+            break;
+        case 10:
+            DDRB  |= (1<<3);
+            PORTB &= ~(1<<3);
+            break;
+        case 11:
+            DDRD  |= (1<<2);
+            PORTD &= ~(1<<3);
+            break;
+        case 12:
+            DDRD  |= (1<<3);
+            PORTD &= ~(1<<3);
+            break;
+        case 13:
+            DDRC  |= (1<<6);
+            PORTC &= ~(1<<6);
+            break;
     }
 }
 
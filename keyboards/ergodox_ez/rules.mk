@@ -15,8 +15,7 @@
 #----------------------------------------------------------------------------
 
 # # project specific files
-SRC = twimaster.c \
-	  matrix.c
+SRC = matrix.c
 
 # MCU name
 MCU = atmega32u4
@@ -77,6 +76,7 @@ EXTRAKEY_ENABLE  = yes # Audio control and System control(+450)
 CONSOLE_ENABLE   = no  # Console for debug(+400)
 COMMAND_ENABLE   = yes # Commands for debug and configuration
 CUSTOM_MATRIX    = yes # Custom matrix file for the ErgoDox EZ
+I2C_MASTER_ENABLE = yes # Interrupt driven i2c, talks to the MCP23018 on the left hand
 NKRO_ENABLE      = yes # USB Nkey Rollover - if this doesn't work, see here: https://github.com/tmk/tmk_keyboard/wiki/FAQ#nkro-doesnt-work
 UNICODE_ENABLE   = yes # Unicode
 SWAP_HANDS_ENABLE= yes # Allow swapping hands of keyboard
@@ -71,6 +71,13 @@ void process_api(uint16_t length, uint8_t * data) {
                     #endif
                     break;
                 }
+                case DT_KEYMAP: {
+                    // layer, row, col, keycode (big endian), acked with the keycode read back
+                    #ifdef DYNAMIC_KEYMAP_ENABLE
+                        dynamic_keymap_set_keycode(data[2], data[3], data[4], (data[5] << 8) | data[6]);
+                    #endif
+                    break;
+                }
             }
         case MT_GET_DATA:
             switch (data[1]) {
@@ -79,12 +86,12 @@ void process_api(uint16_t length, uint8_t * data) {
                     break;
                 }
                 case DT_DEBUG: {
-                    uint8_t debug_bytes[1] = { eeprom_read_byte(EECONFIG_DEBUG) };
+                    uint8_t debug_bytes[1] = { eeconfig_read_byte(EECONFIG_DEBUG) };
                     MT_GET_DATA_ACK(DT_DEBUG, debug_bytes, 1);
                     break;
                 }
                 case DT_DEFAULT_LAYER: {
-                    uint8_t default_bytes[1] = { eeprom_read_byte(EECONFIG_DEFAULT_LAYER) };
+                    uint8_t default_bytes[1] = { eeconfig_read_byte(EECONFIG_DEFAULT_LAYER) };
                     MT_GET_DATA_ACK(DT_DEFAULT_LAYER, default_bytes, 1);
                     break;
                 }
@@ -96,7 +103,7 @@ void process_api(uint16_t length, uint8_t * data) {
                 }
                 case DT_AUDIO: {
                     #ifdef AUDIO_ENABLE
-                        uint8_t audio_bytes[1] = { eeprom_read_byte(EECONFIG_AUDIO) };
+                        uint8_t audio_bytes[1] = { eeconfig_read_byte(EECONFIG_AUDIO) };
                         MT_GET_DATA_ACK(DT_AUDIO, audio_bytes, 1);
                     #else
                         MT_GET_DATA_ACK(DT_AUDIO, NULL, 0);
@@ -105,7 +112,7 @@ void process_api(uint16_t length, uint8_t * data) {
                 }
                 case DT_BACKLIGHT: {
                     #ifdef BACKLIGHT_ENABLE
-                        uint8_t backlight_bytes[1] = { eeprom_read_byte(EECONFIG_BACKLIGHT) };
+                        uint8_t backlight_bytes[1] = { eeconfig_read_byte(EECONFIG_BACKLIGHT) };
                         MT_GET_DATA_ACK(DT_BACKLIGHT, backlight_bytes, 1);
                     #else
                         MT_GET_DATA_ACK(DT_BACKLIGHT, NULL, 0);
@@ -132,29 +139,18 @@ void process_api(uint16_t length, uint8_t * data) {
                     MT_GET_DATA_ACK(DT_KEYMAP_SIZE, keymap_size, 2);
                     break;
                 }
-                // This may be too much
-                // case DT_KEYMAP: {
-                //     uint8_t keymap_data[MATRIX_ROWS * MATRIX_COLS * 4 + 3];
-                //     keymap_data[0] = data[2];
-                //     keymap_data[1] = MATRIX_ROWS;
-                //     keymap_data[2] = MATRIX_COLS;
-                //     for (int i = 0; i < MATRIX_ROWS; i++) {
-                //         for (int j = 0; j < MATRIX_COLS; j++) {
-                //             keymap_data[3 + (i*MATRIX_COLS*2) + (j*2)] = pgm_read_word(&keymaps[data[2]][i][j]) >> 8;
-                //             keymap_data[3 + (i*MATRIX_COLS*2) + (j*2) + 1] = pgm_read_word(&keymaps[data[2]][i][j]) & 0xFF;
-                //         }
-                //     }
-                //     MT_GET_DATA_ACK(DT_KEYMAP, keymap_data, MATRIX_ROWS * MATRIX_COLS * 4 + 3);
-                //     // uint8_t keymap_data[5];
-                //     // keymap_data[0] = data[2];
-                //     // keymap_data[1] = data[3];
-                //     // keymap_data[2] = data[4];
-                //     // keymap_data[3] = pgm_read_word(&keymaps[data[2]][data[3]][data[4]]) >> 8;
-                //     // keymap_data[4] = pgm_read_word(&keymaps[data[2]][data[3]][data[4]]) & 0xFF;
-
-                //     // MT_GET_DATA_ACK(DT_KEYMAP, keymap_data, 5);
-                //     break;
-                // }
+                case DT_KEYMAP: {
+                    // layer, row, col, keycode (big endian)
+                    if (data[3] >= MATRIX_ROWS || data[4] >= MATRIX_COLS) {
+                        MT_GET_DATA_ACK(DT_KEYMAP, NULL, 0);
+                        break;
+                    }
+                    keypos_t key = { .row = data[3], .col = data[4] };
+                    uint16_t keycode = keymap_key_to_keycode(data[2], key);
+                    uint8_t keymap_bytes[5] = { data[2], data[3], data[4], keycode >> 8, keycode & 0xFF };
+                    MT_GET_DATA_ACK(DT_KEYMAP, keymap_bytes, 5);
+                    break;
+                }
                 default:
                     break;
             }
@@ -24,6 +24,9 @@
 #endif
 #include "print.h"
 #include "audio.h"
+#include "synth.h"
+#include "sequencer.h"
+#include "timer.h"
 #include "keymap.h"
 #include "wait.h"
 
@@ -113,51 +116,32 @@
 // -----------------------------------------------------------------------------
 
 
-int voices = 0;
-int voice_place = 0;
-float frequency = 0;
-float frequency_alt = 0;
-int volume = 0;
-long position = 0;
+static synth_t synth;
 
-float frequencies[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-int volumes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-bool sliding = false;
-
-float place = 0;
-
-uint8_t * sample;
-uint16_t sample_length = 0;
-
-bool     playing_notes = false;
 bool     playing_note = false;
-float    note_frequency = 0;
-float    note_length = 0;
 uint8_t  note_tempo = TEMPO_DEFAULT;
-float    note_timbre = TIMBRE_DEFAULT;
-uint16_t note_position = 0;
-float (* notes_pointer)[][2];
-uint16_t notes_count;
-bool     notes_repeat;
-bool     note_resting = false;
 
-uint8_t current_note = 0;
-uint8_t rest_counter = 0;
+// The float side of the settings, kept for voice_envelope() and the setters
+float    note_timbre = TIMBRE_DEFAULT;
+float    polyphony_rate = 0;
+uint16_t envelope_index = 0;
+bool     glissando = true;
 
 #ifdef VIBRATO_ENABLE
-float vibrato_counter = 0;
 float vibrato_strength = .5;
 float vibrato_rate = 0.125;
 #endif
 
-float polyphony_rate = 0;
-
 static bool audio_initialized = false;
 
-audio_config_t audio_config;
+#ifdef VIBRATO_ENABLE
+static void update_vibrato(void) {
+    synth.vibrato_rate = synth_q8(vibrato_rate);
+    synth.vibrato_strength = synth_q8(vibrato_strength);
+}
+#endif
 
-uint16_t envelope_index = 0;
-bool glissando = true;
+audio_config_t audio_config;
 
 #ifndef STARTUP_SONG
     #define STARTUP_SONG SONG(STARTUP_SOUND)
@@ -168,9 +152,9 @@ bool glissando = true;
 #ifndef AUDIO_OFF_SONG
     #define AUDIO_OFF_SONG SONG(AUDIO_OFF_SOUND)
 #endif
-float startup_song[][2] = STARTUP_SONG;
-float audio_on_song[][2] = AUDIO_ON_SONG;
-float audio_off_song[][2] = AUDIO_OFF_SONG;
+const song_note_t startup_song[] PROGMEM = STARTUP_SONG;
+const song_note_t audio_on_song[] PROGMEM = AUDIO_ON_SONG;
+const song_note_t audio_off_song[] PROGMEM = AUDIO_OFF_SONG;
 
 void audio_init()
 {
@@ -230,11 +214,15 @@ void audio_init()
             TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (440 * CPU_PRESCALER)) * note_timbre);
         #endif 
 
+        synth_init(&synth);
+        #ifdef VIBRATO_ENABLE
+            update_vibrato();
+        #endif
         audio_initialized = true;
     }
 
     if (audio_config.enable) {
-        PLAY_SONG(startup_song);
+        PLAY_COMPACT_SONG(startup_song);
     }
     
 }
@@ -246,7 +234,6 @@ void stop_all_notes()
     if (!audio_initialized) {
         audio_init();
     }
-    voices = 0;
 
     #ifdef CPIN_AUDIO
         DISABLE_AUDIO_COUNTER_3_ISR;
@@ -258,47 +245,19 @@ void stop_all_notes()
         DISABLE_AUDIO_COUNTER_1_OUTPUT;
     #endif
 
-    playing_notes = false;
+    sequencer_stop();
     playing_note = false;
-    frequency = 0;
-    frequency_alt = 0;
-    volume = 0;
-
-    for (uint8_t i = 0; i < 8; i++)
-    {
-        frequencies[i] = 0;
-        volumes[i] = 0;
-    }
+    synth_all_notes_off(&synth);
 }
 
-void stop_note(float freq)
+static void note_off(float freq, uint8_t owner)
 {
-    dprintf("audio stop note freq=%d", (int)freq);
-
     if (playing_note) {
         if (!audio_initialized) {
             audio_init();
         }
-        for (int i = 7; i >= 0; i--) {
-            if (frequencies[i] == freq) {
-                frequencies[i] = 0;
-                volumes[i] = 0;
-                for (int j = i; (j < 7); j++) {
-                    frequencies[j] = frequencies[j+1];
-                    frequencies[j+1] = 0;
-                    volumes[j] = volumes[j+1];
-                    volumes[j+1] = 0;
-                }
-                break;
-            }
-        }
-        voices--;
-        if (voices < 0)
-            voices = 0;
-        if (voice_place >= voices) {
-            voice_place = 0;
-        }
-        if (voices == 0) {
+        synth_note_off(&synth, freq, owner);
+        if (synth.voices == 0) {
             #ifdef CPIN_AUDIO
                 DISABLE_AUDIO_COUNTER_3_ISR;
                 DISABLE_AUDIO_COUNTER_3_OUTPUT;
@@ -307,211 +266,39 @@ void stop_note(float freq)
                 DISABLE_AUDIO_COUNTER_1_ISR;
                 DISABLE_AUDIO_COUNTER_1_OUTPUT;
             #endif
-            frequency = 0;
-            frequency_alt = 0;
-            volume = 0;
             playing_note = false;
         }
     }
 }
 
-#ifdef VIBRATO_ENABLE
-
-float mod(float a, int b)
+void stop_note(float freq)
 {
-    float r = fmod(a, b);
-    return r < 0 ? r + b : r;
-}
-
-float vibrato(float average_freq) {
-    #ifdef VIBRATO_STRENGTH_ENABLE
-        float vibrated_freq = average_freq * pow(vibrato_lut[(int)vibrato_counter], vibrato_strength);
-    #else
-        float vibrated_freq = average_freq * vibrato_lut[(int)vibrato_counter];
-    #endif
-    vibrato_counter = mod((vibrato_counter + vibrato_rate * (1.0 + 440.0/average_freq)), VIBRATO_LUT_LENGTH);
-    return vibrated_freq;
+    dprintf("audio stop note freq=%d", (int)freq);
+    note_off(freq, SYNTH_OWNER_KEY);
 }
 
-#endif
-
 #ifdef CPIN_AUDIO
 ISR(TIMER3_AUDIO_vect)
 {
-    float freq;
+    synth_output_t out;
 
-    if (playing_note) {
-        if (voices > 0) {
-
-            #ifdef BPIN_AUDIO
-            float freq_alt = 0;
-                if (voices > 1) {
-                    if (polyphony_rate == 0) {
-                        if (glissando) {
-                            if (frequency_alt != 0 && frequency_alt < frequencies[voices - 2] && frequency_alt < frequencies[voices - 2] * pow(2, -440/frequencies[voices - 2]/12/2)) {
-                                frequency_alt = frequency_alt * pow(2, 440/frequency_alt/12/2);
-                            } else if (frequency_alt != 0 && frequency_alt > frequencies[voices - 2] && frequency_alt > frequencies[voices - 2] * pow(2, 440/frequencies[voices - 2]/12/2)) {
-                                frequency_alt = frequency_alt * pow(2, -440/frequency_alt/12/2);
-                            } else {
-                                frequency_alt = frequencies[voices - 2];
-                            }
-                        } else {
-                            frequency_alt = frequencies[voices - 2];
-                        }
-
-                        #ifdef VIBRATO_ENABLE
-                            if (vibrato_strength > 0) {
-                                freq_alt = vibrato(frequency_alt);
-                            } else {
-                                freq_alt = frequency_alt;
-                            }
-                        #else
-                            freq_alt = frequency_alt;
-                        #endif
-                    }
-
-                    if (envelope_index < 65535) {
-                        envelope_index++;
-                    }
-
-                    freq_alt = voice_envelope(freq_alt);
-
-                    if (freq_alt < 30.517578125) {
-                        freq_alt = 30.52;
-                    }
-
-                    TIMER_1_PERIOD = (uint16_t)(((float)F_CPU) / (freq_alt * CPU_PRESCALER));
-                    TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq_alt * CPU_PRESCALER)) * note_timbre);
-                }
-            #endif
-
-            if (polyphony_rate > 0) {
-                if (voices > 1) {
-                    voice_place %= voices;
-                    if (place++ > (frequencies[voice_place] / polyphony_rate / CPU_PRESCALER)) {
-                        voice_place = (voice_place + 1) % voices;
-                        place = 0.0;
-                    }
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequencies[voice_place]);
-                    } else {
-                        freq = frequencies[voice_place];
-                    }
-                #else
-                    freq = frequencies[voice_place];
-                #endif
-            } else {
-                if (glissando) {
-                    if (frequency != 0 && frequency < frequencies[voices - 1] && frequency < frequencies[voices - 1] * pow(2, -440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, 440/frequency/12/2);
-                    } else if (frequency != 0 && frequency > frequencies[voices - 1] && frequency > frequencies[voices - 1] * pow(2, 440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, -440/frequency/12/2);
-                    } else {
-                        frequency = frequencies[voices - 1];
-                    }
-                } else {
-                    frequency = frequencies[voices - 1];
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequency);
-                    } else {
-                        freq = frequency;
-                    }
-                #else
-                    freq = frequency;
-                #endif
-            }
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-
-            freq = voice_envelope(freq);
-
-            if (freq < 30.517578125) {
-                freq = 30.52;
-            }
-
-            TIMER_3_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_3_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        }
-    }
-
-    if (playing_notes) {
-        if (note_frequency > 0) {
-            #ifdef VIBRATO_ENABLE
-                if (vibrato_strength > 0) {
-                    freq = vibrato(note_frequency);
-                } else {
-                    freq = note_frequency;
-                }
-            #else
-                    freq = note_frequency;
-            #endif
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-            freq = voice_envelope(freq);
-
-            TIMER_3_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_3_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        } else {
-            TIMER_3_PERIOD = 0;
-            TIMER_3_DUTY_CYCLE = 0;
-        }
-
-        note_position++;
-        bool end_of_note = false;
-        if (TIMER_3_PERIOD > 0) {
-            if (!note_resting) 
-                end_of_note = (note_position >= (note_length / TIMER_3_PERIOD * 0xFFFF - 1));
-            else
-                end_of_note = (note_position >= (note_length));
-        } else {
-            end_of_note = (note_position >= (note_length));
-        }
-
-        if (end_of_note) {
-            current_note++;
-            if (current_note >= notes_count) {
-                if (notes_repeat) {
-                    current_note = 0;
-                } else {
-                    DISABLE_AUDIO_COUNTER_3_ISR;
-                    DISABLE_AUDIO_COUNTER_3_OUTPUT;
-                    playing_notes = false;
-                    return;
-                }
-            }
-            if (!note_resting) {
-                note_resting = true;
-                current_note--;
-                if ((*notes_pointer)[current_note][0] == (*notes_pointer)[current_note + 1][0]) {
-                    note_frequency = 0;
-                    note_length = 1;
-                } else {
-                    note_frequency = (*notes_pointer)[current_note][0];
-                    note_length = 1;
-                }
-            } else {
-                note_resting = false;
-                envelope_index = 0;
-                note_frequency = (*notes_pointer)[current_note][0];
-                note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
+    if (playing_note && synth.voices > 0) {
+        #ifdef BPIN_AUDIO
+            synth_output_t alt;
+            synth_step(&synth, &out, &alt);
+            if (synth.voices > 1) {
+                TIMER_1_PERIOD = alt.period;
+                TIMER_1_DUTY_CYCLE = alt.duty;
             }
-
-            note_position = 0;
-        }
+        #else
+            synth_step(&synth, &out, NULL);
+        #endif
+        TIMER_3_PERIOD = out.period;
+        TIMER_3_DUTY_CYCLE = out.duty;
     }
 
-    if (!audio_config.enable) {
-        playing_notes = false;
+    // audio_off() lets its song play out
+    if (!audio_config.enable && !sequencer_playing()) {
         playing_note = false;
     }
 }
@@ -521,152 +308,33 @@ ISR(TIMER3_AUDIO_vect)
 ISR(TIMER1_AUDIO_vect)
 {
     #if defined(BPIN_AUDIO) && !defined(CPIN_AUDIO)
-    float freq = 0;
+    synth_output_t out;
 
-    if (playing_note) {
-        if (voices > 0) {
-            if (polyphony_rate > 0) {
-                if (voices > 1) {
-                    voice_place %= voices;
-                    if (place++ > (frequencies[voice_place] / polyphony_rate / CPU_PRESCALER)) {
-                        voice_place = (voice_place + 1) % voices;
-                        place = 0.0;
-                    }
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequencies[voice_place]);
-                    } else {
-                        freq = frequencies[voice_place];
-                    }
-                #else
-                    freq = frequencies[voice_place];
-                #endif
-            } else {
-                if (glissando) {
-                    if (frequency != 0 && frequency < frequencies[voices - 1] && frequency < frequencies[voices - 1] * pow(2, -440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, 440/frequency/12/2);
-                    } else if (frequency != 0 && frequency > frequencies[voices - 1] && frequency > frequencies[voices - 1] * pow(2, 440/frequencies[voices - 1]/12/2)) {
-                        frequency = frequency * pow(2, -440/frequency/12/2);
-                    } else {
-                        frequency = frequencies[voices - 1];
-                    }
-                } else {
-                    frequency = frequencies[voices - 1];
-                }
-
-                #ifdef VIBRATO_ENABLE
-                    if (vibrato_strength > 0) {
-                        freq = vibrato(frequency);
-                    } else {
-                        freq = frequency;
-                    }
-                #else
-                    freq = frequency;
-                #endif
-            }
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-
-            freq = voice_envelope(freq);
-
-            if (freq < 30.517578125) {
-                freq = 30.52;
-            }
-
-            TIMER_1_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        }
-    }
-
-    if (playing_notes) {
-        if (note_frequency > 0) {
-            #ifdef VIBRATO_ENABLE
-                if (vibrato_strength > 0) {
-                    freq = vibrato(note_frequency);
-                } else {
-                    freq = note_frequency;
-                }
-            #else
-                    freq = note_frequency;
-            #endif
-
-            if (envelope_index < 65535) {
-                envelope_index++;
-            }
-            freq = voice_envelope(freq);
-
-            TIMER_1_PERIOD = (uint16_t)(((float)F_CPU) / (freq * CPU_PRESCALER));
-            TIMER_1_DUTY_CYCLE = (uint16_t)((((float)F_CPU) / (freq * CPU_PRESCALER)) * note_timbre);
-        } else {
-            TIMER_1_PERIOD = 0;
-            TIMER_1_DUTY_CYCLE = 0;
-        }
-
-        note_position++;
-        bool end_of_note = false;
-        if (TIMER_1_PERIOD > 0) {
-            if (!note_resting) 
-                end_of_note = (note_position >= (note_length / TIMER_1_PERIOD * 0xFFFF - 1));
-            else
-                end_of_note = (note_position >= (note_length));
-        } else {
-            end_of_note = (note_position >= (note_length));
-        }
-
-        if (end_of_note) {
-            current_note++;
-            if (current_note >= notes_count) {
-                if (notes_repeat) {
-                    current_note = 0;
-                } else {
-                    DISABLE_AUDIO_COUNTER_1_ISR;
-                    DISABLE_AUDIO_COUNTER_1_OUTPUT;
-                    playing_notes = false;
-                    return;
-                }
-            }
-            if (!note_resting) {
-                note_resting = true;
-                current_note--;
-                if ((*notes_pointer)[current_note][0] == (*notes_pointer)[current_note + 1][0]) {
-                    note_frequency = 0;
-                    note_length = 1;
-                } else {
-                    note_frequency = (*notes_pointer)[current_note][0];
-                    note_length = 1;
-                }
-            } else {
-                note_resting = false;
-                envelope_index = 0;
-                note_frequency = (*notes_pointer)[current_note][0];
-                note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-            }
-
-            note_position = 0;
-        }
+    if (playing_note && synth.voices > 0) {
+        synth_step(&synth, &out, NULL);
+        TIMER_1_PERIOD = out.period;
+        TIMER_1_DUTY_CYCLE = out.duty;
     }
 
-    if (!audio_config.enable) {
-        playing_notes = false;
+    // audio_off() lets its song play out
+    if (!audio_config.enable && !sequencer_playing()) {
         playing_note = false;
     }
 #endif
 }
 #endif
 
-void play_note(float freq, int vol) {
-
-    dprintf("audio play note freq=%d vol=%d", (int)freq, vol);
-
+static void note_on(float freq, uint8_t owner)
+{
     if (!audio_initialized) {
         audio_init();
     }
 
-    if (audio_config.enable && voices < 8) {
+    // Songs are only queued while audio is on, apart from the one audio_off()
+    // plays on its way out
+    bool enabled = audio_config.enable || owner == SYNTH_OWNER_SONG;
+
+    if (enabled && synth.voices < SYNTH_MAX_VOICES) {
         #ifdef CPIN_AUDIO
             DISABLE_AUDIO_COUNTER_3_ISR;
         #endif
@@ -674,19 +342,8 @@ void play_note(float freq, int vol) {
             DISABLE_AUDIO_COUNTER_1_ISR;
         #endif
 
-        // Cancel notes if notes are playing
-        if (playing_notes)
-            stop_all_notes();
-
         playing_note = true;
-
-        envelope_index = 0;
-
-        if (freq > 0) {
-            frequencies[voices] = freq;
-            volumes[voices] = vol;
-            voices++;
-        }
+        synth_note_on(&synth, freq, owner);
 
         #ifdef CPIN_AUDIO
             ENABLE_AUDIO_COUNTER_3_ISR;
@@ -694,7 +351,7 @@ void play_note(float freq, int vol) {
         #endif
         #ifdef BPIN_AUDIO
             #ifdef CPIN_AUDIO
-            if (voices > 1) {
+            if (synth.voices > 1) {
                 ENABLE_AUDIO_COUNTER_1_ISR;
                 ENABLE_AUDIO_COUNTER_1_OUTPUT;
             }
@@ -707,6 +364,13 @@ void play_note(float freq, int vol) {
 
 }
 
+void play_note(float freq, int vol) {
+
+    dprintf("audio play note freq=%d vol=%d", (int)freq, vol);
+    note_on(freq, SYNTH_OWNER_KEY);
+
+}
+
 void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
 {
 
@@ -715,48 +379,34 @@ void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat)
     }
 
     if (audio_config.enable) {
+        sequencer_play_float(np, n_count, n_repeat, note_tempo);
+    }
 
-        #ifdef CPIN_AUDIO
-            DISABLE_AUDIO_COUNTER_3_ISR;
-        #endif
-        #ifdef BPIN_AUDIO
-            DISABLE_AUDIO_COUNTER_1_ISR;
-        #endif
-
-        // Cancel note if a note is playing
-        if (playing_note)
-            stop_all_notes();
-
-        playing_notes = true;
+}
 
-        notes_pointer = np;
-        notes_count = n_count;
-        notes_repeat = n_repeat;
+void play_compact_song(const song_note_t *notes, uint16_t count, bool repeat)
+{
 
-        place = 0;
-        current_note = 0;
+    if (!audio_initialized) {
+        audio_init();
+    }
 
-        note_frequency = (*notes_pointer)[current_note][0];
-        note_length = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
-        note_position = 0;
+    if (audio_config.enable) {
+        sequencer_play(notes, count, repeat, note_tempo);
+    }
 
+}
 
-        #ifdef CPIN_AUDIO
-            ENABLE_AUDIO_COUNTER_3_ISR;
-            ENABLE_AUDIO_COUNTER_3_OUTPUT;
-        #endif
-        #ifdef BPIN_AUDIO
-            #ifndef CPIN_AUDIO
-            ENABLE_AUDIO_COUNTER_1_ISR;
-            ENABLE_AUDIO_COUNTER_1_OUTPUT;
-            #endif
-        #endif
-    }
+void sequencer_note_on(float frequency) {
+    note_on(frequency, SYNTH_OWNER_SONG);
+}
 
+void sequencer_note_off(float frequency) {
+    note_off(frequency, SYNTH_OWNER_SONG);
 }
 
 bool is_playing_notes(void) {
-    return playing_notes;
+    return sequencer_playing();
 }
 
 bool is_audio_on(void) {
@@ -768,21 +418,24 @@ void audio_toggle(void) {
     eeconfig_update_audio(audio_config.raw);
     if (audio_config.enable)
         audio_on_user();
+    else
+        stop_all_notes();
 }
 
 void audio_on(void) {
     audio_config.enable = 1;
     eeconfig_update_audio(audio_config.raw);
     audio_on_user();
-    PLAY_SONG(audio_on_song);
+    PLAY_COMPACT_SONG(audio_on_song);
 }
 
 void audio_off(void) {
-    PLAY_SONG(audio_off_song);
-    wait_ms(100);
     stop_all_notes();
     audio_config.enable = 0;
     eeconfig_update_audio(audio_config.raw);
+    // Nothing else gets queued while audio is off, the sequencer plays this
+    // from the main loop and the sound stops when it ends
+    sequencer_play(audio_off_song, NOTE_ARRAY_SIZE(audio_off_song), false, note_tempo);
 }
 
 #ifdef VIBRATO_ENABLE
@@ -791,28 +444,34 @@ void audio_off(void) {
 
 void set_vibrato_rate(float rate) {
     vibrato_rate = rate;
+    update_vibrato();
 }
 
 void increase_vibrato_rate(float change) {
     vibrato_rate *= change;
+    update_vibrato();
 }
 
 void decrease_vibrato_rate(float change) {
     vibrato_rate /= change;
+    update_vibrato();
 }
 
 #ifdef VIBRATO_STRENGTH_ENABLE
 
 void set_vibrato_strength(float strength) {
     vibrato_strength = strength;
+    update_vibrato();
 }
 
 void increase_vibrato_strength(float change) {
     vibrato_strength *= change;
+    update_vibrato();
 }
 
 void decrease_vibrato_strength(float change) {
     vibrato_strength /= change;
+    update_vibrato();
 }
 
 #endif  /* VIBRATO_STRENGTH_ENABLE */
@@ -823,28 +482,34 @@ void decrease_vibrato_strength(float change) {
 
 void set_polyphony_rate(float rate) {
     polyphony_rate = rate;
+    synth_set_polyphony_rate(&synth, polyphony_rate);
 }
 
 void enable_polyphony() {
     polyphony_rate = 5;
+    synth_set_polyphony_rate(&synth, polyphony_rate);
 }
 
 void disable_polyphony() {
     polyphony_rate = 0;
+    synth_set_polyphony_rate(&synth, polyphony_rate);
 }
 
 void increase_polyphony_rate(float change) {
     polyphony_rate *= change;
+    synth_set_polyphony_rate(&synth, polyphony_rate);
 }
 
 void decrease_polyphony_rate(float change) {
     polyphony_rate /= change;
+    synth_set_polyphony_rate(&synth, polyphony_rate);
 }
 
 // Timbre function
 
 void set_timbre(float timbre) {
     note_timbre = timbre;
+    synth.timbre = synth_q8(timbre);
 }
 
 // Tempo functions
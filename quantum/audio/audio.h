@@ -25,6 +25,7 @@
 #include "musical_notes.h"
 #include "song_list.h"
 #include "voices.h"
+#include "sequencer.h"
 #include "quantum.h"
 #include <math.h>
 
@@ -90,6 +91,8 @@ void play_note(float freq, int vol);
 void stop_note(float freq);
 void stop_all_notes(void);
 void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat);
+// Songs are queued behind the one playing, see sequencer.h
+void play_compact_song(const song_note_t *notes, uint16_t count, bool repeat);
 
 #define SCALE (int8_t []){ 0 + (12*0), 2 + (12*0), 4 + (12*0), 5 + (12*0), 7 + (12*0), 9 + (12*0), 11 + (12*0), \
                            0 + (12*1), 2 + (12*1), 4 + (12*1), 5 + (12*1), 7 + (12*1), 9 + (12*1), 11 + (12*1), \
@@ -105,7 +108,20 @@ void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat);
 	_Pragma ("message \"'PLAY_NOTE_ARRAY' macro is deprecated\"")
 #define PLAY_SONG(note_array) play_notes(&note_array, NOTE_ARRAY_SIZE((note_array)), false)
 #define PLAY_LOOP(note_array) play_notes(&note_array, NOTE_ARRAY_SIZE((note_array)), true)
+#define PLAY_COMPACT_SONG(notes) play_compact_song(notes, NOTE_ARRAY_SIZE((notes)), false)
+#define PLAY_COMPACT_LOOP(notes) play_compact_song(notes, NOTE_ARRAY_SIZE((notes)), true)
 
 bool is_playing_notes(void);
 
+#ifdef PROTOCOL_CHIBIOS
+// Load of the DAC mixer thread
+typedef struct {
+    uint32_t buffers;           // halves of the DAC buffer rendered
+    uint32_t underruns;         // halves the DMA replayed before they were rendered
+    uint32_t max_render_ticks;  // longest render of a half, in realtime counter ticks
+} audio_dac_stats_t;
+
+void audio_dac_stats(audio_dac_stats_t *stats);
+#endif
+
 #endif
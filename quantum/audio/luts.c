@@ -40,6 +40,13 @@ const float vibrato_lut[VIBRATO_LUT_LENGTH] =
 	1.0000000000000,
 };
 
+// The same curve as timer period offsets, (1 / vibrato_lut[i] - 1) in Q16
+const int16_t vibrato_period_lut[VIBRATO_LUT_LENGTH] =
+{
+	-146, -278, -382, -448, -471, -448, -382, -278, -146,    0,
+	 146,  279,  384,  452,  475,  452,  384,  279,  146,    0,
+};
+
 const uint16_t frequency_lut[FREQUENCY_LUT_LENGTH] =
 {
 	0x8E0B,
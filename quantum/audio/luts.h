@@ -18,9 +18,11 @@
     #include <avr/io.h>
     #include <avr/interrupt.h>
     #include <avr/pgmspace.h>
-#else
+#elif defined(PROTOCOL_CHIBIOS)
     #include "ch.h"
     #include "hal.h"
+#else
+    #include <stdint.h>
 #endif
 
 #ifndef LUTS_H
@@ -31,6 +33,7 @@
 #define FREQUENCY_LUT_LENGTH 349
 
 extern const float vibrato_lut[VIBRATO_LUT_LENGTH];
+extern const int16_t vibrato_period_lut[VIBRATO_LUT_LENGTH];
 extern const uint16_t frequency_lut[FREQUENCY_LUT_LENGTH];
 
 #endif /* LUTS_H */
@@ -0,0 +1,166 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "mixer.h"
+
+#define MS_TO_SAMPLES(ms) (((uint32_t)(ms) * AUDIO_MIXER_SAMPLE_RATE + 999) / 1000)
+#define ENV_STEP(range, ms) ((range) / MS_TO_SAMPLES(ms) > 0 ? (range) / MS_TO_SAMPLES(ms) : 1)
+
+#define SUSTAIN_LEVEL ((int16_t)(((uint32_t)MIXER_LEVEL_MAX * AUDIO_MIXER_SUSTAIN) >> 8))
+#define ATTACK_STEP   ((int16_t)ENV_STEP(MIXER_LEVEL_MAX, AUDIO_MIXER_ATTACK_MS))
+#define DECAY_STEP    ((int16_t)ENV_STEP(MIXER_LEVEL_MAX - SUSTAIN_LEVEL, AUDIO_MIXER_DECAY_MS))
+#define RELEASE_STEP  ((int16_t)ENV_STEP(SUSTAIN_LEVEL, AUDIO_MIXER_RELEASE_MS))
+
+static uint32_t phase_increment(float frequency) {
+    return (uint32_t)(frequency * (4294967296.0f / AUDIO_MIXER_SAMPLE_RATE));
+}
+
+void mixer_init(mixer_t *mixer) {
+    memset(mixer, 0, sizeof(*mixer));
+    mixer_set_timbre(mixer, 0.5f);
+}
+
+void mixer_set_timbre(mixer_t *mixer, float timbre) {
+    if (timbre <= 0) {
+        mixer->duty = 0;
+    } else if (timbre >= 1) {
+        mixer->duty = 0xFFFFFFFF;
+    } else {
+        mixer->duty = (uint32_t)(timbre * 4294967296.0f);
+    }
+}
+
+static void voice_start(mixer_t *mixer, float frequency, uint8_t owner) {
+    mixer_voice_t *voice = &mixer->voices[0];
+
+    // A free voice, otherwise the quietest one
+    for (uint8_t i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        mixer_voice_t *v = &mixer->voices[i];
+        if (v->stage == MIXER_ENV_OFF) {
+            voice = v;
+            break;
+        }
+        if (v->level < voice->level) {
+            voice = v;
+        }
+    }
+
+    voice->phase = 0;
+    voice->increment = phase_increment(frequency);
+    voice->duty = mixer->duty;
+    voice->level = 0;
+    voice->stage = MIXER_ENV_ATTACK;
+    voice->owner = owner;
+}
+
+static void voice_release(mixer_voice_t *voice) {
+    if (voice->stage != MIXER_ENV_OFF) {
+        voice->stage = MIXER_ENV_RELEASE;
+    }
+}
+
+void mixer_note_on(mixer_t *mixer, float frequency, uint8_t owner) {
+    if (frequency > 0) {
+        voice_start(mixer, frequency, owner);
+    }
+}
+
+void mixer_note_off(mixer_t *mixer, float frequency, uint8_t owner) {
+    uint32_t increment = phase_increment(frequency);
+
+    for (uint8_t i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        mixer_voice_t *v = &mixer->voices[i];
+        if (v->increment == increment && v->owner == owner &&
+            v->stage != MIXER_ENV_OFF && v->stage != MIXER_ENV_RELEASE) {
+            voice_release(v);
+            break;
+        }
+    }
+}
+
+void mixer_all_notes_off(mixer_t *mixer) {
+    for (uint8_t i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        voice_release(&mixer->voices[i]);
+    }
+}
+
+bool mixer_active(const mixer_t *mixer) {
+    for (uint8_t i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        if (mixer->voices[i].stage != MIXER_ENV_OFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline void envelope_step(mixer_voice_t *v) {
+    switch (v->stage) {
+        case MIXER_ENV_ATTACK:
+            if (v->level >= MIXER_LEVEL_MAX - ATTACK_STEP) {
+                v->level = MIXER_LEVEL_MAX;
+                v->stage = MIXER_ENV_DECAY;
+            } else {
+                v->level += ATTACK_STEP;
+            }
+            break;
+        case MIXER_ENV_DECAY:
+            if (v->level <= SUSTAIN_LEVEL + DECAY_STEP) {
+                v->level = SUSTAIN_LEVEL;
+                v->stage = MIXER_ENV_SUSTAIN;
+            } else {
+                v->level -= DECAY_STEP;
+            }
+            break;
+        case MIXER_ENV_RELEASE:
+            if (v->level <= RELEASE_STEP) {
+                v->level = 0;
+                v->stage = MIXER_ENV_OFF;
+            } else {
+                v->level -= RELEASE_STEP;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void mixer_render(mixer_t *mixer, uint16_t *buffer, size_t n) {
+    mixer_voice_t *active[AUDIO_MIXER_VOICES];
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        if (mixer->voices[i].stage != MIXER_ENV_OFF) {
+            active[count++] = &mixer->voices[i];
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        int32_t mix = 0;
+        for (uint8_t j = 0; j < count; j++) {
+            mixer_voice_t *v = active[j];
+            v->phase += v->increment;
+            mix += v->phase < v->duty ? v->level : -v->level;
+            envelope_step(v);
+        }
+
+        int32_t sample = MIXER_SAMPLE_MID + ((mix * AUDIO_MIXER_VOICE_AMPLITUDE) >> 15);
+        if (sample < 0) {
+            sample = 0;
+        } else if (sample > MIXER_SAMPLE_MAX) {
+            sample = MIXER_SAMPLE_MAX;
+        }
+        buffer[i] = sample;
+    }
+}
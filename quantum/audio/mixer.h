@@ -0,0 +1,111 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Sample based mixer for the DAC driver.
+ *
+ * Every held note gets its own voice: a phase accumulator playing a square
+ * wave, with an attack/decay/sustain/release envelope on its amplitude. The
+ * voices are summed into unsigned 12 bit samples centred on 2048, so a chord
+ * really plays all of its notes at once instead of switching between them.
+ *
+ * Rendering only does integer adds and compares per voice and sample, so the
+ * cost of a buffer is bounded by AUDIO_MIXER_VOICES * samples. Frequencies are
+ * converted once when a note starts.
+ */
+
+#ifndef AUDIO_MIXER_VOICES
+#  define AUDIO_MIXER_VOICES 8
+#endif
+
+#ifndef AUDIO_MIXER_SAMPLE_RATE
+#  define AUDIO_MIXER_SAMPLE_RATE 22050
+#endif
+
+// Peak of one voice in DAC steps, four voices at full level reach full scale
+// and louder mixes are clipped
+#ifndef AUDIO_MIXER_VOICE_AMPLITUDE
+#  define AUDIO_MIXER_VOICE_AMPLITUDE 511
+#endif
+
+#ifndef AUDIO_MIXER_ATTACK_MS
+#  define AUDIO_MIXER_ATTACK_MS 2
+#endif
+#ifndef AUDIO_MIXER_DECAY_MS
+#  define AUDIO_MIXER_DECAY_MS 80
+#endif
+// Level a held note decays to, Q8 of the peak
+#ifndef AUDIO_MIXER_SUSTAIN
+#  define AUDIO_MIXER_SUSTAIN 160
+#endif
+#ifndef AUDIO_MIXER_RELEASE_MS
+#  define AUDIO_MIXER_RELEASE_MS 20
+#endif
+
+#define MIXER_SAMPLE_MAX 4095
+#define MIXER_SAMPLE_MID 2048
+#define MIXER_LEVEL_MAX 0x7FFF
+
+// Who started a note. A song only releases its own notes, never a key held
+// in music mode at the same pitch.
+enum {
+    MIXER_OWNER_KEY = 0,
+    MIXER_OWNER_SONG,
+};
+
+typedef enum {
+    MIXER_ENV_OFF = 0,
+    MIXER_ENV_ATTACK,
+    MIXER_ENV_DECAY,
+    MIXER_ENV_SUSTAIN,
+    MIXER_ENV_RELEASE,
+} mixer_env_stage_t;
+
+typedef struct {
+    uint32_t phase;
+    uint32_t increment;     // phase step per sample, 2^32 is one cycle
+    uint32_t duty;          // the wave is high while phase is below this
+    int16_t level;          // envelope, up to MIXER_LEVEL_MAX
+    uint8_t stage;          // mixer_env_stage_t
+    uint8_t owner;
+} mixer_voice_t;
+
+typedef struct {
+    mixer_voice_t voices[AUDIO_MIXER_VOICES];
+    uint32_t duty;          // timbre of new notes
+} mixer_t;
+
+void mixer_init(mixer_t *mixer);
+// Timbre of the notes started afterwards, the duty cycle from 0 to 1
+void mixer_set_timbre(mixer_t *mixer, float timbre);
+
+// Starts a note. If all voices are busy the quietest one is taken over.
+void mixer_note_on(mixer_t *mixer, float frequency, uint8_t owner);
+// Releases the note with this frequency started by owner
+void mixer_note_off(mixer_t *mixer, float frequency, uint8_t owner);
+void mixer_all_notes_off(mixer_t *mixer);
+// True while any voice is still sounding, including release tails
+bool mixer_active(const mixer_t *mixer);
+
+// Fills buffer with the next n samples
+void mixer_render(mixer_t *mixer, uint16_t *buffer, size_t n);
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stddef.h>
+#include "sequencer.h"
+#include "timer.h"
+
+// The timer driver plays a length of 1 at tempo 100 for 0xFFFF ticks of its
+// 2MHz clock; in ms that is length * tempo * 65535 / 800000
+#define NOTE_MS_NUM 65535UL
+#define NOTE_MS_DEN 800000UL
+
+typedef struct {
+    const song_note_t *notes;   // PROGMEM, NULL for float songs
+    float (*float_notes)[][2];
+    uint16_t count;
+    uint8_t tempo;
+    bool repeat;
+} queued_song_t;
+
+static queued_song_t queue[SEQUENCER_QUEUE_SIZE];
+static uint8_t queue_head = 0;
+static uint8_t queue_count = 0;
+
+static bool started = false;     // the head of the queue is playing
+static uint16_t current = 0;
+static uint16_t note_start;
+static uint16_t note_ms;
+static float sounding = 0;        // frequency of the playing note, 0 if none
+static float pending = 0;         // frequency waiting out the repeat gap
+
+static void read_note(const queued_song_t *song, uint16_t index, float *frequency, uint16_t *ms) {
+    uint32_t length;
+
+    if (song->notes) {
+        // byte reads, the packed notes may sit on odd addresses
+        const uint8_t *note = (const uint8_t *)&song->notes[index];
+        uint16_t hz = pgm_read_byte(note) | (pgm_read_byte(note + 1) << 8);
+        // centre the error of the truncated frequency
+        *frequency = hz ? hz + 0.5f : 0;
+        length = ((uint32_t)pgm_read_byte(note + offsetof(song_note_t, length)) * song->tempo * NOTE_MS_NUM) / NOTE_MS_DEN;
+    } else {
+        *frequency = (*song->float_notes)[index][0];
+        length = (*song->float_notes)[index][1] * song->tempo * ((float)NOTE_MS_NUM / NOTE_MS_DEN);
+    }
+    *ms = length > 0xFFFF ? 0xFFFF : length;
+}
+
+static bool enqueue(const queued_song_t *song) {
+    if (song->count == 0) {
+        return true;
+    }
+    if (queue_count >= SEQUENCER_QUEUE_SIZE) {
+        return false;
+    }
+    queue[(queue_head + queue_count) % SEQUENCER_QUEUE_SIZE] = *song;
+    queue_count++;
+    return true;
+}
+
+bool sequencer_play(const song_note_t *notes, uint16_t count, bool repeat, uint8_t tempo) {
+    queued_song_t song = {.notes = notes, .count = count, .tempo = tempo, .repeat = repeat};
+    return enqueue(&song);
+}
+
+bool sequencer_play_float(float (*notes)[][2], uint16_t count, bool repeat, uint8_t tempo) {
+    queued_song_t song = {.float_notes = notes, .count = count, .tempo = tempo, .repeat = repeat};
+    return enqueue(&song);
+}
+
+static void silence(void) {
+    if (sounding > 0) {
+        sequencer_note_off(sounding);
+    }
+    sounding = 0;
+    pending = 0;
+}
+
+void sequencer_stop(void) {
+    silence();
+    queue_count = 0;
+    started = false;
+}
+
+bool sequencer_playing(void) {
+    return queue_count > 0;
+}
+
+static void start_note(void) {
+    float frequency;
+    float previous = sounding;
+
+    silence();
+    read_note(&queue[queue_head], current, &frequency, &note_ms);
+    if (frequency <= 0) {
+        return;
+    }
+    if (frequency == previous && note_ms > SEQUENCER_REPEAT_GAP_MS) {
+        pending = frequency;
+    } else {
+        sequencer_note_on(frequency);
+        sounding = frequency;
+    }
+}
+
+// Moves to the next note, returns false once the queue is empty
+static bool next_note(void) {
+    queued_song_t *song = &queue[queue_head];
+
+    if (++current < song->count) {
+        return true;
+    }
+    current = 0;
+    if (song->repeat && queue_count == 1) {
+        return true;
+    }
+    queue_head = (queue_head + 1) % SEQUENCER_QUEUE_SIZE;
+    queue_count--;
+    return queue_count > 0;
+}
+
+void sequencer_task(void) {
+    if (queue_count == 0) {
+        return;
+    }
+
+    if (!started) {
+        started = true;
+        current = 0;
+        note_start = timer_read();
+        start_note();
+        return;
+    }
+
+    uint16_t elapsed = timer_elapsed(note_start);
+
+    if (pending > 0 && elapsed >= SEQUENCER_REPEAT_GAP_MS) {
+        sequencer_note_on(pending);
+        sounding = pending;
+        pending = 0;
+    }
+
+    if (elapsed < note_ms) {
+        return;
+    }
+
+    // Keep the song in time if the main loop was late
+    note_start += note_ms;
+    if (!next_note()) {
+        silence();
+        started = false;
+        return;
+    }
+    start_note();
+}
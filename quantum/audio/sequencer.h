@@ -0,0 +1,67 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "progmem.h"
+
+/*
+ * Song sequencer, run from the main loop.
+ *
+ * Songs are queued and played one after the other, so a layer song doesn't
+ * cut off the startup song. Note timing is done here in milliseconds; the
+ * audio driver only sees notes starting and stopping, the same way keys in
+ * music mode start and stop them.
+ *
+ * Besides the float songs of play_notes(), songs can be stored compactly in
+ * flash, three bytes per note instead of eight in RAM. The macros from
+ * song_list.h work for both:
+ *
+ *   const song_note_t my_song[] PROGMEM = SONG(QWERTY_SOUND);
+ *   PLAY_COMPACT_SONG(my_song);
+ */
+
+#ifndef SEQUENCER_QUEUE_SIZE
+#  define SEQUENCER_QUEUE_SIZE 4
+#endif
+
+// Silence before a note that repeats the one before it
+#ifndef SEQUENCER_REPEAT_GAP_MS
+#  define SEQUENCER_REPEAT_GAP_MS 5
+#endif
+
+typedef struct __attribute__((packed)) {
+    uint16_t frequency;     // whole Hz, truncated from the NOTE_ values; 0 rests
+    uint8_t length;         // 64ths of a whole note, as in musical_notes.h
+} song_note_t;
+
+// Queue a song, returns false if the queue is full. A repeating song gives
+// way to the next queued song at the end of its current pass.
+bool sequencer_play(const song_note_t *notes, uint16_t count, bool repeat, uint8_t tempo);
+bool sequencer_play_float(float (*notes)[][2], uint16_t count, bool repeat, uint8_t tempo);
+// Stops the current song and drops the queue
+void sequencer_stop(void);
+bool sequencer_playing(void);
+
+// Starts and stops the notes, call it from the main loop
+void sequencer_task(void);
+
+// Implemented by the audio driver
+void sequencer_note_on(float frequency);
+void sequencer_note_off(float frequency);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "synth.h"
+#include "voices.h"
+#include "luts.h"
+#include "musical_notes.h"
+
+// The float driver glided by a factor of 2^(440 / frequency / 24) per
+// interrupt. On periods that is 2^x with x = 440 * period / (24 * clock);
+// this is ln(2) * x in Q16 per tick of period, scaled by 2^12.
+#define SYNTH_GLIDE_K ((uint32_t)(0.69314718 * 440.0 * 65536.0 * 4096.0 / (24.0 * SYNTH_CLOCK) + 0.5))
+
+// 440 / frequency in Q8 is period * SYNTH_VIBRATO_K >> 16
+#define SYNTH_VIBRATO_K ((uint32_t)(440.0 * 16777216.0 / SYNTH_CLOCK + 0.5))
+
+uint16_t synth_period(float frequency) {
+    if (frequency <= 0) {
+        return 0;
+    }
+    float period = SYNTH_CLOCK / frequency;
+    return period >= SYNTH_MAX_PERIOD ? SYNTH_MAX_PERIOD : (uint16_t)period;
+}
+
+uint16_t synth_q8(float value) {
+    float q8 = value * 256 + 0.5f;
+    if (q8 <= 0) {
+        return 0;
+    }
+    return q8 >= 0xFFFF ? 0xFFFF : (uint16_t)q8;
+}
+
+static void update_poly_ticks(synth_t *synth) {
+    for (uint8_t i = 0; i < synth->voices; i++) {
+        uint32_t ticks = 0;
+        if (synth->polyphony_rate > 0) {
+            // frequency / rate / 8, with the rate in Q8
+            ticks = (SYNTH_CLOCK * 32UL) / ((uint32_t)synth->notes[i] * synth->polyphony_rate);
+        }
+        synth->poly_ticks[i] = ticks > 0xFFFF ? 0xFFFF : ticks;
+    }
+}
+
+void synth_init(synth_t *synth) {
+    memset(synth, 0, sizeof(*synth));
+    synth->timbre = synth_q8(TIMBRE_DEFAULT);
+    synth->glissando = true;
+}
+
+bool synth_note_on(synth_t *synth, float frequency, uint8_t owner) {
+    if (synth->voices >= SYNTH_MAX_VOICES) {
+        return false;
+    }
+    synth->envelope_index = 0;
+    if (frequency > 0) {
+        synth->notes[synth->voices] = synth_period(frequency);
+        synth->owners[synth->voices] = owner;
+        synth->voices++;
+        update_poly_ticks(synth);
+    }
+    return true;
+}
+
+void synth_note_off(synth_t *synth, float frequency, uint8_t owner) {
+    uint16_t period = synth_period(frequency);
+
+    for (int8_t i = synth->voices - 1; i >= 0; i--) {
+        if (synth->notes[i] == period && synth->owners[i] == owner) {
+            for (uint8_t j = i; j < synth->voices - 1; j++) {
+                synth->notes[j] = synth->notes[j + 1];
+                synth->owners[j] = synth->owners[j + 1];
+                synth->poly_ticks[j] = synth->poly_ticks[j + 1];
+            }
+            synth->voices--;
+            break;
+        }
+    }
+    if (synth->voice_place >= synth->voices) {
+        synth->voice_place = 0;
+    }
+    if (synth->voices == 0) {
+        synth->period = 0;
+        synth->period_alt = 0;
+    }
+}
+
+void synth_all_notes_off(synth_t *synth) {
+    synth->voices = 0;
+    synth->voice_place = 0;
+    synth->period = 0;
+    synth->period_alt = 0;
+}
+
+void synth_set_polyphony_rate(synth_t *synth, float rate) {
+    synth->polyphony_rate = synth_q8(rate);
+    update_poly_ticks(synth);
+}
+
+// period * (2^x - 1) when getting longer, period * (1 - 2^-x) when getting
+// shorter, using the series of e^a up to a^3
+static uint16_t glide_delta(uint16_t period, bool longer) {
+    uint32_t a = ((uint32_t)period * SYNTH_GLIDE_K) >> 12;
+    uint32_t a2 = (a * a) >> 17;
+    uint32_t a3 = (((a2 * a) >> 16) * 21845) >> 16;
+    uint32_t ratio = longer ? a + a2 + a3 : a - a2 + a3;
+    return ((uint32_t)period * (ratio >> 1) + 0x4000) >> 15;
+}
+
+uint16_t synth_glide(uint16_t period, uint16_t target) {
+    if (period == 0 || target == 0) {
+        return target;
+    }
+    // Snap to the target once it's less than a step away
+    if (period > target && period - target > glide_delta(target, true)) {
+        return period - glide_delta(period, false);
+    }
+    if (period < target && target - period > glide_delta(target, false)) {
+        uint32_t next = (uint32_t)period + glide_delta(period, true);
+        return next > SYNTH_MAX_PERIOD ? SYNTH_MAX_PERIOD : next;
+    }
+    return target;
+}
+
+uint16_t synth_vibrato(synth_t *synth, uint16_t period) {
+    int32_t offset = vibrato_period_lut[synth->vibrato_counter >> 8];
+#ifdef VIBRATO_STRENGTH_ENABLE
+    offset = (offset * synth->vibrato_strength) >> 8;
+#endif
+    int32_t vibrated = period + (((int32_t)period * offset) >> 16);
+
+    // Faster for lower notes, by rate * (1 + 440 / frequency) per interrupt
+    uint32_t ratio = ((uint32_t)period * SYNTH_VIBRATO_K + 0x8000) >> 16;
+    uint32_t counter = synth->vibrato_counter + synth->vibrato_rate + ((synth->vibrato_rate * ratio) >> 8);
+    while (counter >= (VIBRATO_LUT_LENGTH << 8)) {
+        counter -= VIBRATO_LUT_LENGTH << 8;
+    }
+    synth->vibrato_counter = counter;
+
+    if (vibrated < 1) {
+        return 1;
+    }
+    return vibrated > SYNTH_MAX_PERIOD ? SYNTH_MAX_PERIOD : vibrated;
+}
+
+static void synth_output(synth_t *synth, uint16_t period, synth_output_t *out) {
+    if (synth->vibrato_strength > 0) {
+        period = synth_vibrato(synth, period);
+    }
+    if (synth->envelope_index < 0xFFFF) {
+        synth->envelope_index++;
+    }
+    period = voice_envelope_period(synth, period);
+
+    out->period = period;
+    out->duty = synth_duty(period, synth->timbre);
+}
+
+void synth_step(synth_t *synth, synth_output_t *out, synth_output_t *alt) {
+    if (alt) {
+        alt->period = 0;
+        alt->duty = 0;
+        if (synth->voices > 1 && synth->polyphony_rate == 0) {
+            uint16_t target = synth->notes[synth->voices - 2];
+            synth->period_alt = synth->glissando ? synth_glide(synth->period_alt, target) : target;
+            synth_output(synth, synth->period_alt, alt);
+        }
+    }
+
+    if (synth->voices == 0) {
+        out->period = 0;
+        out->duty = 0;
+        return;
+    }
+
+    if (synth->polyphony_rate > 0) {
+        if (synth->voices > 1) {
+            synth->voice_place %= synth->voices;
+            if (synth->place++ > synth->poly_ticks[synth->voice_place]) {
+                synth->voice_place = (synth->voice_place + 1) % synth->voices;
+                synth->place = 0;
+            }
+        }
+        synth_output(synth, synth->notes[synth->voice_place], out);
+    } else {
+        uint16_t target = synth->notes[synth->voices - 1];
+        synth->period = synth->glissando ? synth_glide(synth->period, target) : target;
+        synth_output(synth, synth->period, out);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fixed point core of the timer based audio driver.
+ *
+ * Everything here works on timer periods in ticks of SYNTH_CLOCK rather than
+ * on frequencies, since a period is what the timer needs anyway. Float
+ * frequencies from play_note() are converted once when a note starts, so
+ * the timer interrupt only does integer adds, shifts and multiplies: no
+ * pow(), fmod() or float division.
+ */
+
+// Timer clock, the CPU clock through the /8 prescaler used by audio.c
+#ifndef SYNTH_CLOCK
+#  ifdef F_CPU
+#    define SYNTH_CLOCK (F_CPU / 8)
+#  else
+#    define SYNTH_CLOCK 2000000UL
+#  endif
+#endif
+
+#define SYNTH_MAX_VOICES 8
+// Longest period the 16 bit timers can do, about 30.5Hz at 2MHz
+#define SYNTH_MAX_PERIOD 0xFFFF
+
+// Who started a note. A song only stops its own notes, never a key held in
+// music mode at the same pitch.
+enum {
+    SYNTH_OWNER_KEY = 0,
+    SYNTH_OWNER_SONG,
+};
+
+typedef struct {
+    uint16_t period;    // 0 is silence
+    uint16_t duty;
+} synth_output_t;
+
+typedef struct {
+    // Held notes as periods, the most recent one last
+    uint16_t notes[SYNTH_MAX_VOICES];
+    uint8_t owners[SYNTH_MAX_VOICES];
+    // Interrupts each note plays before polyphony moves on to the next one
+    uint16_t poly_ticks[SYNTH_MAX_VOICES];
+    uint8_t voices;
+    uint8_t voice_place;
+    uint16_t place;
+
+    // Current periods of the two channels while gliding towards the notes
+    uint16_t period;
+    uint16_t period_alt;
+
+    uint16_t envelope_index;
+    uint16_t timbre;            // duty cycle, Q8 (128 is 50%)
+    uint16_t polyphony_rate;    // Q8, 0 turns polyphony off
+    bool glissando;
+
+    uint16_t vibrato_counter;   // Q8.8 position in vibrato_period_lut
+    uint16_t vibrato_rate;      // Q8.8
+    uint16_t vibrato_strength;  // Q8.8, 0 turns vibrato off
+} synth_t;
+
+// Float conversions, don't use these from the interrupt
+uint16_t synth_period(float frequency);
+uint16_t synth_q8(float value);
+
+void synth_init(synth_t *synth);
+// Adds a held note, returns false if all voices are taken
+bool synth_note_on(synth_t *synth, float frequency, uint8_t owner);
+// Removes the most recent note with this frequency started by owner
+void synth_note_off(synth_t *synth, float frequency, uint8_t owner);
+void synth_all_notes_off(synth_t *synth);
+void synth_set_polyphony_rate(synth_t *synth, float rate);
+
+// One step towards target, following the same curve as the float version
+uint16_t synth_glide(uint16_t period, uint16_t target);
+// Applies the vibrato to period and advances it
+uint16_t synth_vibrato(synth_t *synth, uint16_t period);
+
+static inline uint16_t synth_duty(uint16_t period, uint16_t timbre) {
+    return ((uint32_t)period * timbre) >> 8;
+}
+
+// One timer interrupt of the held notes. alt, if not NULL, gets the second
+// to last note for a second channel, or a period of 0 when there is none.
+void synth_step(synth_t *synth, synth_output_t *out, synth_output_t *alt);
+
+#endif
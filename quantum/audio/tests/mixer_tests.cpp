@@ -0,0 +1,267 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+extern "C" {
+#include "mixer.h"
+#include "sequencer_songs.h"
+#include "timer.h"
+
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+}
+
+// Where the offline renders go, listen to them with any audio player
+#ifndef RENDER_DIR
+#define RENDER_DIR ".build/test"
+#endif
+
+#define RATE AUDIO_MIXER_SAMPLE_RATE
+
+// The driver hooks of the sequencer play on the mixer under test
+static mixer_t* song_mixer;
+
+extern "C" {
+void sequencer_note_on(float frequency) {
+    mixer_note_on(song_mixer, frequency, MIXER_OWNER_SONG);
+}
+
+void sequencer_note_off(float frequency) {
+    mixer_note_off(song_mixer, frequency, MIXER_OWNER_SONG);
+}
+}
+
+static void write_le(FILE* f, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((value >> (8 * i)) & 0xFF, f);
+    }
+}
+
+// 16 bit mono WAV of the 12 bit DAC samples
+static bool write_wav(const char* path, const std::vector<uint16_t>& samples) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    uint32_t data_size = samples.size() * 2;
+    fputs("RIFF", f);
+    write_le(f, 36 + data_size, 4);
+    fputs("WAVEfmt ", f);
+    write_le(f, 16, 4);
+    write_le(f, 1, 2);
+    write_le(f, 1, 2);
+    write_le(f, RATE, 4);
+    write_le(f, RATE * 2, 4);
+    write_le(f, 2, 2);
+    write_le(f, 16, 2);
+    fputs("data", f);
+    write_le(f, data_size, 4);
+    for (uint16_t s : samples) {
+        write_le(f, (uint16_t)((int16_t)(s - MIXER_SAMPLE_MID) * 16), 2);
+    }
+    fclose(f);
+    return true;
+}
+
+// Power of one frequency in the samples, normalized to the length
+static double goertzel(const std::vector<uint16_t>& samples, float frequency) {
+    double w = 2 * M_PI * frequency / RATE;
+    double coeff = 2 * cos(w);
+    double s1 = 0, s2 = 0;
+    for (uint16_t sample : samples) {
+        double s = (sample - (double)MIXER_SAMPLE_MID) + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s;
+    }
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return power / ((double)samples.size() * samples.size());
+}
+
+class Mixer : public testing::Test {
+public:
+    Mixer() {
+        mixer_init(&mixer);
+        song_mixer = &mixer;
+        set_time(0);
+        sequencer_stop();
+    }
+
+    std::vector<uint16_t> render(size_t n) {
+        std::vector<uint16_t> samples(n);
+        mixer_render(&mixer, samples.data(), n);
+        return samples;
+    }
+
+    // Renders the samples of one ms of main loop, the sequencer starting and
+    // stopping notes in between
+    void render_ms(std::vector<uint16_t>& pcm) {
+        sequencer_task();
+        uint32_t ms = timer_read32();
+        size_t n = (ms + 1) * RATE / 1000 - ms * RATE / 1000;
+        uint16_t samples[RATE / 1000 + 1];
+        mixer_render(&mixer, samples, n);
+        pcm.insert(pcm.end(), samples, samples + n);
+        advance_time(1);
+    }
+
+    static uint32_t song_ms(const song_note_t* notes, uint16_t count) {
+        uint32_t total = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            total += (uint32_t)notes[i].length * TEMPO_DEFAULT * 65535 / 800000;
+        }
+        return total;
+    }
+
+    mixer_t mixer;
+};
+
+TEST_F(Mixer, SilentWithoutNotes) {
+    for (uint16_t s : render(1000)) {
+        EXPECT_EQ(s, MIXER_SAMPLE_MID);
+    }
+    EXPECT_FALSE(mixer_active(&mixer));
+}
+
+TEST_F(Mixer, ChordPlaysAllNotesAtOnce) {
+    mixer_note_on(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    mixer_note_on(&mixer, NOTE_CS5, MIXER_OWNER_KEY);
+    mixer_note_on(&mixer, NOTE_E5, MIXER_OWNER_KEY);
+    render(RATE / 10);
+    auto chord = render(RATE / 5);
+
+    double off_note = goertzel(chord, NOTE_G4);
+    for (float note : {NOTE_A4, NOTE_CS5, NOTE_E5}) {
+        EXPECT_GT(goertzel(chord, note), 100 * off_note) << "note " << note;
+    }
+    // All three at the same strength, not one after the other
+    EXPECT_NEAR(goertzel(chord, NOTE_A4), goertzel(chord, NOTE_E5), 0.2 * goertzel(chord, NOTE_A4));
+}
+
+TEST_F(Mixer, NoteOffReleasesOnlyThatNote) {
+    mixer_note_on(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    mixer_note_on(&mixer, NOTE_E5, MIXER_OWNER_KEY);
+    render(RATE / 10);
+    mixer_note_off(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    render(RATE * (AUDIO_MIXER_RELEASE_MS + 5) / 1000);
+    auto held = render(RATE / 5);
+
+    EXPECT_GT(goertzel(held, NOTE_E5), 1000 * goertzel(held, NOTE_A4));
+
+    mixer_note_off(&mixer, NOTE_E5, MIXER_OWNER_KEY);
+    render(RATE * (AUDIO_MIXER_RELEASE_MS + 5) / 1000);
+    EXPECT_FALSE(mixer_active(&mixer));
+    for (uint16_t s : render(100)) {
+        EXPECT_EQ(s, MIXER_SAMPLE_MID);
+    }
+}
+
+TEST_F(Mixer, SongNoteOffLeavesAHeldKeyOfTheSamePitch) {
+    mixer_note_on(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    mixer_note_on(&mixer, NOTE_A4, MIXER_OWNER_SONG);
+    render(RATE / 10);
+    mixer_note_off(&mixer, NOTE_A4, MIXER_OWNER_SONG);
+    render(RATE * (AUDIO_MIXER_RELEASE_MS + 5) / 1000);
+    auto held = render(RATE / 5);
+
+    EXPECT_GT(goertzel(held, NOTE_A4), 100 * goertzel(held, NOTE_G4));
+
+    mixer_note_off(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    render(RATE * (AUDIO_MIXER_RELEASE_MS + 5) / 1000);
+    EXPECT_FALSE(mixer_active(&mixer));
+}
+
+TEST_F(Mixer, EnvelopeRisesAndSettles) {
+    mixer_note_on(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    auto samples = render(RATE / 2);
+
+    auto peak = [&](size_t from, size_t n) {
+        int max = 0;
+        for (size_t i = from; i < from + n; i++) {
+            max = std::max(max, abs(samples[i] - MIXER_SAMPLE_MID));
+        }
+        return max;
+    };
+    size_t ms = RATE / 1000;
+    // Full level right after the attack, the sustain level once it decayed
+    EXPECT_NEAR(peak(AUDIO_MIXER_ATTACK_MS * ms, 5 * ms), AUDIO_MIXER_VOICE_AMPLITUDE, 20);
+    EXPECT_NEAR(peak(RATE / 2 - 10 * ms, 10 * ms), AUDIO_MIXER_VOICE_AMPLITUDE * AUDIO_MIXER_SUSTAIN / 256, 5);
+}
+
+TEST_F(Mixer, LoudMixesClipInsteadOfWrapping) {
+    float notes[] = {NOTE_C4, NOTE_E4, NOTE_G4, NOTE_C5, NOTE_E5, NOTE_G5, NOTE_C6, NOTE_E6};
+    for (float note : notes) {
+        mixer_note_on(&mixer, note, MIXER_OWNER_KEY);
+    }
+    for (uint16_t s : render(RATE / 10)) {
+        ASSERT_LE(s, MIXER_SAMPLE_MAX);
+    }
+}
+
+TEST_F(Mixer, TakesOverTheQuietestVoiceWhenFull) {
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        mixer_note_on(&mixer, NOTE_C4 * (i + 1), MIXER_OWNER_KEY);
+        render(RATE / 50);
+    }
+    mixer_note_on(&mixer, NOTE_A4, MIXER_OWNER_KEY);
+    render(RATE / 10);
+    auto samples = render(RATE / 5);
+    EXPECT_GT(goertzel(samples, NOTE_A4), 100 * goertzel(samples, NOTE_G4));
+}
+
+TEST_F(Mixer, SongKeepsPlayingUnderHeldNotes) {
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    mixer_note_on(&mixer, NOTE_E3, MIXER_OWNER_KEY);
+    std::vector<uint16_t> pcm;
+    for (int i = 0; i < 150; i++) {
+        render_ms(pcm);
+    }
+    std::vector<uint16_t> samples(pcm.begin() + RATE / 20, pcm.end());
+
+    EXPECT_GT(goertzel(samples, NOTE_A4), 100 * goertzel(samples, NOTE_G4));
+    EXPECT_GT(goertzel(samples, NOTE_E3), 100 * goertzel(samples, NOTE_G4));
+}
+
+TEST_F(Mixer, RenderStartupSong) {
+    sequencer_play(compact_startup, compact_startup_count, false, TEMPO_DEFAULT);
+
+    std::vector<uint16_t> pcm;
+    while (sequencer_playing() || mixer_active(&mixer)) {
+        render_ms(pcm);
+    }
+    uint32_t expected = song_ms(compact_startup, compact_startup_count) * RATE / 1000;
+    EXPECT_GE(pcm.size(), expected);
+    EXPECT_LE(pcm.size(), expected + RATE * (AUDIO_MIXER_RELEASE_MS + 2) / 1000);
+
+    EXPECT_TRUE(write_wav(RENDER_DIR "/audio_mixer_startup.wav", pcm));
+}
+
+TEST_F(Mixer, RenderCostPerSample) {
+    float notes[] = {NOTE_C4, NOTE_E4, NOTE_G4, NOTE_C5, NOTE_E5, NOTE_G5, NOTE_C6, NOTE_E6};
+    for (float note : notes) {
+        mixer_note_on(&mixer, note, MIXER_OWNER_KEY);
+    }
+    const size_t n = RATE * 10;
+    std::vector<uint16_t> samples(256);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i += 256) {
+        mixer_render(&mixer, samples.data(), 256);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%d voices: %.1f ns per sample on the host\n", AUDIO_MIXER_VOICES, elapsed / n);
+}
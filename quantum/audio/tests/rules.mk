@@ -0,0 +1,24 @@
+audio_synth_SRC := \
+	$(QUANTUM_PATH)/audio/tests/synth_tests.cpp \
+	$(QUANTUM_PATH)/audio/synth.c \
+	$(QUANTUM_PATH)/audio/voices.c \
+	$(QUANTUM_PATH)/audio/luts.c
+
+audio_synth_INC := $(QUANTUM_PATH)/audio
+
+audio_mixer_SRC := \
+	$(QUANTUM_PATH)/audio/tests/mixer_tests.cpp \
+	$(QUANTUM_PATH)/audio/tests/sequencer_songs.c \
+	$(QUANTUM_PATH)/audio/mixer.c \
+	$(QUANTUM_PATH)/audio/sequencer.c \
+	$(TMK_PATH)/common/test/timer.c
+
+audio_mixer_INC := $(QUANTUM_PATH)/audio
+
+audio_sequencer_SRC := \
+	$(QUANTUM_PATH)/audio/tests/sequencer_tests.cpp \
+	$(QUANTUM_PATH)/audio/tests/sequencer_songs.c \
+	$(QUANTUM_PATH)/audio/sequencer.c \
+	$(TMK_PATH)/common/test/timer.c
+
+audio_sequencer_INC := $(QUANTUM_PATH)/audio
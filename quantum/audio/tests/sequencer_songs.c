@@ -0,0 +1,25 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compact songs are declared like this in the firmware, which only works in C
+#include "sequencer_songs.h"
+
+const song_note_t compact_zelda_treasure[] PROGMEM = SONG(ZELDA_TREASURE);
+const uint16_t compact_zelda_treasure_count = sizeof(compact_zelda_treasure) / sizeof(compact_zelda_treasure[0]);
+
+float float_zelda_treasure[][2] = SONG(ZELDA_TREASURE);
+
+const song_note_t compact_startup[] PROGMEM = SONG(STARTUP_SOUND);
+const uint16_t compact_startup_count = sizeof(compact_startup) / sizeof(compact_startup[0]);
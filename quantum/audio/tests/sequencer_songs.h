@@ -0,0 +1,29 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SEQUENCER_SONGS_H
+#define SEQUENCER_SONGS_H
+
+#include "sequencer.h"
+#include "musical_notes.h"
+#include "song_list.h"
+
+extern const song_note_t compact_zelda_treasure[];
+extern const uint16_t compact_zelda_treasure_count;
+extern float float_zelda_treasure[][2];
+
+extern const song_note_t compact_startup[];
+extern const uint16_t compact_startup_count;
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+extern "C" {
+#include "sequencer_songs.h"
+#include "timer.h"
+
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+}
+
+struct NoteEvent {
+    uint32_t time;
+    bool on;
+    float frequency;
+};
+
+static std::vector<NoteEvent> events;
+
+extern "C" {
+void sequencer_note_on(float frequency) {
+    events.push_back({timer_read32(), true, frequency});
+}
+
+void sequencer_note_off(float frequency) {
+    events.push_back({timer_read32(), false, frequency});
+}
+}
+
+// ms a note of this length lasts on the timer driver
+static uint32_t note_ms(float length, uint8_t tempo = TEMPO_DEFAULT) {
+    return (uint32_t)(length * tempo * 65535.0 / 800000.0);
+}
+
+class Sequencer : public testing::Test {
+public:
+    Sequencer() {
+        set_time(1000);
+        sequencer_stop();
+        events.clear();
+    }
+
+    // Runs the main loop every ms until the queue is empty
+    uint32_t run(uint32_t limit = 60000) {
+        uint32_t start = timer_read32();
+        sequencer_task();
+        while (sequencer_playing() && timer_read32() - start < limit) {
+            advance_time(1);
+            sequencer_task();
+        }
+        return timer_read32() - start;
+    }
+
+    std::vector<NoteEvent> note_ons() {
+        std::vector<NoteEvent> ons;
+        for (auto& e : events) {
+            if (e.on) {
+                ons.push_back(e);
+            }
+        }
+        return ons;
+    }
+};
+
+TEST_F(Sequencer, compact_notes_take_three_bytes) {
+    EXPECT_EQ(sizeof(song_note_t), 3u);
+    EXPECT_EQ(compact_startup_count, 3);
+    EXPECT_EQ(compact_startup[0].frequency, (uint16_t)NOTE_E6);
+    EXPECT_EQ(compact_startup[2].frequency, (uint16_t)NOTE_E7);
+    EXPECT_EQ(compact_startup[2].length, 8 + 4);
+}
+
+TEST_F(Sequencer, notes_start_on_time) {
+    uint32_t start = timer_read32();
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    run();
+
+    auto ons = note_ons();
+    ASSERT_EQ(ons.size(), compact_zelda_treasure_count);
+    uint32_t expected = start;
+    for (uint16_t i = 0; i < compact_zelda_treasure_count; i++) {
+        EXPECT_EQ(ons[i].time, expected) << "note " << i;
+        EXPECT_NEAR(ons[i].frequency, float_zelda_treasure[i][0], 0.5);
+        expected += note_ms(compact_zelda_treasure[i].length);
+    }
+    // Everything is stopped at the end
+    ASSERT_FALSE(events.empty());
+    EXPECT_FALSE(events.back().on);
+    EXPECT_EQ(events.back().time, expected);
+}
+
+TEST_F(Sequencer, float_songs_play_like_compact_ones) {
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    uint32_t compact = run();
+    auto compact_ons = note_ons();
+
+    events.clear();
+    sequencer_play_float(&float_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    uint32_t floats = run();
+    auto float_ons = note_ons();
+
+    EXPECT_NEAR(floats, compact, compact_zelda_treasure_count);
+    ASSERT_EQ(float_ons.size(), compact_ons.size());
+    for (size_t i = 0; i < float_ons.size(); i++) {
+        EXPECT_EQ(float_ons[i].frequency, float_zelda_treasure[i][0]);
+    }
+}
+
+TEST_F(Sequencer, queued_songs_play_one_after_the_other) {
+    EXPECT_TRUE(sequencer_play(compact_startup, compact_startup_count, false, TEMPO_DEFAULT));
+    sequencer_task();
+    advance_time(10);
+    sequencer_task();
+    // Queued while the first one plays, like a layer song after the startup song
+    EXPECT_TRUE(sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT));
+    run();
+
+    auto ons = note_ons();
+    ASSERT_EQ(ons.size(), (size_t)compact_startup_count + compact_zelda_treasure_count);
+    for (uint16_t i = 0; i < compact_startup_count; i++) {
+        EXPECT_NEAR(ons[i].frequency, compact_startup[i].frequency, 1);
+    }
+    for (uint16_t i = 0; i < compact_zelda_treasure_count; i++) {
+        EXPECT_NEAR(ons[compact_startup_count + i].frequency, compact_zelda_treasure[i].frequency, 1);
+    }
+}
+
+TEST_F(Sequencer, full_queue_rejects_songs) {
+    for (int i = 0; i < SEQUENCER_QUEUE_SIZE; i++) {
+        EXPECT_TRUE(sequencer_play(compact_startup, compact_startup_count, false, TEMPO_DEFAULT));
+    }
+    EXPECT_FALSE(sequencer_play(compact_startup, compact_startup_count, false, TEMPO_DEFAULT));
+    run();
+    EXPECT_EQ(note_ons().size(), (size_t)SEQUENCER_QUEUE_SIZE * compact_startup_count);
+}
+
+TEST_F(Sequencer, loop_gives_way_to_the_next_song) {
+    sequencer_play(compact_startup, compact_startup_count, true, TEMPO_DEFAULT);
+    for (int i = 0; i < 2000; i++) {
+        advance_time(1);
+        sequencer_task();
+    }
+    EXPECT_TRUE(sequencer_playing());
+    size_t looped = note_ons().size();
+    EXPECT_GT(looped, 3u * compact_startup_count);
+
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    run();
+    auto ons = note_ons();
+    // The loop finishes its pass, then the next song plays once
+    EXPECT_EQ((ons.size() - compact_zelda_treasure_count) % compact_startup_count, 0u);
+    EXPECT_NEAR(ons.back().frequency, compact_zelda_treasure[compact_zelda_treasure_count - 1].frequency, 1);
+}
+
+TEST_F(Sequencer, repeated_note_gets_a_gap) {
+    static const song_note_t notes[] = {{440, 16}, {440, 16}};
+    uint32_t start = timer_read32();
+    sequencer_play(notes, 2, false, TEMPO_DEFAULT);
+    run();
+
+    auto ons = note_ons();
+    ASSERT_EQ(ons.size(), 2u);
+    EXPECT_EQ(ons[1].time, start + note_ms(16) + SEQUENCER_REPEAT_GAP_MS);
+    // and the first note stopped before it
+    ASSERT_GE(events.size(), 3u);
+    EXPECT_FALSE(events[1].on);
+    EXPECT_EQ(events[1].time, start + note_ms(16));
+}
+
+TEST_F(Sequencer, rests_are_silent) {
+    static const song_note_t notes[] = {{440, 16}, {0, 16}, {660, 16}};
+    uint32_t start = timer_read32();
+    sequencer_play(notes, 3, false, TEMPO_DEFAULT);
+    run();
+
+    auto ons = note_ons();
+    ASSERT_EQ(ons.size(), 2u);
+    EXPECT_EQ(ons[1].time, start + 2 * note_ms(16));
+}
+
+TEST_F(Sequencer, late_main_loop_keeps_the_tempo) {
+    uint32_t start = timer_read32();
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    sequencer_task();
+    // a slow scan every now and then
+    for (int i = 0; sequencer_playing(); i++) {
+        advance_time(i % 7 == 0 ? 9 : 1);
+        sequencer_task();
+    }
+
+    auto ons = note_ons();
+    ASSERT_EQ(ons.size(), compact_zelda_treasure_count);
+    uint32_t expected = start + note_ms(compact_zelda_treasure[0].length) + note_ms(compact_zelda_treasure[1].length);
+    EXPECT_GE(ons[2].time, expected);
+    EXPECT_LT(ons[2].time, expected + 9);
+}
+
+TEST_F(Sequencer, stop_silences_and_drops_the_queue) {
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    sequencer_play(compact_startup, compact_startup_count, false, TEMPO_DEFAULT);
+    sequencer_task();
+    advance_time(50);
+    sequencer_task();
+
+    sequencer_stop();
+    EXPECT_FALSE(sequencer_playing());
+    ASSERT_FALSE(events.empty());
+    EXPECT_FALSE(events.back().on);
+
+    size_t count = events.size();
+    run();
+    EXPECT_EQ(events.size(), count);
+}
+
+TEST_F(Sequencer, tempo_scales_the_lengths) {
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT);
+    uint32_t normal = run();
+    sequencer_play(compact_zelda_treasure, compact_zelda_treasure_count, false, TEMPO_DEFAULT * 2);
+    uint32_t slow = run();
+    EXPECT_NEAR(slow, 2 * normal, compact_zelda_treasure_count);
+}
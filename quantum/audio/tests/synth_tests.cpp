@@ -0,0 +1,281 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+extern "C" {
+#include "synth.h"
+#include "luts.h"
+#include "voices.h"
+#include "musical_notes.h"
+
+// used by voice_envelope()
+uint16_t envelope_index = 0;
+float note_timbre = 0.5f;
+float polyphony_rate = 0;
+bool glissando = true;
+}
+
+// The timer interrupt math of the float driver, as it was before the synth
+// core, to compare against.
+class FloatReference {
+public:
+    std::vector<float> frequencies;
+    float frequency = 0;
+    float vibrato_counter = 0;
+    float vibrato_rate = 0.125;
+    bool vibrato = false;
+    float polyphony_rate = 0;
+    int voice_place = 0;
+    float place = 0;
+
+    float apply_vibrato(float average_freq) {
+        float vibrated_freq = average_freq * vibrato_lut[(int)vibrato_counter];
+        float r = fmod(vibrato_counter + vibrato_rate * (1.0 + 440.0 / average_freq), VIBRATO_LUT_LENGTH);
+        vibrato_counter = r < 0 ? r + VIBRATO_LUT_LENGTH : r;
+        return vibrated_freq;
+    }
+
+    static float glide(float frequency, float target) {
+        if (frequency != 0 && frequency < target && frequency < target * pow(2, -440 / target / 12 / 2)) {
+            return frequency * pow(2, 440 / frequency / 12 / 2);
+        } else if (frequency != 0 && frequency > target && frequency > target * pow(2, 440 / target / 12 / 2)) {
+            return frequency * pow(2, -440 / frequency / 12 / 2);
+        }
+        return target;
+    }
+
+    synth_output_t step() {
+        int voices = frequencies.size();
+        float freq;
+        if (polyphony_rate > 0) {
+            if (voices > 1) {
+                voice_place %= voices;
+                if (place++ > (frequencies[voice_place] / polyphony_rate / 8)) {
+                    voice_place = (voice_place + 1) % voices;
+                    place = 0.0;
+                }
+            }
+            freq = frequencies[voice_place];
+        } else {
+            freq = frequencies[voices - 1];
+        }
+        if (vibrato) {
+            freq = apply_vibrato(freq);
+        }
+        synth_output_t out;
+        out.period = (uint16_t)(SYNTH_CLOCK / freq);
+        out.duty = (uint16_t)((SYNTH_CLOCK / freq) * 0.5f);
+        return out;
+    }
+};
+
+// The pin output of the timer, sampled every RENDER_TICKS clock ticks
+#define RENDER_TICKS 16
+
+class Waveform {
+public:
+    void add(synth_output_t out) {
+        uint32_t period = out.period > 0 ? out.period : 1;
+        uint64_t end = ticks + period;
+        while (samples.size() * RENDER_TICKS < end) {
+            samples.push_back(samples.size() * RENDER_TICKS - ticks < out.duty);
+        }
+        ticks = end;
+    }
+
+    // Rising edges in each window of the given number of samples
+    std::vector<int> cycles(size_t window) const {
+        std::vector<int> result;
+        for (size_t start = 1; start + window <= samples.size(); start += window) {
+            int edges = 0;
+            for (size_t i = start; i < start + window; i++) {
+                edges += samples[i] && !samples[i - 1];
+            }
+            result.push_back(edges);
+        }
+        return result;
+    }
+
+    std::vector<uint8_t> samples;
+    uint64_t ticks = 0;
+};
+
+static void expect_same_pitch(const Waveform& fixed, const Waveform& reference) {
+    // 10ms windows
+    size_t window = SYNTH_CLOCK / RENDER_TICKS / 100;
+    std::vector<int> a = fixed.cycles(window);
+    std::vector<int> b = reference.cycles(window);
+    size_t n = std::min(a.size(), b.size());
+    ASSERT_GT(n, 0u);
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_NEAR(a[i], b[i], 1) << "window " << i;
+    }
+    double duration = fixed.ticks;
+    EXPECT_NEAR(duration / reference.ticks, 1.0, 0.005);
+}
+
+class Synth : public testing::Test {
+public:
+    Synth() {
+        synth_init(&synth);
+        set_voice(default_voice);
+    }
+
+    synth_t synth;
+};
+
+TEST_F(Synth, converts_frequencies_like_the_float_driver) {
+    EXPECT_EQ(synth_period(440.0f), (uint16_t)(SYNTH_CLOCK / 440.0f));
+    EXPECT_EQ(synth_period(NOTE_C4), (uint16_t)(SYNTH_CLOCK / NOTE_C4));
+    EXPECT_EQ(synth_period(0), 0);
+    EXPECT_EQ(synth_period(10.0f), SYNTH_MAX_PERIOD);
+}
+
+TEST_F(Synth, held_note_matches_float_reference) {
+    FloatReference reference;
+    reference.frequencies = {NOTE_A4};
+    synth_note_on(&synth, NOTE_A4, SYNTH_OWNER_KEY);
+
+    Waveform fixed, expected;
+    for (int i = 0; i < 440; i++) {
+        synth_output_t out;
+        synth_step(&synth, &out, NULL);
+        synth_output_t ref = reference.step();
+        EXPECT_EQ(out.period, ref.period);
+        EXPECT_EQ(out.duty, ref.duty);
+        fixed.add(out);
+        expected.add(ref);
+    }
+    EXPECT_EQ(fixed.samples, expected.samples);
+}
+
+TEST_F(Synth, vibrato_matches_float_reference) {
+    FloatReference reference;
+    reference.frequencies = {NOTE_E5};
+    reference.vibrato = true;
+    synth.vibrato_rate = synth_q8(0.125);
+    synth.vibrato_strength = synth_q8(0.5);
+    synth_note_on(&synth, NOTE_E5, SYNTH_OWNER_KEY);
+
+    Waveform fixed, expected;
+    uint16_t lowest = 0xFFFF, highest = 0;
+    for (int i = 0; i < 2 * 660; i++) {
+        synth_output_t out;
+        synth_step(&synth, &out, NULL);
+        synth_output_t ref = reference.step();
+        EXPECT_NEAR(out.period, ref.period, ref.period / 100);
+        lowest = std::min(lowest, out.period);
+        highest = std::max(highest, out.period);
+        fixed.add(out);
+        expected.add(ref);
+    }
+    // The vibrato is actually there
+    EXPECT_GT(highest - lowest, synth_period(NOTE_E5) / 100);
+    expect_same_pitch(fixed, expected);
+}
+
+TEST_F(Synth, glide_follows_the_float_curve) {
+    const float pairs[][2] = {
+        {NOTE_A4, NOTE_A5},
+        {NOTE_A5, NOTE_A4},
+        {NOTE_C3, NOTE_C6},
+        {NOTE_C6, NOTE_C3},
+        {NOTE_B1, NOTE_E2},
+    };
+    for (auto& pair : pairs) {
+        float frequency = pair[0];
+        uint16_t period = synth_period(pair[0]);
+        uint16_t target = synth_period(pair[1]);
+        int steps = 0, reference_steps = 0;
+        while (frequency != pair[1] && reference_steps < 1000) {
+            frequency = FloatReference::glide(frequency, pair[1]);
+            reference_steps++;
+            if (period != target) {
+                period = synth_glide(period, target);
+                steps++;
+                // Either may snap to the target a step before the other
+                if (period != target && frequency != pair[1]) {
+                    uint16_t expected = synth_period(frequency);
+                    EXPECT_NEAR(period, expected, expected / 100 + 1) << pair[0] << " -> " << pair[1] << " step " << steps;
+                }
+            }
+        }
+        while (period != target && steps < 1000) {
+            period = synth_glide(period, target);
+            steps++;
+        }
+        EXPECT_NEAR(steps, reference_steps, 1) << pair[0] << " -> " << pair[1];
+    }
+}
+
+TEST_F(Synth, polyphony_matches_float_reference) {
+    FloatReference reference;
+    reference.frequencies = {NOTE_C4, NOTE_E4, NOTE_G4};
+    reference.polyphony_rate = 5;
+    synth_note_on(&synth, NOTE_C4, SYNTH_OWNER_KEY);
+    synth_note_on(&synth, NOTE_E4, SYNTH_OWNER_KEY);
+    synth_note_on(&synth, NOTE_G4, SYNTH_OWNER_KEY);
+    synth_set_polyphony_rate(&synth, 5);
+
+    Waveform fixed, expected;
+    int mismatches = 0;
+    const int steps = 2000;
+    for (int i = 0; i < steps; i++) {
+        synth_output_t out;
+        synth_step(&synth, &out, NULL);
+        synth_output_t ref = reference.step();
+        mismatches += out.period != ref.period;
+        fixed.add(out);
+        expected.add(ref);
+    }
+    EXPECT_LT(mismatches, steps / 50);
+    expect_same_pitch(fixed, expected);
+}
+
+TEST_F(Synth, second_channel_gets_the_previous_note) {
+    synth_note_on(&synth, NOTE_C4, SYNTH_OWNER_KEY);
+    synth_note_on(&synth, NOTE_G4, SYNTH_OWNER_KEY);
+    synth_output_t out, alt;
+    synth_step(&synth, &out, &alt);
+    EXPECT_EQ(out.period, synth_period(NOTE_G4));
+    EXPECT_EQ(alt.period, synth_period(NOTE_C4));
+
+    synth_note_off(&synth, NOTE_G4, SYNTH_OWNER_KEY);
+    synth_step(&synth, &out, &alt);
+    EXPECT_EQ(out.period, synth_period(NOTE_C4));
+    EXPECT_EQ(alt.period, 0);
+
+    synth_note_off(&synth, NOTE_C4, SYNTH_OWNER_KEY);
+    EXPECT_EQ(synth.voices, 0);
+}
+
+TEST_F(Synth, stopping_a_note_that_isnt_held_keeps_the_others) {
+    synth_note_on(&synth, NOTE_C4, SYNTH_OWNER_KEY);
+    synth_note_off(&synth, NOTE_D4, SYNTH_OWNER_KEY);
+    EXPECT_EQ(synth.voices, 1);
+}
+
+TEST_F(Synth, a_song_doesnt_stop_a_held_key_of_the_same_pitch) {
+    synth_note_on(&synth, NOTE_A4, SYNTH_OWNER_KEY);
+    synth_note_on(&synth, NOTE_A4, SYNTH_OWNER_SONG);
+    synth_note_off(&synth, NOTE_A4, SYNTH_OWNER_SONG);
+    ASSERT_EQ(synth.voices, 1);
+    EXPECT_EQ(synth.owners[0], SYNTH_OWNER_KEY);
+
+    synth_note_off(&synth, NOTE_A4, SYNTH_OWNER_SONG);
+    EXPECT_EQ(synth.voices, 1);
+}
@@ -14,15 +14,21 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "voices.h"
-#include "audio.h"
-#include "stdlib.h"
+#include "musical_notes.h"
+#include <stdlib.h>
 
-// these are imported from audio.c
+// these are imported from audio.c, for voice_envelope()
 extern uint16_t envelope_index;
 extern float note_timbre;
 extern float polyphony_rate;
 extern bool glissando;
 
+#define Q8(x) ((uint16_t)((x) * 256))
+// Period of a frequency in Hz
+#define HZ(f) ((uint16_t)(SYNTH_CLOCK / (f)))
+// 880 / frequency in Q8 is period * VOICE_880_K >> 16
+#define VOICE_880_K ((uint32_t)(880.0 * 16777216.0 / SYNTH_CLOCK + 0.5))
+
 voice_type voice = default_voice;
 
 void set_voice(voice_type v) {
@@ -37,45 +43,62 @@ void voice_deiterate() {
     voice = (voice - 1 + number_of_voices) % number_of_voices;
 }
 
-float voice_envelope(float frequency) {
-    // envelope_index ranges from 0 to 0xFFFF, which is preserved at 880.0 Hz
+#ifdef AUDIO_VOICES
+
+// envelope_index ranges from 0 to 0xFFFF, which is preserved at 880.0 Hz
+static uint16_t compensated_index(uint16_t index, uint16_t period) {
+    uint32_t ratio = ((uint32_t)period * VOICE_880_K) >> 16;
+    uint32_t compensated = ((uint32_t)index * ratio) >> 8;
+    return compensated > 0xFFFF ? 0xFFFF : compensated;
+}
+
+static uint16_t scale_period(uint16_t period, uint8_t factor) {
+    uint32_t scaled = (uint32_t)period * factor;
+    return scaled > SYNTH_MAX_PERIOD ? SYNTH_MAX_PERIOD : scaled;
+}
+
+// Random period between shortest and longest
+static uint16_t random_period(uint16_t shortest, uint16_t longest) {
+    return shortest + rand() % (longest - shortest);
+}
+
+#endif
+
+uint16_t voice_envelope_period(synth_t *synth, uint16_t period) {
     __attribute__ ((unused))
-    uint16_t compensated_index = (uint16_t)((float)envelope_index * (880.0 / frequency));
+    uint16_t index = synth->envelope_index;
 
     switch (voice) {
         case default_voice:
-            glissando = false;
-            note_timbre = TIMBRE_50;
-            polyphony_rate = 0;
-	        break;
+            synth->glissando = false;
+            synth->timbre = Q8(TIMBRE_50);
+            break;
 
     #ifdef AUDIO_VOICES
 
         case something:
-            glissando = false;
-            polyphony_rate = 0;
-            switch (compensated_index) {
+            synth->glissando = false;
+            switch (compensated_index(index, period)) {
                 case 0 ... 9:
-                    note_timbre = TIMBRE_12;
+                    synth->timbre = Q8(TIMBRE_12);
                     break;
 
                 case 10 ... 19:
-                    note_timbre = TIMBRE_25;
+                    synth->timbre = Q8(TIMBRE_25);
                     break;
 
                 case 20 ... 200:
-                    note_timbre = .125 + .125;
+                    synth->timbre = Q8(.125 + .125);
                     break;
 
                 default:
-                    note_timbre = .125;
+                    synth->timbre = Q8(.125);
                     break;
             }
             break;
 
         case drums:
-            glissando = false;
-            polyphony_rate = 0;
+            synth->glissando = false;
                 // switch (compensated_index) {
                 //     case 0 ... 10:
                 //         note_timbre = 0.5;
@@ -89,98 +112,98 @@ float voice_envelope(float frequency) {
                 // }
                 // frequency = (rand() % (int)(frequency * 1.2 - frequency)) + (frequency * 0.8);
 
-            if (frequency < 80.0) {
+            if (period > HZ(80)) {
 
-            } else if (frequency < 160.0) {
+            } else if (period > HZ(160)) {
 
                 // Bass drum: 60 - 100 Hz
-                frequency = (rand() % (int)(40)) + 60;
-                switch (envelope_index) {
+                period = random_period(HZ(100), HZ(60));
+                switch (index) {
                     case 0 ... 10:
-                        note_timbre = 0.5;
+                        synth->timbre = Q8(0.5);
                         break;
                     case 11 ... 20:
-                        note_timbre = 0.5 * (21 - envelope_index) / 10;
+                        synth->timbre = Q8(0.5) * (21 - index) / 10;
                         break;
                     default:
-                        note_timbre = 0;
+                        synth->timbre = 0;
                         break;
                 }
 
-            } else if (frequency < 320.0) {
-
+            } else if (period > HZ(320)) {
 
                 // Snare drum: 1 - 2 KHz
-                frequency = (rand() % (int)(1000)) + 1000;
-                switch (envelope_index) {
+                period = random_period(HZ(2000), HZ(1000));
+                switch (index) {
                     case 0 ... 5:
-                        note_timbre = 0.5;
+                        synth->timbre = Q8(0.5);
                         break;
                     case 6 ... 20:
-                        note_timbre = 0.5 * (21 - envelope_index) / 15;
+                        synth->timbre = Q8(0.5) * (21 - index) / 15;
                         break;
                     default:
-                        note_timbre = 0;
+                        synth->timbre = 0;
                         break;
                 }
 
-            } else if (frequency < 640.0) {
+            } else if (period > HZ(640)) {
 
                 // Closed Hi-hat: 3 - 5 KHz
-                frequency = (rand() % (int)(2000)) + 3000;
-                switch (envelope_index) {
+                period = random_period(HZ(5000), HZ(3000));
+                switch (index) {
                     case 0 ... 15:
-                        note_timbre = 0.5;
+                        synth->timbre = Q8(0.5);
                         break;
                     case 16 ... 20:
-                        note_timbre = 0.5 * (21 - envelope_index) / 5;
+                        synth->timbre = Q8(0.5) * (21 - index) / 5;
                         break;
                     default:
-                        note_timbre = 0;
+                        synth->timbre = 0;
                         break;
                 }
 
-            } else if (frequency < 1280.0) {
+            } else if (period > HZ(1280)) {
 
                 // Open Hi-hat: 3 - 5 KHz
-                frequency = (rand() % (int)(2000)) + 3000;
-                switch (envelope_index) {
+                period = random_period(HZ(5000), HZ(3000));
+                switch (index) {
                     case 0 ... 35:
-                        note_timbre = 0.5;
+                        synth->timbre = Q8(0.5);
                         break;
                     case 36 ... 50:
-                        note_timbre = 0.5 * (51 - envelope_index) / 15;
+                        synth->timbre = Q8(0.5) * (51 - index) / 15;
                         break;
                     default:
-                        note_timbre = 0;
+                        synth->timbre = 0;
                         break;
                 }
 
             }
             break;
         case butts_fader:
-            glissando = true;
-            polyphony_rate = 0;
-            switch (compensated_index) {
+            synth->glissando = true;
+            switch (compensated_index(index, period)) {
                 case 0 ... 9:
-                    frequency = frequency / 4;
-                    note_timbre = TIMBRE_12;
-	                break;
+                    period = scale_period(period, 4);
+                    synth->timbre = Q8(TIMBRE_12);
+                    break;
 
                 case 10 ... 19:
-                    frequency = frequency / 2;
-                    note_timbre = TIMBRE_12;
-	                break;
+                    period = scale_period(period, 2);
+                    synth->timbre = Q8(TIMBRE_12);
+                    break;
 
-                case 20 ... 200:
-                    note_timbre = .125 - pow(((float)compensated_index - 20) / (200 - 20), 2)*.125;
-	                break;
+                case 20 ... 200: {
+                    uint32_t fade = compensated_index(index, period) - 20;
+                    synth->timbre = Q8(.125) - Q8(.125) * fade * fade / ((200 - 20) * (200 - 20));
+                    break;
+                }
 
                 default:
-                    note_timbre = 0;
-                	break;
+                    synth->timbre = 0;
+                    break;
             }
-    	    break;
+            break;
 
         // case octave_crunch:
         //     polyphony_rate = 0;
@@ -206,42 +229,35 @@ float voice_envelope(float frequency) {
 	       //  break;
 
         case duty_osc:
-            // This slows the loop down a substantial amount, so higher notes may freeze
-            glissando = true;
-            polyphony_rate = 0;
-            switch (compensated_index) {
-                default:
-                    #define OCS_SPEED 10
-                    #define OCS_AMP   .25
-                    // sine wave is slow
-                    // note_timbre = (sin((float)compensated_index/10000*OCS_SPEED) * OCS_AMP / 2) + .5;
-                    // triangle wave is a bit faster
-                    note_timbre = (float)abs((compensated_index*OCS_SPEED % 3000) - 1500) * ( OCS_AMP / 1500 ) + (1 - OCS_AMP) / 2;
-                	break;
-            }
-	        break;
+            synth->glissando = true;
+            #define OCS_SPEED 10
+            #define OCS_AMP   .25
+            // sine wave is slow
+            // note_timbre = (sin((float)compensated_index/10000*OCS_SPEED) * OCS_AMP / 2) + .5;
+            // triangle wave is a bit faster
+            synth->timbre = (uint32_t)abs((int32_t)((uint32_t)compensated_index(index, period) * OCS_SPEED % 3000) - 1500) * Q8(OCS_AMP) / 1500 + Q8((1 - OCS_AMP) / 2);
+            break;
 
         case duty_octave_down:
-            glissando = true;
-            polyphony_rate = 0;
-            note_timbre = (envelope_index % 2) * .125 + .375 * 2;
-            if ((envelope_index % 4) == 0)
-                note_timbre = 0.5;
-            if ((envelope_index % 8) == 0)
-                note_timbre = 0;
+            synth->glissando = true;
+            synth->timbre = (index % 2) * Q8(.125) + Q8(.375 * 2);
+            if ((index % 4) == 0)
+                synth->timbre = Q8(0.5);
+            if ((index % 8) == 0)
+                synth->timbre = 0;
             break;
         case delayed_vibrato:
-            glissando = true;
-            polyphony_rate = 0;
-            note_timbre = TIMBRE_50;
+            synth->glissando = true;
+            synth->timbre = Q8(TIMBRE_50);
             #define VOICE_VIBRATO_DELAY 150
             #define VOICE_VIBRATO_SPEED 50
-            switch (compensated_index) {
-                case 0 ... VOICE_VIBRATO_DELAY:
-                    break;
-                default:
-                    frequency = frequency * vibrato_lut[(int)fmod((((float)compensated_index - (VOICE_VIBRATO_DELAY + 1))/1000*VOICE_VIBRATO_SPEED), VIBRATO_LUT_LENGTH)];
-                    break;
+            {
+                uint16_t compensated = compensated_index(index, period);
+                if (compensated > VOICE_VIBRATO_DELAY) {
+                    uint16_t step = (compensated - (VOICE_VIBRATO_DELAY + 1)) / (1000 / VOICE_VIBRATO_SPEED);
+                    int32_t offset = vibrato_period_lut[step % VIBRATO_LUT_LENGTH];
+                    period = period + (((int32_t)period * offset) >> 16);
+                }
             }
             break;
         // case delayed_vibrato_octave:
@@ -288,9 +304,29 @@ float voice_envelope(float frequency) {
 
     #endif
 
-		default:
-   			break;
+        default:
+            break;
     }
 
-    return frequency;
+    return period;
+}
+
+// Frequency based wrapper for the drivers that don't use the synth core
+float voice_envelope(float frequency) {
+    synth_t synth = {
+        .envelope_index = envelope_index,
+        .timbre = synth_q8(note_timbre),
+        .glissando = glissando,
+    };
+    uint16_t period = synth_period(frequency);
+    uint16_t envelope_period = voice_envelope_period(&synth, period);
+
+    note_timbre = synth.timbre / 256.0f;
+    glissando = synth.glissando;
+    polyphony_rate = 0;
+
+    if (envelope_period == period || envelope_period == 0) {
+        return frequency;
+    }
+    return (float)SYNTH_CLOCK / envelope_period;
 }
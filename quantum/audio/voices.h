@@ -20,11 +20,15 @@
 #endif
 #include "wait.h"
 #include "luts.h"
+#include "synth.h"
 
 #ifndef VOICES_H
 #define VOICES_H
 
 float voice_envelope(float frequency);
+// Fixed point version used by the synth core, see synth.h. Applies the current
+// voice to period, and sets the timbre and glissando of synth.
+uint16_t voice_envelope_period(synth_t *synth, uint16_t period);
 
 typedef enum {
     default_voice,
@@ -0,0 +1,131 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "backlight_pwm.h"
+#include "led_tables.h"
+#include "progmem.h"
+
+#define BREATHING_TOP_INDEX 128
+
+// The breath position is 8.16 fixed point, the integer part indexes
+// LED_BREATHING_TABLE
+#define PHASE_MASK 0xFFFFFFUL
+
+#define FADE_PERIODS (BACKLIGHT_FADE_MS * BACKLIGHT_PWM_FREQUENCY / 1000UL)
+#if FADE_PERIODS > 0
+// 8.8 fixed point steps that take 0 to 255 in BACKLIGHT_FADE_MS
+#define FADE_STEP ((uint16_t)((255UL << 8) / FADE_PERIODS))
+#endif
+
+enum { NO_JUMP, JUMP_BOTTOM, JUMP_TOP };
+
+// Written by the main loop, the interrupt only reads these, all single bytes
+static volatile uint8_t target = 0;
+static volatile bool breathing = false;
+static volatile uint8_t halt = BACKLIGHT_BREATHING_NO_HALT;
+static volatile uint8_t period = BREATHING_PERIOD;
+static volatile uint8_t jump = NO_JUMP;
+
+// Only touched in the interrupt
+static uint16_t current = 0;    // 8.8 fixed point brightness
+static uint32_t phase = 0;
+static uint32_t phase_step;
+static uint8_t step_period = 0;
+
+void backlight_pwm_set_brightness(uint8_t brightness) {
+    target = brightness;
+}
+
+uint8_t backlight_pwm_get_brightness(void) {
+    return target;
+}
+
+void backlight_pwm_breathing(bool on) {
+    breathing = on;
+}
+
+bool backlight_pwm_is_breathing(void) {
+    return breathing;
+}
+
+void backlight_pwm_breathing_jump(bool top) {
+    jump = top ? JUMP_TOP : JUMP_BOTTOM;
+}
+
+void backlight_pwm_breathing_halt(uint8_t value) {
+    halt = value;
+}
+
+void backlight_pwm_breathing_period(uint8_t seconds) {
+    period = seconds ? seconds : 1;
+}
+
+uint8_t backlight_pwm_get_breathing_period(void) {
+    return period;
+}
+
+uint16_t backlight_pwm_cie(uint8_t brightness) {
+    return pgm_read_byte(&CIE1931_CURVE[brightness]) * 0x0101U;
+}
+
+static void fade(void) {
+    uint16_t to = (uint16_t)target << 8;
+
+#ifdef FADE_STEP
+    if (to > current) {
+        current = to - current > FADE_STEP ? current + FADE_STEP : to;
+    } else {
+        current = current - to > FADE_STEP ? current - FADE_STEP : to;
+    }
+#else
+    current = to;
+#endif
+}
+
+// Scales the breathing curve to the brightness, 255 * 255 stays 255
+static uint8_t breathe(uint8_t brightness) {
+    uint8_t before, index;
+
+    if (step_period != period) {
+        // the one division, only when the period changes
+        step_period = period;
+        phase_step = (PHASE_MASK + 1) / ((uint32_t)step_period * BACKLIGHT_PWM_FREQUENCY);
+    }
+    if (jump != NO_JUMP) {
+        phase = jump == JUMP_TOP ? (uint32_t)BREATHING_TOP_INDEX << 16 : 0;
+        jump = NO_JUMP;
+    }
+
+    before = phase >> 16;
+    phase = (phase + phase_step) & PHASE_MASK;
+    index = phase >> 16;
+
+    if ((halt == BACKLIGHT_BREATHING_HALT_ON && before < BREATHING_TOP_INDEX && index >= BREATHING_TOP_INDEX) ||
+        (halt == BACKLIGHT_BREATHING_HALT_OFF && index < before)) {
+        breathing = false;
+        return brightness;
+    }
+    return ((uint16_t)pgm_read_byte(&LED_BREATHING_TABLE[index]) * brightness + 255) >> 8;
+}
+
+uint16_t backlight_pwm_tick(void) {
+    uint8_t brightness;
+
+    fade();
+    brightness = current >> 8;
+    if (breathing) {
+        brightness = breathe(brightness);
+    }
+    return backlight_pwm_cie(brightness);
+}
@@ -0,0 +1,77 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKLIGHT_PWM_H
+#define BACKLIGHT_PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Works out the backlight duty cycle once per PWM period, from the timer
+ * overflow interrupt. Brightness goes through the CIE1931 curve, fades and
+ * breathing advance by one step per period using integer math only.
+ */
+
+/* Top of the 16 bit PWM timer, the duty cycle is out of this */
+#define BACKLIGHT_PWM_TOP 0xFFFFU
+
+/* PWM periods per second, Timer1 counting to BACKLIGHT_PWM_TOP without a
+ * prescaler: 244 at 16MHz, 122 at 8MHz */
+#ifndef BACKLIGHT_PWM_FREQUENCY
+#  ifdef F_CPU
+#    define BACKLIGHT_PWM_FREQUENCY (F_CPU / (BACKLIGHT_PWM_TOP + 1UL))
+#  else
+#    define BACKLIGHT_PWM_FREQUENCY 244
+#  endif
+#endif
+
+/* ms a brightness change takes to fade in, 0 changes right away */
+#ifndef BACKLIGHT_FADE_MS
+#define BACKLIGHT_FADE_MS 0
+#endif
+
+/* Seconds of one breath */
+#ifndef BREATHING_PERIOD
+#define BREATHING_PERIOD 6
+#endif
+
+/* Where breathing stops by itself */
+enum backlight_breathing_halt {
+    BACKLIGHT_BREATHING_NO_HALT,
+    BACKLIGHT_BREATHING_HALT_OFF,   // at the bottom of a breath
+    BACKLIGHT_BREATHING_HALT_ON     // at the top
+};
+
+/* 0-255, fades there unless BACKLIGHT_FADE_MS is 0 */
+void backlight_pwm_set_brightness(uint8_t brightness);
+uint8_t backlight_pwm_get_brightness(void);
+
+void backlight_pwm_breathing(bool on);
+bool backlight_pwm_is_breathing(void);
+/* Moves the breath to the bottom (false) or top (true) */
+void backlight_pwm_breathing_jump(bool top);
+void backlight_pwm_breathing_halt(uint8_t halt);
+void backlight_pwm_breathing_period(uint8_t seconds);
+uint8_t backlight_pwm_get_breathing_period(void);
+
+/* Perceived brightness 0-255 to a duty cycle out of BACKLIGHT_PWM_TOP */
+uint16_t backlight_pwm_cie(uint8_t brightness);
+
+/* Advances one PWM period and returns the duty cycle for the next one,
+ * out of BACKLIGHT_PWM_TOP. Called from the timer interrupt. */
+uint16_t backlight_pwm_tick(void);
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <cmath>
+extern "C" {
+#include "backlight_pwm.h"
+}
+
+#define TOP BACKLIGHT_PWM_TOP
+#define FREQUENCY BACKLIGHT_PWM_FREQUENCY
+#define FADE_PERIODS (BACKLIGHT_FADE_MS * FREQUENCY / 1000)
+
+// Perceived lightness 0-100 of a duty cycle 0-1, the CIE1931 formula
+static double lightness(double y) {
+    return y > 0.008856 ? 116 * std::cbrt(y) - 16 : 903.3 * y;
+}
+
+/*
+ * Timer1 and the two interrupts of the software PWM in quantum.c, counting
+ * one clock at a time. OCR1B only takes effect at the next period.
+ */
+class SoftwarePwm {
+   public:
+    SoftwarePwm() : ocr(0), duty(0), pin(false) {}
+
+    // Runs one period, returns the clocks the pin was on
+    uint32_t period() {
+        uint32_t on = 0;
+
+        // overflow interrupt
+        duty = ocr;
+        if (duty) {
+            pin = true;
+        }
+        ocr = backlight_pwm_tick();
+
+        for (uint32_t count = 0; count <= TOP; count++) {
+            // compare B interrupt
+            if (count == duty && duty < TOP) {
+                pin = false;
+            }
+            on += pin;
+        }
+        return on;
+    }
+
+   private:
+    uint16_t ocr;
+    uint16_t duty;
+    bool pin;
+};
+
+class BacklightPwm : public ::testing::Test {
+   public:
+    BacklightPwm() {
+        backlight_pwm_breathing(false);
+        backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_NO_HALT);
+        backlight_pwm_breathing_period(BREATHING_PERIOD);
+        set_and_settle(0);
+    }
+
+    // Fades all the way to brightness, returns the last duty cycle
+    uint16_t set_and_settle(uint8_t brightness) {
+        uint16_t duty = 0;
+        backlight_pwm_set_brightness(brightness);
+        for (int i = 0; i <= FADE_PERIODS + 1; i++) {
+            duty = backlight_pwm_tick();
+        }
+        return duty;
+    }
+};
+
+TEST_F(BacklightPwm, CieCurveCoversTheWholeRange) {
+    EXPECT_EQ(backlight_pwm_cie(0), 0);
+    EXPECT_EQ(backlight_pwm_cie(255), TOP);
+    for (int b = 1; b < 256; b++) {
+        EXPECT_GE(backlight_pwm_cie(b), backlight_pwm_cie(b - 1)) << "brightness " << b;
+    }
+}
+
+TEST_F(BacklightPwm, CieCurveIsPerceptuallyLinear) {
+    // the table has 8 bits of output, the low end is off by up to 1.6 L*
+    for (int b = 0; b < 256; b++) {
+        double l = lightness(backlight_pwm_cie(b) / (double)TOP);
+        EXPECT_NEAR(l, b * 100.0 / 255, 2.0) << "brightness " << b;
+    }
+}
+
+TEST_F(BacklightPwm, SoftwarePwmDutyCycleIsExact) {
+    SoftwarePwm pwm;
+
+    for (int b = 0; b < 256; b += 15) {
+        uint16_t duty = set_and_settle(b);
+        pwm.period();   // the duty cycle of the last tick is now latched
+        uint32_t on = pwm.period();
+        if (duty == TOP) {
+            EXPECT_EQ(on, TOP + 1) << "brightness " << b;
+        } else {
+            EXPECT_EQ(on, duty) << "brightness " << b;
+        }
+    }
+}
+
+TEST_F(BacklightPwm, SoftwarePwmIsOffAtZero) {
+    SoftwarePwm pwm;
+
+    set_and_settle(0);
+    EXPECT_EQ(pwm.period(), 0u);
+    EXPECT_EQ(pwm.period(), 0u);
+}
+
+TEST_F(BacklightPwm, FadesInBacklightFadeMs) {
+    uint16_t last = 0, duty = 0;
+    int periods = 0;
+
+    backlight_pwm_set_brightness(255);
+    while (duty < TOP && periods < 10 * FADE_PERIODS) {
+        duty = backlight_pwm_tick();
+        EXPECT_GE(duty, last);
+        last = duty;
+        periods++;
+    }
+    EXPECT_NEAR(periods, FADE_PERIODS, 1);
+    EXPECT_EQ(backlight_pwm_get_brightness(), 255);
+}
+
+TEST_F(BacklightPwm, FadesDownAndStopsAtTheTarget) {
+    int periods = 0;
+
+    set_and_settle(255);
+    backlight_pwm_set_brightness(128);
+    while (backlight_pwm_tick() > backlight_pwm_cie(128) && periods < 10 * FADE_PERIODS) {
+        periods++;
+    }
+    EXPECT_NEAR(periods, FADE_PERIODS / 2, 1);
+    for (int i = 0; i < FADE_PERIODS; i++) {
+        EXPECT_EQ(backlight_pwm_tick(), backlight_pwm_cie(128));
+    }
+}
+
+TEST_F(BacklightPwm, BreathingTakesThePeriod) {
+    const int period = 2 * FREQUENCY;
+    uint16_t duty[period];
+
+    set_and_settle(255);
+    backlight_pwm_breathing_period(2);
+    backlight_pwm_breathing_jump(false);
+    backlight_pwm_breathing(true);
+    for (int i = 0; i < period; i++) {
+        duty[i] = backlight_pwm_tick();
+    }
+
+    // dark at both ends, brightest in the middle, up then down
+    EXPECT_LT(duty[0], TOP / 100);
+    EXPECT_LT(duty[period - 1], TOP / 100);
+    EXPECT_GT(duty[period / 2], TOP * 9 / 10);
+    for (int i = 1; i < period / 2 - 2; i++) {
+        EXPECT_GE(duty[i], duty[i - 1]) << "period " << i;
+    }
+    for (int i = period / 2 + 2; i < period; i++) {
+        EXPECT_LE(duty[i], duty[i - 1]) << "period " << i;
+    }
+    EXPECT_TRUE(backlight_pwm_is_breathing());
+}
+
+TEST_F(BacklightPwm, BreathingIsScaledToTheBrightness) {
+    uint16_t top = 0;
+
+    set_and_settle(128);
+    backlight_pwm_breathing_period(1);
+    backlight_pwm_breathing(true);
+    for (int i = 0; i < FREQUENCY; i++) {
+        uint16_t duty = backlight_pwm_tick();
+        top = duty > top ? duty : top;
+    }
+    EXPECT_LE(top, backlight_pwm_cie(128));
+    EXPECT_GE(top, backlight_pwm_cie(126));
+}
+
+TEST_F(BacklightPwm, HaltOnStopsAtTheTop) {
+    int periods = 0;
+
+    set_and_settle(255);
+    backlight_pwm_breathing_period(2);
+    backlight_pwm_breathing_jump(false);
+    backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_HALT_ON);
+    backlight_pwm_breathing(true);
+    while (backlight_pwm_is_breathing() && periods < 10 * FREQUENCY) {
+        backlight_pwm_tick();
+        periods++;
+    }
+    EXPECT_NEAR(periods, FREQUENCY, 2);
+    EXPECT_EQ(backlight_pwm_tick(), TOP);
+}
+
+TEST_F(BacklightPwm, HaltOffStopsAtTheBottom) {
+    int periods = 0;
+
+    set_and_settle(255);
+    backlight_pwm_breathing_period(1);
+    backlight_pwm_breathing_jump(true);
+    backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_HALT_OFF);
+    backlight_pwm_breathing(true);
+    while (backlight_pwm_is_breathing() && periods < 10 * FREQUENCY) {
+        backlight_pwm_tick();
+        periods++;
+    }
+    EXPECT_NEAR(periods, FREQUENCY / 2, 2);
+}
+
+TEST_F(BacklightPwm, ChangingThePeriodKeepsThePosition) {
+    set_and_settle(255);
+    backlight_pwm_breathing_period(4);
+    backlight_pwm_breathing_jump(true);
+    backlight_pwm_breathing(true);
+    uint16_t before = backlight_pwm_tick();
+    backlight_pwm_breathing_period(1);
+    uint16_t after = backlight_pwm_tick();
+
+    EXPECT_GT(before, TOP * 9 / 10);
+    EXPECT_GT(after, TOP * 9 / 10);
+    EXPECT_EQ(backlight_pwm_get_breathing_period(), 1);
+}
+
+TEST_F(BacklightPwm, ZeroPeriodIsOneSecond) {
+    backlight_pwm_breathing_period(0);
+    EXPECT_EQ(backlight_pwm_get_breathing_period(), 1);
+}
+
+TEST_F(BacklightPwm, FrequencyFollowsTheCpuClock) {
+    // Timer1 counting to 0xFFFF at 8MHz
+    EXPECT_EQ(FREQUENCY, 122u);
+}
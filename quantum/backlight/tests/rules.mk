@@ -0,0 +1,12 @@
+backlight_pwm_SRC := \
+	$(QUANTUM_PATH)/backlight/tests/backlight_pwm_tests.cpp \
+	$(QUANTUM_PATH)/backlight/backlight_pwm.c \
+	$(QUANTUM_PATH)/led_tables.c
+
+backlight_pwm_INC := $(QUANTUM_PATH)/backlight
+
+backlight_pwm_DEFS := \
+	-DUSE_CIE1931_CURVE \
+	-DUSE_LED_BREATHING_TABLE \
+	-DBACKLIGHT_FADE_MS=500 \
+	-DF_CPU=8000000UL
@@ -0,0 +1,228 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "keymap.h"
+#include "eeprom.h"
+#include "progmem.h"
+#include "dynamic_keymap.h"
+#ifdef RAW_ENABLE
+#include "raw_hid.h"
+#endif
+
+/*
+ * EEPROM layout, from DYNAMIC_KEYMAP_EEPROM_ADDR:
+ *
+ *  0-1  magic
+ *  2    DYNAMIC_KEYMAP_VERSION
+ *  3    layers
+ *  4    rows
+ *  5    cols
+ *  6-7  unused
+ *  8-   keycodes, big endian, layer by layer, row by row
+ *
+ * A header that doesn't match this firmware means the keymap is copied from
+ * keymaps[] again.
+ */
+#define DYNAMIC_KEYMAP_MAGIC 0x4B4D
+#define KEYCODES_ADDR (DYNAMIC_KEYMAP_EEPROM_ADDR + 8)
+#define EEPROM_PTR(addr) ((uint8_t *)(uintptr_t)(addr))
+#define KEYCODES_SIZE ((uint16_t)DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2)
+
+#if DYNAMIC_KEYMAP_EEPROM_ADDR + 8 + DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2 > EEPROM_BYTE_COUNT
+#  error "The dynamic keymap doesn't fit in EEPROM, lower DYNAMIC_KEYMAP_LAYER_COUNT"
+#endif
+
+#define NO_LAYER 0xFF
+
+// The keycodes of each key on the layers it was last looked up on, most
+// recent first. A miss reads just that key from EEPROM and drops the oldest.
+static uint16_t cache[MATRIX_ROWS][MATRIX_COLS][DYNAMIC_KEYMAP_CACHE_LAYERS];
+static uint8_t cache_layer[MATRIX_ROWS][MATRIX_COLS][DYNAMIC_KEYMAP_CACHE_LAYERS];
+
+static uint8_t *keycode_addr(uint8_t layer, uint8_t row, uint8_t col) {
+    return EEPROM_PTR(KEYCODES_ADDR + (((uint16_t)layer * MATRIX_ROWS + row) * MATRIX_COLS + col) * 2);
+}
+
+static void write_keycode(uint8_t layer, uint8_t row, uint8_t col, uint16_t keycode) {
+    uint8_t *addr = keycode_addr(layer, row, col);
+    eeprom_update_byte(addr, keycode >> 8);
+    eeprom_update_byte(addr + 1, keycode & 0xFF);
+}
+
+static void cache_clear(void) {
+    memset(cache_layer, NO_LAYER, sizeof(cache_layer));
+#ifdef ACTION_TABLE_ENABLE
+    action_table_invalidate();
+#endif
+}
+
+static bool header_matches(void) {
+    const uint8_t *header = EEPROM_PTR(DYNAMIC_KEYMAP_EEPROM_ADDR);
+    return eeprom_read_word((const uint16_t *)header) == DYNAMIC_KEYMAP_MAGIC &&
+        eeprom_read_byte(header + 2) == DYNAMIC_KEYMAP_VERSION &&
+        eeprom_read_byte(header + 3) == DYNAMIC_KEYMAP_LAYER_COUNT &&
+        eeprom_read_byte(header + 4) == MATRIX_ROWS &&
+        eeprom_read_byte(header + 5) == MATRIX_COLS;
+}
+
+void dynamic_keymap_init(void) {
+    cache_clear();
+    if (!header_matches()) {
+        dynamic_keymap_reset();
+    }
+}
+
+void dynamic_keymap_reset(void) {
+    uint8_t *header = EEPROM_PTR(DYNAMIC_KEYMAP_EEPROM_ADDR);
+
+    // invalid while the copy is made, so a reset half way starts over
+    eeprom_update_word((uint16_t *)header, 0xFFFF);
+    for (uint8_t layer = 0; layer < DYNAMIC_KEYMAP_LAYER_COUNT; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                write_keycode(layer, row, col, pgm_read_word(&keymaps[layer][row][col]));
+            }
+        }
+    }
+    eeprom_update_byte(header + 2, DYNAMIC_KEYMAP_VERSION);
+    eeprom_update_byte(header + 3, DYNAMIC_KEYMAP_LAYER_COUNT);
+    eeprom_update_byte(header + 4, MATRIX_ROWS);
+    eeprom_update_byte(header + 5, MATRIX_COLS);
+    eeprom_update_word((uint16_t *)header, DYNAMIC_KEYMAP_MAGIC);
+    cache_clear();
+}
+
+uint16_t dynamic_keymap_get_keycode(uint8_t layer, uint8_t row, uint8_t col) {
+    if (layer >= DYNAMIC_KEYMAP_LAYER_COUNT || row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+        return KC_NO;
+    }
+    uint16_t *keycodes = cache[row][col];
+    uint8_t *layers = cache_layer[row][col];
+    uint8_t i = 0;
+    while (i < DYNAMIC_KEYMAP_CACHE_LAYERS - 1 && layers[i] != layer) {
+        i++;
+    }
+
+    uint16_t keycode;
+    if (layers[i] == layer) {
+        keycode = keycodes[i];
+    } else {
+        const uint8_t *addr = keycode_addr(layer, row, col);
+        // stored big endian
+        keycode = (eeprom_read_byte(addr) << 8) | eeprom_read_byte(addr + 1);
+    }
+    // move it to the front
+    memmove(&keycodes[1], &keycodes[0], i * sizeof(keycodes[0]));
+    memmove(&layers[1], &layers[0], i);
+    keycodes[0] = keycode;
+    layers[0] = layer;
+    return keycode;
+}
+
+void dynamic_keymap_set_keycode(uint8_t layer, uint8_t row, uint8_t col, uint16_t keycode) {
+    if (layer >= DYNAMIC_KEYMAP_LAYER_COUNT || row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+        return;
+    }
+    write_keycode(layer, row, col, keycode);
+#ifdef ACTION_TABLE_ENABLE
+    action_table_invalidate();
+#endif
+    for (uint8_t i = 0; i < DYNAMIC_KEYMAP_CACHE_LAYERS; i++) {
+        if (cache_layer[row][col][i] == layer) {
+            cache[row][col][i] = keycode;
+        }
+    }
+}
+
+static bool valid_key(const uint8_t *position) {
+    return position[0] < DYNAMIC_KEYMAP_LAYER_COUNT && position[1] < MATRIX_ROWS && position[2] < MATRIX_COLS;
+}
+
+bool dynamic_keymap_process_command(uint8_t *data, uint8_t length) {
+    bool ok = true;
+
+    if (length < 6) {
+        return false;
+    }
+
+    switch (data[0]) {
+        case DYNAMIC_KEYMAP_GET_INFO:
+            data[1] = DYNAMIC_KEYMAP_VERSION;
+            data[2] = DYNAMIC_KEYMAP_LAYER_COUNT;
+            data[3] = MATRIX_ROWS;
+            data[4] = MATRIX_COLS;
+            break;
+        case DYNAMIC_KEYMAP_GET_KEYCODE:
+            if ((ok = valid_key(&data[1]))) {
+                uint16_t keycode = dynamic_keymap_get_keycode(data[1], data[2], data[3]);
+                data[4] = keycode >> 8;
+                data[5] = keycode & 0xFF;
+            }
+            break;
+        case DYNAMIC_KEYMAP_SET_KEYCODE:
+            if ((ok = valid_key(&data[1]))) {
+                dynamic_keymap_set_keycode(data[1], data[2], data[3], (data[4] << 8) | data[5]);
+            }
+            break;
+        case DYNAMIC_KEYMAP_RESET:
+            dynamic_keymap_reset();
+            break;
+        case DYNAMIC_KEYMAP_GET_BUFFER:
+        case DYNAMIC_KEYMAP_SET_BUFFER: {
+            uint16_t offset = (data[1] << 8) | data[2];
+            uint8_t size = data[3];
+            if (!(ok = size <= length - 4 && offset <= KEYCODES_SIZE && size <= KEYCODES_SIZE - offset)) {
+                break;
+            }
+            if (data[0] == DYNAMIC_KEYMAP_GET_BUFFER) {
+                eeprom_read_block(&data[4], EEPROM_PTR(KEYCODES_ADDR + offset), size);
+            } else {
+                for (uint8_t i = 0; i < size; i++) {
+                    eeprom_update_byte(EEPROM_PTR(KEYCODES_ADDR + offset) + i, data[4 + i]);
+                }
+                cache_clear();
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+
+    if (!ok) {
+        data[1] = data[0];
+        data[0] = DYNAMIC_KEYMAP_ERROR;
+    }
+    return true;
+}
+
+// With the raw API, raw_api.c owns raw_hid_receive() and passes keymap
+// commands on
+#if defined(RAW_ENABLE) && !defined(RAW_API_ENABLE)
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+    if (dynamic_keymap_process_command(data, length)) {
+        raw_hid_send(data, length);
+    } else {
+        raw_hid_receive_kb(data, length);
+    }
+}
+
+__attribute__ ((weak))
+void raw_hid_receive_kb(uint8_t *data, uint8_t length) {
+    data[1] = data[0];
+    data[0] = DYNAMIC_KEYMAP_ERROR;
+    raw_hid_send(data, length);
+}
+#endif
@@ -0,0 +1,67 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DYNAMIC_KEYMAP_H
+#define DYNAMIC_KEYMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Layers kept in EEPROM, higher layers are still read from keymaps[] */
+#ifndef DYNAMIC_KEYMAP_LAYER_COUNT
+#define DYNAMIC_KEYMAP_LAYER_COUNT 4
+#endif
+
+/* Past the end of the eeconfig block. The keymap has to fit in EEPROM:
+ * 8 + DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2 bytes */
+#ifndef DYNAMIC_KEYMAP_EEPROM_ADDR
+#define DYNAMIC_KEYMAP_EEPROM_ADDR 32
+#endif
+
+/* Layers each key keeps its keycode for, so a key on a held layer and the
+ * one under a transparent key are both looked up without reading EEPROM.
+ * Costs 3 bytes of RAM per key and layer */
+#ifndef DYNAMIC_KEYMAP_CACHE_LAYERS
+#define DYNAMIC_KEYMAP_CACHE_LAYERS 2
+#endif
+
+/* Bumped whenever the layout in EEPROM changes */
+#define DYNAMIC_KEYMAP_VERSION 1
+
+/*
+ * Raw HID commands, the first byte of a packet. The reply starts with the
+ * same byte, or DYNAMIC_KEYMAP_ERROR followed by the command when it can't be
+ * done. See docs/feature_dynamic_keymap.md for the payloads.
+ */
+enum dynamic_keymap_command {
+    DYNAMIC_KEYMAP_GET_INFO    = 0x01,
+    DYNAMIC_KEYMAP_GET_KEYCODE = 0x02,
+    DYNAMIC_KEYMAP_SET_KEYCODE = 0x03,
+    DYNAMIC_KEYMAP_RESET       = 0x04,
+    DYNAMIC_KEYMAP_GET_BUFFER  = 0x05,
+    DYNAMIC_KEYMAP_SET_BUFFER  = 0x06,
+    DYNAMIC_KEYMAP_ERROR       = 0xFF
+};
+
+void dynamic_keymap_init(void);
+void dynamic_keymap_reset(void);
+uint16_t dynamic_keymap_get_keycode(uint8_t layer, uint8_t row, uint8_t col);
+void dynamic_keymap_set_keycode(uint8_t layer, uint8_t row, uint8_t col, uint16_t keycode);
+
+/* Handles a command in place, data holds the reply afterwards. Returns false
+ * if the command isn't one of the above. */
+bool dynamic_keymap_process_command(uint8_t *data, uint8_t length);
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "key_trace.h"
+#include "timer.h"
+#ifdef KEY_TRACE_CONSOLE
+#include "console.h"
+#endif
+
+/*
+ * Events are stored as they come, in RAM, and turned into bytes only when
+ * they are sent. Recording one is a handful of stores, so tracing can stay
+ * on without changing the timing it measures.
+ */
+static key_trace_event_t events[KEY_TRACE_SIZE];
+static uint8_t tail = 0;
+static uint8_t count = 0;
+static uint8_t sequence = 0;
+static uint16_t dropped = 0;
+
+_Static_assert((KEY_TRACE_SIZE & (KEY_TRACE_SIZE - 1)) == 0, "KEY_TRACE_SIZE must be a power of two");
+_Static_assert(KEY_TRACE_SIZE <= 128, "count is a byte");
+
+void key_trace_record(keyrecord_t *record, uint16_t keycode, uint8_t layer) {
+    key_trace_event_t *event;
+    uint16_t delay;
+
+    if (count == KEY_TRACE_SIZE) {
+        sequence++;
+        if (dropped < UINT16_MAX) {
+            dropped++;
+        }
+        return;
+    }
+
+    event = &events[(tail + count) & (KEY_TRACE_SIZE - 1)];
+    // keyboard_task sets the low bit of the event time so it is never 0,
+    // which can put it 1ms ahead of the timer
+    delay = timer_elapsed(record->event.time);
+    if (delay > UINT16_MAX / 2) {
+        delay = 0;
+    }
+
+    event->sequence = sequence++;
+    event->time = record->event.time;
+    event->delay = delay < 255 ? delay : 255;
+    event->row = record->event.key.row;
+    event->col = record->event.key.col;
+    event->flags = (layer & KEY_TRACE_LAYER_MASK) | (record->event.pressed ? KEY_TRACE_PRESSED : 0);
+    event->keycode = keycode;
+#ifndef NO_ACTION_TAPPING
+    event->tap_count = record->tap.count;
+    if (record->tap.interrupted) {
+        event->flags |= KEY_TRACE_INTERRUPTED;
+    }
+#else
+    event->tap_count = 0;
+#endif
+    count++;
+}
+
+bool key_trace_read(key_trace_event_t *event) {
+    if (!count) {
+        return false;
+    }
+    *event = events[tail];
+    tail = (tail + 1) & (KEY_TRACE_SIZE - 1);
+    count--;
+    return true;
+}
+
+void key_trace_serialize(const key_trace_event_t *event, uint8_t *bytes) {
+    bytes[0] = event->sequence;
+    bytes[1] = event->time >> 8;
+    bytes[2] = event->time & 0xFF;
+    bytes[3] = event->delay;
+    bytes[4] = event->row;
+    bytes[5] = event->col;
+    bytes[6] = event->flags;
+    bytes[7] = event->keycode >> 8;
+    bytes[8] = event->keycode & 0xFF;
+    bytes[9] = event->tap_count;
+}
+
+uint8_t key_trace_pending(void) {
+    return count;
+}
+
+uint16_t key_trace_dropped(void) {
+    return dropped;
+}
+
+#ifdef KEY_TRACE_CONSOLE
+// "KT", the event in hex and a newline
+#define LINE_SIZE (2 + KEY_TRACE_EVENT_SIZE * 2 + 1)
+
+static const char hex[16] = "0123456789ABCDEF";
+
+void key_trace_task(void) {
+    key_trace_event_t event;
+    uint8_t bytes[KEY_TRACE_EVENT_SIZE];
+
+    // only whole lines, the rest of the console output keeps its room
+    while (count && CONSOLE_BUFFER_SIZE - console_pending() >= LINE_SIZE) {
+        key_trace_read(&event);
+        key_trace_serialize(&event, bytes);
+        console_putc('K');
+        console_putc('T');
+        for (uint8_t i = 0; i < KEY_TRACE_EVENT_SIZE; i++) {
+            console_putc(hex[bytes[i] >> 4]);
+            console_putc(hex[bytes[i] & 0xF]);
+        }
+        console_putc('\n');
+    }
+}
+#else
+void key_trace_task(void) {}
+#endif
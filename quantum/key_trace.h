@@ -0,0 +1,69 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEY_TRACE_H
+#define KEY_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "action.h"
+
+/* Events kept until they are sent, a power of two */
+#ifndef KEY_TRACE_SIZE
+#define KEY_TRACE_SIZE 32
+#endif
+
+/* Bytes of one event on the wire */
+#define KEY_TRACE_EVENT_SIZE 10
+
+/*
+ * One key event as quantum saw it. On the wire it is KEY_TRACE_EVENT_SIZE
+ * bytes in this order, big endian.
+ */
+typedef struct {
+    uint8_t  sequence;      // counts every event, a gap means events were dropped
+    uint16_t time;          // event time, ms
+    uint8_t  delay;         // ms from the event to processing it, 255 or more is 255
+    uint8_t  row;
+    uint8_t  col;
+    uint8_t  flags;         // KEY_TRACE_PRESSED, KEY_TRACE_INTERRUPTED, layer in the low bits
+    uint16_t keycode;       // resolved on that layer
+    uint8_t  tap_count;
+} key_trace_event_t;
+
+#define KEY_TRACE_PRESSED     0x80
+#define KEY_TRACE_INTERRUPTED 0x40
+#define KEY_TRACE_LAYER_MASK  0x1F
+
+/* Adds an event, from process_record_quantum(). Never waits, when the
+ * buffer is full the event is dropped. */
+void key_trace_record(keyrecord_t *record, uint16_t keycode, uint8_t layer);
+
+/* Takes the oldest event out, false if there is none */
+bool key_trace_read(key_trace_event_t *event);
+
+/* Writes an event as KEY_TRACE_EVENT_SIZE bytes */
+void key_trace_serialize(const key_trace_event_t *event, uint8_t *bytes);
+
+uint8_t key_trace_pending(void);
+
+/* Events dropped because the buffer was full */
+uint16_t key_trace_dropped(void);
+
+/* Sends pending events to the console as "KT" and hex lines, with
+ * KEY_TRACE_CONSOLE. Called from matrix_scan_quantum(). */
+void key_trace_task(void);
+
+#endif
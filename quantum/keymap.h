@@ -52,5 +52,15 @@ uint16_t keymap_function_id_to_action( uint16_t function_id );
 extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
 extern const uint16_t fn_actions[];
 
+#ifdef ACTION_TABLE_ENABLE
+/* Layers resolved into the action table, keymaps[] needs at least this many */
+#ifndef ACTION_TABLE_LAYERS
+#define ACTION_TABLE_LAYERS 4
+#endif
+
+// rebuilds the action table on the next lookup, for keymaps that change
+void action_table_invalidate(void);
+#endif
+
 
 #endif
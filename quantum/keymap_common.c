@@ -33,16 +33,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 	#include "process_midi.h"
 #endif
 
+#ifdef DYNAMIC_KEYMAP_ENABLE
+	#include "dynamic_keymap.h"
+#endif
+
 extern keymap_config_t keymap_config;
 
 #include <inttypes.h>
 
-/* converts key to action */
-action_t action_for_key(uint8_t layer, keypos_t key)
+/* converts keycode to action */
+static action_t keycode_to_action(uint16_t keycode)
 {
-    // 16bit keycodes - important
-    uint16_t keycode = keymap_key_to_keycode(layer, key);
-
     // keycode remapping
     keycode = keycode_config(keycode);
 
@@ -164,6 +165,53 @@ action_t action_for_key(uint8_t layer, keypos_t key)
     return action;
 }
 
+#ifdef ACTION_TABLE_ENABLE
+/*
+ * Action table
+ *
+ * Every key of the first ACTION_TABLE_LAYERS layers resolved to its action,
+ * so a lookup is a single read. It is built on the first lookup and again
+ * after keymap_config changes, since the swaps are part of the action.
+ */
+static action_t action_table[ACTION_TABLE_LAYERS][MATRIX_ROWS][MATRIX_COLS];
+static bool action_table_valid = false;
+static uint16_t action_table_config;
+
+void action_table_invalidate(void)
+{
+    action_table_valid = false;
+}
+
+static void action_table_build(void)
+{
+    for (uint8_t layer = 0; layer < ACTION_TABLE_LAYERS; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                keypos_t key = { .row = row, .col = col };
+                action_table[layer][row][col] = keycode_to_action(keymap_key_to_keycode(layer, key));
+            }
+        }
+    }
+    action_table_config = keymap_config.raw;
+    action_table_valid = true;
+}
+#endif
+
+/* converts key to action */
+action_t action_for_key(uint8_t layer, keypos_t key)
+{
+#ifdef ACTION_TABLE_ENABLE
+    if (layer < ACTION_TABLE_LAYERS) {
+        if (!action_table_valid || action_table_config != keymap_config.raw) {
+            action_table_build();
+        }
+        return action_table[layer][key.row][key.col];
+    }
+#endif
+    // 16bit keycodes - important
+    return keycode_to_action(keymap_key_to_keycode(layer, key));
+}
+
 __attribute__ ((weak))
 const uint16_t PROGMEM fn_actions[] = {
 
@@ -186,6 +234,11 @@ void action_function(keyrecord_t *record, uint8_t id, uint8_t opt)
 __attribute__ ((weak))
 uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key)
 {
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    if (layer < DYNAMIC_KEYMAP_LAYER_COUNT) {
+        return dynamic_keymap_get_keycode(layer, key.row, key.col);
+    }
+#endif
     // Read entire word (16bits)
     return pgm_read_word(&keymaps[(layer)][(key.row)][(key.col)]);
 }
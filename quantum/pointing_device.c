@@ -23,7 +23,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "pointing_device.h"
 
+// Only the buttons are kept here, the motion that hasn't been sent yet is
+// accumulated in 16 bits and sent 127 at a time.
 static report_mouse_t mouseReport = {};
+static int16_t motion_x = 0;
+static int16_t motion_y = 0;
+static int16_t motion_v = 0;
+static int16_t motion_h = 0;
+
+static uint8_t sent_buttons = 0;
+static uint16_t last_report = 0;
+
+static int16_t add_saturated(int16_t a, int16_t b) {
+    int32_t sum = (int32_t)a + b;
+    if (sum > INT16_MAX) return INT16_MAX;
+    if (sum < INT16_MIN) return INT16_MIN;
+    return sum;
+}
+
+// The part of the motion that fits in one report
+static int8_t report_part(int16_t motion) {
+    if (motion > 127) return 127;
+    if (motion < -127) return -127;
+    return motion;
+}
 
 __attribute__ ((weak))
 void pointing_device_init(void){
@@ -33,30 +56,57 @@ void pointing_device_init(void){
 __attribute__ ((weak))
 void pointing_device_send(void){
     //If you need to do other things, like debugging, this is the place to do it.
-    host_mouse_send(&mouseReport);
-	//send it and 0 it out except for buttons, so those stay until they are explicity over-ridden using update_pointing_device
-	mouseReport.x = 0;
-	mouseReport.y = 0;
-	mouseReport.v = 0;
-	mouseReport.h = 0;
+    bool moving = motion_x || motion_y || motion_v || motion_h;
+    if (mouseReport.buttons == sent_buttons &&
+        !(moving && timer_elapsed(last_report) >= POINTING_DEVICE_REPORT_INTERVAL)) {
+        return;
+    }
+    //send what fits and keep the rest for the next report, buttons stay until they are explicity over-ridden using pointing_device_set_report
+    report_mouse_t report = pointing_device_get_report();
+    motion_x -= report.x;
+    motion_y -= report.y;
+    motion_v -= report.v;
+    motion_h -= report.h;
+    host_mouse_send(&report);
+    sent_buttons = report.buttons;
+    last_report = timer_read();
 }
 
 __attribute__ ((weak))
 void pointing_device_task(void){
     //gather info and put it in:
-    //mouseReport.x = 127 max -127 min
-    //mouseReport.y = 127 max -127 min
-    //mouseReport.v = 127 max -127 min (scroll vertical)
-    //mouseReport.h = 127 max -127 min (scroll horizontal)
+    //pointing_device_move(x, y) adds movement, -32767 to 32767
+    //pointing_device_scroll(v, h) adds scrolling, -32767 to 32767
     //mouseReport.buttons = 0x1F (decimal 31, binary 00011111) max (bitmask for mouse buttons 1-5, 1 is rightmost, 5 is leftmost) 0x00 min
-    //send the report
+    //send the report, if there is anything to send
     pointing_device_send();
 }
 
 report_mouse_t pointing_device_get_report(void){
-	return mouseReport;
+    report_mouse_t report = mouseReport;
+    report.x = report_part(motion_x);
+    report.y = report_part(motion_y);
+    report.v = report_part(motion_v);
+    report.h = report_part(motion_h);
+    return report;
 }
 
 void pointing_device_set_report(report_mouse_t newMouseReport){
-	mouseReport = newMouseReport;
-}
\ No newline at end of file
+    //replaces the part of the motion that fits in the next report, whatever
+    //didn't fit is still sent afterwards
+    mouseReport.buttons = newMouseReport.buttons;
+    motion_x = add_saturated(motion_x, newMouseReport.x - report_part(motion_x));
+    motion_y = add_saturated(motion_y, newMouseReport.y - report_part(motion_y));
+    motion_v = add_saturated(motion_v, newMouseReport.v - report_part(motion_v));
+    motion_h = add_saturated(motion_h, newMouseReport.h - report_part(motion_h));
+}
+
+void pointing_device_move(int16_t x, int16_t y){
+    motion_x = add_saturated(motion_x, x);
+    motion_y = add_saturated(motion_y, y);
+}
+
+void pointing_device_scroll(int16_t v, int16_t h){
+    motion_v = add_saturated(motion_v, v);
+    motion_h = add_saturated(motion_h, h);
+}
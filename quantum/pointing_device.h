@@ -22,10 +22,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "report.h"
 
+// Motion is held back and sent at most once per interval, the poll interval
+// of the mouse endpoint. Button changes are always sent right away.
+#ifndef POINTING_DEVICE_REPORT_INTERVAL
+#define POINTING_DEVICE_REPORT_INTERVAL 10
+#endif
+
 void pointing_device_init(void);
 void pointing_device_task(void);
 void pointing_device_send(void);
 report_mouse_t pointing_device_get_report(void);
 void pointing_device_set_report(report_mouse_t newMouseReport);
+void pointing_device_move(int16_t x, int16_t y);
+void pointing_device_scroll(int16_t v, int16_t h);
 
 #endif
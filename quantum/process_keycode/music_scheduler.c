@@ -0,0 +1,314 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "music_scheduler.h"
+#include <math.h>
+#include "progmem.h"
+
+_Static_assert((MUSIC_EVENT_QUEUE_SIZE & (MUSIC_EVENT_QUEUE_SIZE - 1)) == 0, "MUSIC_EVENT_QUEUE_SIZE must be a power of two");
+_Static_assert(MUSIC_EVENT_QUEUE_SIZE <= 128, "the queue indexes are bytes");
+_Static_assert(MUSIC_RECORD_SIZE <= 255, "the record indexes are bytes");
+
+// Longer recordings would not fit the 16 bit times
+#define MUSIC_RECORD_MAX_MS 30000
+
+typedef struct {
+    uint8_t note;
+    bool playback;
+    uint16_t off;       // when a played back note ends
+} music_voice_t;
+
+// Sounding voices, the oldest first
+static music_voice_t voices[MUSIC_VOICES];
+static uint8_t voice_count = 0;
+
+static music_event_t queue[MUSIC_EVENT_QUEUE_SIZE];
+static uint8_t queue_head = 0;
+static uint8_t queue_tail = 0;
+
+// Recorded events, times from the start of the recording
+static music_event_t record[MUSIC_RECORD_SIZE];
+static uint8_t record_count = 0;
+static uint16_t record_start = 0;
+static uint16_t record_length = 0;
+static bool recording = false;
+static bool recorded = false;
+
+static bool playing = false;
+static bool play_restart = false;
+static uint16_t play_start = 0;
+static uint16_t play_length = 0;
+static uint8_t play_position = 0;
+static uint16_t grid = MUSIC_GRID_MS;
+
+// C4 to B4, PITCH_STANDARD_A * 2^((n - 9) / 12), the other octaves are
+// doublings and halvings of these
+static const float PROGMEM octave_frequencies[12] = {
+    PITCH_STANDARD_A * 0.5946035575f,
+    PITCH_STANDARD_A * 0.6299605249f,
+    PITCH_STANDARD_A * 0.6674199271f,
+    PITCH_STANDARD_A * 0.7071067812f,
+    PITCH_STANDARD_A * 0.7491535384f,
+    PITCH_STANDARD_A * 0.7937005260f,
+    PITCH_STANDARD_A * 0.8408964153f,
+    PITCH_STANDARD_A * 0.8908987181f,
+    PITCH_STANDARD_A * 0.9438743127f,
+    PITCH_STANDARD_A,
+    PITCH_STANDARD_A * 1.0594630944f,
+    PITCH_STANDARD_A * 1.1224620483f,
+};
+
+float music_note_frequency(uint8_t note) {
+    // MIDI note 60 is C4
+    return ldexpf(pgm_read_float(&octave_frequencies[note % 12]), (int8_t)(note / 12) - 5);
+}
+
+static void voice_stop(uint8_t i) {
+    music_voice_off(voices[i].note);
+    voice_count--;
+    for (; i < voice_count; i++) {
+        voices[i] = voices[i + 1];
+    }
+}
+
+static void voice_start(uint8_t note, bool playback, uint16_t off) {
+    // the same note again starts over
+    for (uint8_t i = 0; i < voice_count; i++) {
+        if (voices[i].note == note) {
+            voice_stop(i);
+            break;
+        }
+    }
+    if (voice_count == MUSIC_VOICES) {
+        voice_stop(0);
+    }
+    voices[voice_count].note = note;
+    voices[voice_count].playback = playback;
+    voices[voice_count].off = off;
+    voice_count++;
+    music_voice_on(note);
+}
+
+// A released key, its note may have been taken over already
+static void voice_end(uint8_t note) {
+    for (uint8_t i = 0; i < voice_count; i++) {
+        if (voices[i].note == note && !voices[i].playback) {
+            voice_stop(i);
+            return;
+        }
+    }
+}
+
+static void stop_voices(bool playback_only) {
+    for (uint8_t i = voice_count; i > 0; i--) {
+        if (!playback_only || voices[i - 1].playback) {
+            voice_stop(i - 1);
+        }
+    }
+}
+
+static void finish_recording(uint16_t now) {
+    recording = false;
+    record_length = now - record_start;
+    recorded = record_count > 0;
+}
+
+static void record_event(const music_event_t *event) {
+    uint16_t time = event->time - record_start;
+
+    if (record_count == MUSIC_RECORD_SIZE) {
+        finish_recording(event->time);
+        return;
+    }
+    // a key that changed just before the recording started
+    if ((int16_t)time < 0) {
+        time = 0;
+    }
+    record[record_count] = *event;
+    record[record_count].time = time;
+    record_count++;
+}
+
+static void drain(void) {
+    while (queue_tail != queue_head) {
+        music_event_t *event = &queue[queue_tail & (MUSIC_EVENT_QUEUE_SIZE - 1)];
+        if (recording) {
+            record_event(event);
+        }
+        if (event->on) {
+            voice_start(event->note, false, 0);
+        } else {
+            voice_end(event->note);
+        }
+        queue_tail++;
+    }
+}
+
+static void queue_event(uint8_t note, bool on, uint16_t time) {
+    // never drop a note, a lost release would hold it forever
+    if ((uint8_t)(queue_head - queue_tail) == MUSIC_EVENT_QUEUE_SIZE) {
+        drain();
+    }
+    music_event_t *event = &queue[queue_head & (MUSIC_EVENT_QUEUE_SIZE - 1)];
+    event->time = time;
+    event->note = note;
+    event->on = on;
+    queue_head++;
+}
+
+void music_scheduler_note_on(uint8_t note, uint16_t time) {
+    queue_event(note, true, time);
+}
+
+void music_scheduler_note_off(uint8_t note, uint16_t time) {
+    queue_event(note, false, time);
+}
+
+void music_scheduler_all_notes_off(void) {
+    queue_tail = queue_head;
+    stop_voices(false);
+}
+
+uint8_t music_scheduler_voices(void) {
+    return voice_count;
+}
+
+// The nearest grid line, notes at the very end go on the last one
+static uint16_t quantize(uint16_t time) {
+    uint16_t line = (time + grid / 2) / grid * grid;
+    return line < play_length ? line : play_length - grid;
+}
+
+// How long the note started by record[i] plays, at least one grid step
+static uint16_t note_length(uint8_t i) {
+    uint16_t start = quantize(record[i].time);
+    uint16_t end = play_length;
+
+    for (uint8_t j = i + 1; j < record_count; j++) {
+        if (!record[j].on && record[j].note == record[i].note) {
+            end = quantize(record[j].time);
+            break;
+        }
+    }
+    return end > start ? end - start : grid;
+}
+
+static void play_from(uint16_t now) {
+    play_start = now;
+    play_position = 0;
+    play_length = (record_length + grid - 1) / grid * grid;
+    if (play_length == 0) {
+        play_length = grid;
+    }
+}
+
+static void play_task(uint16_t now) {
+    if (play_restart) {
+        stop_voices(true);
+        play_from(now);
+        play_restart = false;
+    }
+
+    for (uint8_t i = 0; i < voice_count;) {
+        if (voices[i].playback && (int16_t)(now - voices[i].off) >= 0) {
+            voice_stop(i);
+        } else {
+            i++;
+        }
+    }
+
+    uint16_t elapsed = now - play_start;
+    if (elapsed >= play_length) {
+        play_start += play_length;
+        play_position = 0;
+        elapsed -= play_length;
+        if (elapsed >= play_length) {
+            // the task was not run for a whole loop
+            play_start = now;
+            elapsed = 0;
+        }
+    }
+
+    while (play_position < record_count && quantize(record[play_position].time) <= elapsed) {
+        if (record[play_position].on) {
+            uint16_t off = play_start + quantize(record[play_position].time) + note_length(play_position);
+            voice_start(record[play_position].note, true, off);
+        }
+        play_position++;
+    }
+}
+
+void music_scheduler_task(uint16_t now) {
+    drain();
+    if (recording && (uint16_t)(now - record_start) > MUSIC_RECORD_MAX_MS) {
+        finish_recording(now);
+    }
+    if (playing) {
+        play_task(now);
+    }
+}
+
+void music_record_start(uint16_t now) {
+    drain();
+    music_play_stop();
+    record_count = 0;
+    record_start = now;
+    recording = true;
+    recorded = false;
+}
+
+void music_record_stop(uint16_t now) {
+    drain();
+    if (recording) {
+        finish_recording(now);
+    }
+}
+
+bool music_recording(void) {
+    return recording;
+}
+
+bool music_recorded(void) {
+    return recorded;
+}
+
+void music_play_start(uint16_t now) {
+    drain();
+    if (!recorded) {
+        return;
+    }
+    stop_voices(true);
+    playing = true;
+    play_restart = false;
+    play_from(now);
+}
+
+void music_play_stop(void) {
+    playing = false;
+    stop_voices(true);
+}
+
+bool music_playing(void) {
+    return playing;
+}
+
+void music_set_grid(uint16_t ms) {
+    grid = ms < MUSIC_GRID_MIN_MS ? MUSIC_GRID_MIN_MS : ms;
+    // the loop starts over on the new grid
+    play_restart = playing;
+}
+
+uint16_t music_get_grid(void) {
+    return grid;
+}
@@ -0,0 +1,89 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_SCHEDULER_H
+#define MUSIC_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * The notes of music mode on their way to the audio driver and MIDI.
+ *
+ * Key presses queue note events and music_scheduler_task() starts and stops
+ * the voices from the main loop. At most MUSIC_VOICES sound at once, a new
+ * note takes over the oldest voice when they are all busy. The notes played
+ * can be recorded with their times and played back in a loop, quantized to
+ * a grid.
+ */
+
+#ifndef MUSIC_VOICES
+#  define MUSIC_VOICES 4
+#endif
+
+// Note events between two tasks, a power of two
+#ifndef MUSIC_EVENT_QUEUE_SIZE
+#  define MUSIC_EVENT_QUEUE_SIZE 16
+#endif
+
+// Note events a recording holds, a note is two
+#ifndef MUSIC_RECORD_SIZE
+#  define MUSIC_RECORD_SIZE 64
+#endif
+
+#ifndef MUSIC_GRID_MS
+#  define MUSIC_GRID_MS 100
+#endif
+#define MUSIC_GRID_MIN_MS 10
+
+#ifndef PITCH_STANDARD_A
+#  define PITCH_STANDARD_A 440.0f
+#endif
+
+typedef struct {
+    uint16_t time;
+    uint8_t note;
+    bool on;
+} music_event_t;
+
+// Queue a note, time is when its key changed
+void music_scheduler_note_on(uint8_t note, uint16_t time);
+void music_scheduler_note_off(uint8_t note, uint16_t time);
+// Stops every voice and drops the queued notes, recording and playback go on
+void music_scheduler_all_notes_off(void);
+// Starts and stops the voices, call it from the main loop
+void music_scheduler_task(uint16_t now);
+uint8_t music_scheduler_voices(void);
+
+void music_record_start(uint16_t now);
+void music_record_stop(uint16_t now);
+bool music_recording(void);
+bool music_recorded(void);
+
+// Plays the recording in a loop, each note moved to the nearest grid line
+void music_play_start(uint16_t now);
+void music_play_stop(void);
+bool music_playing(void);
+void music_set_grid(uint16_t ms);
+uint16_t music_get_grid(void);
+
+// Frequency of a MIDI note from a table, no pow() at run time
+float music_note_frequency(uint8_t note);
+
+// Implemented by music mode
+void music_voice_on(uint8_t note);
+void music_voice_off(uint8_t note);
+
+#endif
@@ -30,9 +30,29 @@
   unregister_code(key); \
   unregister_code(mod)
 
-uint16_t autoshift_time = 0;
+enum {
+  AUTOSHIFT_HELD,
+  AUTOSHIFT_TAPPED,
+  AUTOSHIFT_SHIFTED
+};
+
+// A key waiting to be typed. Keys are typed in press order, a key that is
+// decided waits for the ones pressed before it.
+typedef struct {
+  keypos_t key;
+  uint16_t keycode;
+  uint16_t time;
+  uint16_t timeout;
+  uint8_t state;
+} autoshift_key_t;
+
+static autoshift_key_t autoshift_keys[AUTO_SHIFT_KEYS];
+static uint8_t autoshift_head = 0;
+static uint8_t autoshift_count = 0;
+
 uint16_t autoshift_timeout = AUTO_SHIFT_TIMEOUT;
-uint16_t autoshift_lastkey = KC_NO;
+
+#define AUTOSHIFT_KEY(i) autoshift_keys[(autoshift_head + (i)) % AUTO_SHIFT_KEYS]
 
 void autoshift_timer_report(void) {
   char display[8];
@@ -42,29 +62,96 @@ void autoshift_timer_report(void) {
   send_string((const char *)display);
 }
 
-void autoshift_on(uint16_t keycode) {
-  autoshift_time = timer_read();
-  autoshift_lastkey = keycode;
+// The class timeouts keep their distance to autoshift_timeout when it is
+// adjusted with KC_ASUP and KC_ASDN, but never drop below zero
+static uint16_t timeout_for(uint16_t keycode) {
+  int32_t timeout = autoshift_timeout;
+
+  switch (keycode) {
+    case KC_A ... KC_Z:
+      timeout += (int32_t)AUTO_SHIFT_ALPHA_TIMEOUT - AUTO_SHIFT_TIMEOUT;
+      break;
+    case KC_1 ... KC_0:
+      timeout += (int32_t)AUTO_SHIFT_NUMERIC_TIMEOUT - AUTO_SHIFT_TIMEOUT;
+      break;
+    default:
+      timeout += (int32_t)AUTO_SHIFT_SPECIAL_TIMEOUT - AUTO_SHIFT_TIMEOUT;
+      break;
+  }
+  if (timeout < 0) {
+    return 0;
+  }
+  return timeout > UINT16_MAX ? UINT16_MAX : timeout;
 }
 
-void autoshift_flush(void) {
-  if (autoshift_lastkey != KC_NO) {
-    uint16_t elapsed = timer_elapsed(autoshift_time);
+static void autoshift_decide(autoshift_key_t *key, uint16_t time) {
+  if (key->state == AUTOSHIFT_HELD) {
+    key->state = TIMER_DIFF_16(time, key->time) > key->timeout ? AUTOSHIFT_SHIFTED : AUTOSHIFT_TAPPED;
+  }
+}
 
-    if (elapsed > autoshift_timeout) {
-      register_code(KC_LSFT);
+// Types the decided keys at the front
+static void autoshift_type(void) {
+  while (autoshift_count && AUTOSHIFT_KEY(0).state != AUTOSHIFT_HELD) {
+    if (AUTOSHIFT_KEY(0).state == AUTOSHIFT_SHIFTED) {
+      TAP_WITH_MOD(KC_LSFT, AUTOSHIFT_KEY(0).keycode);
+    } else {
+      TAP(AUTOSHIFT_KEY(0).keycode);
     }
+    autoshift_head = (autoshift_head + 1) % AUTO_SHIFT_KEYS;
+    autoshift_count--;
+  }
+}
+
+static void autoshift_flush_at(uint16_t time) {
+  for (uint8_t i = 0; i < autoshift_count; i++) {
+    autoshift_decide(&AUTOSHIFT_KEY(i), time);
+  }
+  autoshift_type();
+}
 
-    register_code(autoshift_lastkey);
-    unregister_code(autoshift_lastkey);
+static void autoshift_on(uint16_t keycode, keyrecord_t *record) {
+  autoshift_key_t *key;
 
-    if (elapsed > autoshift_timeout) {
-      unregister_code(KC_LSFT);
+  if (autoshift_count == AUTO_SHIFT_KEYS) {
+    autoshift_decide(&AUTOSHIFT_KEY(0), record->event.time);
+    autoshift_type();
+  }
+  key = &AUTOSHIFT_KEY(autoshift_count);
+  key->key = record->event.key;
+  key->keycode = keycode;
+  key->time = record->event.time;
+  key->timeout = timeout_for(keycode);
+  key->state = AUTOSHIFT_HELD;
+  autoshift_count++;
+}
+
+// The key was let go, it is decided by how long it was held
+static bool autoshift_off(keyrecord_t *record) {
+  for (uint8_t i = 0; i < autoshift_count; i++) {
+    autoshift_key_t *key = &AUTOSHIFT_KEY(i);
+    if (key->state == AUTOSHIFT_HELD && KEYEQ(key->key, record->event.key)) {
+      autoshift_decide(key, record->event.time);
+      autoshift_type();
+      return true;
     }
+  }
+  return false;
+}
+
+void autoshift_flush(void) {
+  autoshift_flush_at(timer_read());
+}
 
-    autoshift_time = 0;
-    autoshift_lastkey = KC_NO;
+void autoshift_task(void) {
+  // keys held past their timeout are shifted, no need to wait for the release
+  for (uint8_t i = 0; i < autoshift_count; i++) {
+    autoshift_key_t *key = &AUTOSHIFT_KEY(i);
+    if (key->state == AUTOSHIFT_HELD && timer_elapsed(key->time) > key->timeout) {
+      key->state = AUTOSHIFT_SHIFTED;
+    }
   }
+  autoshift_type();
 }
 
 bool autoshift_enabled = true;
@@ -175,8 +262,10 @@ bool process_auto_shift(uint16_t keycode, keyrecord_t *record) {
       case KC_GRAVE:
 #endif
 
-        autoshift_flush();
-        if (!autoshift_enabled) return true;
+        if (!autoshift_enabled) {
+          autoshift_flush_at(record->event.time);
+          return true;
+        }
 
 #ifndef AUTO_SHIFT_MODIFIERS
         any_mod_pressed = get_mods() & (
@@ -187,19 +276,21 @@ bool process_auto_shift(uint16_t keycode, keyrecord_t *record) {
         );
 
         if (any_mod_pressed) {
+          autoshift_flush_at(record->event.time);
           return true;
         }
 #endif
 
-        autoshift_on(keycode);
+        autoshift_on(keycode, record);
         return false;
 
       default:
-        autoshift_flush();
+        // the keys before it are typed first, as far as they are held now
+        autoshift_flush_at(record->event.time);
         return true;
     }
-  } else {
-    autoshift_flush();
+  } else if (autoshift_off(record)) {
+    return false;
   }
 
   return true;
@@ -23,7 +23,29 @@
   #define AUTO_SHIFT_TIMEOUT 175
 #endif
 
+/* Timeouts of each class of keys, they move with AUTO_SHIFT_TIMEOUT when it
+ * is adjusted at run time */
+#ifndef AUTO_SHIFT_ALPHA_TIMEOUT
+  #define AUTO_SHIFT_ALPHA_TIMEOUT AUTO_SHIFT_TIMEOUT
+#endif
+#ifndef AUTO_SHIFT_NUMERIC_TIMEOUT
+  #define AUTO_SHIFT_NUMERIC_TIMEOUT AUTO_SHIFT_TIMEOUT
+#endif
+#ifndef AUTO_SHIFT_SPECIAL_TIMEOUT
+  #define AUTO_SHIFT_SPECIAL_TIMEOUT AUTO_SHIFT_TIMEOUT
+#endif
+
+/* Keys that can be held at the same time, rolling over more types the
+ * oldest right away */
+#ifndef AUTO_SHIFT_KEYS
+  #define AUTO_SHIFT_KEYS 4
+#endif
+
+/* AUTO_SHIFT_TIMEOUT, as adjusted by KC_ASUP and KC_ASDN */
+extern uint16_t autoshift_timeout;
+
 bool process_auto_shift(uint16_t keycode, keyrecord_t *record);
+void autoshift_task(void);
 
 void autoshift_enable(void);
 void autoshift_disable(void);
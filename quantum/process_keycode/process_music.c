@@ -30,16 +30,16 @@ uint8_t music_starting_note = 0x0C;
 int music_offset = 7;
 uint8_t music_mode = MUSIC_MODE_CHROMATIC;
 
-// music sequencer
-static bool music_sequence_recording = false;
-static bool music_sequence_recorded = false;
-static bool music_sequence_playing = false;
-static uint8_t music_sequence[16] = {0};
-static uint8_t music_sequence_count = 0;
-static uint8_t music_sequence_position = 0;
-
-static uint16_t music_sequence_timer = 0;
-static uint16_t music_sequence_interval = 100;
+// Where the notes of each mode start and how far apart the rows are
+static const struct {
+    int8_t offset;
+    uint8_t row;
+} music_scales[NUMBER_OF_MODES] = {
+    [MUSIC_MODE_CHROMATIC] = { -3, 12 },
+    [MUSIC_MODE_GUITAR]    = { 32, 5 },
+    [MUSIC_MODE_VIOLIN]    = { 32, 7 },
+    [MUSIC_MODE_MAJOR]     = { -3, 12 },
+};
 
 #ifdef AUDIO_ENABLE
   #ifndef MUSIC_ON_SONG
@@ -82,7 +82,7 @@ static uint16_t music_sequence_interval = 100;
   #define MUSIC_MASK keycode < 0xFF
 #endif
 
-static void music_noteon(uint8_t note) {
+void music_voice_on(uint8_t note) {
     #ifdef AUDIO_ENABLE
     if (music_activated)
       process_audio_noteon(note);
@@ -93,7 +93,7 @@ static void music_noteon(uint8_t note) {
     #endif
 }
 
-static void music_noteoff(uint8_t note) {
+void music_voice_off(uint8_t note) {
     #ifdef AUDIO_ENABLE
     if (music_activated)
       process_audio_noteoff(note);
@@ -105,6 +105,7 @@ static void music_noteoff(uint8_t note) {
 }
 
 void music_all_notes_off(void) {
+    music_scheduler_all_notes_off();
     #ifdef AUDIO_ENABLE
     if (music_activated)
       process_audio_all_notes_off();
@@ -164,63 +165,45 @@ bool process_music(uint16_t keycode, keyrecord_t *record) {
       if (record->event.pressed) {
         if (keycode == KC_LCTL) { // Start recording
           music_all_notes_off();
-          music_sequence_recording = true;
-          music_sequence_recorded = false;
-          music_sequence_playing = false;
-          music_sequence_count = 0;
+          music_record_start(record->event.time);
           return false;
         }
 
         if (keycode == KC_LALT) { // Stop recording/playing
           music_all_notes_off();
-          if (music_sequence_recording) { // was recording
-            music_sequence_recorded = true;
-          }
-          music_sequence_recording = false;
-          music_sequence_playing = false;
+          music_record_stop(record->event.time);
+          music_play_stop();
           return false;
         }
 
-        if (keycode == KC_LGUI && music_sequence_recorded) { // Start playing
+        if (keycode == KC_LGUI && music_recorded()) { // Start playing
           music_all_notes_off();
-          music_sequence_recording = false;
-          music_sequence_playing = true;
-          music_sequence_position = 0;
-          music_sequence_timer = 0;
+          music_play_start(record->event.time);
           return false;
         }
 
-        if (keycode == KC_UP) {
-          music_sequence_interval-=10;
+        if (keycode == KC_UP) { // Finer playback grid
+          music_set_grid(music_get_grid() - 10);
           return false;
         }
 
         if (keycode == KC_DOWN) {
-          music_sequence_interval+=10;
+          music_set_grid(music_get_grid() + 10);
           return false;
         }
       }
 
-      uint8_t note;
-      if (music_mode == MUSIC_MODE_CHROMATIC) 
-        note = (music_starting_note + record->event.key.col + music_offset - 3)+12*(MATRIX_ROWS - record->event.key.row);
-      else if (music_mode == MUSIC_MODE_GUITAR)
-        note = (music_starting_note + record->event.key.col + music_offset + 32)+5*(MATRIX_ROWS - record->event.key.row);
-      else if (music_mode == MUSIC_MODE_VIOLIN)
-        note = (music_starting_note + record->event.key.col + music_offset + 32)+7*(MATRIX_ROWS - record->event.key.row);
-      else if (music_mode == MUSIC_MODE_MAJOR)
-        note = (music_starting_note + SCALE[record->event.key.col + music_offset] - 3)+12*(MATRIX_ROWS - record->event.key.row);
-      else
-        note = music_starting_note;
+      uint8_t step = record->event.key.col + music_offset;
+      if (music_mode == MUSIC_MODE_MAJOR)
+        step = SCALE[step];
+      uint8_t note = music_starting_note + step + music_scales[music_mode].offset
+                     + music_scales[music_mode].row * (MATRIX_ROWS - record->event.key.row);
 
+      // started and stopped by the scheduler in the next scan
       if (record->event.pressed) {
-        music_noteon(note);
-        if (music_sequence_recording) {
-          music_sequence[music_sequence_count] = note;
-          music_sequence_count++;
-        }
+        music_scheduler_note_on(note, record->event.time);
       } else {
-        music_noteoff(note);
+        music_scheduler_note_off(note, record->event.time);
       }
 
       if (MUSIC_MASK)
@@ -297,16 +280,7 @@ void music_mode_cycle(void) {
 }
 
 void matrix_scan_music(void) {
-  if (music_sequence_playing) {
-    if ((music_sequence_timer == 0) || (timer_elapsed(music_sequence_timer) > music_sequence_interval)) {
-      music_sequence_timer = timer_read();
-      uint8_t prev_note = music_sequence[(music_sequence_position - 1 < 0)?(music_sequence_position - 1 + music_sequence_count):(music_sequence_position - 1)];
-      uint8_t next_note = music_sequence[music_sequence_position];
-      music_noteoff(prev_note);
-      music_noteon(next_note);
-      music_sequence_position = (music_sequence_position + 1) % music_sequence_count;
-    }
-  }
+  music_scheduler_task(timer_read());
 }
 
 __attribute__ ((weak))
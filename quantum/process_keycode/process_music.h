@@ -18,6 +18,7 @@
 #define PROCESS_MUSIC_H
 
 #include "quantum.h"
+#include "music_scheduler.h"
 
 #if defined(AUDIO_ENABLE) || (defined(MIDI_ENABLE) && defined(MIDI_BASIC))
 
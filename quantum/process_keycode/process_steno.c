@@ -17,7 +17,12 @@
 #include "quantum_keycodes.h"
 #include "eeprom.h"
 #include "keymap_steno.h"
+#ifdef VIRTSER_ENABLE
 #include "virtser.h"
+#endif
+#ifdef STENO_DICT_ENABLE
+#include "process_steno_dict.h"
+#endif
 #include <string.h>
 
 // TxBolt Codes
@@ -63,6 +68,7 @@ static uint8_t chord[MAX_STATE_SIZE] = {0};
 static int8_t pressed = 0;
 static steno_mode_t mode;
 
+#ifdef VIRTSER_ENABLE
 static const uint8_t boltmap[64] PROGMEM = {
   TXB_NUL, TXB_NUM, TXB_NUM, TXB_NUM, TXB_NUM, TXB_NUM, TXB_NUM,
   TXB_S_L, TXB_S_L, TXB_T_L, TXB_K_L, TXB_P_L, TXB_W_L, TXB_H_L,
@@ -71,31 +77,58 @@ static const uint8_t boltmap[64] PROGMEM = {
   TXB_P_R, TXB_B_R, TXB_L_R, TXB_G_R, TXB_T_R, TXB_S_R, TXB_D_R,
   TXB_NUM, TXB_NUM, TXB_NUM, TXB_NUM, TXB_NUM, TXB_NUM, TXB_Z_R
 };
+#endif
 
 static void steno_clear_state(void) {
   memset(state, 0, sizeof(state));
   memset(chord, 0, sizeof(chord));
 }
 
-static void send_steno_state(uint8_t size, bool send_empty) {
+#ifdef VIRTSER_ENABLE
+// Queues the chord as one frame, it goes to the host in one packet
+static void send_steno_state(uint8_t size, bool send_empty, bool terminate) {
+  uint8_t frame[MAX_STATE_SIZE + 1];
+  uint8_t length = 0;
+
   for (uint8_t i = 0; i < size; ++i) {
     if (chord[i] || send_empty) {
-      virtser_send(chord[i]);
+      frame[length++] = chord[i];
     }
   }
+  if (terminate) {
+    frame[length++] = 0;
+  }
+  virtser_send_buf(frame, length);
 }
+#endif
 
 void steno_init() {
   if (!eeconfig_is_enabled()) {
     eeconfig_init();
   }
-  mode = eeprom_read_byte(EECONFIG_STENOMODE);
+  mode = eeconfig_read_byte(EECONFIG_STENOMODE);
+#ifndef STENO_DICT_ENABLE
+  if (mode == STENO_MODE_DICT) {
+    mode = STENO_MODE_GEMINI;
+  }
+#endif
+#ifndef VIRTSER_ENABLE
+  mode = STENO_MODE_DICT;
+#endif
 }
 
 void steno_set_mode(steno_mode_t new_mode) {
   steno_clear_state();
+#ifdef VIRTSER_ENABLE
   mode = new_mode;
-  eeprom_update_byte(EECONFIG_STENOMODE, mode);
+#else
+  // Without the serial port the dictionary is the only mode there is
+  mode = STENO_MODE_DICT;
+#endif
+#ifdef STENO_DICT_ENABLE
+  steno_dict_reset();
+#endif
+  eeconfig_update_byte(EECONFIG_STENOMODE, mode);
 }
 
 /* override to intercept chords right before they get sent.
@@ -113,13 +146,21 @@ bool process_steno_user(uint16_t keycode, keyrecord_t *record) { return true; }
 static void send_steno_chord(void) {
   if (send_steno_chord_user(mode, chord)) {
     switch(mode) {
+#ifdef VIRTSER_ENABLE
       case STENO_MODE_BOLT:
-	send_steno_state(BOLT_STATE_SIZE, false);
-	virtser_send(0); // terminating byte
+	send_steno_state(BOLT_STATE_SIZE, false, true); // with the terminating byte
 	break;
       case STENO_MODE_GEMINI:
 	chord[0] |= 0x80; // Indicate start of packet
-	send_steno_state(GEMINI_STATE_SIZE, true);
+	send_steno_state(GEMINI_STATE_SIZE, true, false);
+	break;
+#endif
+#ifdef STENO_DICT_ENABLE
+      case STENO_MODE_DICT:
+	steno_dict_translate(steno_dict_stroke(chord));
+	break;
+#endif
+      default:
 	break;
     }
   }
@@ -134,6 +175,7 @@ uint8_t *steno_get_chord(void) {
   return &chord[0];
 }
 
+#ifdef VIRTSER_ENABLE
 static bool update_state_bolt(uint8_t key, bool press) {
   uint8_t boltcode = pgm_read_byte(boltmap + key);
   if (press) {
@@ -144,6 +186,7 @@ static bool update_state_bolt(uint8_t key, bool press) {
   }
   return false;
 }
+#endif
 
 static bool update_state_gemini(uint8_t key, bool press) {
   int idx = key / 7;
@@ -159,6 +202,7 @@ static bool update_state_gemini(uint8_t key, bool press) {
 
 bool process_steno(uint16_t keycode, keyrecord_t *record) {
   switch (keycode) {
+#ifdef VIRTSER_ENABLE
     case QK_STENO_BOLT:
       if (!process_steno_user(keycode, record)) {
 	return false;
@@ -176,6 +220,18 @@ bool process_steno(uint16_t keycode, keyrecord_t *record) {
         steno_set_mode(STENO_MODE_GEMINI);
       }
       return false;
+#endif
+
+#ifdef STENO_DICT_ENABLE
+    case QK_STENO_DICT:
+      if (!process_steno_user(keycode, record)) {
+	return false;
+      }
+      if (IS_PRESSED(record->event)) {
+        steno_set_mode(STENO_MODE_DICT);
+      }
+      return false;
+#endif
 
     case STN__MIN...STN__MAX:
       if (!process_steno_user(keycode, record)) {
@@ -183,8 +239,11 @@ bool process_steno(uint16_t keycode, keyrecord_t *record) {
       }
       switch(mode) {
 	case STENO_MODE_BOLT:
+#ifdef VIRTSER_ENABLE
 	  update_state_bolt(keycode - QK_STENO, IS_PRESSED(record->event));
+#endif
 	case STENO_MODE_GEMINI:
+	case STENO_MODE_DICT:
 	  update_state_gemini(keycode - QK_STENO, IS_PRESSED(record->event));
       }
       // allow postprocessing hooks
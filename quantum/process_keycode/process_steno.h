@@ -18,11 +18,13 @@
 
 #include "quantum.h"
 
-#if defined(STENO_ENABLE) && !defined(VIRTSER_ENABLE)
-  #error "must have virtser enabled to use steno"
+#if defined(STENO_ENABLE) && !defined(VIRTSER_ENABLE) && !defined(STENO_DICT_ENABLE)
+  #error "must have virtser or the steno dictionary enabled to use steno"
 #endif
 
-typedef enum { STENO_MODE_BOLT, STENO_MODE_GEMINI } steno_mode_t;
+// STENO_MODE_BOLT and STENO_MODE_GEMINI need VIRTSER_ENABLE, they talk to Plover
+// STENO_MODE_DICT needs STENO_DICT_ENABLE, it types the translations itself
+typedef enum { STENO_MODE_BOLT, STENO_MODE_GEMINI, STENO_MODE_DICT } steno_mode_t;
 
 bool process_steno(uint16_t keycode, keyrecord_t *record);
 void steno_init(void);
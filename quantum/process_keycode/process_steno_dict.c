@@ -0,0 +1,165 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "process_steno_dict.h"
+#include "quantum.h"
+
+#define NONE 0xFF
+
+// The bit of each Gemini PR key in a stroke, in the order of keymap_steno.h
+static const uint8_t gemini_to_stroke[42] PROGMEM = {
+  NONE, 0,    0,    0,    0,    0,    0,
+  1,    1,    2,    3,    4,    5,    6,
+  7,    8,    9,    10,   10,   NONE, NONE,
+  NONE, 10,   10,   11,   12,   13,   14,
+  15,   16,   17,   18,   19,   20,   21,
+  0,    0,    0,    0,    0,    0,    22
+};
+
+static const char order[] PROGMEM = STENO_DICT_ORDER;
+
+// A O * E U, without them a stroke with right hand keys needs a hyphen
+#define MIDDLE_KEYS 0x1F00UL
+#define FIRST_RIGHT_KEY 13
+
+// Output state, the flags of the last translation that still apply
+#define STATE_MASK (STENO_DICT_ATTACH_AFTER | STENO_DICT_CAP_NEXT)
+
+typedef struct {
+  uint8_t length;  // characters typed by the stroke
+  uint8_t state;   // state before it
+} undo_t;
+
+static uint8_t state = STENO_DICT_ATTACH_AFTER;
+static undo_t history[STENO_DICT_UNDO_SIZE];
+static uint8_t history_top = 0;
+static uint8_t history_count = 0;
+
+const steno_dict_entry_t *steno_dict_find(const steno_dict_entry_t *dict, uint16_t size, uint32_t stroke) {
+  uint16_t low = 0, high = size;
+
+  while (low < high) {
+    uint16_t middle = low + (high - low) / 2;
+    uint32_t key = pgm_read_dword(&dict[middle].stroke);
+    if (key == stroke) {
+      return &dict[middle];
+    }
+    if (key < stroke) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+uint32_t steno_dict_stroke(const uint8_t chord[6]) {
+  uint32_t stroke = 0;
+
+  for (uint8_t key = 0; key < sizeof(gemini_to_stroke); key++) {
+    uint8_t bit = pgm_read_byte(&gemini_to_stroke[key]);
+    if (bit != NONE && (chord[key / 7] & (1 << (6 - key % 7)))) {
+      stroke |= 1UL << bit;
+    }
+  }
+  return stroke;
+}
+
+uint8_t steno_dict_outline(uint32_t stroke, char *buffer) {
+  uint8_t length = 0;
+  bool hyphen = !(stroke & MIDDLE_KEYS);
+
+  for (uint8_t i = 0; i < STENO_DICT_KEYS; i++) {
+    if (!(stroke & (1UL << i))) {
+      continue;
+    }
+    if (hyphen && i >= FIRST_RIGHT_KEY) {
+      buffer[length++] = '-';
+      hyphen = false;
+    }
+    buffer[length++] = pgm_read_byte(&order[i]);
+  }
+  buffer[length] = 0;
+  return length;
+}
+
+void steno_dict_reset(void) {
+  state = STENO_DICT_ATTACH_AFTER;
+  history_count = 0;
+}
+
+static void undo(void) {
+  if (!history_count) {
+    return;
+  }
+  history_top = (history_top + STENO_DICT_UNDO_SIZE - 1) % STENO_DICT_UNDO_SIZE;
+  history_count--;
+  for (uint8_t i = 0; i < history[history_top].length; i++) {
+    register_code(KC_BSPC);
+    unregister_code(KC_BSPC);
+  }
+  state = history[history_top].state;
+}
+
+void steno_dict_translate(uint32_t stroke) {
+  const steno_dict_entry_t *entry = steno_dict_find(steno_dict, steno_dict_size, stroke);
+  char outline[STENO_DICT_KEYS + 2];
+  const char *text;
+  uint8_t flags = 0;
+  uint8_t length = 0;
+  char c;
+
+  if (entry) {
+    flags = pgm_read_byte(&entry->flags);
+    text = steno_dict_text + pgm_read_word(&entry->text);
+  } else {
+    // untranslated, the outline is typed like Plover does
+    steno_dict_outline(stroke, outline);
+    text = outline;
+  }
+  if (flags & STENO_DICT_UNDO) {
+    undo();
+    return;
+  }
+
+  c = entry ? pgm_read_byte(text) : *text;
+  if (c) {
+    if (!(state & STENO_DICT_ATTACH_AFTER) && !(flags & STENO_DICT_ATTACH_BEFORE)) {
+      send_char(' ');
+      length++;
+    }
+    if ((state & STENO_DICT_CAP_NEXT) && c >= 'a' && c <= 'z') {
+      c -= 'a' - 'A';
+    }
+    while (c && length < UINT8_MAX) {
+      send_char(c);
+      length++;
+      c = entry ? pgm_read_byte(++text) : *++text;
+    }
+  }
+
+  history[history_top].length = length;
+  history[history_top].state = state;
+  history_top = (history_top + 1) % STENO_DICT_UNDO_SIZE;
+  if (history_count < STENO_DICT_UNDO_SIZE) {
+    history_count++;
+  }
+
+  if (length) {
+    state = flags & STATE_MASK;
+  } else {
+    // {-|} and {^} change the next word without typing anything
+    state |= flags & STATE_MASK;
+  }
+}
@@ -0,0 +1,72 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROCESS_STENO_DICT_H
+#define PROCESS_STENO_DICT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "progmem.h"
+
+/* Strokes undone by the undo translation, each takes 2 bytes of RAM */
+#ifndef STENO_DICT_UNDO_SIZE
+#define STENO_DICT_UNDO_SIZE 16
+#endif
+
+/*
+ * A stroke is a bit per steno key, in steno order: bit 0 is the number
+ * bar, then S T K P W H R A O * E U F R P B L G T S D Z.
+ */
+#define STENO_DICT_KEYS 23
+#define STENO_DICT_ORDER "#STKPWHRAO*EUFRPBLGTSDZ"
+
+/* Translation flags, set by util/steno_dict.py */
+#define STENO_DICT_ATTACH_BEFORE 0x01  // no space before the text, {^}word
+#define STENO_DICT_ATTACH_AFTER  0x02  // no space before the next word, word{^}
+#define STENO_DICT_CAP_NEXT      0x04  // capitalize the next word, {.} and {-|}
+#define STENO_DICT_UNDO          0x08  // =undo, takes back the last stroke
+
+/*
+ * One entry of the dictionary. The entries are sorted by stroke and live
+ * in flash, the text is an offset into steno_dict_text.
+ */
+typedef struct {
+  uint32_t stroke;
+  uint16_t text;
+  uint8_t  flags;
+} steno_dict_entry_t;
+
+/* The dictionary, generated by util/steno_dict.py */
+extern const steno_dict_entry_t steno_dict[] PROGMEM;
+extern const char steno_dict_text[] PROGMEM;
+extern const uint16_t steno_dict_size;
+
+/* The entry for a stroke by binary search, NULL if there is none */
+const steno_dict_entry_t *steno_dict_find(const steno_dict_entry_t *dict, uint16_t size, uint32_t stroke);
+
+/* The stroke of a Gemini PR chord, as kept by process_steno */
+uint32_t steno_dict_stroke(const uint8_t chord[6]);
+
+/* Writes a stroke the way Plover does, like "STKPW" or "-G". Returns the
+ * length, buffer needs STENO_DICT_KEYS + 2 bytes. */
+uint8_t steno_dict_outline(uint32_t stroke, char *buffer);
+
+/* Looks up a stroke and types its translation, or its outline if it is
+ * not in the dictionary */
+void steno_dict_translate(uint32_t stroke);
+
+/* Forgets the undo history and starts a new sentence */
+void steno_dict_reset(void);
+
+#endif
@@ -15,6 +15,7 @@
  */
 
 #include "process_ucis.h"
+#include <string.h>
 
 qk_ucis_state_t qk_ucis_state;
 
@@ -32,22 +33,68 @@ void qk_ucis_start_user(void) {
   unicode_input_finish();
 }
 
-static bool is_uni_seq(char *seq) {
+// Symbols in the table, and whether they are sorted, found on the first lookup
+static uint16_t table_size;
+static bool table_sorted;
+static bool table_scanned = false;
+
+static void scan_table(void) {
+  table_size = 0;
+  table_sorted = true;
+  while (ucis_symbol_table[table_size].symbol) {
+    if (table_size && strcmp(ucis_symbol_table[table_size - 1].symbol, ucis_symbol_table[table_size].symbol) >= 0) {
+      table_sorted = false;
+    }
+    table_size++;
+  }
+  table_scanned = true;
+}
+
+// The typed symbol as text, false if it has a key no symbol can have
+static bool typed_symbol(char *symbol) {
   uint8_t i;
 
-  for (i = 0; seq[i]; i++) {
-    uint16_t code;
-    if (('1' <= seq[i]) && (seq[i] <= '0'))
-      code = seq[i] - '1' + KC_1;
+  for (i = 0; i < qk_ucis_state.count - 1; i++) {
+    uint16_t code = qk_ucis_state.codes[i];
+    if (KC_A <= code && code <= KC_Z)
+      symbol[i] = code - KC_A + 'a';
+    else if (KC_1 <= code && code <= KC_9)
+      symbol[i] = code - KC_1 + '1';
+    else if (code == KC_0)
+      symbol[i] = '0';
     else
-      code = seq[i] - 'a' + KC_A;
-
-    if (i > qk_ucis_state.count || qk_ucis_state.codes[i] != code)
       return false;
   }
+  symbol[i] = 0;
+  return true;
+}
 
-  return (qk_ucis_state.codes[i] == KC_ENT ||
-          qk_ucis_state.codes[i] == KC_SPC);
+static const qk_ucis_symbol_t *find_symbol(const char *symbol) {
+  if (!table_scanned) {
+    scan_table();
+  }
+
+  if (table_sorted) {
+    uint16_t low = 0, high = table_size;
+    while (low < high) {
+      uint16_t middle = low + (high - low) / 2;
+      int order = strcmp(symbol, ucis_symbol_table[middle].symbol);
+      if (order == 0)
+        return &ucis_symbol_table[middle];
+      if (order > 0)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    return NULL;
+  }
+
+  for (uint16_t i = 0; i < table_size; i++) {
+    // most symbols differ in the first letter
+    if (ucis_symbol_table[i].symbol[0] == symbol[0] && !strcmp(ucis_symbol_table[i].symbol, symbol))
+      return &ucis_symbol_table[i];
+  }
+  return NULL;
 }
 
 __attribute__((weak))
@@ -56,35 +103,29 @@ void qk_ucis_symbol_fallback (void) {
     uint8_t code = qk_ucis_state.codes[i];
     register_code(code);
     unregister_code(code);
-    wait_ms(UNICODE_TYPE_DELAY);
   }
 }
 
 void register_ucis(const char *hex) {
   for(int i = 0; hex[i]; i++) {
-    uint8_t kc = 0;
     char c = hex[i];
 
     switch (c) {
-    case '0':
-      kc = KC_0;
-      break;
-    case '1' ... '9':
-      kc = c - '1' + KC_1;
+    case '0' ... '9':
+      c -= '0';
       break;
     case 'a' ... 'f':
-      kc = c - 'a' + KC_A;
+      c -= 'a' - 0xA;
       break;
     case 'A' ... 'F':
-      kc = c - 'A' + KC_A;
+      c -= 'A' - 0xA;
       break;
+    default:
+      continue;
     }
 
-    if (kc) {
-      register_code (kc);
-      unregister_code (kc);
-      wait_ms (UNICODE_TYPE_DELAY);
-    }
+    register_code (hex_to_keycode(c));
+    unregister_code (hex_to_keycode(c));
   }
 }
 
@@ -116,12 +157,12 @@ bool process_ucis (uint16_t keycode, keyrecord_t *record) {
   }
 
   if (keycode == KC_ENT || keycode == KC_SPC || keycode == KC_ESC) {
-    bool symbol_found = false;
+    const qk_ucis_symbol_t *symbol = NULL;
+    char typed[UCIS_MAX_SYMBOL_LENGTH + 1];
 
     for (i = qk_ucis_state.count; i > 0; i--) {
       register_code (KC_BSPC);
       unregister_code (KC_BSPC);
-      wait_ms(UNICODE_TYPE_DELAY);
     }
 
     if (keycode == KC_ESC) {
@@ -129,15 +170,14 @@ bool process_ucis (uint16_t keycode, keyrecord_t *record) {
       return false;
     }
 
-    unicode_input_start();
-    for (i = 0; ucis_symbol_table[i].symbol; i++) {
-      if (is_uni_seq (ucis_symbol_table[i].symbol)) {
-        symbol_found = true;
-        register_ucis(ucis_symbol_table[i].code + 2);
-        break;
-      }
+    if (typed_symbol(typed)) {
+      symbol = find_symbol(typed);
     }
-    if (!symbol_found) {
+
+    unicode_input_start();
+    if (symbol) {
+      register_ucis(symbol->code + 2);
+    } else {
       qk_ucis_symbol_fallback();
     }
     unicode_input_finish();
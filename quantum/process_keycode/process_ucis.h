@@ -31,7 +31,7 @@ typedef struct {
 
 typedef struct {
   uint8_t count;
-  uint16_t codes[UCIS_MAX_SYMBOL_LENGTH];
+  uint16_t codes[UCIS_MAX_SYMBOL_LENGTH + 1]; // and the key that ends it
   bool in_progress:1;
 } qk_ucis_state_t;
 
@@ -23,7 +23,7 @@ uint8_t mods;
 void set_unicode_input_mode(uint8_t os_target)
 {
   input_mode = os_target;
-  eeprom_update_byte(EECONFIG_UNICODEMODE, os_target);
+  eeconfig_update_byte(EECONFIG_UNICODEMODE, os_target);
 }
 
 uint8_t get_unicode_input_mode(void) {
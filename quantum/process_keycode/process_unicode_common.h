@@ -31,6 +31,7 @@ uint8_t get_unicode_input_mode(void);
 void unicode_input_start(void);
 void unicode_input_finish(void);
 void register_hex(uint16_t hex);
+uint16_t hex_to_keycode(uint8_t hex);
 
 #define UC_OSX 0  // Mac OS X
 #define UC_LNX 1  // Linux
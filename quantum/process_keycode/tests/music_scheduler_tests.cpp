@@ -0,0 +1,303 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cmath>
+#include <vector>
+extern "C" {
+#include "music_scheduler.h"
+}
+
+struct VoiceEvent {
+    uint16_t time;
+    bool on;
+    uint8_t note;
+    bool operator==(const VoiceEvent &other) const { return time == other.time && on == other.on && note == other.note; }
+};
+
+static std::ostream &operator<<(std::ostream &os, const VoiceEvent &e) {
+    return os << (e.on ? "on " : "off ") << (int)e.note << " at " << e.time;
+}
+
+static std::vector<VoiceEvent> events;
+static uint16_t now;
+
+extern "C" {
+void music_voice_on(uint8_t note) {
+    events.push_back({now, true, note});
+}
+
+void music_voice_off(uint8_t note) {
+    events.push_back({now, false, note});
+}
+}
+
+static VoiceEvent on(uint16_t time, uint8_t note) {
+    return {time, true, note};
+}
+
+static VoiceEvent off(uint16_t time, uint8_t note) {
+    return {time, false, note};
+}
+
+class MusicScheduler : public ::testing::Test {
+   public:
+    MusicScheduler() {
+        now = 1000;
+        music_play_stop();
+        music_record_stop(now);
+        music_scheduler_all_notes_off();
+        music_set_grid(MUSIC_GRID_MS);
+        events.clear();
+    }
+
+    // Runs the task every ms until time
+    void run_until(uint16_t time) {
+        while (now != time) {
+            now++;
+            music_scheduler_task(now);
+        }
+    }
+
+    void press(uint8_t note) {
+        music_scheduler_note_on(note, now);
+    }
+
+    void release(uint8_t note) {
+        music_scheduler_note_off(note, now);
+    }
+
+    // Records notes as {note, on time, off time} from the start of the recording
+    void record(const std::vector<std::vector<uint16_t> > &notes, uint16_t length) {
+        uint16_t start = now;
+        music_record_start(now);
+        for (uint16_t t = 0; t <= length; t++) {
+            for (size_t i = 0; i < notes.size(); i++) {
+                if (notes[i][1] == t) {
+                    press(notes[i][0]);
+                }
+                if (notes[i][2] == t) {
+                    release(notes[i][0]);
+                }
+            }
+            run_until(start + t + 1);
+        }
+        music_record_stop(now);
+        events.clear();
+    }
+};
+
+TEST_F(MusicScheduler, FrequencyTableMatchesTheFormula) {
+    for (int note = 0; note < 128; note++) {
+        double expected = std::pow(2.0, (note - 69) / 12.0) * PITCH_STANDARD_A;
+        EXPECT_NEAR(music_note_frequency(note), expected, expected * 1e-6) << "note " << note;
+    }
+    EXPECT_FLOAT_EQ(music_note_frequency(69), PITCH_STANDARD_A);
+    EXPECT_FLOAT_EQ(music_note_frequency(57), PITCH_STANDARD_A / 2);
+}
+
+TEST_F(MusicScheduler, NotesStartInTheTask) {
+    press(60);
+    release(62);
+    EXPECT_TRUE(events.empty());
+
+    run_until(1001);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(1001, 60)}));
+    EXPECT_EQ(music_scheduler_voices(), 1);
+}
+
+TEST_F(MusicScheduler, ChordBeyondTheVoicesTakesOverTheOldest) {
+    for (uint8_t note = 60; note < 60 + MUSIC_VOICES + 2; note++) {
+        press(note);
+    }
+    run_until(1001);
+    EXPECT_EQ(music_scheduler_voices(), MUSIC_VOICES);
+
+    std::vector<VoiceEvent> expected;
+    for (uint8_t note = 60; note < 60 + MUSIC_VOICES; note++) {
+        expected.push_back(on(1001, note));
+    }
+    expected.push_back(off(1001, 60));
+    expected.push_back(on(1001, 60 + MUSIC_VOICES));
+    expected.push_back(off(1001, 61));
+    expected.push_back(on(1001, 60 + MUSIC_VOICES + 1));
+    EXPECT_EQ(events, expected);
+
+    // releasing a note that lost its voice does nothing
+    events.clear();
+    release(60);
+    release(62);
+    run_until(1002);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({off(1002, 62)}));
+}
+
+TEST_F(MusicScheduler, SameNoteStartsOver) {
+    press(60);
+    press(60);
+    run_until(1001);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(1001, 60), off(1001, 60), on(1001, 60)}));
+    EXPECT_EQ(music_scheduler_voices(), 1);
+}
+
+TEST_F(MusicScheduler, FullQueueIsNeverDropped) {
+    int ons = 0, offs = 0;
+
+    for (int i = 0; i < 4 * MUSIC_EVENT_QUEUE_SIZE; i++) {
+        press(40 + i);
+        release(40 + i);
+    }
+    run_until(1001);
+    for (size_t i = 0; i < events.size(); i++) {
+        events[i].on ? ons++ : offs++;
+    }
+    EXPECT_EQ(ons, 4 * MUSIC_EVENT_QUEUE_SIZE);
+    EXPECT_EQ(offs, 4 * MUSIC_EVENT_QUEUE_SIZE);
+    EXPECT_EQ(music_scheduler_voices(), 0);
+}
+
+TEST_F(MusicScheduler, AllNotesOffDropsTheQueue) {
+    press(60);
+    run_until(1001);
+    press(62);
+    music_scheduler_all_notes_off();
+    run_until(1002);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(1001, 60), off(1001, 60)}));
+    EXPECT_EQ(music_scheduler_voices(), 0);
+}
+
+TEST_F(MusicScheduler, PlaybackIsQuantizedToTheGrid) {
+    record({{60, 0, 90}, {62, 190, 260}, {64, 420, 480}}, 550);
+    EXPECT_TRUE(music_recorded());
+
+    uint16_t start = now;
+    music_play_start(now);
+    run_until(start + 600 + 1);
+
+    // on the 100ms grid, the loop is 600ms long
+    EXPECT_EQ(events, std::vector<VoiceEvent>({
+                          on(start + 1, 60),
+                          off(start + 100, 60),
+                          on(start + 200, 62),
+                          off(start + 300, 62),
+                          on(start + 400, 64),
+                          off(start + 500, 64),
+                          on(start + 600, 60),
+                      }));
+}
+
+TEST_F(MusicScheduler, LooseChordPlaysTogether) {
+    record({{60, 0, 300}, {64, 30, 300}, {67, 45, 300}}, 400);
+
+    uint16_t start = now;
+    music_play_start(now);
+    run_until(start + 1);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(start + 1, 60), on(start + 1, 64), on(start + 1, 67)}));
+}
+
+TEST_F(MusicScheduler, ShortNotesLastOneGridStep) {
+    record({{60, 0, 10}}, 300);
+
+    uint16_t start = now;
+    music_play_start(now);
+    run_until(start + 150);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(start + 1, 60), off(start + 100, 60)}));
+}
+
+TEST_F(MusicScheduler, FinerGridFollowsTheRecording) {
+    record({{60, 0, 20}, {62, 30, 50}}, 60);
+
+    uint16_t start = now;
+    music_set_grid(10);
+    music_play_start(now);
+    run_until(start + 60);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(start + 1, 60), off(start + 20, 60), on(start + 30, 62), off(start + 50, 62)}));
+}
+
+TEST_F(MusicScheduler, GridChangeStartsTheLoopOver) {
+    record({{60, 0, 100}, {62, 200, 300}}, 400);
+
+    uint16_t start = now;
+    music_play_start(now);
+    run_until(start + 250);
+    events.clear();
+    music_set_grid(50);
+    run_until(start + 260);
+
+    // the held note stops and the loop starts over on the new grid
+    EXPECT_EQ(events, std::vector<VoiceEvent>({off(start + 251, 62), on(start + 251, 60)}));
+}
+
+TEST_F(MusicScheduler, KeysPlayOverThePlayback) {
+    record({{60, 0, 300}}, 400);
+
+    uint16_t start = now;
+    music_play_start(now);
+    run_until(start + 10);
+    press(67);
+    run_until(start + 20);
+    release(67);
+    run_until(start + 30);
+    EXPECT_EQ(events, std::vector<VoiceEvent>({on(start + 1, 60), on(start + 11, 67), off(start + 21, 67)}));
+}
+
+TEST_F(MusicScheduler, StopSilencesThePlayback) {
+    record({{60, 0, 300}}, 400);
+
+    music_play_start(now);
+    run_until(now + 10);
+    music_play_stop();
+    EXPECT_EQ(music_scheduler_voices(), 0);
+    EXPECT_FALSE(music_playing());
+}
+
+TEST_F(MusicScheduler, FullRecordingStops) {
+    music_record_start(now);
+    for (int i = 0; i < MUSIC_RECORD_SIZE; i++) {
+        press(60);
+        release(60);
+        run_until(now + 1);
+    }
+    EXPECT_FALSE(music_recording());
+    EXPECT_TRUE(music_recorded());
+}
+
+TEST_F(MusicScheduler, NothingRecordedPlaysNothing) {
+    music_record_start(now);
+    run_until(now + 100);
+    music_record_stop(now);
+    music_play_start(now);
+
+    EXPECT_FALSE(music_recorded());
+    EXPECT_FALSE(music_playing());
+}
+
+TEST_F(MusicScheduler, TableIsFasterThanPow) {
+    const int rounds = 100000;
+    volatile float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink = sink + std::pow(2.0, ((i & 127) - 69) / 12.0) * PITCH_STANDARD_A;
+    }
+    auto pow_done = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink = sink + music_note_frequency(i & 127);
+    }
+    auto table_done = std::chrono::steady_clock::now();
+
+    std::cout << "[          ] pow " << std::chrono::duration<double, std::nano>(pow_done - start).count() / rounds << " ns, table "
+              << std::chrono::duration<double, std::nano>(table_done - pow_done).count() / rounds << " ns per note" << std::endl;
+}
@@ -0,0 +1,5 @@
+music_scheduler_SRC := \
+	$(QUANTUM_PATH)/process_keycode/tests/music_scheduler_tests.cpp \
+	$(QUANTUM_PATH)/process_keycode/music_scheduler.c
+
+music_scheduler_INC := $(QUANTUM_PATH)/process_keycode
@@ -52,9 +52,9 @@ extern backlight_config_t backlight_config;
   #ifndef AG_SWAP_SONG
     #define AG_SWAP_SONG SONG(AG_SWAP_SOUND)
   #endif
-  float goodbye_song[][2] = GOODBYE_SONG;
-  float ag_norm_song[][2] = AG_NORM_SONG;
-  float ag_swap_song[][2] = AG_SWAP_SONG;
+  const song_note_t goodbye_song[] PROGMEM = GOODBYE_SONG;
+  const song_note_t ag_norm_song[] PROGMEM = AG_NORM_SONG;
+  const song_note_t ag_swap_song[] PROGMEM = AG_SWAP_SONG;
   #ifdef DEFAULT_LAYER_SONGS
     float default_layer_songs[][16][2] = DEFAULT_LAYER_SONGS;
   #endif
@@ -150,15 +150,18 @@ void reset_keyboard(void) {
 #if defined(AUDIO_ENABLE) && !defined(NO_MUSIC_MODE)
   music_all_notes_off();
   uint16_t timer_start = timer_read();
-  PLAY_SONG(goodbye_song);
+  // cut off whatever song is playing, the goodbye song won't wait behind it
+  stop_all_notes();
+  PLAY_COMPACT_SONG(goodbye_song);
   shutdown_user();
   while(timer_elapsed(timer_start) < 250)
-    wait_ms(1);
+    sequencer_task();
   stop_all_notes();
 #else
   wait_ms(250);
 #endif
 // this is also done later in bootloader.c - not sure if it's neccesary here
+  eeconfig_flush();
 #ifdef BOOTLOADER_CATERINA
   *(uint16_t *)0x0800 = 0x7777; // these two are a-star-specific
 #endif
@@ -192,22 +195,25 @@ bool process_record_quantum(keyrecord_t *record) {
   /* This gets the keycode from the key pressed */
   keypos_t key = record->event.key;
   uint16_t keycode;
+  uint8_t layer;
 
   #if !defined(NO_ACTION_LAYER) && defined(PREVENT_STUCK_MODIFIERS)
     /* TODO: Use store_or_get_action() or a similar function. */
     if (!disable_action_cache) {
-      uint8_t layer;
-
       if (record->event.pressed) {
         layer = layer_switch_get_layer(key);
         update_source_layers_cache(key, layer);
       } else {
         layer = read_source_layers_cache(key);
       }
-      keycode = keymap_key_to_keycode(layer, key);
     } else
   #endif
-    keycode = keymap_key_to_keycode(layer_switch_get_layer(key), key);
+    layer = layer_switch_get_layer(key);
+    keycode = keymap_key_to_keycode(layer, key);
+
+  #ifdef KEY_TRACE_ENABLE
+    key_trace_record(record, keycode, layer);
+  #endif
 
     // This is how you use actions here
     // if (keycode == KC_LEAD) {
@@ -484,7 +490,7 @@ bool process_record_quantum(keyrecord_t *record) {
             keymap_config.swap_lalt_lgui = true;
             keymap_config.swap_ralt_rgui = true;
             #ifdef AUDIO_ENABLE
-              PLAY_SONG(ag_swap_song);
+              PLAY_COMPACT_SONG(ag_swap_song);
             #endif
             break;
           case MAGIC_UNSWAP_CONTROL_CAPSLOCK:
@@ -515,7 +521,7 @@ bool process_record_quantum(keyrecord_t *record) {
             keymap_config.swap_lalt_lgui = false;
             keymap_config.swap_ralt_rgui = false;
             #ifdef AUDIO_ENABLE
-              PLAY_SONG(ag_norm_song);
+              PLAY_COMPACT_SONG(ag_norm_song);
             #endif
             break;
           case MAGIC_TOGGLE_NKRO:
@@ -832,6 +838,9 @@ void tap_random_base64(void) {
 }
 
 void matrix_init_quantum() {
+  #ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_init();
+  #endif
   #ifdef BACKLIGHT_ENABLE
     backlight_init_ports();
   #endif
@@ -843,6 +852,9 @@ void matrix_init_quantum() {
 
 void matrix_scan_quantum() {
   #if defined(AUDIO_ENABLE)
+    sequencer_task();
+  #endif
+  #if ( defined(AUDIO_ENABLE) || (defined(MIDI_ENABLE) && defined(MIDI_BASIC))) && !defined(NO_MUSIC_MODE)
     matrix_scan_music();
   #endif
 
@@ -858,11 +870,25 @@ void matrix_scan_quantum() {
     backlight_task();
   #endif
 
+  #ifdef RAW_API_ENABLE
+    raw_api_task();
+  #endif
+
+  #ifdef KEY_TRACE_ENABLE
+    key_trace_task();
+  #endif
+
+  #ifdef AUTO_SHIFT_ENABLE
+    autoshift_task();
+  #endif
+
   matrix_scan_kb();
 }
 
 #if defined(BACKLIGHT_ENABLE) && defined(BACKLIGHT_PIN)
 
+#include "backlight_pwm.h"
+
 static const uint8_t backlight_pin = BACKLIGHT_PIN;
 
 // depending on the pin, we use a different output compare unit
@@ -879,18 +905,20 @@ static const uint8_t backlight_pin = BACKLIGHT_PIN;
 #  define NO_HARDWARE_PWM
 #endif
 
+// Timer1 plays the audio on these, so other pins are switched from
+// backlight_task() without a timer, like before
+#if defined(NO_HARDWARE_PWM) && (defined(B5_AUDIO) || defined(B6_AUDIO) || defined(B7_AUDIO))
+#  define NO_BACKLIGHT_TIMER
+#  if defined(BACKLIGHT_BREATHING) && !defined(BACKLIGHT_CUSTOM_DRIVER)
+#    error "Backlight breathing needs Timer1, which B5_AUDIO, B6_AUDIO and B7_AUDIO take. Please disable."
+#  endif
+#endif
+
 #ifndef BACKLIGHT_ON_STATE
 #define BACKLIGHT_ON_STATE 0
 #endif
 
-#ifdef NO_HARDWARE_PWM // pwm through software
-
-__attribute__ ((weak))
-void backlight_init_ports(void)
-{
-  // Setup backlight pin as output and output to on state.
-  // DDRx |= n
-  _SFR_IO8((backlight_pin >> 4) + 1) |= _BV(backlight_pin & 0xF);
+static inline void backlight_pin_on(void) {
   #if BACKLIGHT_ON_STATE == 0
     // PORTx &= ~n
     _SFR_IO8((backlight_pin >> 4) + 2) &= ~_BV(backlight_pin & 0xF);
@@ -900,135 +928,127 @@ void backlight_init_ports(void)
   #endif
 }
 
+static inline void backlight_pin_off(void) {
+  #if BACKLIGHT_ON_STATE == 0
+    // PORTx |= n
+    _SFR_IO8((backlight_pin >> 4) + 2) |= _BV(backlight_pin & 0xF);
+  #else
+    // PORTx &= ~n
+    _SFR_IO8((backlight_pin >> 4) + 2) &= ~_BV(backlight_pin & 0xF);
+  #endif
+}
+
+#ifndef BACKLIGHT_CUSTOM_DRIVER
+
+/* With the timer resetting at 64k (ICR1), this runs BACKLIGHT_PWM_FREQUENCY
+ * times per second, once per PWM period. OCR1x is double buffered and only
+ * picks up the new duty cycle at the next TOP.
+ */
+#if defined(NO_BACKLIGHT_TIMER) // pwm from the main loop
+
 __attribute__ ((weak))
 void backlight_set(uint8_t level) {}
 
-uint8_t backlight_tick = 0;
+static uint8_t backlight_tick = 0;
 
-#ifndef BACKLIGHT_CUSTOM_DRIVER
 void backlight_task(void) {
   if ((0xFFFF >> ((BACKLIGHT_LEVELS - get_backlight_level()) * ((BACKLIGHT_LEVELS + 1) / 2))) & (1 << backlight_tick)) {
-    #if BACKLIGHT_ON_STATE == 0
-      // PORTx &= ~n
-      _SFR_IO8((backlight_pin >> 4) + 2) &= ~_BV(backlight_pin & 0xF);
-    #else
-      // PORTx |= n
-      _SFR_IO8((backlight_pin >> 4) + 2) |= _BV(backlight_pin & 0xF);
-    #endif
+    backlight_pin_on();
   } else {
-    #if BACKLIGHT_ON_STATE == 0
-      // PORTx |= n
-      _SFR_IO8((backlight_pin >> 4) + 2) |= _BV(backlight_pin & 0xF);
-    #else
-      // PORTx &= ~n
-      _SFR_IO8((backlight_pin >> 4) + 2) &= ~_BV(backlight_pin & 0xF);
-    #endif
+    backlight_pin_off();
   }
   backlight_tick = (backlight_tick + 1) % 16;
 }
-#endif
 
-#ifdef BACKLIGHT_BREATHING
-  #ifndef BACKLIGHT_CUSTOM_DRIVER
-  #error "Backlight breathing only available with hardware PWM. Please disable."
-  #endif
-#endif
+#elif defined(NO_HARDWARE_PWM) // pwm through software
 
-#else // pwm through timer
+// duty cycle of the period that just started
+static uint16_t backlight_duty = 0;
+
+ISR(TIMER1_OVF_vect)
+{
+  // what was written last time, it was latched at TOP
+  backlight_duty = OCR1B;
+  // Compare B outranks this interrupt: if interrupts were held off past the
+  // duty cycle it has already run, and the pin has to stay off this period
+  if (backlight_duty && TCNT1 < backlight_duty && !(TIFR1 & _BV(OCF1B))) {
+    backlight_pin_on();
+  }
+  OCR1B = backlight_pwm_tick();
+}
 
-#define TIMER_TOP 0xFFFFU
-
-// See http://jared.geek.nz/2013/feb/linear-led-pwm
-static uint16_t cie_lightness(uint16_t v) {
-  if (v <= 5243) // if below 8% of max
-    return v / 9; // same as dividing by 900%
-  else {
-    uint32_t y = (((uint32_t) v + 10486) << 8) / (10486 + 0xFFFFUL); // add 16% of max and compare
-    // to get a useful result with integer division, we shift left in the expression above
-    // and revert what we've done again after squaring.
-    y = y * y * y >> 8;
-    if (y > 0xFFFFUL) // prevent overflow
-      return 0xFFFFU;
-    else
-      return (uint16_t) y;
+// the counter reached the duty cycle, the pin goes off until the next period
+ISR(TIMER1_COMPB_vect)
+{
+  if (backlight_duty < BACKLIGHT_PWM_TOP) {
+    backlight_pin_off();
   }
 }
 
-// range for val is [0..TIMER_TOP]. PWM pin is high while the timer count is below val.
-static inline void set_pwm(uint16_t val) {
-  OCR1x = val;
+#else // pwm through timer
+
+ISR(TIMER1_OVF_vect)
+{
+  uint16_t duty = backlight_pwm_tick();
+
+  if (duty == 0) {
+    // fast PWM still gives a one clock pulse at 0, disconnect the pin instead
+    TCCR1A &= ~(_BV(COM1x1));
+  } else {
+    TCCR1A |= _BV(COM1x1);
+  }
+  OCR1x = duty;
 }
 
-#ifndef BACKLIGHT_CUSTOM_DRIVER
+#endif // NO_HARDWARE_PWM
+
+#ifndef NO_BACKLIGHT_TIMER
+
 __attribute__ ((weak))
 void backlight_set(uint8_t level) {
   if (level > BACKLIGHT_LEVELS)
     level = BACKLIGHT_LEVELS;
 
-  if (level == 0) {
-    // Turn off PWM control on backlight pin
-    TCCR1A &= ~(_BV(COM1x1));
-  } else {
-    // Turn on PWM control of backlight pin
-    TCCR1A |= _BV(COM1x1);
-  }
-  // Set the brightness
-  set_pwm(cie_lightness(TIMER_TOP * (uint32_t)level / BACKLIGHT_LEVELS));
+  backlight_pwm_set_brightness((uint16_t)level * 255 / BACKLIGHT_LEVELS);
 }
 
+// The duty cycle is worked out in the timer interrupt, nothing to do here
 void backlight_task(void) {}
-#endif  // BACKLIGHT_CUSTOM_DRIVER
-
-#ifdef BACKLIGHT_BREATHING
 
-#define BREATHING_NO_HALT  0
-#define BREATHING_HALT_OFF 1
-#define BREATHING_HALT_ON  2
-#define BREATHING_STEPS 128
+#endif // NO_BACKLIGHT_TIMER
 
-static uint8_t breathing_period = BREATHING_PERIOD;
-static uint8_t breathing_halt = BREATHING_NO_HALT;
-static uint16_t breathing_counter = 0;
+#ifdef BACKLIGHT_BREATHING
 
 bool is_breathing(void) {
-    return !!(TIMSK1 & _BV(TOIE1));
+  return backlight_pwm_is_breathing();
 }
 
-#define breathing_interrupt_enable() do {TIMSK1 |= _BV(TOIE1);} while (0)
-#define breathing_interrupt_disable() do {TIMSK1 &= ~_BV(TOIE1);} while (0)
-#define breathing_min() do {breathing_counter = 0;} while (0)
-#define breathing_max() do {breathing_counter = breathing_period * 244 / 2;} while (0)
-
 void breathing_enable(void)
 {
-  breathing_counter = 0;
-  breathing_halt = BREATHING_NO_HALT;
-  breathing_interrupt_enable();
+  backlight_pwm_breathing_jump(false);
+  backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_NO_HALT);
+  backlight_pwm_breathing(true);
 }
 
 void breathing_pulse(void)
 {
-    if (get_backlight_level() == 0)
-      breathing_min();
-    else
-      breathing_max();
-    breathing_halt = BREATHING_HALT_ON;
-    breathing_interrupt_enable();
+  backlight_pwm_breathing_jump(get_backlight_level() != 0);
+  backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_HALT_ON);
+  backlight_pwm_breathing(true);
 }
 
 void breathing_disable(void)
 {
-    breathing_interrupt_disable();
-    // Restore backlight level
-    backlight_set(get_backlight_level());
+  // the interrupt goes back to the backlight level by itself
+  backlight_pwm_breathing(false);
 }
 
 void breathing_self_disable(void)
 {
   if (get_backlight_level() == 0)
-    breathing_halt = BREATHING_HALT_OFF;
+    backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_HALT_OFF);
   else
-    breathing_halt = BREATHING_HALT_ON;
+    backlight_pwm_breathing_halt(BACKLIGHT_BREATHING_HALT_ON);
 }
 
 void breathing_toggle(void) {
@@ -1040,9 +1060,7 @@ void breathing_toggle(void) {
 
 void breathing_period_set(uint8_t value)
 {
-  if (!value)
-    value = 1;
-  breathing_period = value;
+  backlight_pwm_breathing_period(value);
 }
 
 void breathing_period_default(void) {
@@ -1051,58 +1069,28 @@ void breathing_period_default(void) {
 
 void breathing_period_inc(void)
 {
-  breathing_period_set(breathing_period+1);
+  breathing_period_set(backlight_pwm_get_breathing_period() + 1);
 }
 
 void breathing_period_dec(void)
 {
-  breathing_period_set(breathing_period-1);
-}
-
-/* To generate breathing curve in python:
- * from math import sin, pi; [int(sin(x/128.0*pi)**4*255) for x in range(128)]
- */
-static const uint8_t breathing_table[BREATHING_STEPS] PROGMEM = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 17, 20, 24, 28, 32, 36, 41, 46, 51, 57, 63, 70, 76, 83, 91, 98, 106, 113, 121, 129, 138, 146, 154, 162, 170, 178, 185, 193, 200, 207, 213, 220, 225, 231, 235, 240, 244, 247, 250, 252, 253, 254, 255, 254, 253, 252, 250, 247, 244, 240, 235, 231, 225, 220, 213, 207, 200, 193, 185, 178, 170, 162, 154, 146, 138, 129, 121, 113, 106, 98, 91, 83, 76, 70, 63, 57, 51, 46, 41, 36, 32, 28, 24, 20, 17, 15, 12, 10, 8, 6, 5, 4, 3, 2, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
-// Use this before the cie_lightness function.
-static inline uint16_t scale_backlight(uint16_t v) {
-  return v / BACKLIGHT_LEVELS * get_backlight_level();
-}
-
-/* Assuming a 16MHz CPU clock and a timer that resets at 64k (ICR1), the following interrupt handler will run
- * about 244 times per second.
- */
-ISR(TIMER1_OVF_vect)
-{
-  uint16_t interval = (uint16_t) breathing_period * 244 / BREATHING_STEPS;
-  // resetting after one period to prevent ugly reset at overflow.
-  breathing_counter = (breathing_counter + 1) % (breathing_period * 244);
-  uint8_t index = breathing_counter / interval % BREATHING_STEPS;
-
-  if (((breathing_halt == BREATHING_HALT_ON) && (index == BREATHING_STEPS / 2)) ||
-      ((breathing_halt == BREATHING_HALT_OFF) && (index == BREATHING_STEPS - 1)))
-  {
-      breathing_interrupt_disable();
-  }
-
-  set_pwm(cie_lightness(scale_backlight((uint16_t) pgm_read_byte(&breathing_table[index]) * 0x0101U)));
+  breathing_period_set(backlight_pwm_get_breathing_period() - 1);
 }
 
 #endif // BACKLIGHT_BREATHING
 
+#endif  // BACKLIGHT_CUSTOM_DRIVER
+
 __attribute__ ((weak))
 void backlight_init_ports(void)
 {
   // Setup backlight pin as output and output to on state.
   // DDRx |= n
   _SFR_IO8((backlight_pin >> 4) + 1) |= _BV(backlight_pin & 0xF);
-  #if BACKLIGHT_ON_STATE == 0
-    // PORTx &= ~n
-    _SFR_IO8((backlight_pin >> 4) + 2) &= ~_BV(backlight_pin & 0xF);
-  #else
-    // PORTx |= n
-    _SFR_IO8((backlight_pin >> 4) + 2) |= _BV(backlight_pin & 0xF);
-  #endif
+  backlight_pin_on();
+
+// Without a timer backlight_task() does the work
+#if !defined(BACKLIGHT_CUSTOM_DRIVER) && !defined(NO_BACKLIGHT_TIMER)
   // I could write a wall of text here to explain... but TL;DW
   // Go read the ATmega32u4 datasheet.
   // And this: http://blog.saikoled.com/post/43165849837/secret-konami-cheat-code-to-high-resolution-pwm-on
@@ -1119,19 +1107,28 @@ void backlight_init_ports(void)
   "In fast PWM mode the counter is incremented until the counter value matches either one of the fixed values 0x00FF, 0x01FF, or 0x03FF (WGMn3:0 = 5, 6, or 7), the value in ICRn (WGMn3:0 = 14), or the value in OCRnA (WGMn3:0 = 15)."
   */
 
-  TCCR1A = _BV(COM1x1) | _BV(WGM11); // = 0b00001010;
+  #ifdef NO_HARDWARE_PWM
+    // Other pins are switched from the overflow and compare B interrupts,
+    // so the pin stays disconnected from the timer
+    TCCR1A = _BV(WGM11);
+    OCR1B = 0;
+    TIMSK1 |= _BV(TOIE1) | _BV(OCIE1B);
+  #else
+    TCCR1A = _BV(COM1x1) | _BV(WGM11); // = 0b00001010;
+    OCR1x = 0;
+    TIMSK1 |= _BV(TOIE1);
+  #endif
   TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS10); // = 0b00011001;
   // Use full 16-bit resolution. Counter counts to ICR1 before reset to 0.
-  ICR1 = TIMER_TOP;
+  ICR1 = BACKLIGHT_PWM_TOP;
 
   backlight_init();
   #ifdef BACKLIGHT_BREATHING
     breathing_enable();
   #endif
+#endif  // BACKLIGHT_CUSTOM_DRIVER, NO_BACKLIGHT_TIMER
 }
 
-#endif // NO_HARDWARE_PWM
-
 #else // backlight
 
 __attribute__ ((weak))
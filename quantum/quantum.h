@@ -112,6 +112,18 @@ extern uint32_t default_layer_state;
 	#include "process_terminal_nop.h"
 #endif
 
+#ifdef DYNAMIC_KEYMAP_ENABLE
+	#include "dynamic_keymap.h"
+#endif
+
+#ifdef RAW_API_ENABLE
+	#include "raw_api.h"
+#endif
+
+#ifdef KEY_TRACE_ENABLE
+	#include "key_trace.h"
+#endif
+
 #define STRINGIZE(z) #z
 #define ADD_SLASH_X(y) STRINGIZE(\x ## y)
 #define SYMBOL_STR(x) ADD_SLASH_X(x)
@@ -77,6 +77,7 @@ enum quantum_keycodes {
     QK_STENO              = 0x5A00,
     QK_STENO_BOLT         = 0x5A30,
     QK_STENO_GEMINI       = 0x5A31,
+    QK_STENO_DICT         = 0x5A32,
     QK_STENO_MAX          = 0x5A3F,
 #endif
 #ifdef SWAP_HANDS_ENABLE
@@ -0,0 +1,325 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include "quantum.h"
+#include "raw_api.h"
+#include "raw_hid.h"
+
+static uint16_t telemetry_interval = 0;
+static uint8_t telemetry_streams;
+static uint16_t telemetry_timer;
+static uint8_t telemetry_sequence = 0;
+
+static uint16_t scan_count = 0;
+static uint16_t scan_rate = 0;
+static uint16_t scan_rate_timer;
+
+static uint32_t read_be(const uint8_t *bytes, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static void write_be(uint8_t *bytes, uint8_t size, uint32_t value) {
+    while (size--) {
+        bytes[size] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+// Bytes a field takes, 0 for fields this keyboard doesn't have
+static uint8_t field_size(uint8_t field) {
+    switch (field) {
+        case RAW_API_DEFAULT_LAYER:
+        case RAW_API_LAYER_STATE:
+        case RAW_API_UPTIME:
+            return 4;
+        case RAW_API_KEYMAP_CONFIG:
+        case RAW_API_DEBUG_CONFIG:
+            return 1;
+        case RAW_API_SCAN_RATE:
+            return 2;
+#ifdef BACKLIGHT_ENABLE
+        case RAW_API_BACKLIGHT:
+            return 1;
+#endif
+#ifdef RGBLIGHT_ENABLE
+        case RAW_API_RGBLIGHT:
+            return 4;
+#endif
+        default:
+            return 0;
+    }
+}
+
+static uint32_t read_field(uint8_t field) {
+    switch (field) {
+        case RAW_API_DEFAULT_LAYER:
+            return default_layer_state;
+        case RAW_API_LAYER_STATE:
+            return layer_state;
+        case RAW_API_KEYMAP_CONFIG:
+            return keymap_config.raw & 0xFF;
+        case RAW_API_DEBUG_CONFIG:
+            return debug_config.raw;
+        case RAW_API_UPTIME:
+            return timer_read32();
+        case RAW_API_SCAN_RATE:
+            return scan_rate;
+#ifdef BACKLIGHT_ENABLE
+        case RAW_API_BACKLIGHT:
+            return get_backlight_level();
+#endif
+#ifdef RGBLIGHT_ENABLE
+        case RAW_API_RGBLIGHT:
+            return rgblight_config.raw;
+#endif
+        default:
+            return 0;
+    }
+}
+
+static bool writable(uint8_t field) {
+    return field != RAW_API_UPTIME && field != RAW_API_SCAN_RATE;
+}
+
+static void write_field(uint8_t field, uint32_t value) {
+    switch (field) {
+        case RAW_API_DEFAULT_LAYER:
+            eeconfig_update_default_layer(value);
+            default_layer_set(value);
+            break;
+        case RAW_API_LAYER_STATE:
+            layer_state_set(value);
+            break;
+        case RAW_API_KEYMAP_CONFIG:
+            keymap_config.raw = value;
+            eeconfig_update_keymap(value);
+            clear_keyboard();
+            break;
+        case RAW_API_DEBUG_CONFIG:
+            debug_config.raw = value;
+            eeconfig_update_debug(value);
+            break;
+#ifdef BACKLIGHT_ENABLE
+        case RAW_API_BACKLIGHT:
+            backlight_level(value);
+            break;
+#endif
+#ifdef RGBLIGHT_ENABLE
+        case RAW_API_RGBLIGHT:
+            rgblight_update_dword(value);
+            break;
+#endif
+    }
+}
+
+/*
+ * GET: count, then count field ids. The reply has count, then each id
+ * followed by its value.
+ */
+static uint8_t get_fields(uint8_t *data, uint8_t length) {
+    uint8_t count = data[1];
+    uint8_t request[RAW_API_PACKET_SIZE];
+    uint8_t reply = 2;
+
+    if (count > length - 2) {
+        return RAW_API_ERROR_TOO_LONG;
+    }
+    // the endpoint may be larger than a packet of this API
+    if (count > sizeof(request)) {
+        count = sizeof(request);
+        data[1] = count;
+    }
+    memcpy(request, &data[2], count);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t size = field_size(request[i]);
+        if (size == 0) {
+            data[3] = request[i];
+            return RAW_API_ERROR_UNKNOWN_FIELD;
+        }
+        if (reply + 1 + size > length) {
+            return RAW_API_ERROR_TOO_LONG;
+        }
+        data[reply] = request[i];
+        write_be(&data[reply + 1], size, read_field(request[i]));
+        reply += 1 + size;
+    }
+    return 0;
+}
+
+/*
+ * SET: count, then each id followed by its value. Nothing is changed unless
+ * every field can be, the reply is the request.
+ */
+static uint8_t set_fields(uint8_t *data, uint8_t length) {
+    uint8_t count = data[1];
+    uint8_t i, offset = 2;
+
+    for (i = 0; i < count; i++) {
+        if (offset >= length) {
+            return RAW_API_ERROR_TOO_LONG;
+        }
+        uint8_t field = data[offset];
+        uint8_t size = field_size(field);
+        if (size == 0 || !writable(field)) {
+            data[3] = field;
+            return size ? RAW_API_ERROR_READ_ONLY : RAW_API_ERROR_UNKNOWN_FIELD;
+        }
+        if (offset + 1 + size > length) {
+            return RAW_API_ERROR_TOO_LONG;
+        }
+        offset += 1 + size;
+    }
+    for (i = 0, offset = 2; i < count; i++) {
+        uint8_t size = field_size(data[offset]);
+        write_field(data[offset], read_be(&data[offset + 1], size));
+        offset += 1 + size;
+    }
+    return 0;
+}
+
+bool raw_api_process_command(uint8_t *data, uint8_t length) {
+    uint8_t error = 0;
+
+    if (length < 6) {
+        return false;
+    }
+
+    switch (data[0]) {
+        case RAW_API_GET_INFO:
+            data[1] = RAW_API_VERSION;
+            data[2] = length;
+            data[3] = MATRIX_ROWS;
+            data[4] = MATRIX_COLS;
+            data[5] = sizeof(matrix_row_t);
+            break;
+        case RAW_API_GET:
+            error = get_fields(data, length);
+            break;
+        case RAW_API_SET:
+            error = set_fields(data, length);
+            break;
+        case RAW_API_TELEMETRY:
+            telemetry_interval = (data[1] << 8) | data[2];
+            telemetry_streams = data[3];
+            telemetry_timer = timer_read();
+            break;
+        default:
+            return false;
+    }
+
+    if (error) {
+        data[1] = data[0];
+        data[0] = RAW_API_ERROR;
+        data[2] = error;
+    }
+    return true;
+}
+
+static void send_report(void) {
+    uint8_t report[RAW_API_PACKET_SIZE] = { RAW_API_REPORT, telemetry_sequence++ };
+    uint8_t streams = telemetry_streams & ~RAW_API_STREAM_TRACE;
+    uint8_t offset = 3;
+    uint16_t size = offset + MATRIX_ROWS * sizeof(matrix_row_t);
+
+    if (streams & RAW_API_STREAM_LAYERS) {
+        size += 8;
+    }
+    if (streams & RAW_API_STREAM_SCAN_RATE) {
+        size += 2;
+    }
+    // a matrix that doesn't fit is left out, the streams byte tells the host
+    if (size > RAW_API_PACKET_SIZE) {
+        streams &= ~RAW_API_STREAM_MATRIX;
+    }
+    if (streams & RAW_API_STREAM_MATRIX) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            write_be(&report[offset], sizeof(matrix_row_t), matrix_get_row(row));
+            offset += sizeof(matrix_row_t);
+        }
+    }
+    if (streams & RAW_API_STREAM_LAYERS) {
+        write_be(&report[offset], 4, layer_state);
+        write_be(&report[offset + 4], 4, default_layer_state);
+        offset += 8;
+    }
+    if (streams & RAW_API_STREAM_SCAN_RATE) {
+        write_be(&report[offset], 2, scan_rate);
+    }
+    report[2] = streams;
+    raw_hid_send(report, RAW_API_PACKET_SIZE);
+}
+
+#ifdef KEY_TRACE_ENABLE
+/*
+ * TRACE: how many events, then that many KEY_TRACE_EVENT_SIZE events. Sent
+ * once per scan while there are events, whatever the telemetry interval.
+ */
+static void send_trace(void) {
+    uint8_t packet[RAW_API_PACKET_SIZE] = { RAW_API_TRACE, 0 };
+    key_trace_event_t event;
+
+    while (2 + (packet[1] + 1) * KEY_TRACE_EVENT_SIZE <= RAW_API_PACKET_SIZE && key_trace_read(&event)) {
+        key_trace_serialize(&event, &packet[2 + packet[1] * KEY_TRACE_EVENT_SIZE]);
+        packet[1]++;
+    }
+    raw_hid_send(packet, RAW_API_PACKET_SIZE);
+}
+#endif
+
+void raw_api_task(void) {
+    scan_count++;
+    if (timer_elapsed(scan_rate_timer) >= 1000) {
+        scan_rate = scan_count;
+        scan_count = 0;
+        scan_rate_timer = timer_read();
+    }
+
+    if (telemetry_interval && timer_elapsed(telemetry_timer) >= telemetry_interval) {
+        telemetry_timer = timer_read();
+        send_report();
+    }
+
+#ifdef KEY_TRACE_ENABLE
+    if ((telemetry_streams & RAW_API_STREAM_TRACE) && key_trace_pending()) {
+        send_trace();
+    }
+#endif
+}
+
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+    if (raw_api_process_command(data, length)) {
+        raw_hid_send(data, length);
+        return;
+    }
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    if (dynamic_keymap_process_command(data, length)) {
+        raw_hid_send(data, length);
+        return;
+    }
+#endif
+    raw_hid_receive_kb(data, length);
+}
+
+__attribute__ ((weak))
+void raw_hid_receive_kb(uint8_t *data, uint8_t length) {
+    data[1] = data[0];
+    data[0] = RAW_API_ERROR;
+    data[2] = 0;
+    raw_hid_send(data, length);
+}
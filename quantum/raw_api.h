@@ -0,0 +1,80 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RAW_API_H
+#define RAW_API_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Size of the packets in both directions, the raw HID endpoint size */
+#ifndef RAW_API_PACKET_SIZE
+#define RAW_API_PACKET_SIZE 32
+#endif
+
+/* Bumped whenever a command or field changes meaning */
+#define RAW_API_VERSION 1
+
+/*
+ * Commands, the first byte of a packet. The reply starts with the same byte,
+ * or RAW_API_ERROR followed by the command and a raw_api_error code. Values
+ * are big endian. See docs/feature_raw_api.md for the payloads.
+ */
+enum raw_api_command {
+    RAW_API_GET_INFO  = 0x10,
+    RAW_API_GET       = 0x11,
+    RAW_API_SET       = 0x12,
+    RAW_API_TELEMETRY = 0x13,
+    // sent by the keyboard while telemetry is on
+    RAW_API_REPORT    = 0x14,
+    // sent by the keyboard while the trace stream is on and there are events
+    RAW_API_TRACE     = 0x15,
+    RAW_API_ERROR     = 0xFF
+};
+
+enum raw_api_error {
+    RAW_API_ERROR_UNKNOWN_FIELD = 0x01,
+    RAW_API_ERROR_READ_ONLY     = 0x02,
+    RAW_API_ERROR_TOO_LONG      = 0x03
+};
+
+enum raw_api_field {
+    RAW_API_DEFAULT_LAYER = 0x01,   // 4 bytes, default_layer_state, set also saves the lowest layer
+    RAW_API_LAYER_STATE   = 0x02,   // 4 bytes
+    RAW_API_KEYMAP_CONFIG = 0x03,   // 1 byte, saved
+    RAW_API_DEBUG_CONFIG  = 0x04,   // 1 byte, saved
+    RAW_API_BACKLIGHT     = 0x05,   // 1 byte, backlight level
+    RAW_API_RGBLIGHT      = 0x06,   // 4 bytes, rgblight_config
+    RAW_API_UPTIME        = 0x07,   // 4 bytes, ms, read only
+    RAW_API_SCAN_RATE     = 0x08    // 2 bytes, scans in the last second, read only
+};
+
+/* What a telemetry report carries, in this order */
+enum raw_api_stream {
+    RAW_API_STREAM_MATRIX    = 1 << 0,  // MATRIX_ROWS rows of sizeof(matrix_row_t) bytes
+    RAW_API_STREAM_LAYERS    = 1 << 1,  // layer_state, default_layer_state
+    RAW_API_STREAM_SCAN_RATE = 1 << 2,  // scans in the last second
+    // key events from key_trace.c, in their own RAW_API_TRACE packets
+    RAW_API_STREAM_TRACE     = 1 << 3
+};
+
+/* Handles a command in place, data holds the reply afterwards. Returns false
+ * if the command isn't one of the above. */
+bool raw_api_process_command(uint8_t *data, uint8_t length);
+
+/* Counts scans and sends telemetry, called from matrix_scan_quantum() */
+void raw_api_task(void);
+
+#endif
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/physical.h"
 #include <stdbool.h>
+#include <string.h>
 
 // This implements the "Consistent overhead byte stuffing protocol"
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
@@ -102,41 +103,66 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 }
 
-static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
-    send_data(link, &num_non_zero, 1);
-    if (end > start) {
-        send_data(link, start, end-start);
+// The encoded frame is collected here and handed to the physical layer in as
+// few send_data calls as possible, since every call locks the output queue.
+typedef struct send_buffer {
+    uint8_t link;
+    uint16_t pos;
+    uint8_t data[SERIAL_LINK_SEND_BUFFER_SIZE];
+} send_buffer_t;
+
+static void flush_send_buffer(send_buffer_t* buffer) {
+    if (buffer->pos > 0) {
+        send_data(buffer->link, buffer->data, buffer->pos);
+        buffer->pos = 0;
+    }
+}
+
+static void write_send_buffer(send_buffer_t* buffer, const uint8_t* data, uint16_t size) {
+    while (size > 0) {
+        if (buffer->pos == SERIAL_LINK_SEND_BUFFER_SIZE) {
+            flush_send_buffer(buffer);
+        }
+        uint16_t count = SERIAL_LINK_SEND_BUFFER_SIZE - buffer->pos;
+        if (count > size) {
+            count = size;
+        }
+        memcpy(buffer->data + buffer->pos, data, count);
+        buffer->pos += count;
+        data += count;
+        size -= count;
     }
 }
 
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    const uint8_t zero = 0;
-    if (size > 0) {
-        uint16_t num_non_zero = 1;
-        uint8_t* end = data + size;
+    if (size == 0) {
+        return;
+    }
+    send_buffer_t buffer;
+    buffer.link = link;
+    buffer.pos = 0;
+
+    uint8_t* end = data + size;
+    while (true) {
+        // A block is up to 254 non-zero bytes, followed by a zero unless it's
+        // a full block or the end of the frame
         uint8_t* start = data;
-        while (data < end) {
-            if (num_non_zero == 0xFF) {
-                // There's more data after big non-zero block
-                // So send it, and start a new block
-                send_block(link, start, data, num_non_zero);
-                start = data;
-                num_non_zero = 1;
-            }
-            else {
-                if (*data == 0) {
-                    // A zero encountered, so send the block
-                    send_block(link, start, data, num_non_zero);
-                    start = data + 1;
-                    num_non_zero = 1;
-                }
-                else {
-                    num_non_zero++;
-                }
-                ++data;
-            }
+        uint8_t* limit = end - data > 254 ? data + 254 : end;
+        while (data < limit && *data != 0) {
+            ++data;
+        }
+        uint8_t num_non_zero = data - start + 1;
+        write_send_buffer(&buffer, &num_non_zero, 1);
+        write_send_buffer(&buffer, start, data - start);
+        if (data == end) {
+            break;
+        }
+        if (num_non_zero != 0xFF) {
+            // Skip the zero, it's encoded by the block header
+            ++data;
         }
-        send_block(link, start, data, num_non_zero);
-        send_data(link, &zero, 1);
     }
+    const uint8_t zero = 0;
+    write_send_buffer(&buffer, &zero, 1);
+    flush_send_buffer(&buffer);
 }
@@ -30,6 +30,12 @@ SOFTWARE.
 #define MAX_FRAME_SIZE 1024
 #define NUM_LINKS 2
 
+// Encoded bytes are sent in chunks of this size, frames that fit go out with a
+// single send_data call
+#ifndef SERIAL_LINK_SEND_BUFFER_SIZE
+#define SERIAL_LINK_SEND_BUFFER_SIZE 64
+#endif
+
 void init_byte_stuffer(void);
 void byte_stuffer_recv_byte(uint8_t link, uint8_t data);
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size);
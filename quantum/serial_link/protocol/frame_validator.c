@@ -27,7 +27,7 @@ SOFTWARE.
 #include "serial_link/protocol/byte_stuffer.h"
 #include <string.h>
 
-const uint32_t poly8_lookup[256] =
+static const uint32_t poly8_lookup[256] =
 {
  0, 0x77073096, 0xEE0E612C, 0x990951BA,
  0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
@@ -95,19 +95,23 @@ const uint32_t poly8_lookup[256] =
  0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
 };
 
-static uint32_t crc32_byte(uint8_t *p, uint32_t bytelength)
-{
+// Standard (zlib) CRC32. It's weak so that a board with a hardware CRC unit,
+// like the one on the Kinetis and STM32 chips, can replace it.
+__attribute__ ((weak))
+uint32_t serial_link_crc32(const uint8_t* data, uint16_t size) {
     uint32_t crc = 0xffffffff;
-    while (bytelength-- !=0) crc = poly8_lookup[((uint8_t) crc ^ *(p++))] ^ (crc >> 8);
-    // return (~crc); also works
-    return (crc ^ 0xffffffff);
+    const uint8_t* end = data + size;
+    while (data < end) {
+        crc = poly8_lookup[(uint8_t)crc ^ *data++] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
 }
 
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size) {
     if (size > 4) {
         uint32_t frame_crc;
         memcpy(&frame_crc, data + size -4, 4);
-        uint32_t expected_crc = crc32_byte(data, size - 4);
+        uint32_t expected_crc = serial_link_crc32(data, size - 4);
         if (frame_crc == expected_crc) {
             route_incoming_frame(link, data, size-4);
         }
@@ -115,7 +119,7 @@ void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size) {
 }
 
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
-    uint32_t crc = crc32_byte(data, size);
+    uint32_t crc = serial_link_crc32(data, size);
     memcpy(data + size, &crc, 4);
     byte_stuffer_send_frame(link, data, size + 4);
 }
@@ -30,5 +30,6 @@ SOFTWARE.
 void validator_recv_frame(uint8_t link, uint8_t* data, uint16_t size);
 // The buffer pointed to by the data needs 4 additional bytes
 void validator_send_frame(uint8_t link, uint8_t* data, uint16_t size);
+uint32_t serial_link_crc32(const uint8_t* data, uint16_t size);
 
 #endif
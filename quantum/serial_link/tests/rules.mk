@@ -20,3 +20,9 @@ serial_link_transport_SRC := \
 	$(SERIAL_PATH)/tests/transport_tests.cpp \
 	$(SERIAL_PATH)/protocol/transport.c \
 	$(SERIAL_PATH)/protocol/triple_buffered_object.c 
+
+serial_link_throughput_SRC := \
+	$(SERIAL_PATH)/tests/throughput_tests.cpp \
+	$(SERIAL_PATH)/protocol/byte_stuffer.c \
+	$(SERIAL_PATH)/protocol/frame_validator.c \
+	$(SERIAL_PATH)/protocol/frame_router.c
@@ -0,0 +1,130 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Fred Sundvik
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <vector>
+#include <chrono>
+#include <cstdio>
+extern "C" {
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/frame_router.h"
+}
+
+// Sends frames from a slave to the master through the whole router ->
+// validator -> byte stuffer pipeline and back, and reports how many frames per
+// second the host manages. The absolute numbers only matter relative to
+// earlier runs, but the send_data call counts are what the serial driver sees.
+
+class Throughput : public testing::Test {
+public:
+    Throughput() {
+        Instance = this;
+        init_byte_stuffer();
+    }
+
+    ~Throughput() {
+        Instance = nullptr;
+    }
+
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        EXPECT_EQ(link, UP_LINK);
+        num_send_calls++;
+        sent.insert(sent.end(), data, data + size);
+    }
+
+    void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+        EXPECT_EQ(from, 1);
+        received_frames++;
+        received_bytes += size;
+    }
+
+    // Returns the time in ns for one frame of the given size
+    double run(uint16_t object_size, int iterations) {
+        // router_send_frame needs room for the destination and the crc
+        std::vector<uint8_t> frame(object_size + 5);
+        for (uint16_t i = 0; i < object_size; i++) {
+            frame[i] = i % 7 == 0 ? 0 : i;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            sent.clear();
+            router_set_master(false);
+            router_send_frame(0, frame.data(), object_size);
+            router_set_master(true);
+            for (uint8_t byte : sent) {
+                byte_stuffer_recv_byte(DOWN_LINK, byte);
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+
+    std::vector<uint8_t> sent;
+    int num_send_calls = 0;
+    int received_frames = 0;
+    int received_bytes = 0;
+
+    static Throughput* Instance;
+};
+
+Throughput* Throughput::Instance = nullptr;
+
+extern "C" {
+    void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+        Throughput::Instance->send_data(link, data, size);
+    }
+
+    void transport_recv_frame(uint8_t from, uint8_t* data, uint16_t size) {
+        Throughput::Instance->transport_recv_frame(from, data, size);
+    }
+}
+
+TEST_F(Throughput, matrix_sized_frames) {
+    const int iterations = 100000;
+    double ns = run(16, iterations);
+    printf("16 byte objects: %.0f ns/frame, %.0f frames/s\n", ns, 1e9 / ns);
+    EXPECT_EQ(received_frames, iterations);
+    EXPECT_EQ(received_bytes, iterations * 16);
+    // The whole encoded frame is written to the serial driver at once
+    EXPECT_EQ(num_send_calls, iterations);
+}
+
+TEST_F(Throughput, large_frames) {
+    const int iterations = 10000;
+    double ns = run(600, iterations);
+    printf("600 byte objects: %.0f ns/frame, %.0f frames/s\n", ns, 1e9 / ns);
+    EXPECT_EQ(received_frames, iterations);
+    EXPECT_EQ(received_bytes, iterations * 600);
+    // stuffing overhead is one byte per block, plus the delimiter
+    int encoded = 600 + 1 + 4 + 1 + 1 + 600 / 7;
+    int chunks = (encoded + SERIAL_LINK_SEND_BUFFER_SIZE - 1) / SERIAL_LINK_SEND_BUFFER_SIZE;
+    EXPECT_LE(num_send_calls, iterations * chunks);
+}
+
+TEST_F(Throughput, crc32_matches_the_standard_check_value) {
+    const uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(serial_link_crc32(data, sizeof(data)), 0xCBF43926u);
+}
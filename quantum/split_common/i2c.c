@@ -4,6 +4,7 @@
 #include <avr/interrupt.h>
 #include <util/twi.h>
 #include <stdbool.h>
+#include "config.h"
 #include "i2c.h"
 
 #ifdef USE_I2C
@@ -19,9 +20,11 @@
 #define BUFFER_POS_INC() (slave_buffer_pos = (slave_buffer_pos+1)%SLAVE_BUFFER_SIZE)
 
 volatile uint8_t i2c_slave_buffer[SLAVE_BUFFER_SIZE];
+volatile bool i2c_slave_buffer_written = false;
 
 static volatile uint8_t slave_buffer_pos;
 static volatile bool slave_has_register_set = false;
+static volatile bool slave_has_data = false;
 
 // Wait for an i2c operation to finish
 inline static
@@ -121,6 +124,7 @@ ISR(TWI_vect) {
     case TW_SR_SLA_ACK:
       // this device has been addressed as a slave receiver
       slave_has_register_set = false;
+      slave_has_data = false;
       break;
 
     case TW_SR_DATA_ACK:
@@ -140,6 +144,16 @@ ISR(TWI_vect) {
       } else {
         i2c_slave_buffer[slave_buffer_pos] = TWDR;
         BUFFER_POS_INC();
+        slave_has_data = true;
+      }
+      break;
+
+    case TW_SR_STOP:
+      // only let the main loop look at the buffer once the master has
+      // finished writing, so it never sees half an update
+      if (slave_has_data) {
+        i2c_slave_buffer_written = true;
+        slave_has_data = false;
       }
       break;
 
@@ -2,6 +2,7 @@
 #define I2C_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifndef F_CPU
 #define F_CPU 16000000UL
@@ -13,12 +14,20 @@
 #define I2C_ACK 1
 #define I2C_NACK 0
 
-#define SLAVE_BUFFER_SIZE 0x10
+// Size of the register file the slave half exposes to the master. It has to
+// hold the synced state (see transport.c) plus one hand's worth of matrix rows.
+#ifndef SLAVE_BUFFER_SIZE
+#define SLAVE_BUFFER_SIZE 0x20
+#endif
 
 // i2c SCL clock frequency
+#ifndef SCL_CLOCK
 #define SCL_CLOCK  400000L
+#endif
 
 extern volatile uint8_t i2c_slave_buffer[SLAVE_BUFFER_SIZE];
+// Set by the slave when the master completed a write to i2c_slave_buffer.
+extern volatile bool i2c_slave_buffer_written;
 
 void i2c_master_init(void);
 uint8_t i2c_master_start(uint8_t address);
@@ -30,12 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "pro_micro.h"
 #include "config.h"
 #include "timer.h"
-
-#ifdef USE_I2C
-#  include "i2c.h"
-#else // USE_SERIAL
-#  include "serial.h"
-#endif
+#include "transport.h"
 
 #ifndef DEBOUNCING_DELAY
 #   define DEBOUNCING_DELAY 5
@@ -51,19 +46,37 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #    define print_matrix_row(row)  print_bin_reverse8(matrix_get_row(row))
 #    define matrix_bitpop(i)       bitpop(matrix[i])
 #    define ROW_SHIFTER ((uint8_t)1)
+#elif (MATRIX_COLS <= 16)
+#    define print_matrix_header()  print("\nr/c 0123456789ABCDEF\n")
+#    define print_matrix_row(row)  print_bin_reverse16(matrix_get_row(row))
+#    define matrix_bitpop(i)       bitpop16(matrix[i])
+#    define ROW_SHIFTER ((uint16_t)1)
 #else
-#    error "Currently only supports 8 COLS"
+#    error "Currently only supports 16 COLS"
 #endif
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 #define ERROR_DISCONNECT_COUNT 5
 
-#define ROWS_PER_HAND (MATRIX_ROWS/2)
-
 static uint8_t error_count = 0;
 
-static const uint8_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+// Boards whose right half is wired differently can give it its own pins.
+#if defined(MATRIX_ROW_PINS_RIGHT) || defined(MATRIX_COL_PINS_RIGHT)
+#    ifndef MATRIX_ROW_PINS_RIGHT
+#        define MATRIX_ROW_PINS_RIGHT MATRIX_ROW_PINS
+#    endif
+#    ifndef MATRIX_COL_PINS_RIGHT
+#        define MATRIX_COL_PINS_RIGHT MATRIX_COL_PINS
+#    endif
+static const uint8_t row_pins_left[ROWS_PER_HAND] = MATRIX_ROW_PINS;
+static const uint8_t col_pins_left[MATRIX_COLS] = MATRIX_COL_PINS;
+static const uint8_t row_pins_right[ROWS_PER_HAND] = MATRIX_ROW_PINS_RIGHT;
+static const uint8_t col_pins_right[MATRIX_COLS] = MATRIX_COL_PINS_RIGHT;
+static const uint8_t *row_pins = row_pins_left;
+static const uint8_t *col_pins = col_pins_left;
+#else
+static const uint8_t row_pins[ROWS_PER_HAND] = MATRIX_ROW_PINS;
 static const uint8_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+#endif
 
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
@@ -121,9 +134,13 @@ void matrix_init(void)
   MCUCR |= (1<<JTD);
 #endif
 
-    debug_enable = true;
-    debug_matrix = true;
-    debug_mouse = true;
+#if defined(MATRIX_ROW_PINS_RIGHT) || defined(MATRIX_COL_PINS_RIGHT)
+    if (!isLeftHand) {
+        row_pins = row_pins_right;
+        col_pins = col_pins_right;
+    }
+#endif
+
     // initialize row and col
 #if (DIODE_DIRECTION == COL2ROW)
     unselect_rows();
@@ -157,7 +174,6 @@ uint8_t _matrix_scan(void)
             if (matrix_changed) {
                 debouncing = true;
                 debouncing_time = timer_read();
-                PORTD ^= (1 << 2);
             }
 
 #       else
@@ -194,64 +210,11 @@ uint8_t _matrix_scan(void)
     return 1;
 }
 
-#ifdef USE_I2C
-
-// Get rows from other half over i2c
-int i2c_transaction(void) {
-    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
-
-    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
-    if (err) goto i2c_error;
-
-    // start of matrix stored at 0x00
-    err = i2c_master_write(0x00);
-    if (err) goto i2c_error;
-
-    // Start read
-    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
-    if (err) goto i2c_error;
-
-    if (!err) {
-        int i;
-        for (i = 0; i < ROWS_PER_HAND-1; ++i) {
-            matrix[slaveOffset+i] = i2c_master_read(I2C_ACK);
-        }
-        matrix[slaveOffset+i] = i2c_master_read(I2C_NACK);
-        i2c_master_stop();
-    } else {
-i2c_error: // the cable is disconnceted, or something else went wrong
-        i2c_reset_state();
-        return err;
-    }
-
-    return 0;
-}
-
-#else // USE_SERIAL
-
-int serial_transaction(void) {
-    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
-
-    if (serial_update_buffers()) {
-        return 1;
-    }
-
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        matrix[slaveOffset+i] = serial_slave_buffer[i];
-    }
-    return 0;
-}
-#endif
-
 uint8_t matrix_scan(void)
 {
     uint8_t ret = _matrix_scan();
 
-#ifdef USE_I2C
-    if( i2c_transaction() ) {
-#else // USE_SERIAL
-    if( serial_transaction() ) {
-#endif
+    if (!transport_master(matrix)) {
         // turn on the indicator led when halves are disconnected
         TXLED1;
 
@@ -275,23 +238,14 @@ uint8_t matrix_scan(void)
 
 void matrix_slave_scan(void) {
     _matrix_scan();
-
-    int offset = (isLeftHand) ? 0 : ROWS_PER_HAND;
-
-#ifdef USE_I2C
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        i2c_slave_buffer[i] = matrix[offset+i];
-    }
-#else // USE_SERIAL
-    for (int i = 0; i < ROWS_PER_HAND; ++i) {
-        serial_slave_buffer[i] = matrix[offset+i];
-    }
-#endif
+    transport_slave(matrix);
 }
 
 bool matrix_is_modified(void)
 {
+#if (DEBOUNCING_DELAY > 0)
     if (debouncing) return false;
+#endif
     return true;
 }
 
@@ -309,10 +263,10 @@ matrix_row_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    print("\nr/c 0123456789ABCDEF\n");
+    print_matrix_header();
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
         phex(row); print(": ");
-        pbin_reverse16(matrix_get_row(row));
+        print_matrix_row(row);
         print("\n");
     }
 }
@@ -321,7 +275,7 @@ uint8_t matrix_key_count(void)
 {
     uint8_t count = 0;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-        count += bitpop16(matrix[i]);
+        count += matrix_bitpop(i);
     }
     return count;
 }
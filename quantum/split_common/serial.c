@@ -20,6 +20,8 @@
 
 uint8_t volatile serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH] = {0};
 uint8_t volatile serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH] = {0};
+volatile bool serial_master_buffer_dirty = false;
+volatile bool serial_master_buffer_received = false;
 
 #define SLAVE_DATA_CORRUPT (1<<0)
 volatile uint8_t status = 0;
@@ -64,10 +66,10 @@ void serial_master_init(void) {
 void serial_slave_init(void) {
   serial_input();
 
-  // Enable INT0
-  EIMSK |= _BV(INT0);
-  // Trigger on falling edge of INT0
-  EICRA &= ~(_BV(ISC00) | _BV(ISC01));
+  // Enable the external interrupt of the serial pin
+  EIMSK |= SERIAL_PIN_INT_MASK;
+  // Trigger on low level of the serial pin
+  EICRA &= ~SERIAL_PIN_INT_SENSE;
 }
 
 // Used by the master to synchronize timing with the slave.
@@ -139,11 +141,22 @@ ISR(SERIAL_PIN_INTERRUPT) {
   // read the middle of pulses
   _delay_us(SERIAL_DELAY/2);
 
-  uint8_t checksum_computed = 0;
-  for (int i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
-    serial_master_buffer[i] = serial_read_byte();
+  // the master only sends its buffer when it has changed, the length byte
+  // tells us whether a payload follows
+  uint8_t length = serial_read_byte();
+  sync_send();
+  if (length > SERIAL_MASTER_BUFFER_LENGTH) {
+    serial_input();
+    status |= SLAVE_DATA_CORRUPT;
+    return;
+  }
+
+  uint8_t buffer[SERIAL_MASTER_BUFFER_LENGTH];
+  uint8_t checksum_computed = length;
+  for (uint8_t i = 0; i < length; ++i) {
+    buffer[i] = serial_read_byte();
     sync_send();
-    checksum_computed += serial_master_buffer[i];
+    checksum_computed += buffer[i];
   }
   uint8_t checksum_received = serial_read_byte();
   sync_send();
@@ -154,11 +167,17 @@ ISR(SERIAL_PIN_INTERRUPT) {
     status |= SLAVE_DATA_CORRUPT;
   } else {
     status &= ~SLAVE_DATA_CORRUPT;
+    for (uint8_t i = 0; i < length; ++i) {
+      serial_master_buffer[i] = buffer[i];
+    }
+    if (length) {
+      serial_master_buffer_received = true;
+    }
   }
 }
 
 inline
-bool serial_slave_DATA_CORRUPT(void) {
+bool serial_slave_data_corrupt(void) {
   return status & SLAVE_DATA_CORRUPT;
 }
 
@@ -207,9 +226,14 @@ int serial_update_buffers(void) {
     return 1;
   }
 
-  uint8_t checksum = 0;
-  // send data to the slave
-  for (int i = 0; i < SERIAL_MASTER_BUFFER_LENGTH; ++i) {
+  // send data to the slave, but only if something changed since the last
+  // successful transaction
+  uint8_t length = serial_master_buffer_dirty ? SERIAL_MASTER_BUFFER_LENGTH : 0;
+  serial_write_byte(length);
+  sync_recv();
+
+  uint8_t checksum = length;
+  for (uint8_t i = 0; i < length; ++i) {
     serial_write_byte(serial_master_buffer[i]);
     sync_recv();
     checksum += serial_master_buffer[i];
@@ -217,6 +241,8 @@ int serial_update_buffers(void) {
   serial_write_byte(checksum);
   sync_recv();
 
+  serial_master_buffer_dirty = false;
+
   // always, release the line when not in use
   serial_output();
   serial_high();
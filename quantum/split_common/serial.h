@@ -0,0 +1,62 @@
+#ifndef MY_SERIAL_H
+#define MY_SERIAL_H
+
+#include "config.h"
+#include <stdbool.h>
+#include "matrix.h"
+
+// The serial line has to be on one of the external interrupt pins D0-D3.
+// Boards wired differently set SOFT_SERIAL_PIN in their config.h.
+#ifndef SOFT_SERIAL_PIN
+#  define SOFT_SERIAL_PIN D0
+#endif
+
+#define SERIAL_PIN_DDR   _SFR_IO8((SOFT_SERIAL_PIN >> 4) + 1)
+#define SERIAL_PIN_PORT  _SFR_IO8((SOFT_SERIAL_PIN >> 4) + 2)
+#define SERIAL_PIN_INPUT _SFR_IO8(SOFT_SERIAL_PIN >> 4)
+#define SERIAL_PIN_MASK  _BV(SOFT_SERIAL_PIN & 0xF)
+
+#if SOFT_SERIAL_PIN == D0
+#  define SERIAL_PIN_INT_MASK  _BV(INT0)
+#  define SERIAL_PIN_INT_SENSE (_BV(ISC00) | _BV(ISC01))
+#  define SERIAL_PIN_INTERRUPT INT0_vect
+#elif SOFT_SERIAL_PIN == D1
+#  define SERIAL_PIN_INT_MASK  _BV(INT1)
+#  define SERIAL_PIN_INT_SENSE (_BV(ISC10) | _BV(ISC11))
+#  define SERIAL_PIN_INTERRUPT INT1_vect
+#elif SOFT_SERIAL_PIN == D2
+#  define SERIAL_PIN_INT_MASK  _BV(INT2)
+#  define SERIAL_PIN_INT_SENSE (_BV(ISC20) | _BV(ISC21))
+#  define SERIAL_PIN_INTERRUPT INT2_vect
+#elif SOFT_SERIAL_PIN == D3
+#  define SERIAL_PIN_INT_MASK  _BV(INT3)
+#  define SERIAL_PIN_INT_SENSE (_BV(ISC30) | _BV(ISC31))
+#  define SERIAL_PIN_INTERRUPT INT3_vect
+#else
+#  error "SOFT_SERIAL_PIN must be one of D0, D1, D2 or D3"
+#endif
+
+// slave -> master: one hand's worth of matrix rows
+#define SERIAL_SLAVE_BUFFER_LENGTH ((MATRIX_ROWS/2) * sizeof(matrix_row_t))
+// master -> slave: synced state, see transport.c for the layout
+#ifndef SERIAL_MASTER_BUFFER_LENGTH
+#  define SERIAL_MASTER_BUFFER_LENGTH 9
+#endif
+
+// Buffers for master - slave communication
+extern volatile uint8_t serial_slave_buffer[SERIAL_SLAVE_BUFFER_LENGTH];
+extern volatile uint8_t serial_master_buffer[SERIAL_MASTER_BUFFER_LENGTH];
+
+// Set by the master when serial_master_buffer has changed. The next
+// transaction sends the buffer and clears the flag; otherwise only an empty
+// length byte goes over the wire.
+extern volatile bool serial_master_buffer_dirty;
+// Set on the slave when a transaction delivered a new serial_master_buffer.
+extern volatile bool serial_master_buffer_received;
+
+void serial_master_init(void);
+void serial_slave_init(void);
+int serial_update_buffers(void);
+bool serial_slave_data_corrupt(void);
+
+#endif
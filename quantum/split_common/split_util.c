@@ -9,14 +9,15 @@
 #include "keyboard.h"
 #include "config.h"
 #include "timer.h"
+#include "transport.h"
+#include "eeconfig.h"
 
-#ifdef USE_I2C
-#  include "i2c.h"
-#else
-#  include "serial.h"
+#ifdef RGBLIGHT_ENABLE
+#  include "rgblight.h"
 #endif
 
 volatile bool isLeftHand = true;
+static bool isMaster = true;
 
 static void setup_handedness(void) {
   #ifdef EE_HANDS
@@ -32,23 +33,19 @@ static void setup_handedness(void) {
 }
 
 static void keyboard_master_setup(void) {
-#ifdef USE_I2C
-    i2c_master_init();
-#ifdef SSD1306OLED
+    transport_master_init();
+#if defined(USE_I2C) && defined(SSD1306OLED)
     matrix_master_OLED_init ();
 #endif
-#else
-    serial_master_init();
-#endif
 }
 
 static void keyboard_slave_setup(void) {
-  timer_init();
-#ifdef USE_I2C
-    i2c_slave_init(SLAVE_I2C_ADDRESS);
-#else
-    serial_slave_init();
-#endif
+    timer_init();
+    transport_slave_init();
+}
+
+bool is_keyboard_master(void) {
+   return isMaster;
 }
 
 bool has_usb(void) {
@@ -59,8 +56,9 @@ bool has_usb(void) {
 
 void split_keyboard_setup(void) {
    setup_handedness();
+   isMaster = has_usb();
 
-   if (has_usb()) {
+   if (isMaster) {
       keyboard_master_setup();
    } else {
       keyboard_slave_setup();
@@ -68,11 +66,21 @@ void split_keyboard_setup(void) {
    sei();
 }
 
+// The slave never reaches keyboard_init()/keyboard_task(), so it runs the
+// parts of them that the state synced from the master relies on.
 void keyboard_slave_loop(void) {
    matrix_init();
+#ifdef RGBLIGHT_ENABLE
+   rgblight_init();
+#endif
 
    while (1) {
       matrix_slave_scan();
+#ifdef RGBLIGHT_ENABLE
+      rgblight_task();
+#endif
+      // write back settings changed by the synced state
+      eeconfig_task();
    }
 }
 
@@ -80,7 +88,7 @@ void keyboard_slave_loop(void) {
 void matrix_setup(void) {
     split_keyboard_setup();
 
-    if (!has_usb()) {
+    if (!isMaster) {
         keyboard_slave_loop();
     }
 }
@@ -4,7 +4,9 @@
 #include <stdbool.h>
 #include "eeconfig.h"
 
-#define SLAVE_I2C_ADDRESS           0x32
+#ifndef SLAVE_I2C_ADDRESS
+#  define SLAVE_I2C_ADDRESS           0x32
+#endif
 
 extern volatile bool isLeftHand;
 
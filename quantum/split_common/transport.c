@@ -0,0 +1,230 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "matrix.h"
+#include "timer.h"
+#include "transport.h"
+#include "split_util.h"
+
+#ifdef BACKLIGHT_ENABLE
+#  include "backlight.h"
+#endif
+#ifdef RGBLIGHT_ENABLE
+#  include "rgblight.h"
+#endif
+#ifndef NO_ACTION_LAYER
+#  include "action_layer.h"
+#endif
+
+#include <avr/interrupt.h>
+#ifdef USE_I2C
+#  include "i2c.h"
+#else // USE_SERIAL
+#  include "serial.h"
+#endif
+
+// State pushed from the master to the slave. This is also the register layout
+// at the start of the i2c slave buffer and the serial master buffer.
+typedef struct {
+    uint8_t backlight_level;
+    uint32_t rgblight_config;
+    uint32_t layer_state;
+} __attribute__((packed)) split_sync_t;
+
+#define SYNC_START   0x00
+#define MATRIX_START (SYNC_START + sizeof(split_sync_t))
+#define MATRIX_BYTES (ROWS_PER_HAND * sizeof(matrix_row_t))
+
+// The slave can't acknowledge the synced state, so the master resends it every
+// now and then even if nothing changed, in case a transfer got corrupted.
+#ifndef SPLIT_SYNC_REFRESH_MS
+#  define SPLIT_SYNC_REFRESH_MS 1000
+#endif
+
+static split_sync_t sync_state;
+static uint16_t sync_timer;
+static bool sync_valid = false;
+
+static void sync_state_read(split_sync_t *state) {
+    memset(state, 0, sizeof(*state));
+#ifdef BACKLIGHT_ENABLE
+    state->backlight_level = get_backlight_level();
+#endif
+#ifdef RGBLIGHT_ENABLE
+    state->rgblight_config = rgblight_read_dword();
+#endif
+#ifndef NO_ACTION_LAYER
+    state->layer_state = layer_state;
+#endif
+}
+
+static void sync_state_apply(const split_sync_t *state) {
+#ifdef BACKLIGHT_ENABLE
+    if (!sync_valid || state->backlight_level != sync_state.backlight_level) {
+        backlight_set(state->backlight_level);
+    }
+#endif
+#ifdef RGBLIGHT_ENABLE
+    if (!sync_valid || state->rgblight_config != sync_state.rgblight_config) {
+        rgblight_update_dword(state->rgblight_config);
+    }
+#endif
+#ifndef NO_ACTION_LAYER
+    // Don't go through layer_state_set(), the slave has no keyboard state to
+    // clear; the layer is only needed for indicators.
+    layer_state = state->layer_state;
+#endif
+    sync_state = *state;
+    sync_valid = true;
+}
+
+// Returns true when the master has state the slave hasn't seen yet.
+static bool sync_state_changed(void) {
+    split_sync_t now;
+    sync_state_read(&now);
+
+    if (sync_valid && memcmp(&now, &sync_state, sizeof(now)) == 0 &&
+        timer_elapsed(sync_timer) < SPLIT_SYNC_REFRESH_MS) {
+        return false;
+    }
+    sync_state = now;
+    sync_timer = timer_read();
+    return true;
+}
+
+#ifdef USE_I2C
+
+_Static_assert(MATRIX_START + MATRIX_BYTES <= SLAVE_BUFFER_SIZE,
+               "SLAVE_BUFFER_SIZE too small for the synced state and the matrix");
+
+void transport_master_init(void) {
+    i2c_master_init();
+}
+
+void transport_slave_init(void) {
+    i2c_slave_init(SLAVE_I2C_ADDRESS);
+}
+
+static int i2c_write_sync_state(void) {
+    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
+    if (err) return err;
+
+    err = i2c_master_write(SYNC_START);
+    const uint8_t *data = (const uint8_t *)&sync_state;
+    for (uint8_t i = 0; i < sizeof(split_sync_t) && !err; ++i) {
+        err = i2c_master_write(data[i]);
+    }
+    i2c_master_stop();
+    return err;
+}
+
+bool transport_master(matrix_row_t matrix[]) {
+    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
+
+    if (sync_state_changed()) {
+        if (i2c_write_sync_state()) {
+            // try again on the next scan
+            sync_valid = false;
+            goto i2c_error;
+        }
+        sync_valid = true;
+    }
+
+    int err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_WRITE);
+    if (err) goto i2c_error;
+
+    err = i2c_master_write(MATRIX_START);
+    if (err) goto i2c_error;
+
+    // Start read
+    err = i2c_master_start(SLAVE_I2C_ADDRESS + I2C_READ);
+    if (err) goto i2c_error;
+
+    uint8_t *rows = (uint8_t *)&matrix[slaveOffset];
+    uint8_t i;
+    for (i = 0; i < MATRIX_BYTES - 1; ++i) {
+        rows[i] = i2c_master_read(I2C_ACK);
+    }
+    rows[i] = i2c_master_read(I2C_NACK);
+    i2c_master_stop();
+
+    return true;
+
+i2c_error: // the cable is disconnceted, or something else went wrong
+    i2c_reset_state();
+    return false;
+}
+
+void transport_slave(matrix_row_t matrix[]) {
+    int offset = (isLeftHand) ? 0 : ROWS_PER_HAND;
+
+    const uint8_t *rows = (const uint8_t *)&matrix[offset];
+    for (uint8_t i = 0; i < MATRIX_BYTES; ++i) {
+        i2c_slave_buffer[MATRIX_START + i] = rows[i];
+    }
+
+    if (i2c_slave_buffer_written) {
+        split_sync_t state;
+        uint8_t *data = (uint8_t *)&state;
+        cli();
+        for (uint8_t i = 0; i < sizeof(split_sync_t); ++i) {
+            data[i] = i2c_slave_buffer[SYNC_START + i];
+        }
+        i2c_slave_buffer_written = false;
+        sei();
+        if (!sync_valid || memcmp(&state, &sync_state, sizeof(state)) != 0) {
+            sync_state_apply(&state);
+        }
+    }
+}
+
+#else // USE_SERIAL
+
+_Static_assert(sizeof(split_sync_t) <= SERIAL_MASTER_BUFFER_LENGTH,
+               "SERIAL_MASTER_BUFFER_LENGTH too small for the synced state");
+
+void transport_master_init(void) {
+    serial_master_init();
+}
+
+void transport_slave_init(void) {
+    serial_slave_init();
+}
+
+bool transport_master(matrix_row_t matrix[]) {
+    int slaveOffset = (isLeftHand) ? (ROWS_PER_HAND) : 0;
+
+    if (!serial_master_buffer_dirty && sync_state_changed()) {
+        memcpy((uint8_t *)serial_master_buffer, &sync_state, sizeof(split_sync_t));
+        serial_master_buffer_dirty = true;
+        sync_valid = true;
+    }
+
+    if (serial_update_buffers()) {
+        return false;
+    }
+
+    memcpy(&matrix[slaveOffset], (const uint8_t *)serial_slave_buffer, MATRIX_BYTES);
+    return true;
+}
+
+void transport_slave(matrix_row_t matrix[]) {
+    int offset = (isLeftHand) ? 0 : ROWS_PER_HAND;
+
+    // the buffer is read from the serial ISR, don't let it see a torn row
+    cli();
+    memcpy((uint8_t *)serial_slave_buffer, &matrix[offset], MATRIX_BYTES);
+    sei();
+
+    if (serial_master_buffer_received) {
+        split_sync_t state;
+        cli();
+        memcpy(&state, (const uint8_t *)serial_master_buffer, sizeof(split_sync_t));
+        serial_master_buffer_received = false;
+        sei();
+        sync_state_apply(&state);
+    }
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef SPLIT_TRANSPORT_H
+#define SPLIT_TRANSPORT_H
+
+#include <stdbool.h>
+#include "matrix.h"
+
+/*
+ * Link between the two halves of a split keyboard. The matrix code only talks
+ * to this interface, the actual wire protocol (USE_I2C or USE_SERIAL) is
+ * selected at compile time.
+ *
+ * Besides the slave's matrix rows, the master pushes its backlight level,
+ * rgblight config and layer state to the slave. Those are only sent when they
+ * change, so an idle link costs no more than the matrix transfer itself.
+ */
+
+#define ROWS_PER_HAND (MATRIX_ROWS/2)
+
+void transport_master_init(void);
+void transport_slave_init(void);
+
+// Fills in the slave half of matrix. Returns false if the slave did not answer.
+bool transport_master(matrix_row_t matrix[]);
+// Publishes the local half of matrix and applies state synced by the master.
+void transport_slave(matrix_row_t matrix[]);
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        {KC_A, KC_LALT, MO(1)},
+        {MAGIC_SWAP_ALT_GUI, MAGIC_UNSWAP_ALT_GUI, MO(4)},
+    },
+    [1] = {
+        {KC_1, KC_TRNS, KC_TRNS},
+        {KC_2, KC_3, KC_TRNS},
+    },
+    [2] = {
+        {KC_NO, KC_NO, KC_NO},
+        {KC_NO, KC_NO, KC_NO},
+    },
+    [3] = {
+        {KC_NO, KC_NO, KC_NO},
+        {KC_NO, KC_NO, KC_NO},
+    },
+    // Past ACTION_TABLE_LAYERS, resolved on every lookup
+    [4] = {
+        {KC_X, KC_TRNS, KC_TRNS},
+        {KC_TRNS, KC_TRNS, KC_TRNS},
+    },
+};
@@ -0,0 +1,108 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "dynamic_keymap.h"
+#include "keycode_config.h"
+#include "eeconfig.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+
+class ActionTable : public TestFixture {
+public:
+    ActionTable() {
+        eeconfig_init();
+        keymap_config.raw = 0;
+        dynamic_keymap_reset();
+    }
+
+    // Layer and magic keys, which may clear the keyboard report on the way
+    void press_silent(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        press_key(col, row);
+        keyboard_task();
+    }
+
+    void release_silent(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        release_key(col, row);
+        keyboard_task();
+    }
+
+    void tap(uint8_t col, uint8_t row, uint8_t keycode) {
+        TestDriver driver;
+        press_key(col, row);
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(keycode)));
+        keyboard_task();
+        release_key(col, row);
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+        keyboard_task();
+    }
+};
+
+TEST_F(ActionTable, MatchesTheKeycodes) {
+    keypos_t key = {.col = 0, .row = 0};
+    EXPECT_EQ(action_for_key(0, key).code, (uint16_t)ACTION_KEY(KC_A));
+    key.col = 2;
+    EXPECT_EQ(action_for_key(0, key).code, (uint16_t)ACTION_LAYER_MOMENTARY(1));
+    key.col = 1;
+    EXPECT_EQ(action_for_key(1, key).code, (uint16_t)ACTION_TRANSPARENT);
+    EXPECT_EQ(action_for_key(2, key).code, (uint16_t)ACTION_NO);
+}
+
+TEST_F(ActionTable, KeysSendTheirKeycodes) {
+    tap(0, 0, KC_A);
+    tap(1, 0, KC_LALT);
+}
+
+TEST_F(ActionTable, TransparentKeysFallThrough) {
+    press_silent(2, 0);
+    tap(0, 0, KC_1);
+    tap(1, 1, KC_3);
+    tap(1, 0, KC_LALT);
+    release_silent(2, 0);
+    tap(0, 0, KC_A);
+}
+
+TEST_F(ActionTable, LayersPastTheTableStillWork) {
+    press_silent(2, 1);
+    tap(0, 0, KC_X);
+    tap(1, 0, KC_LALT);
+    release_silent(2, 1);
+}
+
+TEST_F(ActionTable, SwappingModsRebuildsTheTable) {
+    tap(1, 0, KC_LALT);
+    press_silent(0, 1);
+    release_silent(0, 1);
+    tap(1, 0, KC_LGUI);
+    press_silent(1, 1);
+    release_silent(1, 1);
+    tap(1, 0, KC_LALT);
+}
+
+TEST_F(ActionTable, DynamicKeymapChangesRebuildTheTable) {
+    tap(0, 0, KC_A);
+    dynamic_keymap_set_keycode(0, 0, 0, KC_Q);
+    tap(0, 0, KC_Q);
+    dynamic_keymap_reset();
+    tap(0, 0, KC_A);
+}
@@ -0,0 +1,227 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+
+// 150 words per minute of 5 characters
+static const uint32_t interval = 80;
+static const uint32_t tap = 110;
+static const uint32_t hold = 250;
+
+static const std::pair<uint8_t, uint8_t> space = {2, 3};
+static const std::pair<uint8_t, uint8_t> lt_space = {5, 3};
+static const std::pair<uint8_t, uint8_t> ctrl = {6, 3};
+static const std::pair<uint8_t, uint8_t> toggle = {7, 3};
+
+// Time, col, row, pressed
+typedef std::tuple<uint32_t, uint8_t, uint8_t, bool> event_t;
+
+class AutoShift : public TestFixture {
+public:
+    AutoShift() {
+        autoshift_timeout = AUTO_SHIFT_TIMEOUT;
+        autoshift_enable();
+    }
+
+    // Presses and releases keys at their times, returns what was typed
+    std::string replay(std::vector<event_t> events) {
+        TestDriver driver;
+        std::vector<uint8_t> down;
+        std::string text;
+        EXPECT_CALL(driver, send_keyboard_mock(_))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke([&](report_keyboard_t &report) {
+                bool shift = report.mods & MOD_BIT(KC_LSFT);
+                for (uint8_t key : report.keys) {
+                    if (key && std::find(down.begin(), down.end(), key) == down.end()) {
+                        text += character(key, shift);
+                    }
+                }
+                down.assign(report.keys, report.keys + KEYBOARD_REPORT_KEYS);
+            }));
+
+        std::stable_sort(events.begin(), events.end(), [](const event_t &a, const event_t &b) {
+            return std::get<0>(a) < std::get<0>(b);
+        });
+        // one matrix change per scan, like the keyboard
+        uint32_t time = 0;
+        for (auto &event : events) {
+            while (time < std::get<0>(event)) {
+                run_one_scan_loop();
+                time++;
+            }
+            if (std::get<3>(event)) {
+                press_key(std::get<1>(event), std::get<2>(event));
+            } else {
+                release_key(std::get<1>(event), std::get<2>(event));
+            }
+            run_one_scan_loop();
+            time++;
+        }
+        idle_for(AUTO_SHIFT_TIMEOUT * 2);
+        return text;
+    }
+
+    // Types text at 150 words per minute, holding capitals and <> to shift them
+    std::string write(const std::string &text, std::pair<uint8_t, uint8_t> space_key = space) {
+        std::vector<event_t> events;
+        uint32_t time = 0;
+        for (char c : text) {
+            auto key = position(c, space_key);
+            bool shifted = (c >= 'A' && c <= 'Z') || c == '<' || c == '>';
+            uint32_t release = time + (shifted ? hold + 50 : tap);
+            events.push_back(event_t(time, key.first, key.second, true));
+            events.push_back(event_t(release, key.first, key.second, false));
+            time += interval;
+        }
+        return replay(events);
+    }
+
+private:
+    std::pair<uint8_t, uint8_t> position(char c, std::pair<uint8_t, uint8_t> space_key) {
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return {(c - 'a') % 8, (c - 'a') / 8};
+        }
+        switch (c) {
+            case ' ':
+                return space_key;
+            case '.':
+            case '>':
+                return {3, 3};
+            default:
+                return {4, 3};
+        }
+    }
+
+    char character(uint8_t key, bool shift) {
+        if (key >= KC_A && key <= KC_Z) {
+            return (shift ? 'A' : 'a') + key - KC_A;
+        }
+        switch (key) {
+            case KC_SPC:
+                return ' ';
+            case KC_DOT:
+                return shift ? '>' : '.';
+            case KC_COMM:
+                return shift ? '<' : ',';
+            case KC_1:
+                return shift ? '!' : '1';
+            default:
+                return '?';
+        }
+    }
+};
+
+TEST_F(AutoShift, TapIsLowercaseAndHoldIsShifted) {
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(100, 0, 0, false)}), "a");
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(200, 0, 0, false)}), "A");
+}
+
+TEST_F(AutoShift, HeldKeyIsTypedAtTheTimeoutWithoutWaitingForTheRelease) {
+    EXPECT_EQ(replay({event_t(0, 0, 0, true)}), "A");
+    EXPECT_EQ(replay({event_t(0, 0, 0, false)}), "");
+}
+
+TEST_F(AutoShift, ReleasingAKeyDoesNotDecideTheNextOne) {
+    // a is let go while b is held, b is still shifted
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(50, 1, 0, true), event_t(80, 0, 0, false),
+                      event_t(300, 1, 0, false)}),
+              "aB");
+}
+
+TEST_F(AutoShift, KeysAreTypedInPressOrder) {
+    // b is decided first but waits for the held a
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(50, 1, 0, true), event_t(120, 1, 0, false),
+                      event_t(260, 0, 0, false)}),
+              "Ab");
+}
+
+TEST_F(AutoShift, RollingText) {
+    EXPECT_EQ(write("the quick brown fox jumps over the lazy dog"), "the quick brown fox jumps over the lazy dog");
+}
+
+TEST_F(AutoShift, RollingTextWithCapitals) {
+    const std::string text = "The Quick brown fox, Jumps over the lazy Dog. Pack my box With five dozen liquor jugs.";
+    EXPECT_EQ(write(text), text);
+}
+
+TEST_F(AutoShift, RollingOverALayerTapSpace) {
+    const std::string text = "Sphinx of black quartz, Judge my vow.";
+    EXPECT_EQ(write(text, lt_space), text);
+}
+
+TEST_F(AutoShift, KeysDelayedByATapKeyKeepTheirTimes) {
+    // a waits behind the layer tap until it is tapped, then it has been held for 230 ms
+    EXPECT_EQ(replay({event_t(0, 5, 3, true), event_t(20, 0, 0, true), event_t(100, 5, 3, false),
+                      event_t(250, 0, 0, false)}),
+              " A");
+}
+
+TEST_F(AutoShift, ClassesHaveTheirOwnTimeout) {
+    EXPECT_EQ(write("a,"), "a,");
+    EXPECT_EQ(replay({event_t(0, 3, 3, true), event_t(200, 3, 3, false)}), ".");
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(200, 0, 0, false)}), "A");
+    EXPECT_EQ(replay({event_t(0, 3, 3, true), event_t(300, 3, 3, false)}), ">");
+}
+
+TEST_F(AutoShift, ClassTimeoutsMoveWithTheAdjustedTimeout) {
+    autoshift_timeout = AUTO_SHIFT_TIMEOUT - 100;
+    EXPECT_EQ(replay({event_t(0, 3, 3, true), event_t(200, 3, 3, false)}), ">");
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(100, 0, 0, false)}), "A");
+}
+
+TEST_F(AutoShift, ClassTimeoutsBelowTheAdjustedTimeoutStopAtZero) {
+    // numbers wait 75 ms less than the base, here that is below zero
+    autoshift_timeout = 50;
+    EXPECT_EQ(replay({event_t(0, lt_space.first, lt_space.second, true), event_t(250, 0, 0, true),
+                      event_t(280, 0, 0, false), event_t(300, lt_space.first, lt_space.second, false)}),
+              "!");
+}
+
+TEST_F(AutoShift, OtherKeysTypeTheKeysBeforeThem) {
+    std::vector<event_t> events = {event_t(0, 0, 0, true), event_t(30, space.first, space.second, true),
+                                   event_t(60, space.first, space.second, false), event_t(90, 0, 0, false)};
+    EXPECT_EQ(replay(events), "a ");
+}
+
+TEST_F(AutoShift, RollingOverMoreKeysThanFitTypesTheOldest) {
+    std::vector<event_t> events;
+    for (uint8_t i = 0; i < AUTO_SHIFT_KEYS + 2; i++) {
+        events.push_back(event_t(i * 10, i, 0, true));
+    }
+    for (uint8_t i = 0; i < AUTO_SHIFT_KEYS + 2; i++) {
+        events.push_back(event_t(100 + i * 10, i, 0, false));
+    }
+    EXPECT_EQ(replay(events), "abcdef");
+}
+
+TEST_F(AutoShift, DisablingTypesWhatIsPending) {
+    EXPECT_EQ(replay({event_t(0, 0, 0, true), event_t(20, toggle.first, toggle.second, true),
+                      event_t(40, toggle.first, toggle.second, false), event_t(60, 1, 0, true),
+                      event_t(300, 1, 0, false), event_t(310, 0, 0, false)}),
+              "ab");
+    EXPECT_FALSE(autoshift_state());
+}
@@ -0,0 +1,119 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "console.h"
+
+void advance_time(uint32_t ms);
+}
+
+// The console IN endpoint, busy while endpoint_busy is set
+static std::vector<std::string> packets;
+static bool endpoint_busy = false;
+
+extern "C" uint8_t console_send_packet(const uint8_t *packet, uint8_t length) {
+    if (endpoint_busy) {
+        return 0;
+    }
+    packets.push_back(std::string((const char *)packet, CONSOLE_PACKET_SIZE));
+    return length;
+}
+
+class Console : public testing::Test {
+public:
+    // sends whatever the last test left
+    Console() {
+        advance_time(CONSOLE_FLUSH_DELAY);
+        endpoint_busy = false;
+        console_flush();
+        packets.clear();
+    }
+
+    void print(const std::string &text) {
+        for (char c : text) {
+            console_putc(c);
+        }
+    }
+
+    // text zero padded to a packet
+    std::string padded(const std::string &text) {
+        return text + std::string(CONSOLE_PACKET_SIZE - text.size(), '\0');
+    }
+};
+
+TEST_F(Console, PrintNeverSendsByItself) {
+    print("hello\n");
+    EXPECT_TRUE(packets.empty());
+    EXPECT_EQ(console_pending(), 6);
+}
+
+TEST_F(Console, FullPacketsGoOutRightAway) {
+    std::string text(CONSOLE_PACKET_SIZE * 2 + 5, 'x');
+    print(text);
+    console_flush();
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_EQ(packets[0], text.substr(0, CONSOLE_PACKET_SIZE));
+    EXPECT_EQ(packets[1], text.substr(CONSOLE_PACKET_SIZE, CONSOLE_PACKET_SIZE));
+    EXPECT_EQ(console_pending(), 5);
+}
+
+TEST_F(Console, PartialPacketWaitsForTheFlushDelay) {
+    print("abc");
+    advance_time(CONSOLE_FLUSH_DELAY - 1);
+    console_flush();
+    EXPECT_TRUE(packets.empty());
+
+    advance_time(1);
+    console_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0], padded("abc"));
+    EXPECT_EQ(console_pending(), 0);
+}
+
+TEST_F(Console, BusyEndpointKeepsTheOutput) {
+    print("waiting");
+    advance_time(CONSOLE_FLUSH_DELAY);
+    endpoint_busy = true;
+    console_flush();
+    console_flush();
+    EXPECT_TRUE(packets.empty());
+
+    endpoint_busy = false;
+    console_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0], padded("waiting"));
+}
+
+TEST_F(Console, FullBufferDropsTheNewestOutput) {
+    uint16_t overflows = console_overflow_count();
+    std::string sent;
+
+    std::string text(CONSOLE_BUFFER_SIZE, 'a');
+    print(text);
+    EXPECT_EQ(console_putc('b'), -1);
+    EXPECT_EQ(console_putc('c'), -1);
+    EXPECT_EQ(console_overflow_count(), overflows + 2);
+
+    advance_time(CONSOLE_FLUSH_DELAY);
+    console_flush();
+    for (auto &packet : packets) {
+        sent += packet;
+    }
+    EXPECT_EQ(sent, text);
+}
@@ -0,0 +1,46 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "console.h"
+
+void advance_time(uint32_t ms);
+}
+
+static std::string sent;
+
+extern "C" uint8_t console_send_packet(const uint8_t *packet, uint8_t length) {
+    sent.append((const char *)packet, length);
+    return length;
+}
+
+TEST(ConsoleDropOldest, FullBufferDropsTheOldestOutput) {
+    std::string text;
+
+    for (int i = 0; i < CONSOLE_BUFFER_SIZE + 10; i++) {
+        text += 'a' + i % 26;
+        EXPECT_EQ(console_putc(text.back()), 0);
+    }
+    EXPECT_EQ(console_overflow_count(), 10);
+    EXPECT_EQ(console_pending(), CONSOLE_BUFFER_SIZE);
+
+    advance_time(CONSOLE_FLUSH_DELAY);
+    console_flush();
+    EXPECT_EQ(sent, text.substr(10));
+}
@@ -0,0 +1,36 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        {KC_A, KC_B, MO(1)},
+        {KC_C, KC_D, MO(3)},
+    },
+    [1] = {
+        {KC_1, KC_TRNS, KC_TRNS},
+        {KC_2, KC_TRNS, KC_TRNS},
+    },
+    [2] = {
+        {KC_F1, KC_F2, KC_F3},
+        {KC_F4, KC_F5, KC_F6},
+    },
+    // Past DYNAMIC_KEYMAP_LAYER_COUNT, always read from here
+    [3] = {
+        {KC_X, KC_Y, KC_TRNS},
+        {KC_Z, KC_NO, KC_TRNS},
+    },
+};
@@ -0,0 +1,230 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <vector>
+
+extern "C" {
+#include "dynamic_keymap.h"
+#include "raw_hid.h"
+#include "eeprom.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+
+#define PACKET_SIZE 32
+
+static std::vector<uint8_t> reply;
+
+extern "C" uint32_t eeprom_test_reads;
+
+extern "C" void raw_hid_send(uint8_t *data, uint8_t length) {
+    reply.assign(data, data + length);
+}
+
+class DynamicKeymap : public TestFixture {
+public:
+    DynamicKeymap() {
+        command({DYNAMIC_KEYMAP_RESET});
+    }
+
+    // Sends a raw HID packet and returns the reply
+    std::vector<uint8_t> command(std::vector<uint8_t> bytes) {
+        uint8_t packet[PACKET_SIZE] = {};
+        std::copy(bytes.begin(), bytes.end(), packet);
+        reply.clear();
+        raw_hid_receive(packet, PACKET_SIZE);
+        return reply;
+    }
+
+    uint16_t get_keycode(uint8_t layer, uint8_t row, uint8_t col) {
+        auto r = command({DYNAMIC_KEYMAP_GET_KEYCODE, layer, row, col});
+        EXPECT_EQ(r[0], DYNAMIC_KEYMAP_GET_KEYCODE);
+        return (r[4] << 8) | r[5];
+    }
+
+    void set_keycode(uint8_t layer, uint8_t row, uint8_t col, uint16_t keycode) {
+        auto r = command({DYNAMIC_KEYMAP_SET_KEYCODE, layer, row, col, (uint8_t)(keycode >> 8), (uint8_t)keycode});
+        EXPECT_EQ(r[0], DYNAMIC_KEYMAP_SET_KEYCODE);
+    }
+
+    // MO() keys, which may clear the keyboard report on the way
+    void press_layer_key(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        press_key(col, row);
+        keyboard_task();
+    }
+
+    void release_layer_key(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        release_key(col, row);
+        keyboard_task();
+    }
+
+    void tap(uint8_t col, uint8_t row, uint8_t keycode) {
+        TestDriver driver;
+        press_key(col, row);
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(keycode)));
+        keyboard_task();
+        release_key(col, row);
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+        keyboard_task();
+    }
+};
+
+TEST_F(DynamicKeymap, InfoDescribesTheLayout) {
+    auto r = command({DYNAMIC_KEYMAP_GET_INFO});
+    ASSERT_EQ(r.size(), PACKET_SIZE);
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_GET_INFO);
+    EXPECT_EQ(r[1], DYNAMIC_KEYMAP_VERSION);
+    EXPECT_EQ(r[2], DYNAMIC_KEYMAP_LAYER_COUNT);
+    EXPECT_EQ(r[3], MATRIX_ROWS);
+    EXPECT_EQ(r[4], MATRIX_COLS);
+}
+
+TEST_F(DynamicKeymap, StartsAsACopyOfTheKeymap) {
+    for (uint8_t layer = 0; layer < DYNAMIC_KEYMAP_LAYER_COUNT; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                EXPECT_EQ(get_keycode(layer, row, col), keymaps[layer][row][col]);
+            }
+        }
+    }
+}
+
+TEST_F(DynamicKeymap, SetKeycodeChangesWhatTheKeySends) {
+    tap(0, 0, KC_A);
+    set_keycode(0, 0, 0, KC_Q);
+    EXPECT_EQ(get_keycode(0, 0, 0), KC_Q);
+    tap(0, 0, KC_Q);
+    // the other keys stay as they were
+    tap(1, 0, KC_B);
+    tap(0, 1, KC_C);
+}
+
+TEST_F(DynamicKeymap, ChangesOnAHeldLayerApplyRightAway) {
+    press_layer_key(2, 0);
+    tap(0, 1, KC_2);
+    set_keycode(1, 1, 0, KC_9);
+    tap(0, 1, KC_9);
+    // and transparent keys still fall through
+    tap(1, 1, KC_D);
+    release_layer_key(2, 0);
+    tap(0, 1, KC_C);
+}
+
+TEST_F(DynamicKeymap, KeysUnderAHeldLayerStayCached) {
+    press_layer_key(2, 0);
+    tap(1, 1, KC_D);
+    tap(0, 1, KC_2);
+    uint32_t reads = eeprom_test_reads;
+    // the transparent key is looked up on layer 1 and then layer 0 each time
+    for (int i = 0; i < 10; i++) {
+        tap(1, 1, KC_D);
+        tap(0, 1, KC_2);
+    }
+    EXPECT_EQ(eeprom_test_reads - reads, 0u);
+    release_layer_key(2, 0);
+}
+
+TEST_F(DynamicKeymap, LayersPastTheCountComeFromTheKeymap) {
+    press_layer_key(2, 1);
+    tap(0, 0, KC_X);
+    tap(0, 1, KC_Z);
+    release_layer_key(2, 1);
+
+    auto r = command({DYNAMIC_KEYMAP_GET_KEYCODE, DYNAMIC_KEYMAP_LAYER_COUNT, 0, 0});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_ERROR);
+    EXPECT_EQ(r[1], DYNAMIC_KEYMAP_GET_KEYCODE);
+}
+
+TEST_F(DynamicKeymap, ResetRestoresTheKeymap) {
+    set_keycode(0, 0, 0, KC_Q);
+    set_keycode(2, 1, 2, KC_F12);
+    auto r = command({DYNAMIC_KEYMAP_RESET});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_RESET);
+    EXPECT_EQ(get_keycode(0, 0, 0), KC_A);
+    EXPECT_EQ(get_keycode(2, 1, 2), KC_F6);
+    tap(0, 0, KC_A);
+}
+
+TEST_F(DynamicKeymap, ChangesSurviveARestart) {
+    set_keycode(0, 1, 1, KC_ESC);
+    dynamic_keymap_init();
+    EXPECT_EQ(get_keycode(0, 1, 1), KC_ESC);
+    tap(1, 1, KC_ESC);
+}
+
+TEST_F(DynamicKeymap, ADifferentLayoutStartsOver) {
+    set_keycode(0, 1, 1, KC_ESC);
+    // as if the firmware had a different number of layers
+    eeprom_update_byte((uint8_t *)DYNAMIC_KEYMAP_EEPROM_ADDR + 3, DYNAMIC_KEYMAP_LAYER_COUNT + 1);
+    dynamic_keymap_init();
+    EXPECT_EQ(get_keycode(0, 1, 1), KC_D);
+}
+
+TEST_F(DynamicKeymap, OutOfRangeKeysAreRejected) {
+    for (auto position : std::vector<std::vector<uint8_t>>{{0, MATRIX_ROWS, 0}, {0, 0, MATRIX_COLS}, {0xFF, 0, 0}}) {
+        auto r = command({DYNAMIC_KEYMAP_SET_KEYCODE, position[0], position[1], position[2], 0, KC_Q});
+        EXPECT_EQ(r[0], DYNAMIC_KEYMAP_ERROR);
+        EXPECT_EQ(r[1], DYNAMIC_KEYMAP_SET_KEYCODE);
+    }
+    EXPECT_EQ(get_keycode(0, 0, 0), KC_A);
+}
+
+TEST_F(DynamicKeymap, BufferReadsAndWritesTheWholeKeymap) {
+    const uint16_t size = DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2;
+    const uint8_t chunk = PACKET_SIZE - 4;
+    std::vector<uint8_t> buffer;
+    for (uint16_t offset = 0; offset < size; offset += chunk) {
+        uint8_t n = std::min<uint16_t>(chunk, size - offset);
+        auto r = command({DYNAMIC_KEYMAP_GET_BUFFER, (uint8_t)(offset >> 8), (uint8_t)offset, n});
+        ASSERT_EQ(r[0], DYNAMIC_KEYMAP_GET_BUFFER);
+        buffer.insert(buffer.end(), r.begin() + 4, r.begin() + 4 + n);
+    }
+    ASSERT_EQ(buffer.size(), size);
+    // big endian, layer by layer, row by row
+    EXPECT_EQ((buffer[0] << 8) | buffer[1], KC_A);
+    EXPECT_EQ((buffer[4] << 8) | buffer[5], MO(1));
+    EXPECT_EQ((buffer[size - 2] << 8) | buffer[size - 1], KC_F6);
+
+    // the second key of layer 2, row 0
+    uint16_t offset = (2 * MATRIX_ROWS * MATRIX_COLS + 1) * 2;
+    auto r = command({DYNAMIC_KEYMAP_SET_BUFFER, 0, (uint8_t)offset, 2, 0, KC_F9});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_SET_BUFFER);
+    EXPECT_EQ(get_keycode(2, 0, 1), KC_F9);
+
+    r = command({DYNAMIC_KEYMAP_GET_BUFFER, (uint8_t)(size >> 8), (uint8_t)(size - 1), 2});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_ERROR);
+    r = command({DYNAMIC_KEYMAP_GET_BUFFER, 0, 0, PACKET_SIZE - 3});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_ERROR);
+}
+
+TEST_F(DynamicKeymap, BufferWritesReachCachedLayers) {
+    tap(0, 0, KC_A);
+    auto r = command({DYNAMIC_KEYMAP_SET_BUFFER, 0, 0, 2, 0, KC_W});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_SET_BUFFER);
+    tap(0, 0, KC_W);
+}
+
+TEST_F(DynamicKeymap, UnknownCommandsGetAnError) {
+    auto r = command({0x42, 1, 2, 3});
+    ASSERT_EQ(r.size(), PACKET_SIZE);
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_ERROR);
+    EXPECT_EQ(r[1], 0x42);
+}
@@ -0,0 +1,110 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "eeconfig.h"
+#include "eeprom.h"
+}
+
+class EEConfig : public TestFixture {
+public:
+    EEConfig() {
+        eeconfig_init();
+        eeconfig_stats(&start);
+    }
+
+    // what is in the EEPROM, not in the RAM copy
+    uint8_t stored_keymap() {
+        return eeprom_read_byte(EECONFIG_KEYMAP);
+    }
+
+    eeconfig_stats_t since_start() {
+        eeconfig_stats_t now;
+        eeconfig_stats(&now);
+        return {(uint16_t)(now.writes - start.writes), (uint16_t)(now.writes_avoided - start.writes_avoided)};
+    }
+
+    eeconfig_stats_t start;
+};
+
+TEST_F(EEConfig, InitWritesRightAway) {
+    eeprom_write_byte(EECONFIG_KEYMAP, 0x55);
+    eeprom_write_word(EECONFIG_MAGIC, 0);
+    eeconfig_init();
+    EXPECT_EQ(stored_keymap(), 0);
+    EXPECT_EQ(eeprom_read_word(EECONFIG_MAGIC), EECONFIG_MAGIC_NUMBER);
+    EXPECT_TRUE(eeconfig_is_enabled());
+}
+
+TEST_F(EEConfig, ChangesAreReadBackBeforeTheyAreWritten) {
+    eeconfig_update_keymap(0x12);
+    EXPECT_EQ(eeconfig_read_keymap(), 0x12);
+    EXPECT_EQ(stored_keymap(), 0);
+}
+
+TEST_F(EEConfig, WritesOnceTheChangesStop) {
+    TestDriver driver;
+    eeconfig_update_keymap(0x12);
+    // scans at 0..EECONFIG_FLUSH_DELAY - 1 ms
+    idle_for(EECONFIG_FLUSH_DELAY);
+    EXPECT_EQ(stored_keymap(), 0);
+    run_one_scan_loop();
+    EXPECT_EQ(stored_keymap(), 0x12);
+    EXPECT_EQ(since_start().writes, 1);
+}
+
+TEST_F(EEConfig, RepeatedChangesAreWrittenOnce) {
+    TestDriver driver;
+    // like holding a key that steps a setting every scan
+    for (int i = 1; i <= 50; i++) {
+        eeconfig_update_keymap(i);
+        run_one_scan_loop();
+        EXPECT_EQ(stored_keymap(), 0);
+    }
+    idle_for(EECONFIG_FLUSH_DELAY + 1);
+    EXPECT_EQ(stored_keymap(), 50);
+    EXPECT_EQ(since_start().writes, 1);
+    EXPECT_EQ(since_start().writes_avoided, 49);
+}
+
+TEST_F(EEConfig, ChangingBackWritesNothing) {
+    TestDriver driver;
+    eeconfig_update_keymap(0x12);
+    eeconfig_update_keymap(0);
+    idle_for(EECONFIG_FLUSH_DELAY + 1);
+    EXPECT_EQ(stored_keymap(), 0);
+    EXPECT_EQ(since_start().writes, 0);
+    EXPECT_EQ(since_start().writes_avoided, 2);
+}
+
+TEST_F(EEConfig, FlushWritesEverythingNow) {
+    eeconfig_update_keymap(0x12);
+    eeconfig_update_default_layer(0x02);
+    eeconfig_update_dword(EECONFIG_RGBLIGHT, 0x01020304);
+    eeconfig_flush();
+    EXPECT_EQ(stored_keymap(), 0x12);
+    EXPECT_EQ(eeprom_read_byte(EECONFIG_DEFAULT_LAYER), 0x02);
+    EXPECT_EQ(eeprom_read_dword(EECONFIG_RGBLIGHT), 0x01020304u);
+    EXPECT_EQ(since_start().writes, 6);
+}
+
+TEST_F(EEConfig, AddressesPastTheSettingsGoStraightThrough) {
+    uint8_t *addr = (uint8_t *)(uintptr_t)(EECONFIG_SIZE + 1);
+    eeconfig_update_byte(addr, 0x34);
+    EXPECT_EQ(eeprom_read_byte(addr), 0x34);
+    EXPECT_EQ(eeconfig_read_byte(addr), 0x34);
+}
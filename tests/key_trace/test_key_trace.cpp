@@ -0,0 +1,189 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <vector>
+
+extern "C" {
+#include "action_tapping.h"
+#include "key_trace.h"
+#include "raw_api.h"
+#include "raw_hid.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+
+static std::vector<std::vector<uint8_t>> sent;
+
+extern "C" void raw_hid_send(uint8_t *data, uint8_t length) {
+    sent.emplace_back(data, data + length);
+}
+
+class KeyTrace : public TestFixture {
+public:
+    KeyTrace() {
+        uint8_t packet[RAW_API_PACKET_SIZE] = {RAW_API_TELEMETRY, 0, 0, 0};
+        raw_hid_receive(packet, RAW_API_PACKET_SIZE);
+        drain();
+        sent.clear();
+    }
+
+    std::vector<key_trace_event_t> drain(void) {
+        std::vector<key_trace_event_t> events;
+        key_trace_event_t event;
+        while (key_trace_read(&event)) {
+            events.push_back(event);
+        }
+        return events;
+    }
+
+    void press(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        press_key(col, row);
+        run_one_scan_loop();
+    }
+
+    void release(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        release_key(col, row);
+        run_one_scan_loop();
+    }
+
+    void idle(unsigned ms) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        idle_for(ms);
+    }
+};
+
+TEST_F(KeyTrace, RecordsPressAndRelease) {
+    press(0, 1);
+    idle(5);
+    release(0, 1);
+
+    auto events = drain();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].keycode, KC_C);
+    EXPECT_EQ(events[0].row, 1);
+    EXPECT_EQ(events[0].col, 0);
+    EXPECT_EQ(events[0].flags, KEY_TRACE_PRESSED);
+    EXPECT_EQ(events[0].delay, 0);
+    EXPECT_EQ(events[1].keycode, KC_C);
+    EXPECT_EQ(events[1].flags, 0);
+    EXPECT_EQ((uint8_t)(events[1].sequence - events[0].sequence), 1);
+    EXPECT_EQ((uint16_t)(events[1].time - events[0].time), 6);
+}
+
+TEST_F(KeyTrace, RecordsTheLayerTheKeycodeCameFrom) {
+    press(2, 0);
+    press(1, 1);
+    release(1, 1);
+    release(2, 0);
+
+    auto events = drain();
+    ASSERT_EQ(events.size(), 4u);
+    EXPECT_EQ(events[0].keycode, MO(1));
+    EXPECT_EQ(events[0].flags & KEY_TRACE_LAYER_MASK, 0);
+    EXPECT_EQ(events[1].keycode, KC_4);
+    EXPECT_EQ(events[1].flags & KEY_TRACE_LAYER_MASK, 1);
+}
+
+TEST_F(KeyTrace, RecordsTapCountAndTappingDelay) {
+    press(1, 0);
+    release(1, 0);
+    idle(TAPPING_TERM);
+
+    auto events = drain();
+    ASSERT_GE(events.size(), 2u);
+    EXPECT_EQ(events[0].keycode, LT(1, KC_B));
+    EXPECT_EQ(events[0].tap_count, 1);
+    EXPECT_EQ(events[1].tap_count, 1);
+
+    // held past the tapping term, the press waits in the tapping buffer
+    press(1, 0);
+    idle(TAPPING_TERM + 10);
+    release(1, 0);
+    events = drain();
+    ASSERT_GE(events.size(), 1u);
+    EXPECT_EQ(events[0].tap_count, 0);
+    EXPECT_GE(events[0].delay, TAPPING_TERM - 1);
+}
+
+TEST_F(KeyTrace, FullBufferDropsEventsAndLeavesAGap) {
+    uint16_t dropped = key_trace_dropped();
+
+    for (int i = 0; i < KEY_TRACE_SIZE / 2 + 1; i++) {
+        press(0, 1);
+        release(0, 1);
+    }
+    EXPECT_EQ(key_trace_pending(), KEY_TRACE_SIZE);
+    EXPECT_EQ(key_trace_dropped(), dropped + 2);
+
+    drain();
+    press(0, 1);
+    release(0, 1);
+    auto events = drain();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[1].sequence, (uint8_t)(events[0].sequence + 1));
+}
+
+TEST_F(KeyTrace, SerializesBigEndian) {
+    key_trace_event_t event = {7, 0x1234, 3, 1, 2, KEY_TRACE_PRESSED | 1, 0xABCD, 2};
+    uint8_t bytes[KEY_TRACE_EVENT_SIZE];
+
+    key_trace_serialize(&event, bytes);
+    EXPECT_EQ(std::vector<uint8_t>(bytes, bytes + KEY_TRACE_EVENT_SIZE),
+              std::vector<uint8_t>({7, 0x12, 0x34, 3, 1, 2, 0x81, 0xAB, 0xCD, 2}));
+}
+
+TEST_F(KeyTrace, StreamsOverRawHid) {
+    uint8_t packet[RAW_API_PACKET_SIZE] = {RAW_API_TELEMETRY, 0, 0, RAW_API_STREAM_TRACE};
+    raw_hid_receive(packet, RAW_API_PACKET_SIZE);
+    sent.clear();
+
+    // the release is recorded after the scan that sent the press
+    press(0, 1);
+    release(0, 1);
+    idle(2);
+
+    std::vector<uint8_t> events;
+    for (auto &p : sent) {
+        ASSERT_EQ(p[0], RAW_API_TRACE);
+        events.insert(events.end(), p.begin() + 2, p.begin() + 2 + p[1] * KEY_TRACE_EVENT_SIZE);
+    }
+    ASSERT_EQ(events.size(), 2u * KEY_TRACE_EVENT_SIZE);
+    EXPECT_EQ(events[6], KEY_TRACE_PRESSED);
+    EXPECT_EQ(events[8], KC_C);
+    EXPECT_EQ(events[KEY_TRACE_EVENT_SIZE + 6], 0);
+    EXPECT_EQ(key_trace_pending(), 0);
+}
+
+TEST_F(KeyTrace, TracePacketsHoldThreeEvents) {
+    for (int i = 0; i < 2; i++) {
+        press(0, 1);
+        release(0, 1);
+    }
+    uint8_t packet[RAW_API_PACKET_SIZE] = {RAW_API_TELEMETRY, 0, 0, RAW_API_STREAM_TRACE};
+    raw_hid_receive(packet, RAW_API_PACKET_SIZE);
+    sent.clear();
+    idle(1);
+
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0][1], 3);
+    EXPECT_EQ(key_trace_pending(), 1);
+}
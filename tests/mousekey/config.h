@@ -0,0 +1,24 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TESTS_MOUSEKEY_CONFIG_H_
+#define TESTS_MOUSEKEY_CONFIG_H_
+
+#define MATRIX_ROWS 1
+#define MATRIX_COLS 4
+
+#define MOUSEKEY_CURVE MK_CURVE_LINEAR
+
+#endif /* TESTS_MOUSEKEY_CONFIG_H_ */
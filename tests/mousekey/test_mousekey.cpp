@@ -0,0 +1,199 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <vector>
+
+extern "C" {
+#include "mousekey.h"
+#include "timer.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+
+struct MouseReport {
+    uint32_t time;
+    report_mouse_t report;
+};
+
+class Mousekey : public TestFixture {
+public:
+    Mousekey() {
+        mk_curve = MOUSEKEY_CURVE;
+        mk_interval = MOUSEKEY_INTERVAL;
+        mk_max_speed = MOUSEKEY_MAX_SPEED;
+    }
+
+    // Every mouse report sent from now on ends up in reports
+    void record(TestDriver& driver) {
+        EXPECT_CALL(driver, send_mouse_mock(_))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke([this](report_mouse_t& report) {
+                reports.push_back({timer_read32(), report});
+            }));
+    }
+
+    // Holds a key for ms and returns the distance it moved on each axis
+    void hold(uint8_t col, unsigned ms) {
+        pressed_at = timer_read32();
+        press_key(col, 0);
+        idle_for(ms);
+        release_key(col, 0);
+        run_one_scan_loop();
+    }
+
+    // Time from the end of the delay to the last report that moved, what
+    // was still carried when the key went up is never sent
+    double moving_ms() {
+        uint32_t last = pressed_at;
+        for (auto& r : reports) {
+            if (r.report.x || r.report.y || r.report.v || r.report.h) last = r.time;
+        }
+        return (double)last - pressed_at - MOUSEKEY_DELAY;
+    }
+
+    int distance_x() {
+        int x = 0;
+        for (auto& r : reports) x += r.report.x;
+        return x;
+    }
+
+    // Ramp from MOUSEKEY_MOVE_DELTA per interval up to MOUSEKEY_MAX_SPEED
+    // times that, in units per second
+    static double initial_speed() { return MOUSEKEY_MOVE_DELTA * 1000.0 / MOUSEKEY_INTERVAL; }
+    static double max_speed() { return initial_speed() * MOUSEKEY_MAX_SPEED; }
+    static double ramp_ms() { return MOUSEKEY_TIME_TO_MAX * MOUSEKEY_INTERVAL; }
+
+    std::vector<MouseReport> reports;
+    uint32_t pressed_at = 0;
+};
+
+TEST_F(Mousekey, LinearCurveDistanceFollowsTheRamp) {
+    TestDriver driver;
+    record(driver);
+    hold(0, MOUSEKEY_DELAY + 2000);
+
+    double ramp = (initial_speed() + max_speed()) / 2 * ramp_ms() / 1000;
+    double steady = max_speed() * (moving_ms() - ramp_ms()) / 1000;
+    EXPECT_NEAR(distance_x(), MOUSEKEY_MOVE_DELTA + ramp + steady, 1);
+}
+
+TEST_F(Mousekey, QuadraticCurveStartsSlower) {
+    TestDriver driver;
+    record(driver);
+    mk_curve = MK_CURVE_QUADRATIC;
+    hold(0, MOUSEKEY_DELAY + 2000);
+
+    double ramp = (initial_speed() + (max_speed() - initial_speed()) / 3) * ramp_ms() / 1000;
+    double steady = max_speed() * (moving_ms() - ramp_ms()) / 1000;
+    EXPECT_NEAR(distance_x(), MOUSEKEY_MOVE_DELTA + ramp + steady, 1);
+}
+
+TEST_F(Mousekey, ConstantCurveMovesAtFullSpeedAfterTheDelay) {
+    TestDriver driver;
+    record(driver);
+    mk_curve = MK_CURVE_CONSTANT;
+    hold(0, MOUSEKEY_DELAY + 500);
+    EXPECT_NEAR(distance_x(), MOUSEKEY_MOVE_DELTA + max_speed() * moving_ms() / 1000, 1);
+}
+
+TEST_F(Mousekey, NothingMovesDuringTheDelay) {
+    TestDriver driver;
+    record(driver);
+    hold(0, MOUSEKEY_DELAY - 1);
+    // the press and the release
+    ASSERT_EQ(reports.size(), 2u);
+    EXPECT_EQ(reports[0].report.x, MOUSEKEY_MOVE_DELTA);
+    EXPECT_EQ(reports[1].report.x, 0);
+}
+
+TEST_F(Mousekey, ReportsFollowThePollInterval) {
+    TestDriver driver;
+    record(driver);
+    mk_curve = MK_CURVE_CONSTANT;
+    hold(0, MOUSEKEY_DELAY + 500);
+
+    ASSERT_GT(reports.size(), 3u);
+    for (size_t i = 2; i < reports.size() - 1; i++) {
+        EXPECT_EQ(reports[i].time - reports[i - 1].time, MOUSEKEY_REPORT_INTERVAL);
+        // the same distance every time at a constant speed
+        EXPECT_EQ(reports[i].report.x, max_speed() * MOUSEKEY_REPORT_INTERVAL / 1000);
+    }
+}
+
+TEST_F(Mousekey, SlowSpeedsAreNotRoundedAway) {
+    TestDriver driver;
+    record(driver);
+    mk_curve = MK_CURVE_CONSTANT;
+    // 25 units per second, 1/4 of a unit for every report interval
+    mk_interval = 200;
+    mk_max_speed = 1;
+    hold(0, MOUSEKEY_DELAY + 1000);
+
+    EXPECT_NEAR(distance_x(), MOUSEKEY_MOVE_DELTA + 25 * moving_ms() / 1000, 1);
+    for (auto& r : reports) {
+        EXPECT_LE(r.report.x, MOUSEKEY_MOVE_DELTA);
+    }
+}
+
+TEST_F(Mousekey, DiagonalMovesOneOverSqrtTwoOnEachAxis) {
+    TestDriver driver;
+    record(driver);
+    mk_curve = MK_CURVE_CONSTANT;
+    pressed_at = timer_read32();
+    press_key(0, 0);
+    press_key(1, 0);
+    idle_for(MOUSEKEY_DELAY + 1000);
+    release_key(0, 0);
+    release_key(1, 0);
+    run_one_scan_loop();
+
+    int x = 0, y = 0;
+    for (auto& r : reports) {
+        x += r.report.x;
+        y += r.report.y;
+    }
+    double expected = MOUSEKEY_MOVE_DELTA + max_speed() * 181 / 256 * moving_ms() / 1000;
+    EXPECT_NEAR(x, expected, 2);
+    EXPECT_NEAR(y, expected, 2);
+}
+
+TEST_F(Mousekey, WheelFollowsItsOwnRamp) {
+    TestDriver driver;
+    record(driver);
+    hold(2, MOUSEKEY_DELAY + 3000);
+
+    int v = 0;
+    for (auto& r : reports) v += r.report.v;
+    double initial = MOUSEKEY_WHEEL_DELTA * 1000.0 / MOUSEKEY_INTERVAL;
+    double max = initial * MOUSEKEY_WHEEL_MAX_SPEED;
+    double ramp_ms = MOUSEKEY_WHEEL_TIME_TO_MAX * MOUSEKEY_INTERVAL;
+    double expected = MOUSEKEY_WHEEL_DELTA + (initial + max) / 2 * ramp_ms / 1000 + max * (moving_ms() - ramp_ms) / 1000;
+    EXPECT_NEAR(-v, expected, 1);
+}
+
+TEST_F(Mousekey, AccelKeysPickAFixedSpeed) {
+    TestDriver driver;
+    record(driver);
+    press_key(3, 0);
+    run_one_scan_loop();
+    hold(0, MOUSEKEY_DELAY + 1000);
+    release_key(3, 0);
+    run_one_scan_loop();
+    // the first step is a quarter of the steps at full speed too
+    EXPECT_NEAR(distance_x(), MOUSEKEY_MOVE_DELTA * MOUSEKEY_MAX_SPEED / 4 + max_speed() / 4 * moving_ms() / 1000, 1);
+}
@@ -0,0 +1,175 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <vector>
+
+extern "C" {
+#include "pointing_device.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+
+// A sensor that reports 16 bit counts, read once per scan by the task below
+struct FakeSensor {
+    int16_t x = 0;
+    int16_t y = 0;
+    int16_t wheel = 0;
+    uint8_t buttons = 0;
+    int reads = 0;
+};
+
+static FakeSensor sensor;
+
+extern "C" void pointing_device_task(void) {
+    sensor.reads++;
+    pointing_device_move(sensor.x, sensor.y);
+    pointing_device_scroll(sensor.wheel, 0);
+    sensor.x = sensor.y = sensor.wheel = 0;
+
+    report_mouse_t report = pointing_device_get_report();
+    report.buttons = sensor.buttons;
+    pointing_device_set_report(report);
+    pointing_device_send();
+}
+
+class PointingDevice : public TestFixture {
+public:
+    PointingDevice() {
+        // Let whatever the previous test left behind go out
+        TestDriver driver;
+        EXPECT_CALL(driver, send_mouse_mock(_)).Times(AnyNumber());
+        idle_for(POINTING_DEVICE_REPORT_INTERVAL * 20);
+        sensor = FakeSensor();
+    }
+
+    // Every mouse report sent from now on ends up in reports
+    void record(TestDriver& driver) {
+        EXPECT_CALL(driver, send_mouse_mock(_))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke([this](report_mouse_t& report) { reports.push_back(report); }));
+    }
+
+    std::vector<report_mouse_t> reports;
+};
+
+TEST_F(PointingDevice, NothingIsSentWhileTheSensorIsIdle) {
+    TestDriver driver;
+    EXPECT_CALL(driver, send_mouse_mock(_)).Times(0);
+    idle_for(100);
+    EXPECT_EQ(sensor.reads, 100);
+}
+
+TEST_F(PointingDevice, SlowMotionIsAccumulatedBetweenReports) {
+    TestDriver driver;
+    record(driver);
+    for (int i = 0; i < 100; i++) {
+        sensor.x = 1;
+        sensor.y = -1;
+        run_one_scan_loop();
+    }
+    idle_for(POINTING_DEVICE_REPORT_INTERVAL);
+
+    int x = 0, y = 0;
+    for (auto& report : reports) {
+        x += report.x;
+        y += report.y;
+    }
+    EXPECT_EQ(x, 100);
+    EXPECT_EQ(y, -100);
+    // One report per interval instead of one per scan
+    EXPECT_LE(reports.size(), 100u / POINTING_DEVICE_REPORT_INTERVAL + 1);
+    EXPECT_GE(reports.size(), 100u / POINTING_DEVICE_REPORT_INTERVAL);
+}
+
+TEST_F(PointingDevice, ButtonsAreSentRightAway) {
+    TestDriver driver;
+    record(driver);
+    sensor.buttons = MOUSE_BTN1;
+    run_one_scan_loop();
+    ASSERT_EQ(reports.size(), 1u);
+    EXPECT_EQ(reports[0].buttons, MOUSE_BTN1);
+
+    // Held without moving, nothing more to send
+    idle_for(50);
+    EXPECT_EQ(reports.size(), 1u);
+
+    sensor.buttons = 0;
+    run_one_scan_loop();
+    ASSERT_EQ(reports.size(), 2u);
+    EXPECT_EQ(reports[1].buttons, 0);
+}
+
+TEST_F(PointingDevice, LargeDeltasAreSplitAcrossReports) {
+    TestDriver driver;
+    record(driver);
+    sensor.x = 1000;
+    sensor.y = -300;
+    sensor.wheel = 5;
+    idle_for(POINTING_DEVICE_REPORT_INTERVAL * 20);
+
+    int x = 0, y = 0, v = 0;
+    for (auto& report : reports) {
+        EXPECT_LE(report.x, 127);
+        EXPECT_GE(report.y, -127);
+        x += report.x;
+        y += report.y;
+        v += report.v;
+    }
+    EXPECT_EQ(x, 1000);
+    EXPECT_EQ(y, -300);
+    EXPECT_EQ(v, 5);
+    EXPECT_EQ(reports.size(), 8u);
+}
+
+TEST_F(PointingDevice, MotionSaturatesInsteadOfWrapping) {
+    TestDriver driver;
+    record(driver);
+    for (int i = 0; i < 3; i++) {
+        sensor.x = 30000;
+        run_one_scan_loop();
+    }
+    idle_for(INT16_MAX / 127 * POINTING_DEVICE_REPORT_INTERVAL + 10);
+
+    int x = 0;
+    for (auto& report : reports) {
+        EXPECT_LE(report.x, 127);
+        x += report.x;
+    }
+    // The first report went out before the second read, what is left after
+    // it is capped at the 16 bit maximum
+    EXPECT_EQ(x, 127 + INT16_MAX);
+}
+
+TEST_F(PointingDevice, SetReportKeepsWhatDidNotFit) {
+    TestDriver driver;
+    record(driver);
+    pointing_device_move(200, 0);
+    report_mouse_t report = pointing_device_get_report();
+    EXPECT_EQ(report.x, 127);
+    report.y = 10;
+    pointing_device_set_report(report);
+    idle_for(POINTING_DEVICE_REPORT_INTERVAL * 3);
+
+    int x = 0, y = 0;
+    for (auto& r : reports) {
+        x += r.x;
+        y += r.y;
+    }
+    EXPECT_EQ(x, 200);
+    EXPECT_EQ(y, 10);
+}
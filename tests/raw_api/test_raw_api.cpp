@@ -0,0 +1,226 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <vector>
+
+extern "C" {
+#include "raw_api.h"
+#include "raw_hid.h"
+#include "dynamic_keymap.h"
+#include "keycode_config.h"
+#include "eeconfig.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+
+#define PACKET_SIZE RAW_API_PACKET_SIZE
+
+static std::vector<std::vector<uint8_t>> sent;
+
+extern "C" void raw_hid_send(uint8_t *data, uint8_t length) {
+    sent.emplace_back(data, data + length);
+}
+
+class RawApi : public TestFixture {
+public:
+    RawApi() {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        eeconfig_init();
+        keymap_config.raw = 0;
+        default_layer_set(1);
+        command({RAW_API_TELEMETRY, 0, 0, 0});
+        sent.clear();
+    }
+
+    // Sends a raw HID packet and returns the reply
+    std::vector<uint8_t> command(std::vector<uint8_t> bytes) {
+        uint8_t packet[PACKET_SIZE] = {};
+        std::copy(bytes.begin(), bytes.end(), packet);
+        sent.clear();
+        raw_hid_receive(packet, PACKET_SIZE);
+        EXPECT_EQ(sent.size(), 1u);
+        return sent.empty() ? std::vector<uint8_t>() : sent.back();
+    }
+
+    static uint32_t be(const std::vector<uint8_t>& bytes, size_t offset, size_t size) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < size; i++) {
+            value = (value << 8) | bytes[offset + i];
+        }
+        return value;
+    }
+
+    // Keys that don't check what they send
+    void press(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        press_key(col, row);
+        keyboard_task();
+    }
+
+    void release(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        release_key(col, row);
+        keyboard_task();
+    }
+};
+
+TEST_F(RawApi, InfoDescribesTheKeyboard) {
+    auto r = command({RAW_API_GET_INFO});
+    ASSERT_EQ(r.size(), PACKET_SIZE);
+    EXPECT_EQ(r[0], RAW_API_GET_INFO);
+    EXPECT_EQ(r[1], RAW_API_VERSION);
+    EXPECT_EQ(r[2], PACKET_SIZE);
+    EXPECT_EQ(r[3], MATRIX_ROWS);
+    EXPECT_EQ(r[4], MATRIX_COLS);
+    EXPECT_EQ(r[5], sizeof(matrix_row_t));
+}
+
+TEST_F(RawApi, GetReadsSeveralFieldsInOnePacket) {
+    press(2, 0);
+    auto r = command({RAW_API_GET, 3, RAW_API_LAYER_STATE, RAW_API_DEFAULT_LAYER, RAW_API_KEYMAP_CONFIG});
+    release(2, 0);
+
+    EXPECT_EQ(r[0], RAW_API_GET);
+    EXPECT_EQ(r[1], 3);
+    EXPECT_EQ(r[2], RAW_API_LAYER_STATE);
+    EXPECT_EQ(be(r, 3, 4), 1u << 1);
+    EXPECT_EQ(r[7], RAW_API_DEFAULT_LAYER);
+    EXPECT_EQ(be(r, 8, 4), 1u);
+    EXPECT_EQ(r[12], RAW_API_KEYMAP_CONFIG);
+    EXPECT_EQ(r[13], 0);
+}
+
+TEST_F(RawApi, SetWritesSeveralFieldsInOnePacket) {
+    std::vector<uint8_t> r;
+    {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        r = command({RAW_API_SET, 2, RAW_API_DEFAULT_LAYER, 0, 0, 0, 1 << 1, RAW_API_KEYMAP_CONFIG, EECONFIG_KEYMAP_NKRO});
+    }
+    EXPECT_EQ(r[0], RAW_API_SET);
+    EXPECT_EQ(default_layer_state, 1u << 1);
+    EXPECT_EQ(eeconfig_read_default_layer(), 1 << 1);
+    EXPECT_TRUE(keymap_config.nkro);
+    EXPECT_EQ(eeconfig_read_keymap(), EECONFIG_KEYMAP_NKRO);
+
+    TestDriver driver;
+    press_key(0, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_3)));
+    keyboard_task();
+    release_key(0, 1);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    keyboard_task();
+}
+
+TEST_F(RawApi, SetChangesNothingIfOneFieldCant) {
+    auto r = command({RAW_API_SET, 2, RAW_API_DEFAULT_LAYER, 0, 0, 0, 1 << 1, RAW_API_UPTIME, 0, 0, 0, 0});
+    EXPECT_EQ(r[0], RAW_API_ERROR);
+    EXPECT_EQ(r[1], RAW_API_SET);
+    EXPECT_EQ(r[2], RAW_API_ERROR_READ_ONLY);
+    EXPECT_EQ(r[3], RAW_API_UPTIME);
+    EXPECT_EQ(default_layer_state, 1u);
+}
+
+TEST_F(RawApi, UnknownFieldsAreAnError) {
+    // no backlight on this keyboard
+    auto r = command({RAW_API_GET, 2, RAW_API_LAYER_STATE, RAW_API_BACKLIGHT});
+    EXPECT_EQ(r[0], RAW_API_ERROR);
+    EXPECT_EQ(r[1], RAW_API_GET);
+    EXPECT_EQ(r[2], RAW_API_ERROR_UNKNOWN_FIELD);
+    EXPECT_EQ(r[3], RAW_API_BACKLIGHT);
+}
+
+TEST_F(RawApi, RepliesThatDontFitAreAnError) {
+    // 7 uptimes take 35 bytes
+    auto r = command({RAW_API_GET, 7, RAW_API_UPTIME, RAW_API_UPTIME, RAW_API_UPTIME, RAW_API_UPTIME, RAW_API_UPTIME, RAW_API_UPTIME, RAW_API_UPTIME});
+    EXPECT_EQ(r[0], RAW_API_ERROR);
+    EXPECT_EQ(r[2], RAW_API_ERROR_TOO_LONG);
+
+    r = command({RAW_API_GET, 40});
+    EXPECT_EQ(r[0], RAW_API_ERROR);
+    EXPECT_EQ(r[2], RAW_API_ERROR_TOO_LONG);
+}
+
+TEST_F(RawApi, ScanRateCountsScans) {
+    TestDriver driver;
+    idle_for(2100);
+    auto r = command({RAW_API_GET, 1, RAW_API_SCAN_RATE});
+    EXPECT_NEAR(be(r, 3, 2), 1000, 1);
+}
+
+TEST_F(RawApi, TelemetryStreamsAtTheInterval) {
+    auto r = command({RAW_API_TELEMETRY, 0, 10, RAW_API_STREAM_MATRIX | RAW_API_STREAM_LAYERS | RAW_API_STREAM_SCAN_RATE});
+    EXPECT_EQ(r[0], RAW_API_TELEMETRY);
+    press(2, 0);
+    press(1, 1);
+    sent.clear();
+    {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        idle_for(35);
+    }
+
+    ASSERT_EQ(sent.size(), 3u);
+    for (size_t i = 0; i < sent.size(); i++) {
+        auto& report = sent[i];
+        EXPECT_EQ(report[0], RAW_API_REPORT);
+        EXPECT_EQ(report[1], (uint8_t)(sent[0][1] + i));
+        EXPECT_EQ(report[2], RAW_API_STREAM_MATRIX | RAW_API_STREAM_LAYERS | RAW_API_STREAM_SCAN_RATE);
+        // rows
+        EXPECT_EQ(be(report, 3, sizeof(matrix_row_t)), 1u << 2);
+        EXPECT_EQ(be(report, 3 + sizeof(matrix_row_t), sizeof(matrix_row_t)), 1u << 1);
+        // layers
+        size_t layers = 3 + 2 * sizeof(matrix_row_t);
+        EXPECT_EQ(be(report, layers, 4), 1u << 1);
+        EXPECT_EQ(be(report, layers + 4, 4), 1u);
+    }
+    release(1, 1);
+    release(2, 0);
+
+    command({RAW_API_TELEMETRY, 0, 0, 0});
+    sent.clear();
+    TestDriver driver;
+    idle_for(50);
+    EXPECT_TRUE(sent.empty());
+}
+
+TEST_F(RawApi, TelemetrySendsOnlyWhatWasAskedFor) {
+    command({RAW_API_TELEMETRY, 0, 5, RAW_API_STREAM_SCAN_RATE});
+    sent.clear();
+    TestDriver driver;
+    idle_for(6);
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0][2], RAW_API_STREAM_SCAN_RATE);
+    for (size_t i = 5; i < PACKET_SIZE; i++) {
+        EXPECT_EQ(sent[0][i], 0);
+    }
+}
+
+TEST_F(RawApi, KeymapCommandsStillWork) {
+    auto r = command({DYNAMIC_KEYMAP_GET_KEYCODE, 1, 1, 2});
+    EXPECT_EQ(r[0], DYNAMIC_KEYMAP_GET_KEYCODE);
+    EXPECT_EQ((r[4] << 8) | r[5], KC_5);
+}
+
+TEST_F(RawApi, OtherPacketsAreRejected) {
+    auto r = command({0x42});
+    EXPECT_EQ(r[0], RAW_API_ERROR);
+    EXPECT_EQ(r[1], 0x42);
+}
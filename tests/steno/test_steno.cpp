@@ -0,0 +1,165 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <vector>
+
+extern "C" {
+#include "process_steno.h"
+#include "virtser.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+
+typedef std::vector<uint8_t> packet_t;
+
+// The CDC IN endpoint, busy while endpoint_busy is set
+static std::vector<packet_t> packets;
+static bool endpoint_busy = false;
+
+extern "C" uint8_t virtser_send_packet(const uint8_t *data, uint8_t length) {
+    if (endpoint_busy) {
+        return 0;
+    }
+    packets.push_back(packet_t(data, data + length));
+    return length ? length : 1;
+}
+
+// S1, TL, A and E in Gemini PR, after the start of packet bit
+static const packet_t gemini_chord = {0x80, 0x50, 0x20, 0x08, 0x00, 0x00};
+
+class Steno : public TestFixture {
+public:
+    Steno() {
+        steno_set_mode(STENO_MODE_GEMINI);
+        endpoint_busy = false;
+        virtser_flush();
+        packets.clear();
+    }
+
+    void tap(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        press_key(col, row);
+        run_one_scan_loop();
+        release_key(col, row);
+        run_one_scan_loop();
+    }
+
+    // Presses S1, TL, A and E one scan apart, then lets go of them
+    void stroke(void) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        for (auto &key : chord_keys) {
+            press_key(key.first, key.second);
+            run_one_scan_loop();
+        }
+        for (auto &key : chord_keys) {
+            release_key(key.first, key.second);
+            run_one_scan_loop();
+        }
+    }
+
+    const std::vector<std::pair<uint8_t, uint8_t>> chord_keys = {{0, 0}, {1, 0}, {2, 0}, {0, 1}};
+};
+
+TEST_F(Steno, GeminiChordIsOnePacket) {
+    tap(1, 1);
+    stroke();
+    EXPECT_TRUE(packets.empty());
+
+    virtser_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0], gemini_chord);
+}
+
+TEST_F(Steno, BoltChordIsOnePacketWithItsTerminator) {
+    tap(2, 1);
+    stroke();
+    virtser_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0].back(), 0);
+}
+
+TEST_F(Steno, ChordWaitsForABusyEndpoint) {
+    stroke();
+    endpoint_busy = true;
+    virtser_flush();
+    EXPECT_TRUE(packets.empty());
+
+    endpoint_busy = false;
+    virtser_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0], gemini_chord);
+}
+
+TEST_F(Steno, ChordsQueuedTogetherShareAPacket) {
+    stroke();
+    stroke();
+    virtser_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    packet_t both(gemini_chord);
+    both.insert(both.end(), gemini_chord.begin(), gemini_chord.end());
+    EXPECT_EQ(packets[0], both);
+}
+
+TEST_F(Steno, FullBufferDropsWholeChords) {
+    const unsigned fit = VIRTSER_TX_BUFFER_SIZE / gemini_chord.size();
+    packet_t sent;
+
+    endpoint_busy = true;
+    for (unsigned i = 0; i < fit + 2; i++) {
+        stroke();
+    }
+    endpoint_busy = false;
+    virtser_flush();
+
+    for (auto &packet : packets) {
+        EXPECT_LE(packet.size(), (size_t)VIRTSER_PACKET_SIZE);
+        sent.insert(sent.end(), packet.begin(), packet.end());
+    }
+    ASSERT_EQ(sent.size(), fit * gemini_chord.size());
+    for (unsigned i = 0; i < fit; i++) {
+        EXPECT_EQ(packet_t(sent.begin() + i * gemini_chord.size(), sent.begin() + (i + 1) * gemini_chord.size()), gemini_chord);
+    }
+}
+
+TEST_F(Steno, FullPacketIsFollowedByAnEmptyOne) {
+    uint8_t data[VIRTSER_PACKET_SIZE] = {0x80};
+
+    ASSERT_TRUE(virtser_send_buf(data, sizeof(data)));
+    endpoint_busy = true;
+    virtser_flush();
+    EXPECT_TRUE(packets.empty());
+
+    endpoint_busy = false;
+    virtser_flush();
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_EQ(packets[0], packet_t(data, data + sizeof(data)));
+    EXPECT_TRUE(packets[1].empty());
+
+    // only once
+    virtser_flush();
+    EXPECT_EQ(packets.size(), 2u);
+}
+
+TEST_F(Steno, ShortPacketNeedsNoEmptyOne) {
+    stroke();
+    virtser_flush();
+    virtser_flush();
+    ASSERT_EQ(packets.size(), 1u);
+    EXPECT_EQ(packets[0], gemini_chord);
+}
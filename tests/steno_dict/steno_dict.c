@@ -0,0 +1,31 @@
+/* Generated by util/steno_dict.py from dict.json, do not edit */
+#include "process_steno_dict.h"
+
+const uint16_t steno_dict_size = 11;
+
+const steno_dict_entry_t steno_dict[] PROGMEM = {
+  {0x000003,     0, 0x00},  // #S
+  {0x000020,     4, 0x00},  // W
+  {0x000118,     9, 0x04},  // KPA
+  {0x000400,     9, 0x08},  // *
+  {0x000890,    10, 0x02},  // PRE
+  {0x028014,    14, 0x05},  // TP-PL
+  {0x028028,    16, 0x05},  // KW-PL
+  {0x040000,    18, 0x01},  // -G
+  {0x04020C,    22, 0x00},  // TKOG
+  {0x050028,    26, 0x01},  // KW-BG
+  {0x080108,    28, 0x00},  // KAT
+};
+
+const char steno_dict_text[] PROGMEM =
+  "one\0"
+  "with\0"
+  "\0"
+  "pre\0"
+  ".\0"
+  "\?\0"
+  "ing\0"
+  "dog\0"
+  ",\0"
+  "cat\0"
+;
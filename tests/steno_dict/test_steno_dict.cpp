@@ -0,0 +1,230 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "process_steno.h"
+#include "process_steno_dict.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+
+static const std::string order = STENO_DICT_ORDER;
+
+// Where each key of STENO_DICT_ORDER is in the keymap, col then row
+static const std::pair<uint8_t, uint8_t> keys[STENO_DICT_KEYS] = {
+    {0, 0}, {1, 0}, {2, 0}, {2, 1}, {3, 0}, {3, 1}, {4, 0}, {4, 1}, {5, 1}, {6, 1}, {5, 0}, {7, 1},
+    {8, 1}, {6, 0}, {0, 2}, {7, 0}, {1, 2}, {8, 0}, {2, 2}, {0, 1}, {3, 2}, {1, 1}, {4, 2},
+};
+
+// The text an editor would show for the reports sent so far
+class Editor {
+public:
+    void report(report_keyboard_t &report) {
+        bool shift = report.mods & MOD_BIT(KC_LSFT);
+        for (uint8_t key : report.keys) {
+            if (key && std::find(down.begin(), down.end(), key) == down.end()) {
+                type(key, shift);
+            }
+        }
+        down.assign(report.keys, report.keys + KEYBOARD_REPORT_KEYS);
+    }
+
+    std::string text;
+
+private:
+    void type(uint8_t key, bool shift) {
+        if (key >= KC_A && key <= KC_Z) {
+            text += (shift ? 'A' : 'a') + key - KC_A;
+        } else if (key == KC_BSPC) {
+            ASSERT_FALSE(text.empty());
+            text.pop_back();
+        } else if (key == KC_SPC) {
+            text += ' ';
+        } else if (key == KC_DOT) {
+            text += '.';
+        } else if (key == KC_COMM) {
+            text += ',';
+        } else if (key == KC_MINS) {
+            text += '-';
+        } else if (key == KC_SLSH && shift) {
+            text += '?';
+        } else {
+            ADD_FAILURE() << "unexpected key " << (int)key;
+        }
+    }
+
+    std::vector<uint8_t> down;
+};
+
+class StenoDict : public TestFixture {
+public:
+    StenoDict() {
+        tap(5, 2);
+        editor.text.clear();
+    }
+
+    void tap(uint8_t col, uint8_t row) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        press_key(col, row);
+        run_one_scan_loop();
+        release_key(col, row);
+        run_one_scan_loop();
+    }
+
+    // Writes strokes like Plover outlines, one key per scan
+    std::string write(std::vector<std::string> strokes) {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke(&editor, &Editor::report));
+
+        for (auto &stroke : strokes) {
+            std::vector<std::pair<uint8_t, uint8_t>> down;
+            size_t position = 1;
+            for (char c : stroke) {
+                if (c == '-') {
+                    position = order.find('F');
+                    continue;
+                }
+                position = c == '#' ? 0 : order.find(c, position);
+                EXPECT_NE(position, std::string::npos) << stroke;
+                down.push_back(keys[position++]);
+            }
+            for (auto &key : down) {
+                press_key(key.first, key.second);
+                run_one_scan_loop();
+            }
+            for (auto &key : down) {
+                release_key(key.first, key.second);
+                run_one_scan_loop();
+            }
+        }
+        return editor.text;
+    }
+
+    Editor editor;
+};
+
+TEST_F(StenoDict, TypesWordsWithSpacesBetween) {
+    EXPECT_EQ(write({"KAT", "W", "TKOG"}), "cat with dog");
+}
+
+TEST_F(StenoDict, AttachesSuffixesAndPrefixes) {
+    EXPECT_EQ(write({"KAT", "-G"}), "cating");
+    EXPECT_EQ(write({"PRE", "KAT"}), "cating precat");
+}
+
+TEST_F(StenoDict, PunctuationCapitalizesTheNextWord) {
+    EXPECT_EQ(write({"KAT", "TP-PL", "TKOG", "KW-BG", "KAT", "KW-PL"}), "cat. Dog, cat?");
+    EXPECT_EQ(write({"KPA", "KAT"}), "cat. Dog, cat? Cat");
+}
+
+TEST_F(StenoDict, TheNumberBarIsPartOfTheStroke) {
+    EXPECT_EQ(write({"#S", "KAT"}), "one cat");
+}
+
+TEST_F(StenoDict, UntranslatedStrokesAreTypedAsTheirOutline) {
+    EXPECT_EQ(write({"KAT", "TKPW", "-Z"}), "cat TKPW -Z");
+}
+
+TEST_F(StenoDict, UndoTakesBackStrokesAndTheirSpacing) {
+    EXPECT_EQ(write({"KAT", "TP-PL", "TKOG", "*"}), "cat.");
+    EXPECT_EQ(write({"*", "TKOG"}), "cat dog");
+    EXPECT_EQ(write({"*", "*", "*", "KAT"}), "cat");
+}
+
+// Built without the serial port, Gemini is not there to switch to
+TEST_F(StenoDict, GeminiKeyKeepsTheDictionary) {
+    tap(6, 2);
+    EXPECT_EQ(write({"KAT"}), "cat");
+}
+
+TEST_F(StenoDict, ChordsFromGeminiKeys) {
+    uint8_t chord[6] = {0};
+
+    // S2, the third number key and the first star
+    chord[1] = 0x20;
+    chord[0] = 0x08;
+    chord[2] = 0x08;
+    EXPECT_EQ(steno_dict_stroke(chord), 1u << 0 | 1u << 1 | 1u << 10);
+}
+
+TEST_F(StenoDict, OutlinesNeedAHyphenOnlyWithoutVowels) {
+    char outline[STENO_DICT_KEYS + 2];
+
+    EXPECT_EQ(steno_dict_outline(1u << 13 | 1u << 18, outline), 3);
+    EXPECT_STREQ(outline, "-FG");
+    steno_dict_outline(1u << 1 | 1u << 8 | 1u << 13, outline);
+    EXPECT_STREQ(outline, "SAF");
+    EXPECT_EQ(steno_dict_outline((1u << STENO_DICT_KEYS) - 1, outline), STENO_DICT_KEYS);
+    EXPECT_STREQ(outline, STENO_DICT_ORDER);
+}
+
+TEST_F(StenoDict, FindsEveryEntryAndNothingElse) {
+    std::mt19937 random(1);
+    std::set<uint32_t> strokes;
+    while (strokes.size() < 30000) {
+        strokes.insert(random() & ((1u << STENO_DICT_KEYS) - 1));
+    }
+    std::vector<steno_dict_entry_t> dict;
+    for (uint32_t stroke : strokes) {
+        dict.push_back({stroke, (uint16_t)dict.size(), 0});
+    }
+
+    for (auto &entry : dict) {
+        const steno_dict_entry_t *found = steno_dict_find(dict.data(), dict.size(), entry.stroke);
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(found->text, entry.text);
+    }
+    for (int i = 0; i < 30000; i++) {
+        uint32_t stroke = random() & ((1u << STENO_DICT_KEYS) - 1);
+        EXPECT_EQ(steno_dict_find(dict.data(), dict.size(), stroke) != nullptr, strokes.count(stroke) == 1);
+    }
+    EXPECT_EQ(steno_dict_find(dict.data(), 0, dict[0].stroke), nullptr);
+    EXPECT_EQ(steno_dict_find(dict.data(), 1, dict[0].stroke), &dict[0]);
+}
+
+TEST_F(StenoDict, LookupIsFastEnoughForLargeDictionaries) {
+    // about the size of Plover's main dictionary without its multi stroke entries
+    const size_t size = 60000;
+    const int lookups = 1000000;
+    std::vector<steno_dict_entry_t> dict;
+    for (uint32_t i = 0; i < size; i++) {
+        dict.push_back({i * 97, 0, 0});
+    }
+
+    uint32_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++) {
+        found += steno_dict_find(dict.data(), dict.size(), (uint32_t)i * 61) != nullptr;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    // 16 probes each, a generous bound for a host that is far slower than usual
+    EXPECT_GT(found, 0u);
+    EXPECT_LT(elapsed.count() / lookups, 1000.0);
+    RecordProperty("ns_per_lookup", (int)(elapsed.count() / lookups));
+}
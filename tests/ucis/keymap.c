@@ -0,0 +1,33 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quantum.h"
+#include "quantum.h"
+
+const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+    [0] = {
+        {KC_B, KC_E, KC_R, KC_P, KC_O, KC_F, KC_L, KC_S},
+        {KC_M, KC_I, KC_X, KC_2, KC_ENT, KC_SPC, KC_ESC, KC_BSPC},
+    },
+};
+
+// Sorted, so it is searched by bisection
+const qk_ucis_symbol_t ucis_symbol_table[] = UCIS_TABLE(
+    UCIS_SYM("beer", 0x1F37A),
+    UCIS_SYM("poop", 0x1F4A9),
+    UCIS_SYM("rofl", 0x1F923),
+    UCIS_SYM("smile", 0x263A),
+    UCIS_SYM("x2", 0xD7)
+);
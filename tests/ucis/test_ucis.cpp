@@ -0,0 +1,123 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include "process_ucis.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Invoke;
+
+// Where each key is in the keymap, col then row
+static const std::map<uint16_t, std::pair<uint8_t, uint8_t>> positions = {
+    {KC_B, {0, 0}}, {KC_E, {1, 0}}, {KC_R, {2, 0}}, {KC_P, {3, 0}}, {KC_O, {4, 0}}, {KC_F, {5, 0}},
+    {KC_L, {6, 0}}, {KC_S, {7, 0}}, {KC_M, {0, 1}}, {KC_I, {1, 1}}, {KC_X, {2, 1}}, {KC_2, {3, 1}},
+    {KC_ENT, {4, 1}}, {KC_SPC, {5, 1}}, {KC_ESC, {6, 1}}, {KC_BSPC, {7, 1}},
+};
+
+class Ucis : public TestFixture {
+public:
+    Ucis() {
+        TestDriver driver;
+        EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+        set_unicode_input_mode(UC_LNX);
+        qk_ucis_start();
+    }
+
+    // The keys pressed while typing, without the modifiers
+    std::vector<uint8_t> type(std::vector<uint16_t> keycodes) {
+        TestDriver driver;
+        std::vector<uint8_t> down;
+        EXPECT_CALL(driver, send_keyboard_mock(_))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke([&](report_keyboard_t &report) {
+                for (uint8_t key : report.keys) {
+                    if (key && std::find(down.begin(), down.end(), key) == down.end()) {
+                        pressed.push_back(key);
+                    }
+                }
+                down.assign(report.keys, report.keys + KEYBOARD_REPORT_KEYS);
+            }));
+
+        pressed.clear();
+        for (uint16_t keycode : keycodes) {
+            auto &key = positions.at(keycode);
+            press_key(key.first, key.second);
+            run_one_scan_loop();
+            release_key(key.first, key.second);
+            run_one_scan_loop();
+        }
+        return pressed;
+    }
+
+    // Erasing the symbol and the keyboard sign, then Ctrl+Shift+U, the code and space
+    std::vector<uint8_t> unicode(uint8_t typed, std::vector<uint8_t> hex) {
+        std::vector<uint8_t> keys(typed, KC_BSPC);
+        keys.push_back(KC_U);
+        keys.insert(keys.end(), hex.begin(), hex.end());
+        keys.push_back(KC_SPC);
+        return keys;
+    }
+
+    std::vector<uint8_t> pressed;
+};
+
+TEST_F(Ucis, FindsTheFirstSymbol) {
+    type({KC_B, KC_E, KC_E, KC_R});
+    EXPECT_EQ(type({KC_ENT}), unicode(5, {KC_1, KC_F, KC_3, KC_7, KC_A}));
+    EXPECT_FALSE(qk_ucis_state.in_progress);
+}
+
+TEST_F(Ucis, FindsASymbolInTheMiddle) {
+    type({KC_R, KC_O, KC_F, KC_L});
+    EXPECT_EQ(type({KC_SPC}), unicode(5, {KC_1, KC_F, KC_9, KC_2, KC_3}));
+}
+
+TEST_F(Ucis, FindsTheLastSymbolWithADigit) {
+    type({KC_X, KC_2});
+    EXPECT_EQ(type({KC_ENT}), unicode(3, {KC_D, KC_7}));
+}
+
+TEST_F(Ucis, MatchesWholeSymbolsOnly) {
+    // typed again as Unicode input, the way it was
+    type({KC_P, KC_O, KC_O});
+    EXPECT_EQ(type({KC_ENT}), unicode(4, {KC_P, KC_O, KC_O}));
+}
+
+TEST_F(Ucis, BackspaceEditsTheSymbol) {
+    type({KC_S, KC_M, KC_I, KC_X, KC_BSPC, KC_L, KC_E});
+    EXPECT_EQ(type({KC_ENT}), unicode(6, {KC_2, KC_6, KC_3, KC_A}));
+}
+
+TEST_F(Ucis, EscapeCancels) {
+    type({KC_P, KC_O});
+    EXPECT_EQ(type({KC_ESC}), std::vector<uint8_t>(3, KC_BSPC));
+    EXPECT_FALSE(qk_ucis_state.in_progress);
+}
+
+TEST_F(Ucis, SendsTheSymbolWithoutWaitingBetweenKeys) {
+    type({KC_P, KC_O, KC_O, KC_P});
+    uint32_t start = timer_read32();
+    type({KC_ENT});
+
+    // two scans and the one delay after starting Unicode input
+    EXPECT_EQ(timer_read32() - start, 2u + UNICODE_TYPE_DELAY);
+}
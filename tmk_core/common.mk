@@ -50,6 +50,10 @@ else
     TMK_COMMON_SRC += $(COMMON_DIR)/magic.c
 endif
 
+ifeq ($(strip $(VIRTSER_ENABLE)), yes)
+    TMK_COMMON_SRC += $(COMMON_DIR)/virtser.c
+endif
+
 ifeq ($(strip $(MOUSEKEY_ENABLE)), yes)
     TMK_COMMON_SRC += $(COMMON_DIR)/mousekey.c
     TMK_COMMON_DEFS += -DMOUSEKEY_ENABLE
@@ -66,6 +70,7 @@ endif
 
 ifeq ($(strip $(CONSOLE_ENABLE)), yes)
     TMK_COMMON_DEFS += -DCONSOLE_ENABLE
+    TMK_COMMON_SRC += $(COMMON_DIR)/console.c
 else
     TMK_COMMON_DEFS += -DNO_PRINT
     TMK_COMMON_DEFS += -DNO_DEBUG
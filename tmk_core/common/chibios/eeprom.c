@@ -2,6 +2,7 @@
 #include "hal.h"
 
 #include "eeconfig.h"
+#include "eeprom.h"
 
 /*************************************/
 /*          Hardware backend         */
@@ -603,30 +604,38 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len) {
 }
 
 #endif /* chip selection */
-// The update functions just calls write for now, but could probably be optimized
+
+#if EEPROM_SIZE != EEPROM_BYTE_COUNT
+#  error "EEPROM_BYTE_COUNT in eeprom.h doesn't match this chip"
+#endif
+// The update functions only write the bytes that change, every write of the
+// Teensy LC emulation takes a new slot of the flash log even if the value is
+// the same, and the log has to be erased and rewritten when it is full.
 
 void eeprom_update_byte(uint8_t *addr, uint8_t value) {
-	eeprom_write_byte(addr, value);
+	if (eeprom_read_byte(addr) != value) {
+		eeprom_write_byte(addr, value);
+	}
 }
 
 void eeprom_update_word(uint16_t *addr, uint16_t value) {
 	uint8_t *p = (uint8_t *)addr;
-	eeprom_write_byte(p++, value);
-	eeprom_write_byte(p, value >> 8);
+	eeprom_update_byte(p++, value);
+	eeprom_update_byte(p, value >> 8);
 }
 
 void eeprom_update_dword(uint32_t *addr, uint32_t value) {
 	uint8_t *p = (uint8_t *)addr;
-	eeprom_write_byte(p++, value);
-	eeprom_write_byte(p++, value >> 8);
-	eeprom_write_byte(p++, value >> 16);
-	eeprom_write_byte(p, value >> 24);
+	eeprom_update_byte(p++, value);
+	eeprom_update_byte(p++, value >> 8);
+	eeprom_update_byte(p++, value >> 16);
+	eeprom_update_byte(p, value >> 24);
 }
 
 void eeprom_update_block(const void *buf, void *addr, uint32_t len) {
 	uint8_t *p = (uint8_t *)addr;
 	const uint8_t *src = (const uint8_t *)buf;
 	while (len--) {
-		eeprom_write_byte(p++, *src++);
+		eeprom_update_byte(p++, *src++);
 	}
 }
@@ -10,6 +10,7 @@
 #include "host.h"
 #include "backlight.h"
 #include "suspend.h"
+#include "eeconfig.h"
 #include "wait.h"
 
 /** \brief suspend idle
@@ -26,6 +27,8 @@ void suspend_idle(uint8_t time) {
  * FIXME: needs doc
  */
 void suspend_power_down(void) {
+	eeconfig_flush();
+
 	// TODO: figure out what to power down and how
 	// shouldn't power down TPM/FTM if we want a breathing LED
 	// also shouldn't power down USB
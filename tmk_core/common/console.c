@@ -0,0 +1,130 @@
+#include <string.h>
+#include "console.h"
+#include "timer.h"
+
+/*
+ * print and xprintf write into this buffer and return right away. The USB
+ * driver sends it from its main loop task in whole packets, so debug output
+ * no longer waits up to 5ms per character for the host.
+ */
+static uint8_t buffer[CONSOLE_BUFFER_SIZE];
+static uint8_t tail = 0;
+static uint8_t count = 0;
+static uint16_t overflows = 0;
+// when the oldest byte that hasn't been sent was queued
+static uint16_t pending_since;
+
+// taken out of the buffer, until the driver has sent it
+static uint8_t packet[CONSOLE_PACKET_SIZE];
+static uint8_t packet_length = 0;
+
+_Static_assert((CONSOLE_BUFFER_SIZE & (CONSOLE_BUFFER_SIZE - 1)) == 0, "CONSOLE_BUFFER_SIZE must be a power of two");
+_Static_assert(CONSOLE_BUFFER_SIZE <= 128, "count is a byte");
+
+#define WRAP(i) ((i) & (CONSOLE_BUFFER_SIZE - 1))
+
+// The LUFA USB events print from the USB interrupt
+#ifdef __AVR__
+#  include <util/atomic.h>
+#  define CONSOLE_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#  define CONSOLE_ATOMIC
+#endif
+
+/** \brief Console Put Char
+ *
+ * Queues a byte, dropping the newest or oldest output when full
+ */
+int8_t console_putc(uint8_t c)
+{
+    int8_t result = 0;
+
+    CONSOLE_ATOMIC {
+        if (count == CONSOLE_BUFFER_SIZE) {
+            if (overflows < UINT16_MAX) {
+                overflows++;
+            }
+#ifdef CONSOLE_DROP_OLDEST
+            tail = WRAP(tail + 1);
+            count--;
+#else
+            result = -1;
+#endif
+        }
+        if (result == 0) {
+            if (count == 0) {
+                pending_since = timer_read();
+            }
+            buffer[WRAP(tail + count)] = c;
+            count++;
+        }
+    }
+    return result;
+}
+
+// Moves the next packet out of the buffer, if it is full or has waited long enough
+static void take_packet(void)
+{
+    CONSOLE_ATOMIC {
+        if (count >= CONSOLE_PACKET_SIZE || (count && timer_elapsed(pending_since) >= CONSOLE_FLUSH_DELAY)) {
+            packet_length = count < CONSOLE_PACKET_SIZE ? count : CONSOLE_PACKET_SIZE;
+            for (uint8_t i = 0; i < packet_length; i++) {
+                packet[i] = buffer[WRAP(tail + i)];
+            }
+            tail = WRAP(tail + packet_length);
+            count -= packet_length;
+        }
+    }
+    if (packet_length) {
+        memset(&packet[packet_length], 0, CONSOLE_PACKET_SIZE - packet_length);
+    }
+}
+
+/** \brief Console Flush
+ *
+ * Sends every full packet, and what is left once it has waited
+ * CONSOLE_FLUSH_DELAY ms, until the driver is busy
+ */
+void console_flush(void)
+{
+    while (true) {
+        if (!packet_length) {
+            take_packet();
+            if (!packet_length) {
+                return;
+            }
+        }
+
+        uint8_t sent = console_send_packet(packet, packet_length);
+        if (!sent) {
+            return;
+        }
+        if (sent < packet_length) {
+            memmove(packet, &packet[sent], packet_length - sent);
+            packet_length -= sent;
+            memset(&packet[packet_length], 0, CONSOLE_PACKET_SIZE - packet_length);
+        } else {
+            packet_length = 0;
+        }
+    }
+}
+
+uint8_t console_pending(void)
+{
+    uint8_t pending;
+
+    CONSOLE_ATOMIC {
+        pending = count + packet_length;
+    }
+    return pending;
+}
+
+uint16_t console_overflow_count(void)
+{
+    uint16_t result;
+
+    CONSOLE_ATOMIC {
+        result = overflows;
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Bytes of print output waiting for the host, a power of two */
+#ifndef CONSOLE_BUFFER_SIZE
+#define CONSOLE_BUFFER_SIZE 128
+#endif
+
+/* Console endpoint size, CONSOLE_EPSIZE */
+#ifndef CONSOLE_PACKET_SIZE
+#define CONSOLE_PACKET_SIZE 32
+#endif
+
+/* ms a partly filled packet waits for more output before it is sent */
+#ifndef CONSOLE_FLUSH_DELAY
+#define CONSOLE_FLUSH_DELAY 10
+#endif
+
+/* When the buffer is full the new output is dropped, or with
+ * CONSOLE_DROP_OLDEST defined the oldest output makes room for it */
+
+/* The sendchar() of the USB drivers, queues c and never waits */
+int8_t console_putc(uint8_t c);
+
+/* Sends the queued output in packets, called from the USB driver's main
+ * loop task */
+void console_flush(void);
+
+/* Bytes queued */
+uint8_t console_pending(void);
+
+/* Bytes dropped because the buffer was full */
+uint16_t console_overflow_count(void);
+
+/* Implemented by the USB driver: sends one CONSOLE_PACKET_SIZE packet, zero
+ * padded after length, and returns how many bytes it took, 0 while the
+ * endpoint is busy */
+uint8_t console_send_packet(const uint8_t *packet, uint8_t length);
+
+#endif
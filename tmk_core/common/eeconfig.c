@@ -2,6 +2,142 @@
 #include <stdbool.h>
 #include "eeprom.h"
 #include "eeconfig.h"
+#include "timer.h"
+
+/*
+ * The settings are read into RAM once and changed there. Changed bytes are
+ * written back once nothing has changed for EECONFIG_FLUSH_DELAY ms, or on
+ * eeconfig_flush(), so holding a key that steps the RGB hue writes the final
+ * hue once instead of every step (an AVR EEPROM write takes ~3.3ms per byte).
+ */
+static uint8_t shadow[EECONFIG_SIZE];
+static uint16_t dirty = 0;
+static bool loaded = false;
+static uint16_t last_change;
+static eeconfig_stats_t stats;
+
+_Static_assert(EECONFIG_SIZE <= 16, "dirty has one bit per byte");
+
+static void load(void)
+{
+    if (!loaded) {
+        eeprom_read_block(shadow, (const void *)0, EECONFIG_SIZE);
+        loaded = true;
+    }
+}
+
+/** \brief eeconfig read byte
+ *
+ * Reads a byte of the settings, including changes that aren't written yet.
+ */
+uint8_t eeconfig_read_byte(const uint8_t *addr)
+{
+    uintptr_t offset = (uintptr_t)addr;
+
+    if (offset >= EECONFIG_SIZE) {
+        return eeprom_read_byte(addr);
+    }
+    load();
+    return shadow[offset];
+}
+
+/** \brief eeconfig update byte
+ *
+ * Changes a byte of the settings, it is written to the EEPROM later.
+ */
+void eeconfig_update_byte(uint8_t *addr, uint8_t val)
+{
+    uintptr_t offset = (uintptr_t)addr;
+
+    if (offset >= EECONFIG_SIZE) {
+        eeprom_update_byte(addr, val);
+        return;
+    }
+    load();
+    if (shadow[offset] == val) {
+        return;
+    }
+    if (dirty & (1 << offset)) {
+        stats.writes_avoided++;
+    }
+    shadow[offset] = val;
+    dirty |= 1 << offset;
+    last_change = timer_read();
+#if EECONFIG_FLUSH_DELAY == 0
+    eeconfig_flush();
+#endif
+}
+
+static void update_word(uint16_t *addr, uint16_t val)
+{
+    uint8_t *p = (uint8_t *)addr;
+    eeconfig_update_byte(p, val);
+    eeconfig_update_byte(p + 1, val >> 8);
+}
+
+/** \brief eeconfig read dword
+ *
+ * Reads a little endian dword of the settings, including changes that aren't written yet.
+ */
+uint32_t eeconfig_read_dword(const uint32_t *addr)
+{
+    const uint8_t *p = (const uint8_t *)addr;
+    return eeconfig_read_byte(p) | ((uint32_t)eeconfig_read_byte(p + 1) << 8)
+        | ((uint32_t)eeconfig_read_byte(p + 2) << 16) | ((uint32_t)eeconfig_read_byte(p + 3) << 24);
+}
+
+/** \brief eeconfig update dword
+ *
+ * Changes a little endian dword of the settings, byte by byte, it is written to the EEPROM later.
+ */
+void eeconfig_update_dword(uint32_t *addr, uint32_t val)
+{
+    uint8_t *p = (uint8_t *)addr;
+    for (uint8_t i = 0; i < 4; i++) {
+        eeconfig_update_byte(p + i, val >> (8 * i));
+    }
+}
+
+/** \brief eeconfig flush
+ *
+ * Writes every changed byte now, before a reset or when going to sleep.
+ */
+void eeconfig_flush(void)
+{
+    for (uint8_t i = 0; dirty; i++) {
+        if (dirty & (1 << i)) {
+            uint8_t *addr = (uint8_t *)(uintptr_t)i;
+            if (eeprom_read_byte(addr) == shadow[i]) {
+                // changed and changed back
+                stats.writes_avoided++;
+            } else {
+                eeprom_write_byte(addr, shadow[i]);
+                stats.writes++;
+            }
+            dirty &= ~(1 << i);
+        }
+    }
+}
+
+/** \brief eeconfig task
+ *
+ * Writes the changed bytes once the settings stopped changing.
+ */
+void eeconfig_task(void)
+{
+    if (dirty && timer_elapsed(last_change) >= EECONFIG_FLUSH_DELAY) {
+        eeconfig_flush();
+    }
+}
+
+/** \brief eeconfig stats
+ *
+ * Copies the counts of bytes written and of writes avoided since power on.
+ */
+void eeconfig_stats(eeconfig_stats_t *out)
+{
+    *out = stats;
+}
 
 /** \brief eeconfig initialization
  *
@@ -9,23 +145,27 @@
  */
 void eeconfig_init(void)
 {
-    eeprom_update_word(EECONFIG_MAGIC,          EECONFIG_MAGIC_NUMBER);
-    eeprom_update_byte(EECONFIG_DEBUG,          0);
-    eeprom_update_byte(EECONFIG_DEFAULT_LAYER,  0);
-    eeprom_update_byte(EECONFIG_KEYMAP,         0);
-    eeprom_update_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
+    // start over from what is in the EEPROM
+    dirty = 0;
+    loaded = false;
+    update_word(EECONFIG_MAGIC,                  EECONFIG_MAGIC_NUMBER);
+    eeconfig_update_byte(EECONFIG_DEBUG,          0);
+    eeconfig_update_byte(EECONFIG_DEFAULT_LAYER,  0);
+    eeconfig_update_byte(EECONFIG_KEYMAP,         0);
+    eeconfig_update_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
 #ifdef BACKLIGHT_ENABLE
-    eeprom_update_byte(EECONFIG_BACKLIGHT,      0);
+    eeconfig_update_byte(EECONFIG_BACKLIGHT,      0);
 #endif
 #ifdef AUDIO_ENABLE
-    eeprom_update_byte(EECONFIG_AUDIO,             0xFF); // On by default
+    eeconfig_update_byte(EECONFIG_AUDIO,             0xFF); // On by default
 #endif
 #ifdef RGBLIGHT_ENABLE
-    eeprom_update_dword(EECONFIG_RGBLIGHT,      0);
+    eeconfig_update_dword(EECONFIG_RGBLIGHT,      0);
 #endif
 #ifdef STENO_ENABLE
-    eeprom_update_byte(EECONFIG_STENOMODE,      0);
+    eeconfig_update_byte(EECONFIG_STENOMODE,      0);
 #endif
+    eeconfig_flush();
 }
 
 /** \brief eeconfig enable
@@ -34,7 +174,8 @@ void eeconfig_init(void)
  */
 void eeconfig_enable(void)
 {
-    eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
+    update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER);
+    eeconfig_flush();
 }
 
 /** \brief eeconfig disable
@@ -43,7 +184,8 @@ void eeconfig_enable(void)
  */
 void eeconfig_disable(void)
 {
-    eeprom_update_word(EECONFIG_MAGIC, 0xFFFF);
+    update_word(EECONFIG_MAGIC, 0xFFFF);
+    eeconfig_flush();
 }
 
 /** \brief eeconfig is enabled
@@ -52,53 +194,54 @@ void eeconfig_disable(void)
  */
 bool eeconfig_is_enabled(void)
 {
-    return (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER);
+    const uint8_t *magic = (const uint8_t *)EECONFIG_MAGIC;
+    return (eeconfig_read_byte(magic) | (eeconfig_read_byte(magic + 1) << 8)) == EECONFIG_MAGIC_NUMBER;
 }
 
 /** \brief eeconfig read debug
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_debug(void)      { return eeprom_read_byte(EECONFIG_DEBUG); }
+uint8_t eeconfig_read_debug(void)      { return eeconfig_read_byte(EECONFIG_DEBUG); }
 /** \brief eeconfig update debug
  *
  * FIXME: needs doc
  */
-void eeconfig_update_debug(uint8_t val) { eeprom_update_byte(EECONFIG_DEBUG, val); }
+void eeconfig_update_debug(uint8_t val) { eeconfig_update_byte(EECONFIG_DEBUG, val); }
 
 /** \brief eeconfig read default layer
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_default_layer(void)      { return eeprom_read_byte(EECONFIG_DEFAULT_LAYER); }
+uint8_t eeconfig_read_default_layer(void)      { return eeconfig_read_byte(EECONFIG_DEFAULT_LAYER); }
 /** \brief eeconfig update default layer
  *
  * FIXME: needs doc
  */
-void eeconfig_update_default_layer(uint8_t val) { eeprom_update_byte(EECONFIG_DEFAULT_LAYER, val); }
+void eeconfig_update_default_layer(uint8_t val) { eeconfig_update_byte(EECONFIG_DEFAULT_LAYER, val); }
 
 /** \brief eeconfig read keymap
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_keymap(void)      { return eeprom_read_byte(EECONFIG_KEYMAP); }
+uint8_t eeconfig_read_keymap(void)      { return eeconfig_read_byte(EECONFIG_KEYMAP); }
 /** \brief eeconfig update keymap
  *
  * FIXME: needs doc
  */
-void eeconfig_update_keymap(uint8_t val) { eeprom_update_byte(EECONFIG_KEYMAP, val); }
+void eeconfig_update_keymap(uint8_t val) { eeconfig_update_byte(EECONFIG_KEYMAP, val); }
 
 #ifdef BACKLIGHT_ENABLE
 /** \brief eeconfig read backlight
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_backlight(void)      { return eeprom_read_byte(EECONFIG_BACKLIGHT); }
+uint8_t eeconfig_read_backlight(void)      { return eeconfig_read_byte(EECONFIG_BACKLIGHT); }
 /** \brief eeconfig update backlight
  *
  * FIXME: needs doc
  */
-void eeconfig_update_backlight(uint8_t val) { eeprom_update_byte(EECONFIG_BACKLIGHT, val); }
+void eeconfig_update_backlight(uint8_t val) { eeconfig_update_byte(EECONFIG_BACKLIGHT, val); }
 #endif
 
 #ifdef AUDIO_ENABLE
@@ -106,10 +249,10 @@ void eeconfig_update_backlight(uint8_t val) { eeprom_update_byte(EECONFIG_BACKLI
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_audio(void)      { return eeprom_read_byte(EECONFIG_AUDIO); }
+uint8_t eeconfig_read_audio(void)      { return eeconfig_read_byte(EECONFIG_AUDIO); }
 /** \brief eeconfig update audio
  *
  * FIXME: needs doc
  */
-void eeconfig_update_audio(uint8_t val) { eeprom_update_byte(EECONFIG_AUDIO, val); }
+void eeconfig_update_audio(uint8_t val) { eeconfig_update_byte(EECONFIG_AUDIO, val); }
 #endif
@@ -38,6 +38,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // EEHANDS for two handed boards
 #define EECONFIG_HANDEDNESS         				(uint8_t *)14
 
+/* bytes kept in RAM and written back lazily */
+#define EECONFIG_SIZE                               15
+
+/* ms without changes before the settings are written, 0 writes right away */
+#ifndef EECONFIG_FLUSH_DELAY
+#define EECONFIG_FLUSH_DELAY                        1000
+#endif
+
 
 /* debug bit */
 #define EECONFIG_DEBUG_ENABLE                       (1<<0)
@@ -56,6 +64,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_KEYMAP_NKRO                        (1<<7)
 
 
+typedef struct {
+    uint16_t writes;            // bytes written to the EEPROM
+    uint16_t writes_avoided;    // byte changes that never had to be written
+} eeconfig_stats_t;
+
 bool eeconfig_is_enabled(void);
 
 void eeconfig_init(void);
@@ -83,4 +96,13 @@ uint8_t eeconfig_read_audio(void);
 void eeconfig_update_audio(uint8_t val);
 #endif
 
+uint8_t eeconfig_read_byte(const uint8_t *addr);
+void eeconfig_update_byte(uint8_t *addr, uint8_t val);
+uint32_t eeconfig_read_dword(const uint32_t *addr);
+void eeconfig_update_dword(uint32_t *addr, uint32_t val);
+
+void eeconfig_task(void);
+void eeconfig_flush(void);
+void eeconfig_stats(eeconfig_stats_t *stats);
+
 #endif
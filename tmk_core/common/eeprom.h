@@ -3,9 +3,23 @@
 
 #if defined(__AVR__)
 #include <avr/eeprom.h>
+
+#define EEPROM_BYTE_COUNT (E2END + 1)
 #else
 #include <stdint.h>
 
+/* Size of the emulated EEPROM, EEPROM_SIZE in chibios/eeprom.c */
+#if defined(PROTOCOL_CHIBIOS)
+#include "hal.h"
+#endif
+#if defined(KL2x)
+#define EEPROM_BYTE_COUNT 128
+#elif defined(PROTOCOL_CHIBIOS) || defined(__arm__)
+#define EEPROM_BYTE_COUNT 32
+#else  /* unit tests, as much as an ATmega32U4 */
+#define EEPROM_BYTE_COUNT 1024
+#endif
+
 uint8_t 	eeprom_read_byte (const uint8_t *__p);
 uint16_t 	eeprom_read_word (const uint16_t *__p);
 uint32_t 	eeprom_read_dword (const uint32_t *__p);
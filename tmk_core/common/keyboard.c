@@ -68,6 +68,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 #ifdef MIDI_ENABLE
 #   include "process_midi.h"
+#   include "midi_queue.h"
 #endif
 
 #ifdef MATRIX_HAS_GHOST
@@ -289,8 +290,12 @@ MATRIX_LOOP_END:
 
 #ifdef MIDI_ENABLE
     midi_task();
+    midi_queue_flush();
 #endif
 
+    // write back changed settings
+    eeconfig_task();
+
     // update LED
     if (led_status != host_keyboard_leds()) {
         led_status = host_keyboard_leds();
@@ -46,8 +46,13 @@ uint8_t mk_interval = MOUSEKEY_INTERVAL;
 uint8_t mk_max_speed = MOUSEKEY_MAX_SPEED;
 /* number of events (count) accelerating to steady speed (0-255) */
 uint8_t mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
+#ifdef MOUSEKEY_CURVE
+/* ramp used to reach maximum pointer speed (MK_CURVE_*) */
+uint8_t mk_curve = MOUSEKEY_CURVE;
+#else
 /* ramp used to reach maximum pointer speed (NOT SUPPORTED) */
 //int8_t mk_curve = 0;
+#endif
 /* wheel params */
 uint8_t mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
 uint8_t mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
@@ -102,6 +107,102 @@ static uint8_t wheel_unit(void)
     return (unit > MOUSEKEY_WHEEL_MAX ? MOUSEKEY_WHEEL_MAX : (unit == 0 ? 1 : unit));
 }
 
+#ifdef MOUSEKEY_CURVE
+/*
+ * Time based movement
+ *
+ *  The speed is integrated over the time since the last report, the part
+ *  of a unit that isn't sent yet is carried to the next one, in 1/1000.
+ */
+static uint32_t motion_start = 0;
+static uint32_t last_step = 0;
+static uint32_t move_carry = 0;
+static uint32_t wheel_carry = 0;
+
+/* units per second, t ms after the delay */
+static uint32_t curve_speed(uint32_t t, uint8_t delta, uint8_t max_speed, uint8_t time_to_max)
+{
+    uint8_t interval = mk_interval ? mk_interval : 1;
+    uint32_t initial = (uint32_t)delta * 1000 / interval;
+    uint32_t max = initial * max_speed;
+    uint32_t ramp = (uint32_t)time_to_max * interval;
+    uint32_t progress;
+
+    if (mousekey_accel & (1<<0)) return max / 4;
+    if (mousekey_accel & (1<<1)) return max / 2;
+    if (mousekey_accel & (1<<2)) return max;
+    if (mk_curve == MK_CURVE_CONSTANT || t >= ramp || max <= initial) return max;
+
+    /* 0-256 along the ramp, rounded so the error doesn't add up over it */
+    progress = ((t << 8) + ramp/2) / ramp;
+    if (mk_curve == MK_CURVE_QUADRATIC) {
+        progress = (progress * progress + 128) >> 8;
+    }
+    return initial + (((max - initial) * progress + 128) >> 8);
+}
+
+/* whole units out of the carry, what doesn't fit in a report stays */
+static uint8_t take_units(uint32_t *carry, uint8_t max)
+{
+    uint32_t units = *carry / 1000;
+    if (units > max) units = max;
+    *carry -= units * 1000;
+    return units;
+}
+
+static int8_t with_sign(int8_t direction, uint8_t units)
+{
+    return direction > 0 ? units : (direction < 0 ? -units : 0);
+}
+
+void mousekey_task(void)
+{
+    report_mouse_t report = mouse_report;
+    uint32_t now = timer_read32();
+    uint32_t start = motion_start + mk_delay*10;
+    uint32_t dt, t;
+    uint8_t move, wheel;
+
+    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
+        return;
+
+    if (TIMER_DIFF_32(now, motion_start) < (uint32_t)mk_delay*10)
+        return;
+
+    if (timer_elapsed(last_timer) < MOUSEKEY_REPORT_INTERVAL)
+        return;
+
+    /* speed at the middle of the step, which is exact for a straight ramp */
+    if (TIMER_DIFF_32(last_step, start) > TIMER_DIFF_32(now, start))
+        last_step = start;
+    dt = TIMER_DIFF_32(now, last_step);
+    t = TIMER_DIFF_32(last_step, start) + dt/2;
+    last_step = now;
+
+    if (mouse_report.x || mouse_report.y) {
+        uint32_t speed = curve_speed(t, MOUSEKEY_MOVE_DELTA, mk_max_speed, mk_time_to_max);
+        /* diagonal move [1/sqrt(2)] */
+        if (mouse_report.x && mouse_report.y)
+            speed = (speed * 181) >> 8;
+        move_carry += speed * dt;
+    }
+    if (mouse_report.v || mouse_report.h) {
+        wheel_carry += (uint32_t)curve_speed(t, MOUSEKEY_WHEEL_DELTA, mk_wheel_max_speed, mk_wheel_time_to_max) * dt;
+    }
+
+    move = take_units(&move_carry, MOUSEKEY_MOVE_MAX);
+    wheel = take_units(&wheel_carry, MOUSEKEY_WHEEL_MAX);
+    if (move == 0 && wheel == 0)
+        return;
+
+    report.x = with_sign(mouse_report.x, move);
+    report.y = with_sign(mouse_report.y, move);
+    report.v = with_sign(mouse_report.v, wheel);
+    report.h = with_sign(mouse_report.h, wheel);
+    host_mouse_send(&report);
+    last_timer = timer_read();
+}
+#else
 void mousekey_task(void)
 {
     if (timer_elapsed(last_timer) < (mousekey_repeat ? mk_interval : mk_delay*10))
@@ -132,9 +233,19 @@ void mousekey_task(void)
 
     mousekey_send();
 }
+#endif
 
 void mousekey_on(uint8_t code)
 {
+#ifdef MOUSEKEY_CURVE
+    if ((IS_MOUSEKEY_MOVE(code) || IS_MOUSEKEY_WHEEL(code)) &&
+        mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0) {
+        motion_start = timer_read32();
+        last_step = motion_start;
+        move_carry = 0;
+        wheel_carry = 0;
+    }
+#endif
     if      (code == KC_MS_UP)       mouse_report.y = move_unit() * -1;
     else if (code == KC_MS_DOWN)     mouse_report.y = move_unit();
     else if (code == KC_MS_LEFT)     mouse_report.x = move_unit() * -1;
@@ -60,6 +60,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MOUSEKEY_WHEEL_TIME_TO_MAX 40
 #endif
 
+/* Time based movement, defining MOUSEKEY_CURVE replaces the fixed steps sent
+ * every MOUSEKEY_INTERVAL with a speed that follows the curve over the time
+ * the key is held. Speeds stay in the units above: MOUSEKEY_MOVE_DELTA per
+ * MOUSEKEY_INTERVAL to start with, MOUSEKEY_MAX_SPEED times that after
+ * MOUSEKEY_TIME_TO_MAX intervals. */
+#define MK_CURVE_LINEAR     0
+#define MK_CURVE_QUADRATIC  1
+#define MK_CURVE_CONSTANT   2
+
+#ifdef MOUSEKEY_CURVE
+/* at most one report per poll of the mouse endpoint */
+#ifndef MOUSEKEY_REPORT_INTERVAL
+#define MOUSEKEY_REPORT_INTERVAL 10
+#endif
+#endif
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -71,6 +87,9 @@ extern uint8_t mk_max_speed;
 extern uint8_t mk_time_to_max;
 extern uint8_t mk_wheel_max_speed;
 extern uint8_t mk_wheel_time_to_max;
+#ifdef MOUSEKEY_CURVE
+extern uint8_t mk_curve;
+#endif
 
 
 void mousekey_task(void);
@@ -8,6 +8,17 @@
 #   define pgm_read_byte(p)     *((unsigned char*)p)
 #   define pgm_read_word(p)     *((uint16_t*)p)
 #   define pgm_read_dword(p)    *((uint32_t*)p)
+#   define pgm_read_float(p)    *((float*)p)
+#   define PGM_P                const char *
+#   ifndef PSTR
+#       define PSTR(x) x
+#   endif
+#   ifndef memcpy_P
+#       define memcpy_P(dest, src, n)   memcpy(dest, src, n)
+#   endif
+#   define strcpy_P(dest, src)  strcpy(dest, src)
+#   define strcmp_P(s1, s2)     strcmp(s1, s2)
+#   define strlen_P(s)          strlen(s)
 #endif
 
 #endif
@@ -5,4 +5,7 @@ void raw_hid_receive( uint8_t *data, uint8_t length );
 
 void raw_hid_send( uint8_t *data, uint8_t length );
 
+/* Packets the dynamic keymap or raw API don't handle end up here */
+void raw_hid_receive_kb( uint8_t *data, uint8_t length );
+
 #endif
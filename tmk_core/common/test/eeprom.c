@@ -16,12 +16,16 @@
 
 #include "eeprom.h"
 
-#define EEPROM_SIZE 32
+#define EEPROM_SIZE EEPROM_BYTE_COUNT
 
 static uint8_t buffer[EEPROM_SIZE];
 
+// Bytes read so far, for tests that check what is cached
+uint32_t eeprom_test_reads = 0;
+
 uint8_t eeprom_read_byte(const uint8_t *addr) {
 	uintptr_t offset = (uintptr_t)addr;
+	eeprom_test_reads++;
 	return buffer[offset];
 }
 
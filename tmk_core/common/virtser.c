@@ -0,0 +1,75 @@
+#include "virtser.h"
+
+/*
+ * Bytes are queued here and sent from virtser_task(), so a steno chord goes
+ * out as one USB packet instead of one packet, and one wait for the host,
+ * per byte.
+ */
+static uint8_t tx_buffer[VIRTSER_TX_BUFFER_SIZE];
+static uint8_t tx_tail = 0;
+static uint8_t tx_count = 0;
+// The last packet was full, the host keeps waiting until a short one follows
+static bool tx_end_transfer = false;
+
+_Static_assert((VIRTSER_TX_BUFFER_SIZE & (VIRTSER_TX_BUFFER_SIZE - 1)) == 0, "VIRTSER_TX_BUFFER_SIZE must be a power of two");
+_Static_assert(VIRTSER_TX_BUFFER_SIZE <= 128, "tx_count is a byte");
+
+/** \brief Virtual Serial Send
+ *
+ * Queues one byte, see virtser_send_buf()
+ */
+void virtser_send(const uint8_t byte)
+{
+    virtser_send_buf(&byte, 1);
+}
+
+/** \brief Virtual Serial Send Buffer
+ *
+ * Queues a frame, or nothing if the host isn't keeping up
+ */
+bool virtser_send_buf(const uint8_t *data, uint8_t length)
+{
+    if (length > VIRTSER_TX_BUFFER_SIZE - tx_count) {
+        virtser_flush();
+        if (length > VIRTSER_TX_BUFFER_SIZE - tx_count) {
+            return false;
+        }
+    }
+
+    uint8_t head = tx_tail + tx_count;
+    for (uint8_t i = 0; i < length; i++) {
+        tx_buffer[(head + i) & (VIRTSER_TX_BUFFER_SIZE - 1)] = data[i];
+    }
+    tx_count += length;
+    return true;
+}
+
+/** \brief Virtual Serial Flush
+ *
+ * Hands the queued bytes to the USB driver a packet at a time until it is
+ * busy. Whatever it doesn't take stays for the next call. Once everything
+ * is sent, a transfer that ended on a full packet gets an empty one.
+ */
+void virtser_flush(void)
+{
+    uint8_t packet[VIRTSER_PACKET_SIZE];
+
+    while (tx_count) {
+        uint8_t length = tx_count < VIRTSER_PACKET_SIZE ? tx_count : VIRTSER_PACKET_SIZE;
+        for (uint8_t i = 0; i < length; i++) {
+            packet[i] = tx_buffer[(tx_tail + i) & (VIRTSER_TX_BUFFER_SIZE - 1)];
+        }
+
+        uint8_t sent = virtser_send_packet(packet, length);
+        if (!sent) {
+            return;
+        }
+        tx_tail = (tx_tail + sent) & (VIRTSER_TX_BUFFER_SIZE - 1);
+        tx_count -= sent;
+        tx_end_transfer = sent == VIRTSER_PACKET_SIZE;
+    }
+
+    if (tx_end_transfer && virtser_send_packet(packet, 0)) {
+        tx_end_transfer = false;
+    }
+}
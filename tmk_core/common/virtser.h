@@ -1,10 +1,36 @@
 #ifndef _VIRTSER_H_
 #define _VIRTSER_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Bytes waiting to go to the host, a power of two */
+#ifndef VIRTSER_TX_BUFFER_SIZE
+#define VIRTSER_TX_BUFFER_SIZE 64
+#endif
+
+/* Largest USB packet, CDC_EPSIZE */
+#ifndef VIRTSER_PACKET_SIZE
+#define VIRTSER_PACKET_SIZE 16
+#endif
+
 /* Define this function in your code to process incoming bytes */
 void virtser_recv(const uint8_t ch);
 
 /* Call this to send a character over the Virtual Serial Device */
 void virtser_send(const uint8_t byte);
 
+/* Queues a whole frame, it goes out in as few packets as possible on the
+ * next virtser_task(). Returns false and drops the frame if it doesn't fit. */
+bool virtser_send_buf(const uint8_t *data, uint8_t length);
+
+/* Sends what is queued, called from virtser_task() */
+void virtser_flush(void);
+
+/* Implemented by the USB driver: sends up to length bytes as one packet and
+ * returns how many it took, 0 if the endpoint is still busy. A length of 0
+ * sends an empty packet, which ends a transfer that ended on a full packet,
+ * and returns 1 once it is sent. */
+uint8_t virtser_send_packet(const uint8_t *data, uint8_t length);
+
 #endif
@@ -36,6 +36,18 @@
   extern keymap_config_t keymap_config;
 #endif
 
+#ifdef VIRTSER_ENABLE
+  #include "virtser.h"
+#endif
+
+#ifdef CONSOLE_ENABLE
+  #include "console.h"
+#endif
+
+#ifdef MIDI_ENABLE
+  #include "midi_queue.h"
+#endif
+
 /* ---------------------------------------------------------
  *       Global interface variables and declarations
  * ---------------------------------------------------------
@@ -787,10 +799,27 @@ void send_consumer(uint16_t data) {
 
 #ifdef CONSOLE_ENABLE
 
+// Queued and sent from console_task(), see console.h
 int8_t sendchar(uint8_t c) {
-  // The previous implmentation had timeouts, but I think it's better to just slow down
-  // and make sure that everything is transferred, rather than dropping stuff
-  return chnWrite(&drivers.console_driver.driver, &c, 1);
+  return console_putc(c);
+}
+
+// Takes a packet if the output queue has a free buffer for it, never waits.
+// A packet goes in whole or not at all: after a partial write the padding
+// of this packet would end up in the middle of the next one.
+uint8_t console_send_packet(const uint8_t *packet, uint8_t length) {
+  SerialUSBDriver *driver = &drivers.console_driver.driver;
+  bool full;
+
+  osalSysLock();
+  full = obqIsFullI(&driver->obqueue);
+  osalSysUnlock();
+  if (full) {
+    return 0;
+  }
+  // The USB interrupt only frees buffers, so this fits in the one we saw
+  chnWriteTimeout(driver, packet, CONSOLE_EPSIZE, TIME_IMMEDIATE);
+  return length;
 }
 
 // Just a dummy function for now, this could be exposed as a weak function
@@ -809,6 +838,7 @@ void console_task(void) {
         console_receive(buffer, size);
     }
   } while(size > 0);
+  console_flush();
 }
 
 #else /* CONSOLE_ENABLE */
@@ -856,8 +886,10 @@ void raw_hid_task(void) {
 
 #ifdef MIDI_ENABLE
 
-void send_midi_packet(MIDI_EventPacket_t* event) {
-  chnWrite(&drivers.midi_driver.driver, (uint8_t*)event, sizeof(MIDI_EventPacket_t));
+// Takes what fits in the output queue. Its buffers are MIDI_STREAM_EPSIZE,
+// a multiple of the packet size, so only whole packets are taken.
+uint8_t midi_send_packets(const uint8_t *packets, uint8_t count) {
+  return chnWriteTimeout(&drivers.midi_driver.driver, packets, count * sizeof(MIDI_EventPacket_t), TIME_IMMEDIATE) / sizeof(MIDI_EventPacket_t);
 }
 
 bool recv_midi_packet(MIDI_EventPacket_t* const event) {
@@ -869,8 +901,13 @@ bool recv_midi_packet(MIDI_EventPacket_t* const event) {
 
 #ifdef VIRTSER_ENABLE
 
-void virtser_send(const uint8_t byte) {
-  chnWrite(&drivers.serial_driver.driver, &byte, 1);
+// Takes what fits in the output queue, the driver sends it at the next frame.
+// The serial driver ends transfers with empty packets itself.
+uint8_t virtser_send_packet(const uint8_t *data, uint8_t length) {
+  if (length == 0) {
+    return 1;
+  }
+  return chnWriteTimeout(&drivers.serial_driver.driver, data, length, TIME_IMMEDIATE);
 }
 
 __attribute__ ((weak))
@@ -888,6 +925,7 @@ void virtser_task(void) {
       virtser_recv(buffer[i]);
     }
   } while (numBytesReceived > 0);
+  virtser_flush();
 }
 
 #endif
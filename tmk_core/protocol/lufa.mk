@@ -29,7 +29,8 @@ ifeq ($(strip $(BLUETOOTH_ENABLE)), yes)
 endif
 
 ifeq ($(strip $(BLUETOOTH)), AdafruitBLE)
-		LUFA_SRC += $(LUFA_DIR)/adafruit_ble.cpp
+		LUFA_SRC += $(LUFA_DIR)/adafruit_ble.cpp \
+		$(LUFA_DIR)/adafruit_ble_spi.cpp
 endif
 
 ifeq ($(strip $(BLUETOOTH)), AdafruitEZKey)
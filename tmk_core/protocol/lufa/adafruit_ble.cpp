@@ -2,34 +2,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <alloca.h>
-#include <util/delay.h>
-#include <util/atomic.h>
 #include "debug.h"
-#include "pincontrol.h"
 #include "timer.h"
+#include "wait.h"
 #include "action_util.h"
 #include "ringbuffer.hpp"
+#include "adafruit_ble_spi.h"
 #include <string.h>
 
-// These are the pin assignments for the 32u4 boards.
-// You may define them to something else in your config.h
-// if yours is wired up differently.
-#ifndef AdafruitBleResetPin
-#define AdafruitBleResetPin D4
-#endif
-
-#ifndef AdafruitBleCSPin
-#define AdafruitBleCSPin    B4
-#endif
-
-#ifndef AdafruitBleIRQPin
-#define AdafruitBleIRQPin   E6
-#endif
-
-
 #define SAMPLE_BATTERY
 #define ConnectionUpdateInterval 1000 /* milliseconds */
 
+// Commands we send before reading their responses.  The module answers
+// SdepSlaveNotReady while it can't take any more, so this only bounds
+// how far behind the responses may fall.
+#ifndef AdafruitBleMaxInFlight
+#define AdafruitBleMaxInFlight 3
+#endif
+
 static struct {
   bool is_connected;
   bool initialized;
@@ -37,7 +27,7 @@ static struct {
 
 #define ProbedEvents 1
 #define UsingEvents 2
-  bool event_flags;
+  uint8_t event_flags;
 
 #ifdef SAMPLE_BATTERY
   uint16_t last_battery_update;
@@ -46,21 +36,6 @@ static struct {
   uint16_t last_connection_update;
 } state;
 
-// Commands are encoded using SDEP and sent via SPI
-// https://github.com/adafruit/Adafruit_BluefruitLE_nRF51/blob/master/SDEP.md
-
-#define SdepMaxPayload 16
-struct sdep_msg {
-  uint8_t type;
-  uint8_t cmd_low;
-  uint8_t cmd_high;
-  struct __attribute__((packed)) {
-    uint8_t len:7;
-    uint8_t more:1;
-  };
-  uint8_t payload[SdepMaxPayload];
-} __attribute__((packed));
-
 // The recv latency is relatively high, so when we're hammering keys quickly,
 // we want to avoid waiting for the responses in the matrix loop.  We maintain
 // a short queue for that.  Since there is quite a lot of space overhead for
@@ -71,7 +46,8 @@ enum queue_type {
   QTKeyReport, // 1-byte modifier + 6-byte key report
   QTConsumer,  // 16-bit key code
 #ifdef MOUSE_ENABLE
-  QTMouseMove, // 4-byte mouse report
+  QTMouseMove,    // 4-byte mouse report
+  QTMouseButtons, // 1-byte button state
 #endif
 };
 
@@ -87,29 +63,21 @@ struct queue_item {
     uint16_t consumer;
     struct __attribute__((packed)) {
       int8_t x, y, scroll, pan;
-      uint8_t buttons;
     } mousemove;
+    uint8_t mousebuttons;
   };
 };
 
 // Items that we wish to send
 static RingBuffer<queue_item, 40> send_buf;
-// Pending response; while pending, we can't send any more requests.
-// This records the time at which we sent the command for which we
+// Pending responses, oldest first; up to AdafruitBleMaxInFlight
+// commands go out back to back before we read what came back.
+// This records the time at which we sent each command for which we
 // are expecting a response.
-static RingBuffer<uint16_t, 2> resp_buf;
+static RingBuffer<uint16_t, AdafruitBleMaxInFlight + 1> resp_buf;
 
 static bool process_queue_item(struct queue_item *item, uint16_t timeout);
 
-enum sdep_type {
-  SdepCommand = 0x10,
-  SdepResponse = 0x20,
-  SdepAlert = 0x40,
-  SdepError = 0x80,
-  SdepSlaveNotReady = 0xfe, // Try again later
-  SdepSlaveOverflow = 0xff, // You read more data than is available
-};
-
 enum ble_cmd {
   BleInitialize = 0xbeef,
   BleAtWrapper = 0x0a00,
@@ -124,136 +92,19 @@ enum ble_system_event_bits {
   BleSystemMidiRx = 10,
 };
 
-// The SDEP.md file says 2MHz but the web page and the sample driver
-// both use 4MHz
-#define SpiBusSpeed 4000000
-
 #define SdepTimeout 150 /* milliseconds */
 #define SdepShortTimeout 10 /* milliseconds */
-#define SdepBackOff 25 /* microseconds */
-#define BatteryUpdateInterval 10000 /* milliseconds */
+
+// Reading the battery is a synchronous round trip, keep it rare
+#ifndef BatteryUpdateInterval
+#define BatteryUpdateInterval 60000 /* milliseconds */
+#endif
 
 static bool at_command(const char *cmd, char *resp, uint16_t resplen,
                        bool verbose, uint16_t timeout = SdepTimeout);
 static bool at_command_P(const char *cmd, char *resp, uint16_t resplen,
                          bool verbose = false);
 
-struct SPI_Settings {
-  uint8_t spcr, spsr;
-};
-
-static struct SPI_Settings spi;
-
-// Initialize 4Mhz MSBFIRST MODE0
-void SPI_init(struct SPI_Settings *spi) {
-  spi->spcr = _BV(SPE) | _BV(MSTR);
-  spi->spsr = _BV(SPI2X);
-
-  static_assert(SpiBusSpeed == F_CPU / 2, "hard coded at 4Mhz");
-
-  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-    // Ensure that SS is OUTPUT High
-    digitalWrite(B0, PinLevelHigh);
-    pinMode(B0, PinDirectionOutput);
-
-    SPCR |= _BV(MSTR);
-    SPCR |= _BV(SPE);
-    pinMode(B1 /* SCK */, PinDirectionOutput);
-    pinMode(B2 /* MOSI */, PinDirectionOutput);
-  }
-}
-
-static inline void SPI_begin(struct SPI_Settings*spi) {
-  SPCR = spi->spcr;
-  SPSR = spi->spsr;
-}
-
-static inline uint8_t SPI_TransferByte(uint8_t data) {
-  SPDR = data;
-  asm volatile("nop");
-  while (!(SPSR & _BV(SPIF))) {
-    ; // wait
-  }
-  return SPDR;
-}
-
-static inline void spi_send_bytes(const uint8_t *buf, uint8_t len) {
-  if (len == 0) return;
-  const uint8_t *end = buf + len;
-  while (buf < end) {
-    SPDR = *buf;
-    while (!(SPSR & _BV(SPIF))) {
-      ; // wait
-    }
-    ++buf;
-  }
-}
-
-static inline uint16_t spi_read_byte(void) {
-  return SPI_TransferByte(0x00 /* dummy */);
-}
-
-static inline void spi_recv_bytes(uint8_t *buf, uint8_t len) {
-  const uint8_t *end = buf + len;
-  if (len == 0) return;
-  while (buf < end) {
-    SPDR = 0; // write a dummy to initiate read
-    while (!(SPSR & _BV(SPIF))) {
-      ; // wait
-    }
-    *buf = SPDR;
-    ++buf;
-  }
-}
-
-#if 0
-static void dump_pkt(const struct sdep_msg *msg) {
-  print("pkt: type=");
-  print_hex8(msg->type);
-  print(" cmd=");
-  print_hex8(msg->cmd_high);
-  print_hex8(msg->cmd_low);
-  print(" len=");
-  print_hex8(msg->len);
-  print(" more=");
-  print_hex8(msg->more);
-  print("\n");
-}
-#endif
-
-// Send a single SDEP packet
-static bool sdep_send_pkt(const struct sdep_msg *msg, uint16_t timeout) {
-  SPI_begin(&spi);
-
-  digitalWrite(AdafruitBleCSPin, PinLevelLow);
-  uint16_t timerStart = timer_read();
-  bool success = false;
-  bool ready = false;
-
-  do {
-    ready = SPI_TransferByte(msg->type) != SdepSlaveNotReady;
-    if (ready) {
-      break;
-    }
-
-    // Release it and let it initialize
-    digitalWrite(AdafruitBleCSPin, PinLevelHigh);
-    _delay_us(SdepBackOff);
-    digitalWrite(AdafruitBleCSPin, PinLevelLow);
-  } while (timer_elapsed(timerStart) < timeout);
-
-  if (ready) {
-    // Slave is ready; send the rest of the packet
-    spi_send_bytes(&msg->cmd_low,
-                   sizeof(*msg) - (1 + sizeof(msg->payload)) + msg->len);
-    success = true;
-  }
-
-  digitalWrite(AdafruitBleCSPin, PinLevelHigh);
-
-  return success;
-}
-
 static inline void sdep_build_pkt(struct sdep_msg *msg, uint16_t command,
                                   const uint8_t *payload, uint8_t len,
                                   bool moredata) {
@@ -268,105 +119,61 @@ static inline void sdep_build_pkt(struct sdep_msg *msg, uint16_t command,
   memcpy(msg->payload, payload, len);
 }
 
-// Read a single SDEP packet
-static bool sdep_recv_pkt(struct sdep_msg *msg, uint16_t timeout) {
-  bool success = false;
-  uint16_t timerStart = timer_read();
-  bool ready = false;
-
-  do {
-    ready = digitalRead(AdafruitBleIRQPin);
-    if (ready) {
-      break;
-    }
-    _delay_us(1);
-  } while (timer_elapsed(timerStart) < timeout);
-
-  if (ready) {
-    SPI_begin(&spi);
-
-    digitalWrite(AdafruitBleCSPin, PinLevelLow);
-
-    do {
-      // Read the command type, waiting for the data to be ready
-      msg->type = spi_read_byte();
-      if (msg->type == SdepSlaveNotReady || msg->type == SdepSlaveOverflow) {
-        // Release it and let it initialize
-        digitalWrite(AdafruitBleCSPin, PinLevelHigh);
-        _delay_us(SdepBackOff);
-        digitalWrite(AdafruitBleCSPin, PinLevelLow);
-        continue;
-      }
-
-      // Read the rest of the header
-      spi_recv_bytes(&msg->cmd_low, sizeof(*msg) - (1 + sizeof(msg->payload)));
-
-      // and get the payload if there is any
-      if (msg->len <= SdepMaxPayload) {
-        spi_recv_bytes(msg->payload, msg->len);
-      }
-      success = true;
-      break;
-    } while (timer_elapsed(timerStart) < timeout);
-
-    digitalWrite(AdafruitBleCSPin, PinLevelHigh);
-  }
-  return success;
-}
-
+// Reads the responses that have arrived, just the next packet unless greedy
 static void resp_buf_read_one(bool greedy) {
   uint16_t last_send;
-  if (!resp_buf.peek(last_send)) {
-    return;
-  }
 
-  if (digitalRead(AdafruitBleIRQPin)) {
-    struct sdep_msg msg;
+  while (resp_buf.peek(last_send)) {
+    if (!sdep_response_ready()) {
+      if (timer_elapsed(last_send) > SdepTimeout * 2) {
+        dprintf("waiting_for_result: timeout, resp_buf size %d\n",
+                (int)resp_buf.size());
 
-again:
-    if (sdep_recv_pkt(&msg, SdepTimeout)) {
-      if (!msg.more) {
-        // We got it; consume this entry
+        // Timed out: consume this entry
         resp_buf.get(last_send);
-        dprintf("recv latency %dms\n", TIMER_DIFF_16(timer_read(), last_send));
-      }
-
-      if (greedy && resp_buf.peek(last_send) && digitalRead(AdafruitBleIRQPin)) {
-        goto again;
       }
+      return;
     }
 
-  } else if (timer_elapsed(last_send) > SdepTimeout * 2) {
-    dprintf("waiting_for_result: timeout, resp_buf size %d\n",
-            (int)resp_buf.size());
+    struct sdep_msg msg;
+    if (!sdep_recv_pkt(&msg, SdepTimeout)) {
+      return;
+    }
+    if (!msg.more) {
+      // We got it; consume this entry
+      resp_buf.get(last_send);
+      dprintf("recv latency %dms\n", TIMER_DIFF_16(timer_read(), last_send));
+    }
 
-    // Timed out: consume this entry
-    resp_buf.get(last_send);
+    if (!greedy) {
+      return;
+    }
   }
 }
 
-static void send_buf_send_one(uint16_t timeout = SdepTimeout) {
+// Sends queued items back to back while the module takes them and
+// there is room to track their responses.  Stops at the first one
+// the module is too busy for; that one goes first next time.
+static void send_buf_send(uint16_t timeout = SdepTimeout) {
   struct queue_item item;
 
-  // Don't send anything more until we get an ACK
-  if (!resp_buf.empty()) {
-    return;
-  }
-
-  if (!send_buf.peek(item)) {
-    return;
-  }
-  if (process_queue_item(&item, timeout)) {
+  while (resp_buf.size() < AdafruitBleMaxInFlight && send_buf.peek(item)) {
+    if (!process_queue_item(&item, timeout)) {
+      dprint("failed to send, will retry\n");
+      return;
+    }
     // commit that peek
     send_buf.get(item);
-    dprintf("send_buf_send_one: have %d remaining\n", (int)send_buf.size());
-  } else {
-    dprint("failed to send, will retry\n");
-    _delay_ms(SdepTimeout);
-    resp_buf_read_one(true);
+    dprintf("send_buf_send: have %d remaining\n", (int)send_buf.size());
   }
 }
 
+// The queue is full: make room, waiting on the module if need be
+static void send_buf_make_room(void) {
+  resp_buf_read_one(true);
+  send_buf_send();
+}
+
 static void resp_buf_wait(const char *cmd) {
   bool didPrint = false;
   while (!resp_buf.empty()) {
@@ -383,20 +190,9 @@ static bool ble_init(void) {
   state.configured = false;
   state.is_connected = false;
 
-  pinMode(AdafruitBleIRQPin, PinDirectionInput);
-  pinMode(AdafruitBleCSPin, PinDirectionOutput);
-  digitalWrite(AdafruitBleCSPin, PinLevelHigh);
+  sdep_init();
 
-  SPI_init(&spi);
-
-  // Perform a hardware reset
-  pinMode(AdafruitBleResetPin, PinDirectionOutput);
-  digitalWrite(AdafruitBleResetPin, PinLevelHigh);
-  digitalWrite(AdafruitBleResetPin, PinLevelLow);
-  _delay_ms(10);
-  digitalWrite(AdafruitBleResetPin, PinLevelHigh);
-
-  _delay_ms(1000); // Give it a second to initialize
+  wait_ms(1000); // Give it a second to initialize
 
   state.initialized = true;
   return state.initialized;
@@ -465,11 +261,29 @@ static bool read_response(char *resp, uint16_t resplen, bool verbose) {
   return success;
 }
 
-static bool at_command(const char *cmd, char *resp, uint16_t resplen,
-                       bool verbose, uint16_t timeout) {
+// Fragment the command into a series of SDEP packets.  Only the first
+// one may give up on a busy module; once it is in, the rest follow with
+// the full timeout so that the module never sees half a command.
+static bool sdep_send_command(const char *cmd, uint16_t timeout) {
   const char *end = cmd + strlen(cmd);
   struct sdep_msg msg;
 
+  do {
+    bool more = end - cmd > SdepMaxPayload;
+    uint8_t len = more ? SdepMaxPayload : end - cmd;
+    sdep_build_pkt(&msg, BleAtWrapper, (uint8_t *)cmd, len, more);
+    if (!sdep_send_pkt(&msg, timeout)) {
+      return false;
+    }
+    cmd += len;
+    timeout = SdepTimeout;
+  } while (cmd < end);
+
+  return true;
+}
+
+static bool at_command(const char *cmd, char *resp, uint16_t resplen,
+                       bool verbose, uint16_t timeout) {
   if (verbose) {
     dprintf("ble send: %s\n", cmd);
   }
@@ -482,17 +296,7 @@ static bool at_command(const char *cmd, char *resp, uint16_t resplen,
     *resp = 0;
   }
 
-  // Fragment the command into a series of SDEP packets
-  while (end - cmd > SdepMaxPayload) {
-    sdep_build_pkt(&msg, BleAtWrapper, (uint8_t *)cmd, SdepMaxPayload, true);
-    if (!sdep_send_pkt(&msg, timeout)) {
-      return false;
-    }
-    cmd += SdepMaxPayload;
-  }
-
-  sdep_build_pkt(&msg, BleAtWrapper, (uint8_t *)cmd, end - cmd, false);
-  if (!sdep_send_pkt(&msg, timeout)) {
+  if (!sdep_send_command(cmd, timeout)) {
     return false;
   }
 
@@ -607,23 +411,29 @@ void adafruit_ble_task(void) {
     return;
   }
   resp_buf_read_one(true);
-  send_buf_send_one(SdepShortTimeout);
+  // Don't wait long on a busy module here, the next scan tries again
+  send_buf_send(SdepShortTimeout);
+
+  // Status queries wait for their answers, only ask between reports
+  bool idle = resp_buf.empty() && send_buf.empty();
 
   if (resp_buf.empty() && (state.event_flags & UsingEvents) &&
-      digitalRead(AdafruitBleIRQPin)) {
+      sdep_response_ready()) {
     // Must be an event update
     if (at_command_P(PSTR("AT+EVENTSTATUS"), resbuf, sizeof(resbuf))) {
       uint32_t mask = strtoul(resbuf, NULL, 16);
 
-      if (mask & BleSystemConnected) {
+      // The BleSystem values are bit numbers in the mask
+      if (mask & (1UL << BleSystemConnected)) {
         set_connected(true);
-      } else if (mask & BleSystemDisconnected) {
+      } else if (mask & (1UL << BleSystemDisconnected)) {
         set_connected(false);
       }
     }
   }
 
-  if (timer_elapsed(state.last_connection_update) > ConnectionUpdateInterval) {
+  if (idle &&
+      timer_elapsed(state.last_connection_update) > ConnectionUpdateInterval) {
     bool shouldPoll = true;
     if (!(state.event_flags & ProbedEvents)) {
       // Request notifications about connection status changes.
@@ -640,14 +450,15 @@ void adafruit_ble_task(void) {
 
       // leave shouldPoll == true so that we check at least once
       // before relying solely on events
-    } else {
+    } else if (state.event_flags & UsingEvents) {
+      // Connection changes arrive as events, see above
       shouldPoll = false;
     }
 
     static const char kGetConn[] PROGMEM = "AT+GAPGETCONN";
     state.last_connection_update = timer_read();
 
-    if (at_command_P(kGetConn, resbuf, sizeof(resbuf))) {
+    if (shouldPoll && at_command_P(kGetConn, resbuf, sizeof(resbuf))) {
       set_connected(atoi(resbuf));
     }
   }
@@ -656,8 +467,8 @@ void adafruit_ble_task(void) {
   // I don't know if this really does anything useful yet; the reported
   // voltage level always seems to be around 3200mV.  We may want to just rip
   // this code out.
-  if (timer_elapsed(state.last_battery_update) > BatteryUpdateInterval &&
-      resp_buf.empty()) {
+  if (idle &&
+      timer_elapsed(state.last_battery_update) > BatteryUpdateInterval) {
     state.last_battery_update = timer_read();
 
     if (at_command_P(PSTR("AT+HWVBAT"), resbuf, sizeof(resbuf))) {
@@ -700,20 +511,20 @@ static bool process_queue_item(struct queue_item *item, uint16_t timeout) {
       strcpy_P(fmtbuf, PSTR("AT+BLEHIDMOUSEMOVE=%d,%d,%d,%d"));
       snprintf(cmdbuf, sizeof(cmdbuf), fmtbuf, item->mousemove.x,
           item->mousemove.y, item->mousemove.scroll, item->mousemove.pan);
-      if (!at_command(cmdbuf, NULL, 0, true, timeout)) {
-        return false;
-      }
+      return at_command(cmdbuf, NULL, 0, true, timeout);
+
+    case QTMouseButtons:
       strcpy_P(cmdbuf, PSTR("AT+BLEHIDMOUSEBUTTON="));
-      if (item->mousemove.buttons & MOUSE_BTN1) {
+      if (item->mousebuttons & MOUSE_BTN1) {
         strcat(cmdbuf, "L");
       }
-      if (item->mousemove.buttons & MOUSE_BTN2) {
+      if (item->mousebuttons & MOUSE_BTN2) {
         strcat(cmdbuf, "R");
       }
-      if (item->mousemove.buttons & MOUSE_BTN3) {
+      if (item->mousebuttons & MOUSE_BTN3) {
         strcat(cmdbuf, "M");
       }
-      if (item->mousemove.buttons == 0) {
+      if (item->mousebuttons == 0) {
         strcat(cmdbuf, "0");
       }
       return at_command(cmdbuf, NULL, 0, true, timeout);
@@ -745,7 +556,7 @@ bool adafruit_ble_send_keys(uint8_t hid_modifier_mask, uint8_t *keys,
         dprint("wait for buf space\n");
         didWait = true;
       }
-      send_buf_send_one();
+      send_buf_make_room();
       continue;
     }
 
@@ -765,9 +576,10 @@ bool adafruit_ble_send_consumer_key(uint16_t keycode, int hold_duration) {
 
   item.queue_type = QTConsumer;
   item.consumer = keycode;
+  item.added = timer_read();
 
   while (!send_buf.enqueue(item)) {
-    send_buf_send_one();
+    send_buf_make_room();
   }
   return true;
 }
@@ -778,14 +590,22 @@ bool adafruit_ble_send_mouse_move(int8_t x, int8_t y, int8_t scroll,
   struct queue_item item;
 
   item.queue_type = QTMouseMove;
+  item.added = timer_read();
   item.mousemove.x = x;
   item.mousemove.y = y;
   item.mousemove.scroll = scroll;
   item.mousemove.pan = pan;
-  item.mousemove.buttons = buttons;
 
   while (!send_buf.enqueue(item)) {
-    send_buf_send_one();
+    send_buf_make_room();
+  }
+
+  // Its own item so that a busy module never gets the move sent twice
+  item.queue_type = QTMouseButtons;
+  item.mousebuttons = buttons;
+
+  while (!send_buf.enqueue(item)) {
+    send_buf_make_room();
   }
   return true;
 }
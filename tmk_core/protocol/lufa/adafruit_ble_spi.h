@@ -0,0 +1,42 @@
+/* SDEP packets over SPI to the Adafruit BLE module.
+ * The AVR side lives in adafruit_ble_spi.cpp, the tests bring a fake module.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Commands are encoded using SDEP and sent via SPI
+// https://github.com/adafruit/Adafruit_BluefruitLE_nRF51/blob/master/SDEP.md
+
+#define SdepMaxPayload 16
+struct sdep_msg {
+  uint8_t type;
+  uint8_t cmd_low;
+  uint8_t cmd_high;
+  struct __attribute__((packed)) {
+    uint8_t len:7;
+    uint8_t more:1;
+  };
+  uint8_t payload[SdepMaxPayload];
+} __attribute__((packed));
+
+enum sdep_type {
+  SdepCommand = 0x10,
+  SdepResponse = 0x20,
+  SdepAlert = 0x40,
+  SdepError = 0x80,
+  SdepSlaveNotReady = 0xfe, // Try again later
+  SdepSlaveOverflow = 0xff, // You read more data than is available
+};
+
+// Sets up the pins and SPI and resets the module
+void sdep_init(void);
+
+// Send a single SDEP packet, retrying while the module is busy
+bool sdep_send_pkt(const struct sdep_msg *msg, uint16_t timeout);
+
+// Read a single SDEP packet, waiting up to timeout for one to arrive
+bool sdep_recv_pkt(struct sdep_msg *msg, uint16_t timeout);
+
+// The IRQ line: the module has a response or an event for us
+bool sdep_response_ready(void);
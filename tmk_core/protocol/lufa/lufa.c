@@ -43,6 +43,9 @@
 #include "action.h"
 #include "led.h"
 #include "sendchar.h"
+#ifdef CONSOLE_ENABLE
+    #include "console.h"
+#endif
 #include "debug.h"
 #ifdef SLEEP_LED_ENABLE
 #include "sleep_led.h"
@@ -84,6 +87,7 @@
 
 #ifdef MIDI_ENABLE
   #include "qmk_midi.h"
+  #include "midi_queue.h"
 #endif
 
 #ifdef RAW_ENABLE
@@ -232,7 +236,7 @@ static void raw_hid_task(void)
 #ifdef CONSOLE_ENABLE
 /** \brief Console Task
  *
- * FIXME: Needs doc
+ * Sends what print() queued, called from the main loop
  */
 static void Console_Task(void)
 {
@@ -240,50 +244,29 @@ static void Console_Task(void)
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    uint8_t ep = Endpoint_GetCurrentEndpoint();
-
-#if 0
-    // TODO: impl receivechar()/recvchar()
-    Endpoint_SelectEndpoint(CONSOLE_OUT_EPNUM);
-
-    /* Check to see if a packet has been sent from the host */
-    if (Endpoint_IsOUTReceived())
-    {
-        /* Check to see if the packet contains data */
-        if (Endpoint_IsReadWriteAllowed())
-        {
-            /* Create a temporary buffer to hold the read in report from the host */
-            uint8_t ConsoleData[CONSOLE_EPSIZE];
-
-            /* Read Console Report Data */
-            Endpoint_Read_Stream_LE(&ConsoleData, sizeof(ConsoleData), NULL);
-
-            /* Process Console Report Data */
-            //ProcessConsoleHIDReport(ConsoleData);
-        }
+    console_flush();
+}
 
-        /* Finalize the stream transfer to send the last packet */
-        Endpoint_ClearOUT();
-    }
-#endif
+/** \brief Console Send Packet
+ *
+ * Writes one IN report if the bank is free, never waits for the host
+ */
+uint8_t console_send_packet(const uint8_t *packet, uint8_t length)
+{
+    uint8_t ep = Endpoint_GetCurrentEndpoint();
 
-    /* IN packet */
     Endpoint_SelectEndpoint(CONSOLE_IN_EPNUM);
-    if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured()) {
+    if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured() || Endpoint_IsStalled() ||
+        !Endpoint_IsReadWriteAllowed()) {
         Endpoint_SelectEndpoint(ep);
-        return;
+        return 0;
     }
 
-    // fill empty bank
-    while (Endpoint_IsReadWriteAllowed())
-        Endpoint_Write_8(0);
-
-    // flash senchar packet
-    if (Endpoint_IsINReady()) {
-        Endpoint_ClearIN();
-    }
+    Endpoint_Write_Stream_LE(packet, CONSOLE_EPSIZE, NULL);
+    Endpoint_ClearIN();
 
     Endpoint_SelectEndpoint(ep);
+    return length;
 }
 #endif
 
@@ -309,7 +292,6 @@ void EVENT_USB_Device_Connect(void)
     if (!USB_IsInitialized) {
         USB_Disable();
         USB_Init();
-        USB_Device_EnableSOFEvents();
     }
 }
 
@@ -370,32 +352,6 @@ void EVENT_USB_Device_WakeUp()
 
 
 
-#ifdef CONSOLE_ENABLE
-static bool console_flush = false;
-#define CONSOLE_FLUSH_SET(b)   do { \
-  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {\
-    console_flush = b; \
-  } \
-} while (0)
-
-/** \brief Event USB Device Start Of Frame
- *
- * FIXME: Needs doc
- * called every 1ms
- */
-void EVENT_USB_Device_StartOfFrame(void)
-{
-    static uint8_t count;
-    if (++count % 50) return;
-    count = 0;
-
-    if (!console_flush) return;
-    Console_Task();
-    console_flush = false;
-}
-
-#endif
-
 /** \brief Event handler for the USB_ConfigurationChanged event.
  *
  * This is fired when the host sets the current configuration of the USB device after enumeration.
@@ -800,66 +756,13 @@ static void send_consumer(uint16_t data)
  * sendchar
  ******************************************************************************/
 #ifdef CONSOLE_ENABLE
-#define SEND_TIMEOUT 5
 /** \brief Send Char
  *
- * FIXME: Needs doc
+ * Queues the character for Console_Task(), see console.h
  */
 int8_t sendchar(uint8_t c)
 {
-    // Not wait once timeouted.
-    // Because sendchar() is called so many times, waiting each call causes big lag.
-    static bool timeouted = false;
-
-    // prevents Console_Task() from running during sendchar() runs.
-    // or char will be lost. These two function is mutually exclusive.
-    CONSOLE_FLUSH_SET(false);
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
-        return -1;
-
-    uint8_t ep = Endpoint_GetCurrentEndpoint();
-    Endpoint_SelectEndpoint(CONSOLE_IN_EPNUM);
-    if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured()) {
-        goto ERROR_EXIT;
-    }
-
-    if (timeouted && !Endpoint_IsReadWriteAllowed()) {
-        goto ERROR_EXIT;
-    }
-
-    timeouted = false;
-
-    uint8_t timeout = SEND_TIMEOUT;
-    while (!Endpoint_IsReadWriteAllowed()) {
-        if (USB_DeviceState != DEVICE_STATE_Configured) {
-            goto ERROR_EXIT;
-        }
-        if (Endpoint_IsStalled()) {
-            goto ERROR_EXIT;
-        }
-        if (!(timeout--)) {
-            timeouted = true;
-            goto ERROR_EXIT;
-        }
-        _delay_ms(1);
-    }
-
-    Endpoint_Write_8(c);
-
-    // send when bank is full
-    if (!Endpoint_IsReadWriteAllowed()) {
-        while (!(Endpoint_IsINReady()));
-        Endpoint_ClearIN();
-    } else {
-        CONSOLE_FLUSH_SET(true);
-    }
-
-    Endpoint_SelectEndpoint(ep);
-    return 0;
-ERROR_EXIT:
-    Endpoint_SelectEndpoint(ep);
-    return -1;
+    return console_putc(c);
 }
 #else
 int8_t sendchar(uint8_t c)
@@ -893,8 +796,34 @@ USB_ClassInfo_MIDI_Device_t USB_MIDI_Interface =
   },
 };
 
-void send_midi_packet(MIDI_EventPacket_t* event) {
-  MIDI_Device_SendEventPacket(&USB_MIDI_Interface, event);
+/** \brief Send MIDI Packets
+ *
+ * Writes what fits in the IN endpoint as one transfer, see midi_queue.h
+ */
+uint8_t midi_send_packets(const uint8_t *packets, uint8_t count) {
+  uint8_t ep = Endpoint_GetCurrentEndpoint();
+
+  if (USB_DeviceState != DEVICE_STATE_Configured) {
+    return count;
+  }
+
+  Endpoint_SelectEndpoint(MIDI_STREAM_IN_EPADDR);
+  if (!Endpoint_IsReadWriteAllowed()) {
+    Endpoint_SelectEndpoint(ep);
+    return 0;
+  }
+
+  uint8_t room = (MIDI_STREAM_EPSIZE - Endpoint_BytesInEndpoint()) / sizeof(MIDI_EventPacket_t);
+  if (count > room) {
+    count = room;
+  }
+  for (uint8_t i = 0; i < count * sizeof(MIDI_EventPacket_t); i++) {
+    Endpoint_Write_8(packets[i]);
+  }
+  Endpoint_ClearIN();
+
+  Endpoint_SelectEndpoint(ep);
+  return count;
 }
 
 bool recv_midi_packet(MIDI_EventPacket_t* const event) {
@@ -930,7 +859,7 @@ void virtser_recv(uint8_t c)
 
 /** \brief Virtual Serial Task
  *
- * FIXME: Needs doc
+ * Receives a byte and sends what virtser_send() queued
  */
 void virtser_task(void)
 {
@@ -941,37 +870,47 @@ void virtser_task(void)
     ch = CDC_Device_ReceiveByte(&cdc_device);
     virtser_recv(ch);
   }
+  virtser_flush();
 }
-/** \brief Virtual Serial Send
+
+/** \brief Virtual Serial Send Packet
  *
- * FIXME: Needs doc
+ * Writes one IN packet without waiting for the host, an empty one for a
+ * length of 0. Bytes are dropped while no terminal has the port open.
  */
-void virtser_send(const uint8_t byte)
+uint8_t virtser_send_packet(const uint8_t *data, uint8_t length)
 {
-  uint8_t timeout = 255;
   uint8_t ep = Endpoint_GetCurrentEndpoint();
 
-  if (cdc_device.State.ControlLineStates.HostToDevice & CDC_CONTROL_LINE_OUT_DTR)
-  {
-    /* IN packet */
-    Endpoint_SelectEndpoint(cdc_device.Config.DataINEndpoint.Address);
-
-    if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured()) {
-        Endpoint_SelectEndpoint(ep);
-        return;
-    }
-
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
+  if (length > CDC_EPSIZE) {
+    length = CDC_EPSIZE;
+  }
+  // an empty packet counts as taken once it is out
+  uint8_t taken = length ? length : 1;
 
-    Endpoint_Write_8(byte);
-    CDC_Device_Flush(&cdc_device);
+  if (!(cdc_device.State.ControlLineStates.HostToDevice & CDC_CONTROL_LINE_OUT_DTR)) {
+    return taken;
+  }
 
-    if (Endpoint_IsINReady()) {
-      Endpoint_ClearIN();
-    }
+  /* IN packet */
+  Endpoint_SelectEndpoint(cdc_device.Config.DataINEndpoint.Address);
 
+  if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured()) {
+    Endpoint_SelectEndpoint(ep);
+    return taken;
+  }
+  if (!Endpoint_IsReadWriteAllowed()) {
     Endpoint_SelectEndpoint(ep);
+    return 0;
   }
+
+  for (uint8_t i = 0; i < length; i++) {
+    Endpoint_Write_8(data[i]);
+  }
+  Endpoint_ClearIN();
+
+  Endpoint_SelectEndpoint(ep);
+  return taken;
 }
 #endif
 
@@ -1006,8 +945,6 @@ static void setup_usb(void)
 
     USB_Init();
 
-    // for Console_Task
-    USB_Device_EnableSOFEvents();
     print_set_sendchar(sendchar);
 }
 
@@ -1091,6 +1028,10 @@ int main(void)
         raw_hid_task();
 #endif
 
+#ifdef CONSOLE_ENABLE
+        Console_Task();
+#endif
+
 #if !defined(INTERRUPT_CONTROL_ENDPOINT)
         USB_USBTask();
 #endif
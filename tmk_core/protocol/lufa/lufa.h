@@ -70,9 +70,9 @@ typedef struct {
 
 #ifdef API_SYSEX_ENABLE
   #include "api_sysex.h"
-  // Allocate space for encoding overhead.
-  //The header and terminator are not stored to save a few bytes of precious ram
-  #define MIDI_SYSEX_BUFFER (API_SYSEX_MAX_SIZE + API_SYSEX_MAX_SIZE / 7 + (API_SYSEX_MAX_SIZE % 7 ? 1 : 0))
+  // A whole message: the 4 byte header, the message type and data type and
+  // up to API_SYSEX_MAX_SIZE bytes with the encoding overhead, the terminator
+  #define MIDI_SYSEX_BUFFER (4 + (API_SYSEX_MAX_SIZE + 2) + (API_SYSEX_MAX_SIZE + 2 + 6) / 7 + 1)
 #endif
 
 // #if LUFA_VERSION_INTEGER < 0x120730
@@ -0,0 +1,374 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <deque>
+#include <string>
+#include <vector>
+#include "adafruit_ble.h"
+#include "adafruit_ble_spi.h"
+extern "C" {
+#include "timer.h"
+#include "report.h"
+
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+}
+
+#ifndef AdafruitBleMaxInFlight
+#define AdafruitBleMaxInFlight 3
+#endif
+
+/*
+ * The module at the other end of the SPI bus. It takes AT commands a frame
+ * at a time and answers each one after latency ms. It says it is not ready
+ * while it holds capacity answers nobody read, and for the next busy send
+ * attempts.
+ */
+class FakeModule {
+   public:
+    FakeModule() { reset(); }
+
+    void reset() {
+        commands.clear();
+        answers.clear();
+        partial.clear();
+        latency = 2;
+        capacity = 8;
+        busy = 0;
+        busy_fragments = 0;
+        drop_next = false;
+        unread = 0;
+        max_unread = 0;
+        event = false;
+        event_status = "0";
+    }
+
+    bool ready() {
+        if (busy > 0) {
+            busy--;
+            return false;
+        }
+        if (!partial.empty() && busy_fragments > 0) {
+            busy_fragments--;
+            return false;
+        }
+        return unread < capacity;
+    }
+
+    void receive(const struct sdep_msg *msg) {
+        EXPECT_EQ(msg->type, SdepCommand);
+        EXPECT_EQ(msg->cmd_high << 8 | msg->cmd_low, 0x0a00);
+        EXPECT_LE(msg->len, SdepMaxPayload);
+        if (msg->more) {
+            EXPECT_EQ(msg->len, SdepMaxPayload);
+        }
+        partial.append((const char *)msg->payload, msg->len);
+        if (!msg->more) {
+            commands.push_back(partial);
+            answer(partial);
+            partial.clear();
+        }
+    }
+
+    bool answer_ready() { return !answers.empty() && timer_read32() >= answers.front().time; }
+
+    std::vector<std::string> with_prefix(const std::string &prefix) {
+        std::vector<std::string> found;
+        for (auto &command : commands) {
+            if (command.compare(0, prefix.size(), prefix) == 0) {
+                found.push_back(command);
+            }
+        }
+        return found;
+    }
+
+    struct answer_packet {
+        uint32_t time;
+        struct sdep_msg msg;
+    };
+
+    std::vector<std::string> commands;
+    std::deque<answer_packet> answers;
+    std::string partial;
+    uint32_t latency;
+    int capacity;
+    int busy;
+    int busy_fragments;
+    bool drop_next;
+    int unread;
+    int max_unread;
+    // Raises the IRQ line without an answer pending, the firmware then
+    // reads event_status with AT+EVENTSTATUS
+    bool event;
+    std::string event_status;
+
+   private:
+    void answer(const std::string &command) {
+        std::string text = "OK\r\n";
+        if (command == "AT+GAPGETCONN") {
+            text = "1\r\nOK\r\n";
+        } else if (command == "AT+HWVBAT") {
+            text = "3700\r\nOK\r\n";
+        } else if (command == "AT+EVENTSTATUS") {
+            text = event_status + "\r\nOK\r\n";
+            event = false;
+        }
+        if (drop_next) {
+            drop_next = false;
+            return;
+        }
+
+        unread++;
+        max_unread = std::max(max_unread, unread);
+        for (size_t i = 0; i < text.size(); i += SdepMaxPayload) {
+            answer_packet packet = {};
+            size_t len = std::min(text.size() - i, (size_t)SdepMaxPayload);
+            packet.time = timer_read32() + latency;
+            packet.msg.type = SdepResponse;
+            packet.msg.cmd_low = 0x00;
+            packet.msg.cmd_high = 0x0a;
+            packet.msg.len = len;
+            packet.msg.more = i + len < text.size();
+            memcpy(packet.msg.payload, text.data() + i, len);
+            answers.push_back(packet);
+        }
+    }
+};
+
+static FakeModule module;
+
+void sdep_init(void) {}
+
+bool sdep_response_ready(void) { return module.answer_ready() || module.event; }
+
+// Like the SPI driver: tries at least once, retrying each millisecond
+bool sdep_send_pkt(const struct sdep_msg *msg, uint16_t timeout) {
+    uint16_t start = timer_read();
+    do {
+        if (module.ready()) {
+            module.receive(msg);
+            return true;
+        }
+        advance_time(1);
+    } while (timer_elapsed(start) < timeout);
+    return false;
+}
+
+bool sdep_recv_pkt(struct sdep_msg *msg, uint16_t timeout) {
+    if (module.answers.empty()) {
+        advance_time(timeout);
+        return false;
+    }
+    uint32_t time = module.answers.front().time;
+    if (time > timer_read32() + timeout) {
+        advance_time(timeout);
+        return false;
+    }
+    if (time > timer_read32()) {
+        set_time(time);
+    }
+    *msg = module.answers.front().msg;
+    module.answers.pop_front();
+    if (!msg->more) {
+        module.unread--;
+    }
+    return true;
+}
+
+static std::string key_command(uint8_t key) {
+    char text[48];
+    snprintf(text, sizeof(text), "AT+BLEKEYBOARDCODE=00-00-%02x-00-00-00-00-00", key);
+    return text;
+}
+
+class AdafruitBle : public ::testing::Test {
+   public:
+    AdafruitBle() {
+        // Settles whatever an earlier test left behind; the first time
+        // around this also configures the module and probes for events
+        module.reset();
+        run_for(2000);
+        module.reset();
+    }
+
+    // The main loop, one scan per millisecond
+    void run_for(uint32_t ms) {
+        for (uint32_t i = 0; i < ms; i++) {
+            adafruit_ble_task();
+            advance_time(1);
+        }
+    }
+
+    void send_key(uint8_t key) {
+        uint8_t keys[6] = {key};
+        adafruit_ble_send_keys(0, keys, 1);
+    }
+};
+
+TEST_F(AdafruitBle, ReportsGoOutInOrder) {
+    std::vector<std::string> expected;
+
+    for (int i = 0; i < 30; i++) {
+        send_key(4 + i);
+        expected.push_back(key_command(4 + i));
+    }
+    run_for(500);
+    EXPECT_EQ(module.with_prefix("AT+BLEKEYBOARDCODE"), expected);
+    EXPECT_EQ(module.unread, 0);
+}
+
+TEST_F(AdafruitBle, QueuedReportsGoOutBackToBack) {
+    module.latency = 20;
+    for (int i = 0; i < 5; i++) {
+        send_key(4 + i);
+    }
+
+    uint32_t before = timer_read32();
+    adafruit_ble_task();
+    EXPECT_EQ(timer_read32(), before);
+    EXPECT_EQ(module.commands.size(), (size_t)AdafruitBleMaxInFlight);
+    EXPECT_EQ(module.max_unread, AdafruitBleMaxInFlight);
+
+    run_for(100);
+    EXPECT_EQ(module.commands.size(), 5u);
+    EXPECT_EQ(module.unread, 0);
+}
+
+TEST_F(AdafruitBle, TaskDoesNotWaitForResponses) {
+    module.latency = 20;
+    send_key(4);
+
+    uint32_t before = timer_read32();
+    adafruit_ble_task();
+    EXPECT_EQ(timer_read32(), before);
+    EXPECT_EQ(module.unread, 1);
+
+    advance_time(20);
+    adafruit_ble_task();
+    EXPECT_EQ(module.unread, 0);
+}
+
+TEST_F(AdafruitBle, BusyModuleDoesNotStallTheScan) {
+    for (int i = 0; i < 3; i++) {
+        send_key(4 + i);
+    }
+    module.busy = 1000;
+
+    uint32_t before = timer_read32();
+    adafruit_ble_task();
+    EXPECT_LE(timer_read32() - before, 10u);
+    EXPECT_TRUE(module.commands.empty());
+
+    module.busy = 0;
+    run_for(100);
+    std::vector<std::string> expected = {key_command(4), key_command(5), key_command(6)};
+    EXPECT_EQ(module.with_prefix("AT+BLEKEYBOARDCODE"), expected);
+}
+
+TEST_F(AdafruitBle, BusyModuleKeepsOrderWithoutRepeats) {
+    std::vector<std::string> expected;
+
+    // More than the queue holds, later reports wait for room
+    module.latency = 5;
+    module.capacity = 2;
+    for (int i = 0; i < 60; i++) {
+        if (i % 7 == 0) {
+            module.busy = 20;
+        }
+        send_key(4 + i);
+        expected.push_back(key_command(4 + i));
+    }
+    run_for(2000);
+    EXPECT_EQ(module.with_prefix("AT+BLEKEYBOARDCODE"), expected);
+    EXPECT_LE(module.max_unread, 2);
+}
+
+TEST_F(AdafruitBle, CommandsAreNeverCutInHalf) {
+    // The module fell behind between two frames of a command, the rest
+    // of it must still follow before anything else
+    module.busy_fragments = 12;
+    for (int i = 0; i < 4; i++) {
+        send_key(4 + i);
+    }
+    run_for(200);
+    std::vector<std::string> expected = {key_command(4), key_command(5), key_command(6), key_command(7)};
+    EXPECT_EQ(module.with_prefix("AT+BLEKEYBOARDCODE"), expected);
+    EXPECT_TRUE(module.partial.empty());
+}
+
+TEST_F(AdafruitBle, MouseMoveThenButtons) {
+    adafruit_ble_send_mouse_move(-100, 20, 0, 0, MOUSE_BTN1 | MOUSE_BTN2);
+    adafruit_ble_send_mouse_move(0, 0, 1, 0, 0);
+    run_for(100);
+
+    std::vector<std::string> expected = {
+        "AT+BLEHIDMOUSEMOVE=-100,20,0,0", "AT+BLEHIDMOUSEBUTTON=LR",
+        "AT+BLEHIDMOUSEMOVE=0,0,1,0", "AT+BLEHIDMOUSEBUTTON=0",
+    };
+    EXPECT_EQ(module.with_prefix("AT+BLEHIDMOUSE"), expected);
+}
+
+TEST_F(AdafruitBle, ConsumerKeysShareTheQueue) {
+    send_key(4);
+    adafruit_ble_send_consumer_key(0xE9, 0);
+    send_key(0);
+    run_for(100);
+
+    std::vector<std::string> expected = {key_command(4), "AT+BLEHIDCONTROLKEY=0x00e9", key_command(0)};
+    EXPECT_EQ(module.with_prefix("AT+BLE"), expected);
+}
+
+TEST_F(AdafruitBle, LostResponseTimesOut) {
+    module.drop_next = true;
+    send_key(4);
+    run_for(10);
+    for (int i = 0; i < 5; i++) {
+        send_key(5 + i);
+    }
+    run_for(1000);
+    EXPECT_EQ(module.with_prefix("AT+BLEKEYBOARDCODE").size(), 6u);
+    EXPECT_EQ(module.unread, 0);
+}
+
+TEST_F(AdafruitBle, ConnectionIsNotPolledWithEvents) {
+    run_for(10000);
+    EXPECT_TRUE(module.with_prefix("AT+GAPGETCONN").empty());
+}
+
+TEST_F(AdafruitBle, ConnectionEventsSetTheState) {
+    module.event_status = "1";
+    module.event = true;
+    run_for(10);
+    EXPECT_EQ(module.with_prefix("AT+EVENTSTATUS").size(), 1u);
+    EXPECT_TRUE(adafruit_ble_is_connected());
+
+    module.event_status = "2";
+    module.event = true;
+    run_for(10);
+    EXPECT_EQ(module.with_prefix("AT+EVENTSTATUS").size(), 2u);
+    EXPECT_FALSE(adafruit_ble_is_connected());
+
+    module.event_status = "1";
+    module.event = true;
+    run_for(10);
+    EXPECT_TRUE(adafruit_ble_is_connected());
+}
+
+TEST_F(AdafruitBle, BatteryIsReadOnASlowTimer) {
+    run_for(125000);
+    EXPECT_EQ(module.with_prefix("AT+HWVBAT").size(), 2u);
+    EXPECT_EQ(adafruit_ble_read_battery_voltage(), 3700u);
+}
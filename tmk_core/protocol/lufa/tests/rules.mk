@@ -0,0 +1,14 @@
+adafruit_ble_SRC := \
+	$(TMK_PATH)/protocol/lufa/tests/adafruit_ble_tests.cpp \
+	$(TMK_PATH)/protocol/lufa/adafruit_ble.cpp \
+	$(TMK_PATH)/common/test/timer.c
+
+adafruit_ble_INC := $(TMK_PATH)/protocol/lufa
+
+adafruit_ble_DEFS := \
+	-DMODULE_ADAFRUIT_BLE \
+	-DMOUSE_ENABLE \
+	-DNO_PRINT \
+	-DNO_DEBUG \
+	-DPRODUCT=Test \
+	-DDESCRIPTION=Keyboard
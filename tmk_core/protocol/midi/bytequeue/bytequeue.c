@@ -1,4 +1,4 @@
-//this is a single reader [maybe multiple writer?] byte queue
+//this is a single reader, single writer byte queue
 //Copyright 2008 Alex Norman
 //writen by Alex Norman 
 //
@@ -18,7 +18,9 @@
 //along with avr-bytequeue.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "bytequeue.h"
-#include "interrupt_setting.h"
+
+//one writer moves end, one reader moves start, and each publishes its index
+//only after it is done with the data, so no interrupts need to be disabled
 
 void bytequeue_init(byteQueue_t * queue, uint8_t * dataArray, byteQueueIndex_t arrayLen){
    queue->length = arrayLen;
@@ -27,39 +29,31 @@ void bytequeue_init(byteQueue_t * queue, uint8_t * dataArray, byteQueueIndex_t a
 }
 
 bool bytequeue_enqueue(byteQueue_t * queue, uint8_t item){
-   interrupt_setting_t setting = store_and_clear_interrupt();
+   byteQueueIndex_t end = queue->end;
+   byteQueueIndex_t next = (end + 1) % queue->length;
    //full
-   if(((queue->end + 1) % queue->length) == queue->start){
-      restore_interrupt_setting(setting);
+   if(next == __atomic_load_n(&queue->start, __ATOMIC_ACQUIRE)){
       return false;
    } else {
-      queue->data[queue->end] = item;
-      queue->end = (queue->end + 1) % queue->length;
-      restore_interrupt_setting(setting);
+      queue->data[end] = item;
+      __atomic_store_n(&queue->end, next, __ATOMIC_RELEASE);
       return true;
    }
 }
 
 byteQueueIndex_t bytequeue_length(byteQueue_t * queue){
-   byteQueueIndex_t len;
-   interrupt_setting_t setting = store_and_clear_interrupt();
-   if(queue->end >= queue->start)
-      len = queue->end - queue->start;
+   byteQueueIndex_t start = __atomic_load_n(&queue->start, __ATOMIC_ACQUIRE);
+   byteQueueIndex_t end = __atomic_load_n(&queue->end, __ATOMIC_ACQUIRE);
+   if(end >= start)
+      return end - start;
    else
-      len = (queue->length - queue->start) + queue->end;
-   restore_interrupt_setting(setting);
-   return len;
+      return (queue->length - start) + end;
 }
 
-//we don't need to avoid interrupts if there is only one reader
 uint8_t bytequeue_get(byteQueue_t * queue, byteQueueIndex_t index){
    return queue->data[(queue->start + index) % queue->length];
 }
 
-//we just update the start index to remove elements
 void bytequeue_remove(byteQueue_t * queue, byteQueueIndex_t numToRemove){
-   interrupt_setting_t setting = store_and_clear_interrupt();
-   queue->start = (queue->start + numToRemove) % queue->length;
-   restore_interrupt_setting(setting);
+   __atomic_store_n(&queue->start, (queue->start + numToRemove) % queue->length, __ATOMIC_RELEASE);
 }
-
@@ -267,6 +267,12 @@ void midi_register_sysex_callback(MidiDevice * device, midi_sysex_func_t func) {
    device->input_sysex_callback = func;
 }
 
+void midi_register_sysex_message_callback(MidiDevice * device, midi_sysex_message_func_t func, uint8_t * buffer, uint16_t size) {
+   device->input_sysex_message_callback = func;
+   device->sysex_buffer = buffer;
+   device->sysex_buffer_size = size;
+}
+
 void midi_register_fallthrough_callback(MidiDevice * device, midi_var_byte_func_t func){
    device->input_fallthrough_callback = func;
 }
@@ -381,6 +381,19 @@ void midi_register_tunerequest_callback(MidiDevice * device, midi_one_byte_func_
  */
 void midi_register_sysex_callback(MidiDevice * device, midi_sysex_func_t func);
 
+/**
+ * @brief Register a callback for whole sysex messages.
+ *
+ * Only packet input, midi_device_input_packets, calls it. Messages are
+ * gathered in the buffer, those that do not fit are dropped.
+ *
+ * @param device the device associate with
+ * @param func the callback function to register
+ * @param buffer where messages are gathered, handed to the callback
+ * @param size the size of the buffer
+ */
+void midi_register_sysex_message_callback(MidiDevice * device, midi_sysex_message_func_t func, uint8_t * buffer, uint16_t size);
+
 /**
  * @brief Register fall through callback.
  *
@@ -18,6 +18,7 @@
 
 #include "midi_device.h"
 #include "midi.h"
+#include <string.h>
 
 #ifndef NULL
 #define NULL 0
@@ -52,6 +53,10 @@ void midi_device_init(MidiDevice * device){
 
   //var byte functions
   device->input_sysex_callback = NULL;
+  device->input_sysex_message_callback = NULL;
+  device->sysex_buffer = NULL;
+  device->sysex_buffer_size = 0;
+  device->sysex_count = 0;
   device->input_fallthrough_callback = NULL;
   device->input_catchall_callback = NULL;
 
@@ -64,6 +69,87 @@ void midi_device_input(MidiDevice * device, uint8_t cnt, uint8_t * input) {
     bytequeue_enqueue(&device->input_queue, input[i]);
 }
 
+//a message that is not sysex, in a packet
+static void midi_process_packet_message(MidiDevice * device, uint8_t cnt, uint8_t * data) {
+  input_state_t state = device->input_state;
+  //realtime messages may come in the middle of sysex, anything else ends it
+  if (!midi_is_realtime(data[0]))
+    device->sysex_count = 0;
+  device->input_state = cnt;
+  midi_input_callbacks(device, cnt, data[0], data[1], data[2]);
+  device->input_state = state;
+}
+
+//a sysex packet, cnt bytes of which the last is SYSEX_END if it ends the message
+static void midi_process_packet_sysex(MidiDevice * device, uint8_t cnt, uint8_t * data, bool end) {
+  if (data[0] == SYSEX_BEGIN)
+    device->sysex_count = 0;
+  else if (device->sysex_count == 0)
+    return; //the rest of a message we did not see start
+
+  uint16_t start = device->sysex_count;
+  device->sysex_count += cnt;
+  if (device->sysex_count < start)
+    device->sysex_count = UINT16_MAX; //too long for anything, keep it going
+
+  if (device->input_sysex_message_callback && device->sysex_count <= device->sysex_buffer_size) {
+    memcpy(device->sysex_buffer + start, data, cnt);
+    if (end)
+      device->input_sysex_message_callback(device, device->sysex_count, device->sysex_buffer);
+  }
+
+  //the same chunk callbacks as byte input, the chunks are already 3 bytes
+  input_state_t state = device->input_state;
+  device->input_state = SYSEX_MESSAGE;
+  midi_input_callbacks(device, device->sysex_count, data[0], data[1], data[2]);
+  device->input_state = state;
+
+  if (end)
+    device->sysex_count = 0;
+}
+
+void midi_device_input_packets(MidiDevice * device, uint8_t count, uint8_t * packets) {
+  for (; count; count--, packets += 4) {
+    uint8_t * data = packets + 1;
+    //the code index number says what the packet holds
+    switch (packets[0] & 0x0F) {
+      case 0x4: //sysex starts or continues
+        midi_process_packet_sysex(device, 3, data, false);
+        break;
+      case 0x5: //sysex ends with one byte, or a one byte system common message
+        if (data[0] == SYSEX_END)
+          midi_process_packet_sysex(device, 1, data, true);
+        else
+          midi_process_packet_message(device, 1, data);
+        break;
+      case 0x6: //sysex ends with two bytes
+        midi_process_packet_sysex(device, 2, data, true);
+        break;
+      case 0x7: //sysex ends with three bytes
+        midi_process_packet_sysex(device, 3, data, true);
+        break;
+      case 0xF: //single byte
+        midi_process_packet_message(device, 1, data);
+        break;
+      case 0x2: //two byte system common
+      case 0xC: //program change
+      case 0xD: //channel pressure
+        midi_process_packet_message(device, 2, data);
+        break;
+      case 0x3: //three byte system common
+      case 0x8: //note off
+      case 0x9: //note on
+      case 0xA: //aftertouch
+      case 0xB: //cc
+      case 0xE: //pitch bend
+        midi_process_packet_message(device, 3, data);
+        break;
+      default: //reserved
+        break;
+    }
+  }
+}
+
 void midi_device_set_send_func(MidiDevice * device, midi_var_byte_func_t send_func){
   device->send_func = send_func;
 }
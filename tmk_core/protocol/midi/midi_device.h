@@ -93,6 +93,7 @@ struct _midi_device {
 
    //sysex
    midi_sysex_func_t input_sysex_callback;
+   midi_sysex_message_func_t input_sysex_message_callback;
 
    //only called if more specific callback is not matched
    midi_var_byte_func_t input_fallthrough_callback;
@@ -107,6 +108,12 @@ struct _midi_device {
    input_state_t input_state;
    uint16_t input_count;
 
+   //for packet input, whole sysex messages are gathered in the buffer
+   //registered with the message callback
+   uint8_t * sysex_buffer;
+   uint16_t sysex_buffer_size;
+   uint16_t sysex_count;
+
    //for queueing data between the input and the processing functions
    uint8_t input_queue_data[MIDI_INPUT_QUEUE_LENGTH];
    byteQueue_t input_queue;
@@ -124,6 +131,19 @@ struct _midi_device {
  */
 void midi_device_input(MidiDevice * device, uint8_t cnt, uint8_t * input);
 
+/**
+ * @brief Process USB-MIDI event packets.  Like midi_device_input but the
+ * callbacks are called right away, a packet at a time instead of a byte at a
+ * time, and whole sysex messages go to the sysex message callback.
+ *
+ * Use one of this and midi_device_input for a device, not both.
+ *
+ * @param device the midi device to associate the input with
+ * @param count the number of 4 byte event packets
+ * @param packets the packets to process
+ */
+void midi_device_input_packets(MidiDevice * device, uint8_t count, uint8_t * packets);
+
 /**
  * @brief Set the callback function that will be used for sending output
  * data bytes.  This is only used if you're creating a custom device.
@@ -43,6 +43,9 @@ typedef void (* midi_var_byte_func_t)(MidiDevice * device, uint16_t count, uint8
 //the start byte tells you how far into the sysex message you are, the data_length tells you how many bytes data is
 typedef void (* midi_sysex_func_t)(MidiDevice * device, uint16_t start_byte, uint8_t data_length, uint8_t *data);
 
+//a whole sysex message, from SYSEX_BEGIN to SYSEX_END inclusive
+typedef void (* midi_sysex_message_func_t)(MidiDevice * device, uint16_t length, uint8_t *data);
+
 #ifdef __cplusplus
 }
 #endif 
@@ -0,0 +1,62 @@
+#include "midi_queue.h"
+#include <string.h>
+
+/*
+ * A single producer, single consumer ring. Only midi_queue_send() moves
+ * head and only midi_queue_flush() moves tail, each publishes its index
+ * after touching the data, so neither needs interrupts off.
+ */
+static uint8_t queue[MIDI_QUEUE_SIZE][MIDI_QUEUE_PACKET_SIZE];
+static uint8_t head = 0;
+static uint8_t tail = 0;
+static uint16_t dropped = 0;
+
+_Static_assert((MIDI_QUEUE_SIZE & (MIDI_QUEUE_SIZE - 1)) == 0, "MIDI_QUEUE_SIZE must be a power of two");
+_Static_assert(MIDI_QUEUE_SIZE <= 128, "head and tail are bytes");
+
+bool midi_queue_send(const uint8_t *packet) {
+    uint8_t h = head;
+
+    if ((uint8_t)(h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) == MIDI_QUEUE_SIZE) {
+        if (dropped < UINT16_MAX) {
+            dropped++;
+        }
+        return false;
+    }
+    memcpy(queue[h & (MIDI_QUEUE_SIZE - 1)], packet, MIDI_QUEUE_PACKET_SIZE);
+    __atomic_store_n(&head, (uint8_t)(h + 1), __ATOMIC_RELEASE);
+    return true;
+}
+
+void midi_queue_flush(void) {
+    uint8_t batch[MIDI_QUEUE_BATCH][MIDI_QUEUE_PACKET_SIZE];
+    uint8_t t = tail;
+
+    for (;;) {
+        uint8_t count = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - t;
+        if (!count) {
+            break;
+        }
+        if (count > MIDI_QUEUE_BATCH) {
+            count = MIDI_QUEUE_BATCH;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            memcpy(batch[i], queue[(uint8_t)(t + i) & (MIDI_QUEUE_SIZE - 1)], MIDI_QUEUE_PACKET_SIZE);
+        }
+
+        uint8_t sent = midi_send_packets(&batch[0][0], count);
+        t += sent;
+        __atomic_store_n(&tail, t, __ATOMIC_RELEASE);
+        if (sent < count) {
+            break;
+        }
+    }
+}
+
+uint8_t midi_queue_pending(void) {
+    return (uint8_t)(__atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+}
+
+uint16_t midi_queue_dropped(void) {
+    return dropped;
+}
@@ -0,0 +1,42 @@
+#ifndef MIDI_QUEUE_H
+#define MIDI_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* USB-MIDI event packets waiting to be sent, a power of two up to 128 */
+#ifndef MIDI_QUEUE_SIZE
+#define MIDI_QUEUE_SIZE 32
+#endif
+
+/* Bytes of one USB-MIDI event packet: cable and code index, then 3 MIDI bytes */
+#define MIDI_QUEUE_PACKET_SIZE 4
+
+/* Event packets handed to the driver at once, one MIDI_STREAM_EPSIZE write */
+#ifndef MIDI_QUEUE_BATCH
+#define MIDI_QUEUE_BATCH 16
+#endif
+
+/*
+ * Queues an event packet, false if the queue is full and it was dropped.
+ * Never waits for the host.
+ *
+ * One context queues and one flushes, the queue needs no locking between
+ * the two.
+ */
+bool midi_queue_send(const uint8_t *packet);
+
+/* Hands the queued packets to the driver up to MIDI_QUEUE_BATCH at a time,
+ * until it is busy. Called from the main loop. */
+void midi_queue_flush(void);
+
+uint8_t midi_queue_pending(void);
+
+/* Packets dropped because the queue was full */
+uint16_t midi_queue_dropped(void);
+
+/* Implemented by the USB driver: writes up to count packets as one
+ * transfer, returns how many it took, 0 if the endpoint is busy. */
+uint8_t midi_send_packets(const uint8_t *packets, uint8_t count);
+
+#endif
@@ -2,6 +2,7 @@
 #include "qmk_midi.h"
 #include "sysex_tools.h"
 #include "midi.h"
+#include "midi_queue.h"
 #include "usb_descriptor.h"
 #include "process_midi.h"
 #if API_SYSEX_ENABLE
@@ -72,34 +73,14 @@ static void usb_send_func(MidiDevice * device, uint16_t cnt, uint8_t byte0, uint
     }
   }
 
-  send_midi_packet(&event);
+  // sent with the other events of this scan in one transfer
+  midi_queue_send((const uint8_t *)&event);
 }
 
 static void usb_get_midi(MidiDevice * device) {
   MIDI_EventPacket_t event;
   while (recv_midi_packet(&event)) {
-
-    midi_packet_length_t length = midi_packet_length(event.Data1);
-    uint8_t input[3];
-    input[0] = event.Data1;
-    input[1] = event.Data2;
-    input[2] = event.Data3;
-    if (length == UNDEFINED) {
-      //sysex
-      if (event.Event == MIDI_EVENT(0, SYSEX_START_OR_CONT) || event.Event == MIDI_EVENT(0, SYSEX_ENDS_IN_3)) {
-        length = 3;
-      } else if (event.Event == MIDI_EVENT(0, SYSEX_ENDS_IN_2)) {
-        length = 2;
-      } else if(event.Event ==  MIDI_EVENT(0, SYSEX_ENDS_IN_1)) {
-        length = 1;
-      } else {
-        //XXX what to do?
-      }
-    }
-
-    //pass the data to the device input function
-    if (length != UNDEFINED)
-      midi_device_input(device, length, input);
+    midi_device_input_packets(device, 1, (uint8_t *)&event);
   }
 }
 
@@ -133,36 +114,15 @@ static void cc_callback(MidiDevice * device,
 #ifdef API_SYSEX_ENABLE
 uint8_t midi_buffer[MIDI_SYSEX_BUFFER] = {0};
 
-static void sysex_callback(MidiDevice * device, uint16_t start, uint8_t length, uint8_t * data) {
-  // SEND_STRING("\n");
-  // send_word(start);
-  // SEND_STRING(": ");
-  // Don't store the header
-  int16_t pos = start - 4;
-  for (uint8_t place = 0; place < length; place++) {
-      // send_byte(*data);
-      if (pos >= 0) {
-          if (*data == 0xF7) {
-              // SEND_STRING("\nRD: ");
-              // for (uint8_t i = 0; i < start + place + 1; i++){
-              //     send_byte(midi_buffer[i]);
-              // SEND_STRING(" ");
-              // }
-              const unsigned decoded_length = sysex_decoded_length(pos);
-              uint8_t decoded[API_SYSEX_MAX_SIZE];
-              sysex_decode(decoded, midi_buffer, pos);
-              process_api(decoded_length, decoded);
-              return;
-          }
-          else if (pos >= MIDI_SYSEX_BUFFER) {
-              return;
-          }
-          midi_buffer[pos] = *data;
-      }
-      // SEND_STRING(" ");
-      data++;
-      pos++;
+// F0 00 00 00, the encoded message, F7
+static void sysex_message_callback(MidiDevice * device, uint16_t length, uint8_t * data) {
+  const uint8_t header = 4;
+  if (length < header + 1) {
+      return;
   }
+  // decoded in place, it is shorter than the encoded message
+  uint16_t decoded_length = sysex_decode(data + header, data + header, length - header - 1);
+  process_api(decoded_length, data + header);
 }
 #endif
 
@@ -179,6 +139,6 @@ void setup_midi(void)
   midi_register_fallthrough_callback(&midi_device, fallthrough_callback);
   midi_register_cc_callback(&midi_device, cc_callback);
 #ifdef API_SYSEX_ENABLE
-  midi_register_sysex_callback(&midi_device, sysex_callback);
+  midi_register_sysex_message_callback(&midi_device, sysex_message_callback, midi_buffer, sizeof(midi_buffer));
 #endif
 }
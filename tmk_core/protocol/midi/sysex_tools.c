@@ -34,66 +34,48 @@ uint16_t sysex_decoded_length(uint16_t encoded_length){
       return (encoded_length / 8) * 7;
 }
 
-uint16_t sysex_encode(uint8_t *encoded, const uint8_t *source, const uint16_t length){
-   uint16_t encoded_full = length / 7; //number of full 8 byte sections from 7 bytes of input
-   uint16_t i,j;
+//Each group of 7 bytes becomes a byte of their top bits, first byte in bit 6,
+//followed by the 7 bytes without them. The groups are walked with pointers and
+//the top bits moved one shift at a time, AVR has no barrel shifter.
 
-   //fill out the fully encoded sections
-   for(i = 0; i < encoded_full; i++) {
-      uint16_t encoded_msb_idx = i * 8;
-      uint16_t input_start_idx = i * 7;
-      encoded[encoded_msb_idx] = 0;
-      for(j = 0; j < 7; j++){
-         uint8_t current = source[input_start_idx + j];
-         encoded[encoded_msb_idx] |= (0x80 & current) >> (1 + j);
-         encoded[encoded_msb_idx + 1 + j] = 0x7F & current;
-      }
-   }
+uint16_t sysex_encode(uint8_t *encoded, const uint8_t *source, const uint16_t length){
+   uint8_t *start = encoded;
+   uint16_t left = length;
 
-   //fill out the rest if there is any more
-   uint8_t remainder = length % 7;
-   if (remainder) {
-      uint16_t encoded_msb_idx = encoded_full * 8;
-      uint16_t input_start_idx = encoded_full * 7;
-      encoded[encoded_msb_idx] = 0;
-      for(j = 0; j < remainder; j++){
-         uint8_t current = source[input_start_idx + j];
-         encoded[encoded_msb_idx] |= (0x80 & current) >> (1 + j);
-         encoded[encoded_msb_idx + 1 + j] = 0x7F & current;
-      }
-      return encoded_msb_idx + remainder + 1;
-   } else {
-      return encoded_full * 8;
+   while (left) {
+      uint8_t group = left < 7 ? left : 7;
+      uint8_t *msb = encoded++;
+      uint8_t bits = 0;
+      uint8_t bit = 0x40;
+      left -= group;
+      do {
+         uint8_t current = *source++;
+         if (current & 0x80)
+            bits |= bit;
+         bit >>= 1;
+         *encoded++ = current & 0x7F;
+      } while (--group);
+      *msb = bits;
    }
+   return encoded - start;
 }
 
 uint16_t sysex_decode(uint8_t *decoded, const uint8_t *source, const uint16_t length){
-   uint16_t decoded_full = length / 8;
-   uint16_t i,j;
+   uint8_t *start = decoded;
+   uint16_t left = length;
 
    if (length < 2)
       return 0;
 
-   //fill out the fully encoded sections
-   for(i = 0; i < decoded_full; i++) {
-      uint16_t encoded_msb_idx = i * 8;
-      uint16_t output_start_index = i * 7;
-      for(j = 0; j < 7; j++){
-         decoded[output_start_index + j] = 0x7F & source[encoded_msb_idx + j + 1];
-         decoded[output_start_index + j] |= (0x80 & (source[encoded_msb_idx] << (1 + j)));
-      }
-   }
-   uint8_t remainder = length % 8;
-   if (remainder) {
-      uint16_t encoded_msb_idx = decoded_full * 8;
-      uint16_t output_start_index = decoded_full * 7;
-      for(j = 0; j < (remainder - 1); j++) {
-         decoded[output_start_index + j] = 0x7F & source[encoded_msb_idx + j + 1];
-         decoded[output_start_index + j] |= (0x80 & (source[encoded_msb_idx] << (1 + j)));
-      }
-      return decoded_full * 7 + remainder - 1;
-   } else {
-      return decoded_full * 7;
+   //a trailing msb byte on its own decodes to nothing
+   while (left > 1) {
+      uint8_t group = left < 8 ? left - 1 : 7;
+      uint8_t msb = *source++;
+      left -= group + 1;
+      do {
+         msb <<= 1;
+         *decoded++ = (*source++ & 0x7F) | (msb & 0x80);
+      } while (--group);
    }
+   return decoded - start;
 }
-
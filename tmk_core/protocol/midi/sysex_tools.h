@@ -79,6 +79,7 @@ uint16_t sysex_encode(uint8_t *encoded, const uint8_t *source, uint16_t length);
  * @brief Decode encoded data.
  *
  * @param decoded The output data buffer, must be at least sysex_decoded_length(length) bytes long.
+ * It may be the input buffer, the data is then decoded in place.
  * @param source The input buffer of data to be decoded.
  * @param length The number of bytes from the input buffer to decode.
  * 
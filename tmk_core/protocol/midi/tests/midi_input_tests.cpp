@@ -0,0 +1,371 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+extern "C" {
+#include "midi.h"
+#include "sysex_tools.h"
+}
+
+typedef std::vector<uint8_t> bytes;
+
+// What the callbacks saw, one line per call
+static std::vector<std::string> calls;
+static bytes message;
+static int messages;
+
+static void record(const char *format, int a, int b, int c) {
+    char line[64];
+    snprintf(line, sizeof(line), format, a, b, c);
+    calls.push_back(line);
+}
+
+static void noteon(MidiDevice *device, uint8_t chan, uint8_t note, uint8_t vel) { record("noteon %d %d %d", chan, note, vel); }
+static void cc(MidiDevice *device, uint8_t chan, uint8_t num, uint8_t val) { record("cc %d %d %d", chan, num, val); }
+static void progchange(MidiDevice *device, uint8_t chan, uint8_t num) { record("progchange %d %d %d", chan, num, 0); }
+static void songposition(MidiDevice *device, uint8_t status, uint8_t lsb, uint8_t msb) { record("songposition %d %d %d", status, lsb, msb); }
+static void realtime(MidiDevice *device, uint8_t byte) { record("realtime %d %d %d", byte, 0, 0); }
+static void fallthrough(MidiDevice *device, uint16_t cnt, uint8_t byte0, uint8_t byte1, uint8_t byte2) { record("fallthrough %d %d", cnt, byte0, 0); }
+
+static void sysex(MidiDevice *device, uint16_t start, uint8_t length, uint8_t *data) {
+    record("sysex %d %d %d", start, length, data[0]);
+    for (uint8_t i = 1; i < length; i++) {
+        record("  %d %d %d", data[i], 0, 0);
+    }
+}
+
+static void sysex_message(MidiDevice *device, uint16_t length, uint8_t *data) {
+    message.assign(data, data + length);
+    messages++;
+}
+
+// The sysex_tools code before it worked a group at a time
+static uint16_t reference_encode(uint8_t *encoded, const uint8_t *source, uint16_t length) {
+    uint16_t full = length / 7;
+    for (uint16_t i = 0; i < full; i++) {
+        encoded[i * 8] = 0;
+        for (uint16_t j = 0; j < 7; j++) {
+            uint8_t current = source[i * 7 + j];
+            encoded[i * 8] |= (0x80 & current) >> (1 + j);
+            encoded[i * 8 + 1 + j] = 0x7F & current;
+        }
+    }
+    uint8_t remainder = length % 7;
+    if (!remainder) {
+        return full * 8;
+    }
+    encoded[full * 8] = 0;
+    for (uint16_t j = 0; j < remainder; j++) {
+        uint8_t current = source[full * 7 + j];
+        encoded[full * 8] |= (0x80 & current) >> (1 + j);
+        encoded[full * 8 + 1 + j] = 0x7F & current;
+    }
+    return full * 8 + remainder + 1;
+}
+
+static uint16_t reference_decode(uint8_t *decoded, const uint8_t *source, uint16_t length) {
+    uint16_t full = length / 8;
+    if (length < 2) {
+        return 0;
+    }
+    for (uint16_t i = 0; i < full; i++) {
+        for (uint16_t j = 0; j < 7; j++) {
+            decoded[i * 7 + j] = (0x7F & source[i * 8 + j + 1]) | (0x80 & (source[i * 8] << (1 + j)));
+        }
+    }
+    uint8_t remainder = length % 8;
+    if (!remainder) {
+        return full * 7;
+    }
+    for (uint16_t j = 0; j < remainder - 1; j++) {
+        decoded[full * 7 + j] = (0x7F & source[full * 8 + j + 1]) | (0x80 & (source[full * 8] << (1 + j)));
+    }
+    return full * 7 + remainder - 1;
+}
+
+static bytes random_bytes(size_t length, uint8_t mask) {
+    bytes data(length);
+    for (size_t i = 0; i < length; i++) {
+        data[i] = rand() & mask;
+    }
+    return data;
+}
+
+// A sysex message with a payload of 7 bit bytes
+static bytes sysex_of(const bytes &payload) {
+    bytes data(1, SYSEX_BEGIN);
+    data.insert(data.end(), payload.begin(), payload.end());
+    data.push_back(SYSEX_END);
+    return data;
+}
+
+// USB-MIDI event packets for a sysex message, 3 bytes to a packet
+static bytes sysex_packets(const bytes &data) {
+    bytes packets;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        size_t left = data.size() - i;
+        uint8_t packet[4] = {0x04, 0, 0, 0};
+        if (left <= 3) {
+            packet[0] = 0x04 + left;
+        }
+        for (size_t j = 0; j < 3 && j < left; j++) {
+            packet[1 + j] = data[i + j];
+        }
+        packets.insert(packets.end(), packet, packet + 4);
+    }
+    return packets;
+}
+
+// A packet for a channel or system message, its code index from the status
+static bytes message_packet(uint8_t status, uint8_t data1, uint8_t data2) {
+    uint8_t cin = status < 0xF0 ? status >> 4 : 0;
+    switch (status) {
+        case MIDI_SONGPOSITION:
+            cin = 0x3;
+            break;
+        case MIDI_SONGSELECT:
+        case MIDI_TC_QUARTERFRAME:
+            cin = 0x2;
+            break;
+        case MIDI_TUNEREQUEST:
+            cin = 0x5;
+            break;
+        default:
+            if (status >= 0xF8) {
+                cin = 0xF;
+            }
+            break;
+    }
+    uint8_t packet[4] = {cin, status, data1, data2};
+    return bytes(packet, packet + 4);
+}
+
+static uint8_t buffer[4096];
+
+class MidiInput : public ::testing::Test {
+   public:
+    MidiInput() {
+        midi_device_init(&device);
+        midi_register_noteon_callback(&device, noteon);
+        midi_register_cc_callback(&device, cc);
+        midi_register_progchange_callback(&device, progchange);
+        midi_register_songposition_callback(&device, songposition);
+        midi_register_realtime_callback(&device, realtime);
+        midi_register_fallthrough_callback(&device, fallthrough);
+        midi_register_sysex_callback(&device, sysex);
+        midi_register_sysex_message_callback(&device, sysex_message, buffer, sizeof(buffer));
+        calls.clear();
+        message.clear();
+        messages = 0;
+    }
+
+    void input_packets(bytes packets) {
+        for (size_t i = 0; i < packets.size(); i += 4 * 16) {
+            size_t count = (packets.size() - i) / 4;
+            midi_device_input_packets(&device, count < 16 ? count : 16, &packets[i]);
+        }
+    }
+
+    // The same bytes through the byte parser
+    void input_bytes(bytes data) {
+        for (size_t i = 0; i < data.size(); i += 64) {
+            size_t count = data.size() - i;
+            midi_device_input(&device, count < 64 ? count : 64, &data[i]);
+            midi_device_process(&device);
+        }
+    }
+
+    MidiDevice device;
+};
+
+TEST_F(MidiInput, SysexEncodeMatchesTheReference) {
+    for (uint16_t length = 0; length < 300; length++) {
+        bytes data = random_bytes(length, 0xFF);
+        bytes encoded(sysex_encoded_length(length) + 8, 0xAA);
+        bytes expected(encoded);
+
+        EXPECT_EQ(sysex_encode(&encoded[0], data.data(), length), reference_encode(&expected[0], data.data(), length));
+        EXPECT_EQ(encoded, expected) << "length " << length;
+        for (uint16_t i = 0; i < sysex_encoded_length(length); i++) {
+            EXPECT_EQ(encoded[i] & 0x80, 0);
+        }
+    }
+}
+
+TEST_F(MidiInput, SysexDecodeMatchesTheReference) {
+    for (uint16_t length = 0; length < 300; length++) {
+        bytes data = random_bytes(length, 0x7F);
+        bytes decoded(length + 8, 0xAA);
+        bytes expected(decoded);
+
+        uint16_t decoded_length = sysex_decode(&decoded[0], data.data(), length);
+        EXPECT_EQ(decoded_length, reference_decode(&expected[0], data.data(), length));
+        EXPECT_EQ(decoded_length, length ? sysex_decoded_length(length) : 0);
+        EXPECT_EQ(decoded, expected) << "length " << length;
+    }
+}
+
+TEST_F(MidiInput, SysexDecodesInPlace) {
+    for (uint16_t length = 1; length < 2000; length += 37) {
+        bytes data = random_bytes(length, 0xFF);
+        bytes encoded(sysex_encoded_length(length));
+
+        sysex_encode(&encoded[0], data.data(), length);
+        EXPECT_EQ(sysex_decode(&encoded[0], &encoded[0], encoded.size()), length);
+        EXPECT_EQ(bytes(encoded.begin(), encoded.begin() + length), data);
+    }
+}
+
+TEST_F(MidiInput, MessagesMatchTheByteParser) {
+    bytes packets, data;
+    const uint8_t messages[][3] = {
+        {MIDI_NOTEON | 2, 60, 100}, {MIDI_CC | 15, 7, 127}, {MIDI_PROGCHANGE | 3, 12, 0},
+        {MIDI_CHANPRESSURE, 40, 0}, {MIDI_PITCHBEND | 1, 0, 64}, {MIDI_NOTEOFF, 60, 0},
+        {MIDI_SONGPOSITION, 1, 2},  {MIDI_SONGSELECT, 5, 0},     {MIDI_TUNEREQUEST, 0, 0},
+        {MIDI_CLOCK, 0, 0},         {MIDI_START, 0, 0},
+    };
+    for (size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); i++) {
+        const uint8_t *m = messages[i];
+        bytes packet = message_packet(m[0], m[1], m[2]);
+        packets.insert(packets.end(), packet.begin(), packet.end());
+        data.insert(data.end(), m, m + midi_packet_length(m[0]));
+    }
+
+    input_bytes(data);
+    std::vector<std::string> expected = calls;
+    calls.clear();
+    input_packets(packets);
+
+    EXPECT_EQ(calls, expected);
+    EXPECT_EQ(calls.size(), 11u);
+    EXPECT_EQ(calls[0], "noteon 2 60 100");
+}
+
+TEST_F(MidiInput, LargeSysexIsOneMessage) {
+    bytes data = sysex_of(random_bytes(3000, 0x7F));
+
+    input_bytes(data);
+    std::vector<std::string> expected = calls;
+    EXPECT_EQ(messages, 0);
+    calls.clear();
+    input_packets(sysex_packets(data));
+
+    // the chunks are the same, and the whole message comes once
+    EXPECT_EQ(calls, expected);
+    EXPECT_EQ(messages, 1);
+    EXPECT_EQ(message, data);
+}
+
+TEST_F(MidiInput, EveryEndingLength) {
+    for (size_t length = 0; length < 6; length++) {
+        bytes data = sysex_of(random_bytes(length, 0x7F));
+        messages = 0;
+        input_packets(sysex_packets(data));
+        EXPECT_EQ(messages, 1) << "length " << length;
+        EXPECT_EQ(message, data) << "length " << length;
+    }
+}
+
+TEST_F(MidiInput, RealtimeInsideSysexKeepsTheMessage) {
+    bytes data = sysex_of(random_bytes(100, 0x7F));
+    bytes packets = sysex_packets(data);
+    bytes clock = message_packet(MIDI_CLOCK, 0, 0);
+
+    packets.insert(packets.begin() + 4 * 10, clock.begin(), clock.end());
+    input_packets(packets);
+
+    EXPECT_EQ(messages, 1);
+    EXPECT_EQ(message, data);
+    EXPECT_NE(std::find(calls.begin(), calls.end(), "realtime 248 0 0"), calls.end());
+}
+
+TEST_F(MidiInput, OtherMessageEndsTheSysex) {
+    bytes packets = sysex_packets(sysex_of(random_bytes(100, 0x7F)));
+    bytes note = message_packet(MIDI_NOTEON, 60, 1);
+
+    packets.insert(packets.begin() + 4 * 10, note.begin(), note.end());
+    input_packets(packets);
+
+    // the rest of the message has no start and is ignored
+    EXPECT_EQ(messages, 0);
+    EXPECT_EQ(calls[calls.size() - 1], "noteon 0 60 1");
+}
+
+TEST_F(MidiInput, TooLongSysexIsDroppedAndTheNextArrives) {
+    bytes data = sysex_of(random_bytes(100, 0x7F));
+
+    input_packets(sysex_packets(sysex_of(random_bytes(sizeof(buffer), 0x7F))));
+    EXPECT_EQ(messages, 0);
+
+    input_packets(sysex_packets(data));
+    EXPECT_EQ(messages, 1);
+    EXPECT_EQ(message, data);
+}
+
+TEST_F(MidiInput, MessageFillingTheBufferFits) {
+    bytes data = sysex_of(random_bytes(sizeof(buffer) - 2, 0x7F));
+
+    input_packets(sysex_packets(data));
+    EXPECT_EQ(messages, 1);
+    EXPECT_EQ(message, data);
+}
+
+TEST_F(MidiInput, SysexThroughput) {
+    bytes payload = random_bytes(3500, 0xFF);
+    bytes encoded(sysex_encoded_length(payload.size()));
+    sysex_encode(&encoded[0], payload.data(), payload.size());
+    bytes data = sysex_of(encoded);
+    bytes packets = sysex_packets(data);
+    bytes decoded(payload.size());
+    const int rounds = 200;
+
+    // no per chunk callbacks, only the whole message
+    midi_register_sysex_callback(&device, NULL);
+    midi_register_fallthrough_callback(&device, NULL);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        input_bytes(data);
+    }
+    auto bytes_done = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        input_packets(packets);
+        sysex_decode(&decoded[0], message.data() + 1, message.size() - 2);
+    }
+    auto packets_done = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        reference_decode(&decoded[0], encoded.data(), encoded.size());
+    }
+    auto reference_done = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sysex_decode(&decoded[0], encoded.data(), encoded.size());
+    }
+    auto decode_done = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(messages, rounds);
+    EXPECT_EQ(decoded, payload);
+
+    double mb = rounds * data.size() / 1e6;
+    std::cout << "[          ] byte input " << mb / std::chrono::duration<double>(bytes_done - start).count() << " MB/s, "
+              << "packet input and decode " << mb / std::chrono::duration<double>(packets_done - bytes_done).count() << " MB/s" << std::endl;
+    std::cout << "[          ] decode " << mb / std::chrono::duration<double>(decode_done - reference_done).count() << " MB/s, "
+              << "before " << mb / std::chrono::duration<double>(reference_done - packets_done).count() << " MB/s" << std::endl;
+}
@@ -0,0 +1,246 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+extern "C" {
+#include "midi_queue.h"
+#include "bytequeue.h"
+}
+
+/*
+ * The endpoint: takes up to room packets per write, or nothing while busy,
+ * and keeps every write it was given.
+ */
+static bool busy;
+static uint8_t room;
+static std::vector<std::vector<uint32_t> > writes;
+
+extern "C" uint8_t midi_send_packets(const uint8_t *packets, uint8_t count) {
+    if (busy) {
+        return 0;
+    }
+    if (count > room) {
+        count = room;
+    }
+    std::vector<uint32_t> write;
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t *p = packets + i * MIDI_QUEUE_PACKET_SIZE;
+        write.push_back(p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+    }
+    writes.push_back(write);
+    return count;
+}
+
+// A note on packet, its number goes in the note byte and the velocity
+static bool send_note(uint32_t n) {
+    uint8_t packet[MIDI_QUEUE_PACKET_SIZE] = {0x09, 0x90, (uint8_t)(n & 0x7F), (uint8_t)((n >> 7) & 0x7F)};
+    return midi_queue_send(packet);
+}
+
+static uint32_t note(uint32_t n) {
+    return 0x09 | 0x90 << 8 | (n & 0x7F) << 16 | ((n >> 7) & 0x7F) << 24;
+}
+
+static std::vector<uint32_t> all_written() {
+    std::vector<uint32_t> all;
+    for (size_t i = 0; i < writes.size(); i++) {
+        all.insert(all.end(), writes[i].begin(), writes[i].end());
+    }
+    return all;
+}
+
+class MidiQueue : public ::testing::Test {
+   public:
+    MidiQueue() {
+        busy = false;
+        room = MIDI_QUEUE_BATCH;
+        midi_queue_flush();
+        writes.clear();
+    }
+};
+
+TEST_F(MidiQueue, ChordIsOneWrite) {
+    for (uint32_t n = 0; n < 4; n++) {
+        EXPECT_TRUE(send_note(60 + n));
+    }
+    EXPECT_EQ(midi_queue_pending(), 4);
+    EXPECT_TRUE(writes.empty());
+
+    midi_queue_flush();
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0], std::vector<uint32_t>({note(60), note(61), note(62), note(63)}));
+    EXPECT_EQ(midi_queue_pending(), 0);
+}
+
+TEST_F(MidiQueue, WritesAreAtMostABatch) {
+    for (uint32_t n = 0; n < MIDI_QUEUE_BATCH + 3; n++) {
+        send_note(n);
+    }
+    midi_queue_flush();
+    ASSERT_EQ(writes.size(), 2u);
+    EXPECT_EQ(writes[0].size(), (size_t)MIDI_QUEUE_BATCH);
+    EXPECT_EQ(writes[1].size(), 3u);
+}
+
+TEST_F(MidiQueue, FlushingNothingWritesNothing) {
+    midi_queue_flush();
+    EXPECT_TRUE(writes.empty());
+}
+
+TEST_F(MidiQueue, BusyEndpointKeepsTheOrder) {
+    busy = true;
+    for (uint32_t n = 0; n < 10; n++) {
+        send_note(n);
+    }
+    midi_queue_flush();
+    EXPECT_TRUE(writes.empty());
+    EXPECT_EQ(midi_queue_pending(), 10);
+
+    // a partial write leaves the rest for the next flush
+    busy = false;
+    room = 3;
+    midi_queue_flush();
+    EXPECT_EQ(writes.size(), 1u);
+    EXPECT_EQ(midi_queue_pending(), 7);
+
+    room = MIDI_QUEUE_BATCH;
+    send_note(10);
+    midi_queue_flush();
+    std::vector<uint32_t> expected;
+    for (uint32_t n = 0; n < 11; n++) {
+        expected.push_back(note(n));
+    }
+    EXPECT_EQ(all_written(), expected);
+}
+
+TEST_F(MidiQueue, FullQueueDropsAndCounts) {
+    uint16_t dropped = midi_queue_dropped();
+
+    busy = true;
+    for (uint32_t n = 0; n < MIDI_QUEUE_SIZE; n++) {
+        EXPECT_TRUE(send_note(n));
+    }
+    EXPECT_FALSE(send_note(100));
+    EXPECT_FALSE(send_note(101));
+    EXPECT_EQ(midi_queue_dropped(), dropped + 2);
+
+    // the queued packets are still sent, the dropped ones never are
+    busy = false;
+    midi_queue_flush();
+    std::vector<uint32_t> expected;
+    for (uint32_t n = 0; n < MIDI_QUEUE_SIZE; n++) {
+        expected.push_back(note(n));
+    }
+    EXPECT_EQ(all_written(), expected);
+}
+
+TEST_F(MidiQueue, WrapsAround) {
+    std::vector<uint32_t> expected;
+
+    // head and tail wrap at 256, a few times over
+    for (uint32_t n = 0; n < 1000; n++) {
+        send_note(n);
+        expected.push_back(note(n));
+        if (n % 7 == 0) {
+            midi_queue_flush();
+        }
+    }
+    midi_queue_flush();
+    EXPECT_EQ(all_written(), expected);
+}
+
+TEST_F(MidiQueue, Throughput) {
+    const uint32_t events = 1000000;
+    uint32_t sent = 0;
+
+    room = MIDI_QUEUE_BATCH;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < events; n++) {
+        send_note(n);
+        if (n % 8 == 7) {
+            midi_queue_flush();
+            sent += writes.back().size();
+            writes.clear();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(sent, events);
+    std::cout << "[          ] " << (uint32_t)(events / seconds) << " events/s, 8 per flush" << std::endl;
+}
+
+TEST_F(MidiQueue, ProducerAndConsumerOnTwoThreads) {
+    const uint32_t events = 20000;
+    std::vector<uint32_t> expected;
+    std::vector<uint32_t> received;
+
+    // one thread queues like the USB callback, this one flushes like the
+    // main loop, nothing may be lost, duplicated or reordered
+    room = 5;
+    std::thread producer([&]() {
+        for (uint32_t n = 0; n < events; n++) {
+            while (!send_note(n)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    while (received.size() < events) {
+        midi_queue_flush();
+        for (size_t i = 0; i < writes.size(); i++) {
+            received.insert(received.end(), writes[i].begin(), writes[i].end());
+        }
+        writes.clear();
+        std::this_thread::yield();
+    }
+    producer.join();
+
+    for (uint32_t n = 0; n < events; n++) {
+        expected.push_back(note(n));
+    }
+    EXPECT_EQ(received, expected);
+}
+
+TEST(ByteQueue, ProducerAndConsumerOnTwoThreads) {
+    const uint32_t bytes = 20000;
+    uint8_t data[64];
+    byteQueue_t queue;
+    uint32_t received = 0;
+    bool ordered = true;
+
+    bytequeue_init(&queue, data, sizeof(data));
+    std::thread producer([&]() {
+        for (uint32_t n = 0; n < bytes; n++) {
+            while (!bytequeue_enqueue(&queue, (uint8_t)n)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    while (received < bytes) {
+        byteQueueIndex_t length = bytequeue_length(&queue);
+        for (byteQueueIndex_t i = 0; i < length; i++) {
+            ordered &= bytequeue_get(&queue, i) == (uint8_t)(received + i);
+        }
+        bytequeue_remove(&queue, length);
+        received += length;
+        std::this_thread::yield();
+    }
+    producer.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(bytequeue_length(&queue), 0);
+}
@@ -0,0 +1,18 @@
+midi_queue_SRC := \
+	$(TMK_PATH)/protocol/midi/tests/midi_queue_tests.cpp \
+	$(TMK_PATH)/protocol/midi/midi_queue.c \
+	$(TMK_PATH)/protocol/midi/bytequeue/bytequeue.c
+
+midi_queue_INC := \
+	$(TMK_PATH)/protocol/midi \
+	$(TMK_PATH)/protocol/midi/bytequeue
+
+midi_input_SRC := \
+	$(TMK_PATH)/protocol/midi/tests/midi_input_tests.cpp \
+	$(TMK_PATH)/protocol/midi/midi.c \
+	$(TMK_PATH)/protocol/midi/midi_device.c \
+	$(TMK_PATH)/protocol/midi/sysex_tools.c \
+	$(TMK_PATH)/protocol/midi/bytequeue/bytequeue.c
+
+midi_input_INC := \
+	$(TMK_PATH)/protocol/midi
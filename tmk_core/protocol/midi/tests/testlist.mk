@@ -0,0 +1,3 @@
+TEST_LIST +=\
+	midi_queue\
+	midi_input
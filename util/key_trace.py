@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+"""Prints the key events of a keyboard built with KEY_TRACE_ENABLE.
+
+    util/key_trace.py                           over raw HID, needs RAW_API_ENABLE
+    hid_listen | util/key_trace.py --console    the KT lines of KEY_TRACE_CONSOLE
+
+Each line has the time since the previous event, the key, the keycode and
+how long the event waited before it was processed. See the key trace section
+of docs/feature_raw_api.md for the format.
+"""
+
+import argparse
+import sys
+
+import raw_api
+
+EVENT_SIZE = 10
+
+
+def decode(data):
+    return {
+        'sequence': data[0],
+        'time': raw_api.be(data, 1, 2),
+        'delay': data[3],
+        'row': data[4],
+        'col': data[5],
+        'pressed': bool(data[6] & 0x80),
+        'interrupted': bool(data[6] & 0x40),
+        'layer': data[6] & 0x1F,
+        'keycode': raw_api.be(data, 7, 2),
+        'tap_count': data[9],
+    }
+
+
+def hid_events(keyboard):
+    for packet in iter(lambda: keyboard.receive(timeout=None), None):
+        if packet[0] != raw_api.TRACE:
+            continue
+        for i in range(packet[1]):
+            yield decode(packet[2 + i * EVENT_SIZE:2 + (i + 1) * EVENT_SIZE])
+
+
+def console_events(lines):
+    for line in lines:
+        line = line.strip()
+        if line.startswith('KT') and len(line) == 2 + EVENT_SIZE * 2:
+            try:
+                yield decode(bytes.fromhex(line[2:]))
+            except ValueError:
+                pass
+
+
+class Printer(object):
+    def __init__(self):
+        self.last = None
+        self.delays = []
+        self.dropped = 0
+
+    def print(self, event):
+        if self.last is None:
+            since = 0
+        else:
+            since = (event['time'] - self.last['time']) & 0xFFFF
+            gap = (event['sequence'] - self.last['sequence'] - 1) & 0xFF
+            if gap:
+                self.dropped += gap
+                print('  ... %d events dropped' % gap)
+        self.last = event
+        self.delays.append(event['delay'])
+
+        flags = ''
+        if event['tap_count']:
+            flags += ' tap %d' % event['tap_count']
+        if event['interrupted']:
+            flags += ' interrupted'
+        print('%+6d ms  %s  %2d,%-2d  layer %-2d 0x%04X  delay %3d%s%s' % (
+            since, 'down' if event['pressed'] else 'up  ', event['row'], event['col'], event['layer'],
+            event['keycode'], event['delay'], '+' if event['delay'] == 255 else '', flags))
+
+    def summary(self):
+        if not self.delays:
+            return
+        delays = sorted(self.delays)
+        print('%d events, %d dropped, delay median %d ms, max %d ms' % (
+            len(delays), self.dropped, delays[len(delays) // 2], delays[-1]), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--device', help='hidraw device, the first raw HID interface by default')
+    parser.add_argument('--console', action='store_true', help='read KT lines from stdin')
+    args = parser.parse_args()
+    printer = Printer()
+
+    if args.console:
+        try:
+            for event in console_events(sys.stdin):
+                printer.print(event)
+        except KeyboardInterrupt:
+            pass
+        printer.summary()
+        return 0
+
+    path = args.device or raw_api.find_device()
+    if not path:
+        print('No raw HID keyboard found, is RAW_ENABLE on and can you read /dev/hidraw*?', file=sys.stderr)
+        return 1
+    keyboard = raw_api.Keyboard(path)
+
+    try:
+        keyboard.telemetry(0, raw_api.STREAMS['trace'])
+        try:
+            for event in hid_events(keyboard):
+                printer.print(event)
+        except KeyboardInterrupt:
+            keyboard.telemetry(0, 0)
+    except raw_api.ApiError as e:
+        print(e, file=sys.stderr)
+        return 1
+    finally:
+        keyboard.close()
+    printer.summary()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
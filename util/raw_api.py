@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Talks to a keyboard built with RAW_API_ENABLE over Linux hidraw.
+
+    util/raw_api.py info
+    util/raw_api.py get layer_state default_layer scan_rate
+    util/raw_api.py set default_layer=2 keymap_config=0x80
+    util/raw_api.py telemetry --interval 100 matrix layers scan_rate
+
+See docs/feature_raw_api.md for the protocol.
+"""
+
+import argparse
+import glob
+import os
+import select
+import sys
+
+PACKET_SIZE = 32
+
+GET_INFO = 0x10
+GET = 0x11
+SET = 0x12
+TELEMETRY = 0x13
+REPORT = 0x14
+TRACE = 0x15
+ERROR = 0xFF
+
+ERRORS = {0x01: 'unknown field', 0x02: 'read only', 0x03: 'does not fit in a packet'}
+
+# name: (id, size)
+FIELDS = {
+    'default_layer': (0x01, 4),
+    'layer_state': (0x02, 4),
+    'keymap_config': (0x03, 1),
+    'debug_config': (0x04, 1),
+    'backlight': (0x05, 1),
+    'rgblight': (0x06, 4),
+    'uptime': (0x07, 4),
+    'scan_rate': (0x08, 2),
+}
+FIELD_NAMES = {id: name for name, (id, size) in FIELDS.items()}
+
+STREAMS = {'matrix': 1 << 0, 'layers': 1 << 1, 'scan_rate': 1 << 2, 'trace': 1 << 3}
+
+# Usage page 0xFF60, usage 0x61 at the start of the raw HID report descriptor
+RAW_DESCRIPTOR = bytes([0x06, 0x60, 0xFF, 0x09, 0x61])
+
+
+class ApiError(Exception):
+    pass
+
+
+def find_device():
+    """Returns the first /dev/hidraw* that is a raw HID interface."""
+    for path in sorted(glob.glob('/sys/class/hidraw/hidraw*')):
+        try:
+            with open(os.path.join(path, 'device', 'report_descriptor'), 'rb') as f:
+                if f.read().startswith(RAW_DESCRIPTOR):
+                    return os.path.join('/dev', os.path.basename(path))
+        except IOError:
+            pass
+    return None
+
+
+def be(data, offset, size):
+    value = 0
+    for byte in data[offset:offset + size]:
+        value = (value << 8) | byte
+    return value
+
+
+class Keyboard(object):
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR)
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, payload):
+        packet = bytearray(PACKET_SIZE)
+        packet[:len(payload)] = payload
+        # report ID 0, the raw HID interface has no report IDs
+        os.write(self.fd, bytes([0]) + bytes(packet))
+
+    def receive(self, timeout=1.0):
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return None
+        data = os.read(self.fd, PACKET_SIZE)
+        if len(data) < PACKET_SIZE:
+            raise ApiError('short read from the device')
+        return bytearray(data)
+
+    def command(self, payload):
+        """Sends a command and returns its reply, skipping telemetry and traces."""
+        self.send(payload)
+        while True:
+            reply = self.receive()
+            if reply is None:
+                raise ApiError('no reply')
+            if reply[0] in (REPORT, TRACE):
+                continue
+            if reply[0] == ERROR:
+                raise ApiError('command 0x%02X failed: %s' % (reply[1], ERRORS.get(reply[2], 'unknown command')))
+            return reply
+
+    def info(self):
+        r = self.command([GET_INFO])
+        return {'version': r[1], 'packet_size': r[2], 'rows': r[3], 'cols': r[4], 'row_bytes': r[5]}
+
+    def get(self, names):
+        r = self.command([GET, len(names)] + [FIELDS[name][0] for name in names])
+        values = {}
+        offset = 2
+        for _ in range(r[1]):
+            name = FIELD_NAMES[r[offset]]
+            size = FIELDS[name][1]
+            values[name] = be(r, offset + 1, size)
+            offset += 1 + size
+        return values
+
+    def set(self, values):
+        payload = [SET, len(values)]
+        for name, value in values.items():
+            id, size = FIELDS[name]
+            payload += [id] + list(value.to_bytes(size, 'big'))
+        self.command(payload)
+
+    def telemetry(self, interval, streams):
+        self.command([TELEMETRY, interval >> 8, interval & 0xFF, streams])
+
+    def reports(self, info):
+        """Yields the telemetry reports as dicts."""
+        while True:
+            r = self.receive(timeout=None)
+            if r[0] != REPORT:
+                continue
+            report = {'sequence': r[1]}
+            offset = 3
+            if r[2] & STREAMS['matrix']:
+                size = info['row_bytes']
+                report['matrix'] = [be(r, offset + row * size, size) for row in range(info['rows'])]
+                offset += info['rows'] * size
+            if r[2] & STREAMS['layers']:
+                report['layer_state'] = be(r, offset, 4)
+                report['default_layer'] = be(r, offset + 4, 4)
+                offset += 8
+            if r[2] & STREAMS['scan_rate']:
+                report['scan_rate'] = be(r, offset, 2)
+            yield report
+
+
+def print_report(report, info):
+    line = '%3d' % report['sequence']
+    if 'matrix' in report:
+        rows = ['{:0{}b}'.format(row, info['cols'])[::-1] for row in report['matrix']]
+        line += '  matrix ' + ' '.join(rows)
+    if 'layer_state' in report:
+        line += '  layers 0x%08X default 0x%08X' % (report['layer_state'], report['default_layer'])
+    if 'scan_rate' in report:
+        line += '  %d scans/s' % report['scan_rate']
+    print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--device', help='hidraw device, the first raw HID interface by default')
+    commands = parser.add_subparsers(dest='command')
+    commands.add_parser('info')
+    get = commands.add_parser('get')
+    get.add_argument('fields', nargs='+', choices=sorted(FIELDS))
+    set_ = commands.add_parser('set')
+    set_.add_argument('values', nargs='+', metavar='field=value')
+    telemetry = commands.add_parser('telemetry')
+    telemetry.add_argument('--interval', type=int, default=100, help='ms between reports')
+    telemetry.add_argument('streams', nargs='+', choices=sorted(set(STREAMS) - {'trace'}))
+    args = parser.parse_args()
+
+    if not args.command:
+        parser.print_help()
+        return 1
+
+    path = args.device or find_device()
+    if not path:
+        print('No raw HID keyboard found, is RAW_ENABLE on and can you read /dev/hidraw*?', file=sys.stderr)
+        return 1
+    keyboard = Keyboard(path)
+
+    try:
+        if args.command == 'info':
+            for key, value in sorted(keyboard.info().items()):
+                print('%s: %d' % (key, value))
+        elif args.command == 'get':
+            for name, value in sorted(keyboard.get(args.fields).items()):
+                print('%s: %d (0x%X)' % (name, value, value))
+        elif args.command == 'set':
+            values = {}
+            for item in args.values:
+                name, _, value = item.partition('=')
+                if name not in FIELDS:
+                    parser.error('unknown field %s' % name)
+                values[name] = int(value, 0)
+            keyboard.set(values)
+        elif args.command == 'telemetry':
+            info = keyboard.info()
+            streams = 0
+            for name in args.streams:
+                streams |= STREAMS[name]
+            keyboard.telemetry(args.interval, streams)
+            try:
+                for report in keyboard.reports(info):
+                    print_report(report, info)
+            except KeyboardInterrupt:
+                keyboard.telemetry(0, 0)
+    except ApiError as e:
+        print(e, file=sys.stderr)
+        return 1
+    finally:
+        keyboard.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+"""Compiles Plover JSON dictionaries into a C file for STENO_DICT_ENABLE.
+
+    util/steno_dict.py main.json user.json -o keyboards/.../keymaps/steno/steno_dict.c
+
+Later dictionaries override earlier ones. Only single stroke entries fit the
+on-keyboard lookup, and only translations made of text and the attach,
+capitalize and punctuation commands, the rest is skipped and counted. See
+docs/feature_stenography.md.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+ORDER = '#STKPWHRAO*EUFRPBLGTSDZ'
+FIRST_RIGHT_KEY = ORDER.index('F')
+MIDDLE_KEYS = 0x1F00
+
+# Number keys, typed with the number bar
+NUMBERS = {'1': 'S', '2': 'T', '3': 'P', '4': 'H', '5': 'A', '0': 'O', '6': 'F', '7': 'P', '8': 'L', '9': 'T'}
+
+# Flags of process_steno_dict.h
+ATTACH_BEFORE = 0x01
+ATTACH_AFTER = 0x02
+CAP_NEXT = 0x04
+UNDO = 0x08
+
+MAX_TEXT = 254
+
+
+class Unsupported(Exception):
+    pass
+
+
+def parse_stroke(outline):
+    """Returns the bits of one stroke like 'STKPW', '-G' or '1-9'."""
+    stroke = 0
+    position = 1
+    for char in outline:
+        if char == '#':
+            stroke |= 1
+            continue
+        if char in NUMBERS:
+            stroke |= 1
+            if char in '6789':
+                position = max(position, FIRST_RIGHT_KEY)
+            char = NUMBERS[char]
+        if char == '-':
+            if position > FIRST_RIGHT_KEY:
+                raise Unsupported('misplaced hyphen')
+            position = FIRST_RIGHT_KEY
+            continue
+        index = ORDER.find(char, position)
+        if index < 0:
+            raise Unsupported('not a stroke')
+        stroke |= 1 << index
+        position = index + 1
+    if stroke == 0:
+        raise Unsupported('empty stroke')
+    return stroke
+
+
+def outline(stroke):
+    """The stroke the way the keyboard types it when it is untranslated."""
+    text = ''
+    hyphen = not stroke & MIDDLE_KEYS
+    for index, key in enumerate(ORDER):
+        if stroke & (1 << index):
+            if hyphen and index >= FIRST_RIGHT_KEY:
+                text += '-'
+                hyphen = False
+            text += key
+    return text
+
+
+def parse_translation(translation):
+    """Returns (text, flags) of a translation."""
+    if translation == '=undo':
+        return '', UNDO
+
+    tokens = re.findall(r'\{[^{}]*\}|[^{}]+', translation)
+    if ''.join(tokens) != translation:
+        raise Unsupported('unbalanced braces')
+
+    text = ''
+    flags = 0
+    for i, token in enumerate(tokens):
+        first = i == 0
+        last = i == len(tokens) - 1
+        if not token.startswith('{'):
+            text += token
+            continue
+        command = token[1:-1]
+        if command in ('.', '?', '!'):
+            if not last:
+                raise Unsupported('capitalizing in the middle')
+            flags |= CAP_NEXT
+            command = '^' + command
+        elif command in (',', ':', ';'):
+            command = '^' + command
+        elif command == '-|':
+            if not last:
+                raise Unsupported('capitalizing in the middle')
+            flags |= CAP_NEXT
+            continue
+        elif command == '^':
+            if first:
+                flags |= ATTACH_BEFORE
+            if last:
+                flags |= ATTACH_AFTER
+            continue
+        before = command.startswith('^')
+        after = len(command) > 1 and command.endswith('^')
+        command = command[1 if before else 0:len(command) - 1 if after else len(command)]
+        if not before and not after or re.search(r'[{}^|&#=~<>]', command):
+            raise Unsupported('command')
+        if before and first:
+            flags |= ATTACH_BEFORE
+        if after and last:
+            flags |= ATTACH_AFTER
+        text += command
+
+    if any(ord(char) < 0x20 or ord(char) > 0x7E for char in text):
+        raise Unsupported('not printable ASCII')
+    if len(text) > MAX_TEXT:
+        raise Unsupported('too long')
+    return text, flags
+
+
+def compile_dictionaries(dictionaries):
+    entries = {}
+    skipped = {'multiple strokes': 0, 'unsupported': 0}
+    for dictionary in dictionaries:
+        for key, translation in dictionary.items():
+            if '/' in key:
+                skipped['multiple strokes'] += 1
+                continue
+            try:
+                entries[parse_stroke(key)] = parse_translation(translation)
+            except Unsupported:
+                skipped['unsupported'] += 1
+    return entries, skipped
+
+
+def c_string(text):
+    return '"%s\\0"' % text.replace('\\', '\\\\').replace('"', '\\"').replace('?', '\\?')
+
+
+def write_c(entries, sources, out):
+    offsets = {}
+    pool = []
+    size = 0
+    for stroke in sorted(entries):
+        text = entries[stroke][0]
+        if text not in offsets:
+            offsets[text] = size
+            pool.append(text)
+            size += len(text) + 1
+    if len(entries) > 0xFFFF or size > 0x10000:
+        raise Unsupported('the dictionary is too big, %d entries and %d bytes of text' % (len(entries), size))
+
+    out.write('/* Generated by util/steno_dict.py from %s, do not edit */\n' % ', '.join(sources))
+    out.write('#include "process_steno_dict.h"\n\n')
+    out.write('const uint16_t steno_dict_size = %d;\n\n' % len(entries))
+    out.write('const steno_dict_entry_t steno_dict[] PROGMEM = {\n')
+    for stroke in sorted(entries):
+        text, flags = entries[stroke]
+        out.write('  {0x%06X, %5d, 0x%02X},  // %s\n' % (stroke, offsets[text], flags, outline(stroke)))
+    if not entries:
+        out.write('  {0, 0, 0},\n')
+    out.write('};\n\n')
+    out.write('const char steno_dict_text[] PROGMEM =\n')
+    for text in pool:
+        out.write('  %s\n' % c_string(text))
+    if not pool:
+        out.write('  ""\n')
+    out.write(';\n')
+    return len(entries) * 7 + size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('dictionaries', nargs='+', help='Plover JSON dictionaries')
+    parser.add_argument('-o', '--output', default='-', help='C file to write, stdout by default')
+    args = parser.parse_args()
+
+    dictionaries = []
+    for path in args.dictionaries:
+        with open(path, encoding='utf-8') as f:
+            dictionaries.append(json.load(f))
+    entries, skipped = compile_dictionaries(dictionaries)
+
+    sources = [path.rsplit('/', 1)[-1] for path in args.dictionaries]
+    try:
+        if args.output == '-':
+            flash = write_c(entries, sources, sys.stdout)
+        else:
+            with open(args.output, 'w') as out:
+                flash = write_c(entries, sources, out)
+    except Unsupported as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    print('%d entries in %d bytes of flash, skipped %s' % (
+        len(entries), flash, ', '.join('%d with %s' % (n, why) for why, n in skipped.items())), file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())